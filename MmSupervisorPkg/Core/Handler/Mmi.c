@@ -16,9 +16,269 @@ MMI_ENTRY   mRootMmiEntry = {
   MMI_ENTRY_SIGNATURE,
   INITIALIZE_LIST_HEAD_VARIABLE (mRootMmiEntry.AllEntries),
   { 0 },
-  INITIALIZE_LIST_HEAD_VARIABLE (mRootMmiEntry.MmiHandlers),
+  INITIALIZE_LIST_HEAD_VARIABLE (mRootMmiEntry.SupvMmiHandlers),
+  INITIALIZE_LIST_HEAD_VARIABLE (mRootMmiEntry.UserMmiHandlers),
 };
 
+//
+// The entries of mMmiEntryList, hashed on their HandlerType
+//
+MMI_ENTRY_HASH  mMmiEntryHash;
+
+//
+// The user handlers of the last MMI entry dispatched on the user path, laid out for
+// the ring 3 batch dispatcher. The batch is read-only to user mode, the supervisor
+// keeps its own copy to know what was dispatched.
+//
+MM_USER_MMI_BATCH  *mUserMmiBatch      = NULL;
+MM_USER_MMI_BATCH  *mUserMmiBatchStage = NULL;
+MMI_ENTRY          *mUserMmiBatchEntry = NULL;
+BOOLEAN            mUserMmiBatchBusy   = FALSE;
+
+//
+// Nesting depth of MmiManage, and the number of handlers unregistered while it runs.
+// Those are only marked ToRemove and freed when the outermost MmiManage returns, a
+// handler may unregister itself or the handlers after it in the list being walked.
+//
+UINTN  mMmiManageCallingDepth = 0;
+UINTN  mMmiHandlersToRemove   = 0;
+
+/**
+  Allocate the user MMI batch, in pages that are read-only to user mode, and
+  the user writable page its handler statuses are returned in.
+
+  @retval EFI_SUCCESS           The batch is ready.
+  @retval EFI_ALREADY_STARTED   The batch was already allocated.
+  @retval EFI_OUT_OF_RESOURCES  Not enough memory for the batch.
+  @retval Others                The batch pages could not be made read-only.
+**/
+EFI_STATUS
+UserMmiBatchInit (
+  VOID
+  )
+{
+  EFI_STATUS            Status;
+  EFI_PHYSICAL_ADDRESS  BatchBase;
+  EFI_PHYSICAL_ADDRESS  StatusBase;
+  UINTN                 BatchPages;
+  UINTN                 StatusPages;
+
+  if (mUserMmiBatch != NULL) {
+    return EFI_ALREADY_STARTED;
+  }
+
+  BatchPages  = EFI_SIZE_TO_PAGES (sizeof (MM_USER_MMI_BATCH));
+  StatusPages = EFI_SIZE_TO_PAGES ((sizeof (UINTN) + sizeof (UINT64)) * MM_USER_MMI_BATCH_MAX_HANDLERS);
+
+  mUserMmiBatchStage = AllocateZeroPool (sizeof (MM_USER_MMI_BATCH));
+  if (mUserMmiBatchStage == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = MmAllocatePages (AllocateAnyPages, EfiRuntimeServicesData, BatchPages, &BatchBase);
+  if (EFI_ERROR (Status)) {
+    goto Cleanup;
+  }
+
+  Status = MmAllocatePages (AllocateAnyPages, EfiRuntimeServicesData, StatusPages, &StatusBase);
+  if (EFI_ERROR (Status)) {
+    MmFreePages (BatchBase, BatchPages);
+    goto Cleanup;
+  }
+
+  ZeroMem ((VOID *)(UINTN)BatchBase, EFI_PAGES_TO_SIZE (BatchPages));
+  ZeroMem ((VOID *)(UINTN)StatusBase, EFI_PAGES_TO_SIZE (StatusPages));
+  mUserMmiBatchStage->Statuses = (UINTN *)(UINTN)StatusBase;
+  mUserMmiBatchStage->Cycles   = (UINT64 *)(UINTN)(StatusBase + sizeof (UINTN) * MM_USER_MMI_BATCH_MAX_HANDLERS);
+  CopyMem ((VOID *)(UINTN)BatchBase, mUserMmiBatchStage, OFFSET_OF (MM_USER_MMI_BATCH, Handlers));
+
+  Status = SmmSetMemoryAttributes (BatchBase, EFI_PAGES_TO_SIZE (BatchPages), EFI_MEMORY_RO);
+  if (EFI_ERROR (Status)) {
+    MmFreePages (StatusBase, StatusPages);
+    MmFreePages (BatchBase, BatchPages);
+    goto Cleanup;
+  }
+
+  mUserMmiBatch = (MM_USER_MMI_BATCH *)(UINTN)BatchBase;
+  return EFI_SUCCESS;
+
+Cleanup:
+  FreePool (mUserMmiBatchStage);
+  mUserMmiBatchStage = NULL;
+  return Status;
+}
+
+/**
+  Lay out the user handlers of an MMI entry in the user MMI batch, unless the
+  batch already holds them.
+
+  @param  MmiEntry      The MMI entry to be dispatched on the user path.
+  @param  StopOnClaim   If the dispatch stops at the first handler that claims the MMI.
+
+  @retval TRUE    The batch holds at least 2 user handlers of MmiEntry.
+  @retval FALSE   The user handlers shall be demoted one at a time.
+**/
+STATIC
+BOOLEAN
+PrepareUserMmiBatch (
+  IN MMI_ENTRY  *MmiEntry,
+  IN BOOLEAN    StopOnClaim
+  )
+{
+  LIST_ENTRY   *Link;
+  MMI_HANDLER  *MmiHandler;
+  UINT32       Count;
+
+  if ((mUserMmiBatch == NULL) || ((VOID *)RegUserMmiBatchJumpPointer == NULL) || mUserMmiBatchBusy) {
+    return FALSE;
+  }
+
+  if (mUserMmiBatchEntry != MmiEntry) {
+    Count = 0;
+    for (Link = MmiEntry->UserMmiHandlers.ForwardLink; Link != &MmiEntry->UserMmiHandlers; Link = Link->ForwardLink) {
+      MmiHandler = CR (Link, MMI_HANDLER, Link, MMI_HANDLER_SIGNATURE);
+      if (MmiHandler->ToRemove) {
+        continue;
+      }
+
+      if (Count == MM_USER_MMI_BATCH_MAX_HANDLERS) {
+        // Too many handlers for one batch, keep demoting them one at a time
+        Count = 0;
+        break;
+      }
+
+      mUserMmiBatchStage->Handlers[Count].DispatchHandle = MmiHandler;
+      mUserMmiBatchStage->Handlers[Count].Handler        = (VOID *)MmiHandler->Handler;
+      Count++;
+    }
+
+    mUserMmiBatchStage->Count       = Count;
+    mUserMmiBatchStage->StopOnClaim = StopOnClaim;
+    CopyMemToReadOnlyPages (
+      mUserMmiBatch,
+      mUserMmiBatchStage,
+      OFFSET_OF (MM_USER_MMI_BATCH, Handlers) + Count * sizeof (MM_USER_MMI_DESCRIPTOR)
+      );
+    mUserMmiBatchEntry = MmiEntry;
+  }
+
+  // A single handler costs the same ring transitions either way
+  return (BOOLEAN)(mUserMmiBatchStage->Count >= 2);
+}
+
+/**
+  Account one call of an MMI handler in its statistics.
+
+  @param  MmiHandler    The MMI handler that was called.
+  @param  HandlerStatus The status returned by the handler.
+  @param  Cycles        The TSC cycles the call took.
+**/
+STATIC
+VOID
+RecordMmiHandlerStats (
+  IN OUT MMI_HANDLER  *MmiHandler,
+  IN     EFI_STATUS   HandlerStatus,
+  IN     UINT64       Cycles
+  )
+{
+  MMI_HANDLER_STATS  *Stats;
+  UINTN              Bucket;
+
+  switch (HandlerStatus) {
+    case EFI_SUCCESS:
+      Bucket = MMI_HANDLER_STATUS_SUCCESS;
+      break;
+    case EFI_WARN_INTERRUPT_SOURCE_QUIESCED:
+      Bucket = MMI_HANDLER_STATUS_QUIESCED;
+      break;
+    case EFI_WARN_INTERRUPT_SOURCE_PENDING:
+      Bucket = MMI_HANDLER_STATUS_SOURCE_PENDING;
+      break;
+    case EFI_INTERRUPT_PENDING:
+      Bucket = MMI_HANDLER_STATUS_INTERRUPT_PENDING;
+      break;
+    default:
+      Bucket = MMI_HANDLER_STATUS_OTHER;
+      break;
+  }
+
+  Stats = &MmiHandler->Stats;
+
+  Stats->TotalCycles += Cycles;
+  Stats->MaxCycles    = MAX (Stats->MaxCycles, Cycles);
+  Stats->Calls++;
+  Stats->StatusCount[Bucket]++;
+}
+
+/**
+  Fold the status returned by one MMI handler into the result of MmiManage.
+
+  @param  HandlerType     Points to the handler type or NULL for root MMI handlers.
+  @param  HandlerStatus   The status returned by the handler.
+  @param  SuccessReturn   Set to TRUE if the handler makes MmiManage return EFI_SUCCESS.
+
+  @retval TRUE    No additional handlers shall be processed, HandlerStatus is returned.
+  @retval FALSE   Continue with the next handler.
+**/
+STATIC
+BOOLEAN
+FoldMmiHandlerStatus (
+  IN     CONST EFI_GUID  *HandlerType,
+  IN     EFI_STATUS      HandlerStatus,
+  IN OUT BOOLEAN         *SuccessReturn
+  )
+{
+  switch (HandlerStatus) {
+    case EFI_INTERRUPT_PENDING:
+      //
+      // If a handler returns EFI_INTERRUPT_PENDING and HandlerType is not NULL then
+      // no additional handlers will be processed and EFI_INTERRUPT_PENDING will be returned.
+      //
+      if (HandlerType != NULL) {
+        return TRUE;
+      }
+
+      break;
+
+    case EFI_SUCCESS:
+      //
+      // If at least one of the handlers returns EFI_SUCCESS then the function will return
+      // EFI_SUCCESS. If a handler returns EFI_SUCCESS and HandlerType is not NULL then no
+      // additional handlers will be processed.
+      //
+      if (HandlerType != NULL) {
+        return TRUE;
+      }
+
+      *SuccessReturn = TRUE;
+      break;
+
+    case EFI_WARN_INTERRUPT_SOURCE_QUIESCED:
+      //
+      // If at least one of the handlers returns EFI_WARN_INTERRUPT_SOURCE_QUIESCED
+      // then the function will return EFI_SUCCESS.
+      //
+      *SuccessReturn = TRUE;
+      break;
+
+    case EFI_WARN_INTERRUPT_SOURCE_PENDING:
+      //
+      // If all the handlers returned EFI_WARN_INTERRUPT_SOURCE_PENDING
+      // then EFI_WARN_INTERRUPT_SOURCE_PENDING will be returned.
+      //
+      break;
+
+    default:
+      //
+      // Unexpected status code returned.
+      //
+      ASSERT_EFI_ERROR (HandlerStatus);
+      break;
+  }
+
+  return FALSE;
+}
+
 /**
   Finds the MMI entry for the requested handler type.
 
@@ -35,26 +295,16 @@ MmCoreFindMmiEntry (
   IN BOOLEAN   Create
   )
 {
-  LIST_ENTRY  *Link;
-  MMI_ENTRY   *Item;
-  MMI_ENTRY   *MmiEntry;
+  MMI_ENTRY_HASH_NODE  *Node;
+  MMI_ENTRY            *MmiEntry;
 
   //
-  // Search the MMI entry list for the matching GUID
+  // Search the MMI entry hash for the matching GUID
   //
   MmiEntry = NULL;
-  for (Link = mMmiEntryList.ForwardLink;
-       Link != &mMmiEntryList;
-       Link = Link->ForwardLink)
-  {
-    Item = CR (Link, MMI_ENTRY, AllEntries, MMI_ENTRY_SIGNATURE);
-    if (CompareGuid (&Item->HandlerType, HandlerType)) {
-      //
-      // This is the MMI entry
-      //
-      MmiEntry = Item;
-      break;
-    }
+  Node     = MmiEntryHashFind (&mMmiEntryHash, HandlerType);
+  if (Node != NULL) {
+    MmiEntry = CR (Node, MMI_ENTRY, HashNode, MMI_ENTRY_SIGNATURE);
   }
 
   //
@@ -69,18 +319,159 @@ MmCoreFindMmiEntry (
       //
       MmiEntry->Signature = MMI_ENTRY_SIGNATURE;
       CopyGuid ((VOID *)&MmiEntry->HandlerType, HandlerType);
-      InitializeListHead (&MmiEntry->MmiHandlers);
+      InitializeListHead (&MmiEntry->SupvMmiHandlers);
+      InitializeListHead (&MmiEntry->UserMmiHandlers);
 
       //
-      // Add it to MMI entry list
+      // Add it to MMI entry list and hash
       //
       InsertTailList (&mMmiEntryList, &MmiEntry->AllEntries);
+      MmiEntryHashInsert (&mMmiEntryHash, &MmiEntry->HashNode, &MmiEntry->HandlerType);
     }
   }
 
   return MmiEntry;
 }
 
+/**
+  Enumerate the handlers of an MMI entry, supervisor handlers first.
+
+  @param  MmiEntry    The MMI entry.
+  @param  MmiHandler  The handler returned by the previous call, or NULL to get the first one.
+
+  @return The handler after MmiHandler, or NULL if MmiHandler is the last one.
+
+**/
+MMI_HANDLER *
+GetNextMmiHandler (
+  IN MMI_ENTRY    *MmiEntry,
+  IN MMI_HANDLER  *MmiHandler  OPTIONAL
+  )
+{
+  LIST_ENTRY  *Link;
+
+  if (MmiHandler == NULL) {
+    Link = MmiEntry->SupvMmiHandlers.ForwardLink;
+  } else {
+    Link = MmiHandler->Link.ForwardLink;
+  }
+
+  if (Link == &MmiEntry->SupvMmiHandlers) {
+    Link = MmiEntry->UserMmiHandlers.ForwardLink;
+  }
+
+  if (Link == &MmiEntry->UserMmiHandlers) {
+    return NULL;
+  }
+
+  return CR (Link, MMI_HANDLER, Link, MMI_HANDLER_SIGNATURE);
+}
+
+/**
+  Unlink and free an MMI handler, and its MMI entry once the entry has no
+  handler left.
+
+  @param  MmiHandler  The handler to remove.
+
+  @retval TRUE    The MMI entry of MmiHandler was freed too.
+  @retval FALSE   The MMI entry of MmiHandler is still in use, or MmiHandler is a root handler.
+**/
+STATIC
+BOOLEAN
+RemoveMmiHandler (
+  IN MMI_HANDLER  *MmiHandler
+  )
+{
+  MMI_ENTRY  *MmiEntry;
+
+  MmiEntry = MmiHandler->MmiEntry;
+
+  mUserMmiBatchEntry = NULL;
+
+  RemoveEntryList (&MmiHandler->Link);
+  FreePool (MmiHandler);
+
+  if ((MmiEntry == NULL) || (MmiEntry == &mRootMmiEntry)) {
+    //
+    // This is root MMI handler, the root MMI entry is never freed
+    //
+    return FALSE;
+  }
+
+  if (IsListEmpty (&MmiEntry->SupvMmiHandlers) && IsListEmpty (&MmiEntry->UserMmiHandlers)) {
+    //
+    // No handler registered for this interrupt now, remove the MMI_ENTRY
+    //
+    RemoveEntryList (&MmiEntry->AllEntries);
+    MmiEntryHashRemove (&MmiEntry->HashNode);
+
+    FreePool (MmiEntry);
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/**
+  Free the handlers of a handler list that were unregistered while MmiManage ran.
+
+  @param  Handlers    The handler list.
+
+  @retval TRUE    The MMI entry holding Handlers was freed.
+  @retval FALSE   The MMI entry holding Handlers is still in use.
+**/
+STATIC
+BOOLEAN
+RemovePendingMmiHandlersOnList (
+  IN LIST_ENTRY  *Handlers
+  )
+{
+  LIST_ENTRY   *Link;
+  MMI_HANDLER  *MmiHandler;
+
+  Link = Handlers->ForwardLink;
+  while (Link != Handlers) {
+    MmiHandler = CR (Link, MMI_HANDLER, Link, MMI_HANDLER_SIGNATURE);
+    Link       = Link->ForwardLink;
+    if (MmiHandler->ToRemove) {
+      mMmiHandlersToRemove--;
+      if (RemoveMmiHandler (MmiHandler)) {
+        return TRUE;
+      }
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+  Free all handlers that were unregistered while MmiManage ran, once the
+  outermost MmiManage is done with them.
+**/
+STATIC
+VOID
+RemovePendingMmiHandlers (
+  VOID
+  )
+{
+  LIST_ENTRY  *EntryLink;
+  MMI_ENTRY   *MmiEntry;
+
+  RemovePendingMmiHandlersOnList (&mRootMmiEntry.SupvMmiHandlers);
+  RemovePendingMmiHandlersOnList (&mRootMmiEntry.UserMmiHandlers);
+
+  EntryLink = mMmiEntryList.ForwardLink;
+  while ((EntryLink != &mMmiEntryList) && (mMmiHandlersToRemove != 0)) {
+    MmiEntry  = CR (EntryLink, MMI_ENTRY, AllEntries, MMI_ENTRY_SIGNATURE);
+    EntryLink = EntryLink->ForwardLink;
+    if (!RemovePendingMmiHandlersOnList (&MmiEntry->SupvMmiHandlers)) {
+      RemovePendingMmiHandlersOnList (&MmiEntry->UserMmiHandlers);
+    }
+  }
+
+  ASSERT (mMmiHandlersToRemove == 0);
+}
+
 /**
   Manage MMI of a particular type.
 
@@ -111,7 +502,10 @@ MmiManage (
   BOOLEAN      SuccessReturn;
   BOOLEAN      SupervisorPath;
   EFI_STATUS   Status;
+  EFI_STATUS   BatchStatus;
   BOOLEAN      IsUserRange;
+  UINTN        Index;
+  UINT64       StartTsc;
 
   PERF_FUNCTION_BEGIN ();
 
@@ -157,76 +551,80 @@ MmiManage (
     }
   }
 
-  Head = &MmiEntry->MmiHandlers;
+  //
+  // Only walk the handlers this channel dispatches, supervisor handlers are not
+  // dispatched during user channel and vice versa
+  //
+  Head = MMI_ENTRY_HANDLERS (MmiEntry, SupervisorPath);
+
+  mMmiManageCallingDepth++;
+
+  //
+  // Dispatch all the user handlers of the entry with a single ring transition when possible
+  //
+  if (!SupervisorPath && PrepareUserMmiBatch (MmiEntry, (BOOLEAN)(HandlerType != NULL))) {
+    for (Index = 0; Index < mUserMmiBatchStage->Count; Index++) {
+      mUserMmiBatchStage->Statuses[Index] = EFI_WARN_INTERRUPT_SOURCE_PENDING;
+    }
+
+    mUserMmiBatchBusy = TRUE;
+    BatchStatus       = InvokeDemotedMmHandlerBatch (mUserMmiBatch, Context, CommBuffer, CommBufferSize);
+    mUserMmiBatchBusy = FALSE;
+
+    if (!EFI_ERROR (BatchStatus)) {
+      for (Index = 0; Index < mUserMmiBatchStage->Count; Index++) {
+        if (mUserMmiBatchStage->Handlers[Index].Handler == NULL) {
+          // Unregistered during the batch
+          continue;
+        }
+
+        Status = (EFI_STATUS)mUserMmiBatchStage->Statuses[Index];
+        RecordMmiHandlerStats (
+          (MMI_HANDLER *)mUserMmiBatchStage->Handlers[Index].DispatchHandle,
+          Status,
+          mUserMmiBatchStage->Cycles[Index]
+          );
+        if (FoldMmiHandlerStatus (HandlerType, Status, &SuccessReturn)) {
+          goto DispatchDone;
+        }
+      }
+
+      if (SuccessReturn) {
+        Status = EFI_SUCCESS;
+      }
+
+      goto DispatchDone;
+    }
+  }
 
   for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
     MmiHandler = CR (Link, MMI_HANDLER, Link, MMI_HANDLER_SIGNATURE);
+    if (MmiHandler->ToRemove) {
+      // Unregistered earlier in this MMI
+      continue;
+    }
 
-    if (!SupervisorPath && !MmiHandler->IsSupervisor) {
+    StartTsc = AsmReadTsc ();
+    if (!SupervisorPath) {
       Status = InvokeDemotedMmHandler (
                  MmiHandler,
                  Context,
                  CommBuffer,
                  CommBufferSize
                  );
-    } else if (SupervisorPath && MmiHandler->IsSupervisor) {
+    } else {
       Status = MmiHandler->Handler (
                              (EFI_HANDLE)MmiHandler,
                              Context,
                              CommBuffer,
                              CommBufferSize
                              );
-    } else {
-      // We do not dispatch supervisor handlers during user channel and vice versa
-      continue;
     }
 
-    switch (Status) {
-      case EFI_INTERRUPT_PENDING:
-        //
-        // If a handler returns EFI_INTERRUPT_PENDING and HandlerType is not NULL then
-        // no additional handlers will be processed and EFI_INTERRUPT_PENDING will be returned.
-        //
-        if (HandlerType != NULL) {
-          return EFI_INTERRUPT_PENDING;
-        }
-
-        break;
-
-      case EFI_SUCCESS:
-        //
-        // If at least one of the handlers returns EFI_SUCCESS then the function will return
-        // EFI_SUCCESS. If a handler returns EFI_SUCCESS and HandlerType is not NULL then no
-        // additional handlers will be processed.
-        //
-        if (HandlerType != NULL) {
-          return EFI_SUCCESS;
-        }
-
-        SuccessReturn = TRUE;
-        break;
-
-      case EFI_WARN_INTERRUPT_SOURCE_QUIESCED:
-        //
-        // If at least one of the handlers returns EFI_WARN_INTERRUPT_SOURCE_QUIESCED
-        // then the function will return EFI_SUCCESS.
-        //
-        SuccessReturn = TRUE;
-        break;
-
-      case EFI_WARN_INTERRUPT_SOURCE_PENDING:
-        //
-        // If all the handlers returned EFI_WARN_INTERRUPT_SOURCE_PENDING
-        // then EFI_WARN_INTERRUPT_SOURCE_PENDING will be returned.
-        //
-        break;
+    RecordMmiHandlerStats (MmiHandler, Status, AsmReadTsc () - StartTsc);
 
-      default:
-        //
-        // Unexpected status code returned.
-        //
-        ASSERT_EFI_ERROR (Status);
-        break;
+    if (FoldMmiHandlerStatus (HandlerType, Status, &SuccessReturn)) {
+      goto DispatchDone;
     }
   }
 
@@ -234,6 +632,12 @@ MmiManage (
     Status = EFI_SUCCESS;
   }
 
+DispatchDone:
+  mMmiManageCallingDepth--;
+  if ((mMmiManageCallingDepth == 0) && (mMmiHandlersToRemove != 0)) {
+    RemovePendingMmiHandlers ();
+  }
+
 Done:
   PERF_FUNCTION_END ();
   return Status;
@@ -292,11 +696,14 @@ CoreMmiHandlerRegister (
     }
   }
 
-  List = &MmiEntry->MmiHandlers;
+  List = MMI_ENTRY_HANDLERS (MmiEntry, IsSupervisorHandler);
 
   MmiHandler->MmiEntry = MmiEntry;
   InsertTailList (List, &MmiHandler->Link);
 
+  // Handlers registered while a batch runs are dispatched from the next MMI on
+  mUserMmiBatchEntry = NULL;
+
   *DispatchHandle = (EFI_HANDLE)MmiHandler;
 
   return EFI_SUCCESS;
@@ -369,18 +776,22 @@ MmiHandlerUnRegisterEx (
   MMI_ENTRY    *MmiEntry;
   LIST_ENTRY   *EntryLink;
   LIST_ENTRY   *HandlerLink;
+  LIST_ENTRY   *Handlers;
+  UINTN        Index;
+  VOID         *NullHandler;
 
   if (DispatchHandle == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
   //
-  // Look for it in root MMI handlers
+  // Look for it in root MMI handlers, only among the handlers of the requested ownership
   //
   MmiHandler = NULL;
-  for ( HandlerLink = GetFirstNode (&mRootMmiEntry.MmiHandlers)
-        ; !IsNull (&mRootMmiEntry.MmiHandlers, HandlerLink) && ((EFI_HANDLE)MmiHandler != DispatchHandle)
-        ; HandlerLink = GetNextNode (&mRootMmiEntry.MmiHandlers, HandlerLink)
+  Handlers   = MMI_ENTRY_HANDLERS (&mRootMmiEntry, IsSupervisorHandler);
+  for ( HandlerLink = GetFirstNode (Handlers)
+        ; !IsNull (Handlers, HandlerLink) && ((EFI_HANDLE)MmiHandler != DispatchHandle)
+        ; HandlerLink = GetNextNode (Handlers, HandlerLink)
         )
   {
     MmiHandler = CR (HandlerLink, MMI_HANDLER, Link, MMI_HANDLER_SIGNATURE);
@@ -395,39 +806,44 @@ MmiHandlerUnRegisterEx (
         )
   {
     MmiEntry = CR (EntryLink, MMI_ENTRY, AllEntries, MMI_ENTRY_SIGNATURE);
-    for ( HandlerLink = GetFirstNode (&MmiEntry->MmiHandlers)
-          ; !IsNull (&MmiEntry->MmiHandlers, HandlerLink) && ((EFI_HANDLE)MmiHandler != DispatchHandle)
-          ; HandlerLink = GetNextNode (&MmiEntry->MmiHandlers, HandlerLink)
+    Handlers = MMI_ENTRY_HANDLERS (MmiEntry, IsSupervisorHandler);
+    for ( HandlerLink = GetFirstNode (Handlers)
+          ; !IsNull (Handlers, HandlerLink) && ((EFI_HANDLE)MmiHandler != DispatchHandle)
+          ; HandlerLink = GetNextNode (Handlers, HandlerLink)
           )
     {
       MmiHandler = CR (HandlerLink, MMI_HANDLER, Link, MMI_HANDLER_SIGNATURE);
     }
   }
 
-  if (((EFI_HANDLE)MmiHandler != DispatchHandle) || (MmiHandler->IsSupervisor != IsSupervisorHandler)) {
+  if (((EFI_HANDLE)MmiHandler != DispatchHandle) || (MmiHandler->IsSupervisor != IsSupervisorHandler) || MmiHandler->ToRemove) {
     return EFI_INVALID_PARAMETER;
   }
 
-  MmiEntry = MmiHandler->MmiEntry;
-
-  RemoveEntryList (&MmiHandler->Link);
-  FreePool (MmiHandler);
+  //
+  // A handler unregistered by a handler of the running batch must not be called after it is freed
+  //
+  if (mUserMmiBatchBusy && !IsSupervisorHandler) {
+    NullHandler = NULL;
+    for (Index = 0; Index < mUserMmiBatchStage->Count; Index++) {
+      if (mUserMmiBatchStage->Handlers[Index].DispatchHandle == MmiHandler) {
+        mUserMmiBatchStage->Handlers[Index].Handler = NULL;
+        CopyMemToReadOnlyPages (&mUserMmiBatch->Handlers[Index].Handler, &NullHandler, sizeof (NullHandler));
+      }
+    }
+  }
 
-  if (MmiEntry == NULL) {
-    //
-    // This is root MMI handler
-    //
+  //
+  // MmiManage may still be walking the list of this handler, or record its statistics
+  //
+  if (mMmiManageCallingDepth != 0) {
+    MmiHandler->ToRemove = TRUE;
+    mMmiHandlersToRemove++;
+    mUserMmiBatchEntry = NULL;
     return EFI_SUCCESS;
   }
 
-  if (IsListEmpty (&MmiEntry->MmiHandlers)) {
-    //
-    // No handler registered for this interrupt now, remove the MMI_ENTRY
-    //
-    RemoveEntryList (&MmiEntry->AllEntries);
-
-    FreePool (MmiEntry);
-  }
+  RemoveMmiHandler (MmiHandler);
 
   return EFI_SUCCESS;
 }
@@ -0,0 +1,137 @@
+/** @file
+  GUID keyed hash of the MMI entries.
+
+  Every synchronous MMI looks up the entry of its handler type GUID before any
+  handler runs. The entries are kept in buckets chosen from a hash of the GUID,
+  so that only the few entries of one bucket are compared against it.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+
+#include "MmiEntryHash.h"
+
+/**
+  Hash a GUID, mixing all of its bits into the bucket index.
+
+  @param[in]  Key     The GUID to hash.
+
+  @return The hash of Key.
+**/
+STATIC
+UINT32
+HashMmiEntryKey (
+  IN CONST EFI_GUID  *Key
+  )
+{
+  UINT64  Value;
+
+  Value  = ReadUnaligned64 ((CONST UINT64 *)Key) ^ ReadUnaligned64 ((CONST UINT64 *)Key + 1);
+  Value ^= RShiftU64 (Value, 32);
+
+  // Fibonacci hashing, the top bits end up in the bucket index
+  return (UINT32)Value * 0x9E3779B1;
+}
+
+/**
+  Get the bucket of a hash value.
+
+  @param[in]  Hash      The hash holding the buckets.
+  @param[in]  KeyHash   The hash value of the key.
+
+  @return The bucket list head.
+**/
+STATIC
+LIST_ENTRY *
+GetMmiEntryBucket (
+  IN CONST MMI_ENTRY_HASH  *Hash,
+  IN UINT32                KeyHash
+  )
+{
+  return (LIST_ENTRY *)&Hash->Buckets[KeyHash >> (32 - MMI_ENTRY_HASH_BUCKET_BITS)];
+}
+
+/**
+  Add a node to the hash.
+
+  @param[in, out] Hash    The hash to update.
+  @param[in, out] Node    The node to add, must not already be in a hash.
+  @param[in]      Key     The GUID the node will be found with. Must stay valid
+                          while the node is in the hash.
+**/
+VOID
+MmiEntryHashInsert (
+  IN OUT MMI_ENTRY_HASH       *Hash,
+  IN OUT MMI_ENTRY_HASH_NODE  *Node,
+  IN     CONST EFI_GUID       *Key
+  )
+{
+  UINTN  Index;
+
+  if (!Hash->Initialized) {
+    for (Index = 0; Index < MMI_ENTRY_HASH_BUCKETS; Index++) {
+      InitializeListHead (&Hash->Buckets[Index]);
+    }
+
+    Hash->Initialized = TRUE;
+  }
+
+  Node->Key  = Key;
+  Node->Hash = HashMmiEntryKey (Key);
+  InsertTailList (GetMmiEntryBucket (Hash, Node->Hash), &Node->Link);
+}
+
+/**
+  Remove a node from the hash it was added to.
+
+  @param[in, out] Node    The node to remove.
+**/
+VOID
+MmiEntryHashRemove (
+  IN OUT MMI_ENTRY_HASH_NODE  *Node
+  )
+{
+  RemoveEntryList (&Node->Link);
+}
+
+/**
+  Find the node added with a GUID.
+
+  @param[in]  Hash    The hash to search.
+  @param[in]  Key     The GUID to look for.
+
+  @return The node added with Key, or NULL if there is none.
+**/
+MMI_ENTRY_HASH_NODE *
+MmiEntryHashFind (
+  IN CONST MMI_ENTRY_HASH  *Hash,
+  IN CONST EFI_GUID        *Key
+  )
+{
+  LIST_ENTRY           *Bucket;
+  LIST_ENTRY           *Link;
+  MMI_ENTRY_HASH_NODE  *Node;
+  UINT32               KeyHash;
+
+  if (!Hash->Initialized) {
+    return NULL;
+  }
+
+  KeyHash = HashMmiEntryKey (Key);
+  Bucket  = GetMmiEntryBucket (Hash, KeyHash);
+  for (Link = Bucket->ForwardLink; Link != Bucket; Link = Link->ForwardLink) {
+    Node = BASE_CR (Link, MMI_ENTRY_HASH_NODE, Link);
+    if ((Node->Hash == KeyHash) && CompareGuid (Node->Key, Key)) {
+      return Node;
+    }
+  }
+
+  return NULL;
+}
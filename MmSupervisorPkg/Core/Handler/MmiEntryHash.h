@@ -0,0 +1,77 @@
+/** @file
+  GUID keyed hash of the MMI entries.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MM_SUPV_MMI_ENTRY_HASH_H_
+#define _MM_SUPV_MMI_ENTRY_HASH_H_
+
+//
+// The hash has 2^MMI_ENTRY_HASH_BUCKET_BITS buckets.
+//
+#define MMI_ENTRY_HASH_BUCKET_BITS  6
+#define MMI_ENTRY_HASH_BUCKETS      (1 << MMI_ENTRY_HASH_BUCKET_BITS)
+
+/**
+  Node embedded in each hashed entry.
+
+**/
+typedef struct {
+  LIST_ENTRY        Link;   // Link on the bucket of Key
+  CONST EFI_GUID    *Key;   // The GUID the owner is looked up with
+  UINT32            Hash;
+} MMI_ENTRY_HASH_NODE;
+
+/**
+  A zero initialized hash is valid and empty.
+
+**/
+typedef struct {
+  BOOLEAN       Initialized;
+  LIST_ENTRY    Buckets[MMI_ENTRY_HASH_BUCKETS];
+} MMI_ENTRY_HASH;
+
+/**
+  Add a node to the hash.
+
+  @param[in, out] Hash    The hash to update.
+  @param[in, out] Node    The node to add, must not already be in a hash.
+  @param[in]      Key     The GUID the node will be found with. Must stay valid
+                          while the node is in the hash.
+**/
+VOID
+MmiEntryHashInsert (
+  IN OUT MMI_ENTRY_HASH       *Hash,
+  IN OUT MMI_ENTRY_HASH_NODE  *Node,
+  IN     CONST EFI_GUID       *Key
+  );
+
+/**
+  Remove a node from the hash it was added to.
+
+  @param[in, out] Node    The node to remove.
+**/
+VOID
+MmiEntryHashRemove (
+  IN OUT MMI_ENTRY_HASH_NODE  *Node
+  );
+
+/**
+  Find the node added with a GUID.
+
+  @param[in]  Hash    The hash to search.
+  @param[in]  Key     The GUID to look for.
+
+  @return The node added with Key, or NULL if there is none.
+**/
+MMI_ENTRY_HASH_NODE *
+MmiEntryHashFind (
+  IN CONST MMI_ENTRY_HASH  *Hash,
+  IN CONST EFI_GUID        *Key
+  );
+
+#endif // _MM_SUPV_MMI_ENTRY_HASH_H_
@@ -31,6 +31,12 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define GET_OCCUPIED_SIZE(ActualSize, Alignment) \
   ((ActualSize) + (((Alignment) - ((ActualSize) & ((Alignment) - 1))) & ((Alignment) - 1)))
 
+//
+// Size of one handler in the database: the structure, its context, then its statistics
+//
+#define GET_SMI_HANDLER_STRUCT_SIZE(SmiHandler) \
+  (sizeof (SMM_CORE_SMI_HANDLER_STRUCTURE) + GET_OCCUPIED_SIZE ((SmiHandler)->ContextSize, sizeof (UINT64)) + sizeof (MMI_HANDLER_STATS))
+
 typedef struct {
   EFI_GUID            FileGuid;
   PHYSICAL_ADDRESS    EntryPoint;
@@ -518,16 +524,13 @@ DumpSmiHandlerOnSmiEntry (
   IN MMI_ENTRY  *SmiEntry
   )
 {
-  LIST_ENTRY    *ListEntry;
   MMI_HANDLER   *SmiHandler;
   IMAGE_STRUCT  *ImageStruct;
 
-  ListEntry = &SmiEntry->MmiHandlers;
-  for (ListEntry = ListEntry->ForwardLink;
-       ListEntry != &SmiEntry->MmiHandlers;
-       ListEntry = ListEntry->ForwardLink)
+  for (SmiHandler = GetNextMmiHandler (SmiEntry, NULL);
+       SmiHandler != NULL;
+       SmiHandler = GetNextMmiHandler (SmiEntry, SmiHandler))
   {
-    SmiHandler  = CR (ListEntry, MMI_HANDLER, Link, MMI_HANDLER_SIGNATURE);
     ImageStruct = AddressToImageStruct ((UINTN)SmiHandler->Handler);
     if (ImageStruct != NULL) {
       DEBUG ((DEBUG_INFO, " Module - %g", &ImageStruct->FileGuid));
@@ -684,18 +687,15 @@ GetSmmSmiHandlerSizeOnSmiEntry (
   IN MMI_ENTRY  *SmiEntry
   )
 {
-  LIST_ENTRY   *ListEntry;
   MMI_HANDLER  *SmiHandler;
   UINTN        Size;
 
-  Size      = 0;
-  ListEntry = &SmiEntry->MmiHandlers;
-  for (ListEntry = ListEntry->ForwardLink;
-       ListEntry != &SmiEntry->MmiHandlers;
-       ListEntry = ListEntry->ForwardLink)
+  Size = 0;
+  for (SmiHandler = GetNextMmiHandler (SmiEntry, NULL);
+       SmiHandler != NULL;
+       SmiHandler = GetNextMmiHandler (SmiEntry, SmiHandler))
   {
-    SmiHandler = CR (ListEntry, MMI_HANDLER, Link, MMI_HANDLER_SIGNATURE);
-    Size      += sizeof (SMM_CORE_SMI_HANDLER_STRUCTURE) + GET_OCCUPIED_SIZE (SmiHandler->ContextSize, sizeof (UINT64));
+    Size += GET_SMI_HANDLER_STRUCT_SIZE (SmiHandler);
   }
 
   return Size;
@@ -823,30 +823,28 @@ GetSmmSmiHandlerDataOnSmiEntry (
   )
 {
   SMM_CORE_SMI_HANDLER_STRUCTURE  *SmiHandlerStruct;
-  LIST_ENTRY                      *ListEntry;
   MMI_HANDLER                     *SmiHandler;
+  MMI_HANDLER_STATS               *Stats;
   UINTN                           Size;
 
   SmiHandlerStruct = Data;
   Size             = 0;
   *Count           = 0;
-  ListEntry        = &SmiEntry->MmiHandlers;
-  for (ListEntry = ListEntry->ForwardLink;
-       ListEntry != &SmiEntry->MmiHandlers;
-       ListEntry = ListEntry->ForwardLink)
+  for (SmiHandler = GetNextMmiHandler (SmiEntry, NULL);
+       SmiHandler != NULL;
+       SmiHandler = GetNextMmiHandler (SmiEntry, SmiHandler))
   {
-    SmiHandler = CR (ListEntry, MMI_HANDLER, Link, MMI_HANDLER_SIGNATURE);
     if (Size >= MaxSize) {
       *Count = 0;
       return 0;
     }
 
-    if (sizeof (SMM_CORE_SMI_HANDLER_STRUCTURE) + GET_OCCUPIED_SIZE (SmiHandler->ContextSize, sizeof (UINT64)) > MaxSize - Size) {
+    if (GET_SMI_HANDLER_STRUCT_SIZE (SmiHandler) > MaxSize - Size) {
       *Count = 0;
       return 0;
     }
 
-    SmiHandlerStruct->Length            = (UINT32)(sizeof (SMM_CORE_SMI_HANDLER_STRUCTURE) + GET_OCCUPIED_SIZE (SmiHandler->ContextSize, sizeof (UINT64)));
+    SmiHandlerStruct->Length            = (UINT32)GET_SMI_HANDLER_STRUCT_SIZE (SmiHandler);
     SmiHandlerStruct->CallerAddr        = (UINTN)SmiHandler->CallerAddr;
     SmiHandlerStruct->Handler           = (UINTN)SmiHandler->Handler;
     SmiHandlerStruct->ImageRef          = AddressToImageRef ((UINTN)SmiHandler->Handler);
@@ -858,7 +856,11 @@ GetSmmSmiHandlerDataOnSmiEntry (
       SmiHandlerStruct->ContextBufferOffset = 0;
     }
 
-    Size            += sizeof (SMM_CORE_SMI_HANDLER_STRUCTURE) + GET_OCCUPIED_SIZE (SmiHandler->ContextSize, sizeof (UINT64));
+    Stats = (MMI_HANDLER_STATS *)((UINTN)SmiHandlerStruct + SmiHandlerStruct->Length - sizeof (MMI_HANDLER_STATS));
+    CopyMem (Stats, &SmiHandler->Stats, sizeof (MMI_HANDLER_STATS));
+    Stats->Signature = MMI_HANDLER_STATS_SIGNATURE;
+
+    Size            += GET_SMI_HANDLER_STRUCT_SIZE (SmiHandler);
     SmiHandlerStruct = (SMM_CORE_SMI_HANDLER_STRUCTURE *)((UINTN)SmiHandlerStruct + SmiHandlerStruct->Length);
     *Count           = *Count + 1;
   }
@@ -974,7 +976,8 @@ GetSmiHandlerProfileDatabaseData (
 }
 
 /**
-  build SMI handler profile database.
+  build SMI handler profile database. The previous database, if any, is only
+  replaced once the new one is complete, and kept if it cannot be built.
 **/
 VOID
 BuildSmiHandlerProfileDatabase (
@@ -982,18 +985,27 @@ BuildSmiHandlerProfileDatabase (
   )
 {
   EFI_STATUS  Status;
+  VOID        *Database;
+  UINTN       DatabaseSize;
 
-  mSmiHandlerProfileDatabaseSize = GetSmiHandlerProfileDatabaseSize ();
-  mSmiHandlerProfileDatabase     = AllocatePool (mSmiHandlerProfileDatabaseSize);
-  if (mSmiHandlerProfileDatabase == NULL) {
+  DatabaseSize = GetSmiHandlerProfileDatabaseSize ();
+  Database     = AllocatePool (DatabaseSize);
+  if (Database == NULL) {
     return;
   }
 
-  Status = GetSmiHandlerProfileDatabaseData (mSmiHandlerProfileDatabase);
+  Status = GetSmiHandlerProfileDatabaseData (Database);
   if (EFI_ERROR (Status)) {
+    FreePool (Database);
+    return;
+  }
+
+  if (mSmiHandlerProfileDatabase != NULL) {
     FreePool (mSmiHandlerProfileDatabase);
-    mSmiHandlerProfileDatabase = NULL;
   }
+
+  mSmiHandlerProfileDatabase     = Database;
+  mSmiHandlerProfileDatabaseSize = DatabaseSize;
 }
 
 /**
@@ -1046,6 +1058,11 @@ SmiHandlerProfileHandlerGetInfo (
   SmiHandlerProfileRecordingStatus  = mSmiHandlerProfileRecordingStatus;
   mSmiHandlerProfileRecordingStatus = FALSE;
 
+  //
+  // The handler statistics keep changing after ready to lock, snapshot them for the reads that follow
+  //
+  BuildSmiHandlerProfileDatabase ();
+
   SmiHandlerProfileParameterGetInfo->DataSize            = mSmiHandlerProfileDatabaseSize;
   SmiHandlerProfileParameterGetInfo->Header.ReturnStatus = 0;
 
@@ -1241,7 +1258,8 @@ SmmCoreFindHardwareSmiEntry (
       //
       SmiEntry->Signature = MMI_ENTRY_SIGNATURE;
       CopyGuid ((VOID *)&SmiEntry->HandlerType, HandlerType);
-      InitializeListHead (&SmiEntry->MmiHandlers);
+      InitializeListHead (&SmiEntry->SupvMmiHandlers);
+      InitializeListHead (&SmiEntry->UserMmiHandlers);
 
       //
       // Add it to SMI entry list
@@ -1416,7 +1434,7 @@ SmiHandlerProfileRegisterHandler (
     return EFI_OUT_OF_RESOURCES;
   }
 
-  List = &SmiEntry->MmiHandlers;
+  List = MMI_ENTRY_HANDLERS (SmiEntry, SmiHandler->IsSupervisor);
 
   SmiHandler->MmiEntry = SmiEntry;
   InsertTailList (List, &SmiHandler->Link);
@@ -1548,8 +1566,6 @@ SmiHandlerProfileUnregisterHandler (
   IN UINTN                         ContextSize OPTIONAL
   )
 {
-  LIST_ENTRY   *Link;
-  LIST_ENTRY   *Head;
   MMI_HANDLER  *SmiHandler;
   MMI_ENTRY    *SmiEntry;
   MMI_HANDLER  *TargetSmiHandler;
@@ -1578,9 +1594,7 @@ SmiHandlerProfileUnregisterHandler (
   }
 
   TargetSmiHandler = NULL;
-  Head             = &SmiEntry->MmiHandlers;
-  for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
-    SmiHandler = CR (Link, MMI_HANDLER, Link, MMI_HANDLER_SIGNATURE);
+  for (SmiHandler = GetNextMmiHandler (SmiEntry, NULL); SmiHandler != NULL; SmiHandler = GetNextMmiHandler (SmiEntry, SmiHandler)) {
     if (SmiHandler->Handler == Handler) {
       if ((SearchContext == NULL) ||
           ((SearchContextSize == SmiHandler->ContextSize) && (CompareMem (SearchContext, SmiHandler->Context, SearchContextSize) == 0)))
@@ -1612,7 +1626,7 @@ SmiHandlerProfileUnregisterHandler (
 
   FreePool (SmiHandler);
 
-  if (IsListEmpty (&SmiEntry->MmiHandlers)) {
+  if (IsListEmpty (&SmiEntry->SupvMmiHandlers) && IsListEmpty (&SmiEntry->UserMmiHandlers)) {
     RemoveEntryList (&SmiEntry->AllEntries);
     FreePool (SmiEntry);
   }
@@ -0,0 +1,387 @@
+/** @file
+  Unit tests of the MMI entry hash used by the MM supervisor core
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../MmiEntryHash.h"
+
+#define UNIT_TEST_APP_NAME     "MMI Entry Hash Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define RANDOM_ENTRY_COUNT      256
+#define RANDOM_OPERATIONS       4000
+#define BENCHMARK_LOOKUP_COUNT  200000
+
+typedef struct {
+  UINTN    EntryCount;
+} TEST_CONTEXT_BENCHMARK;
+
+//
+// Stand-in for MMI_ENTRY, hashed and listed the same way
+//
+typedef struct {
+  LIST_ENTRY             AllEntries;
+  EFI_GUID               HandlerType;
+  MMI_ENTRY_HASH_NODE    HashNode;
+  BOOLEAN                Hashed;
+} TEST_MMI_ENTRY;
+
+/**
+  Advance a linear congruential generator.
+
+  @param[in, out] Seed    The generator state.
+
+  @return The next pseudo random value.
+**/
+STATIC
+UINT32
+NextRandom (
+  IN OUT UINT32  *Seed
+  )
+{
+  *Seed = *Seed * 1103515245 + 12345;
+  return *Seed >> 8;
+}
+
+/**
+  Fill a GUID the way handler type GUIDs differ: in every field.
+
+  @param[out]     Guid    The GUID to fill.
+  @param[in, out] Seed    The generator state.
+**/
+STATIC
+VOID
+RandomGuid (
+  OUT    EFI_GUID  *Guid,
+  IN OUT UINT32    *Seed
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < sizeof (EFI_GUID); Index++) {
+    ((UINT8 *)Guid)[Index] = (UINT8)NextRandom (Seed);
+  }
+}
+
+/**
+  Entries should only be found with their own GUID, and no longer once removed.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+MmiEntryHashInsertFindRemove (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MMI_ENTRY_HASH  Hash;
+  TEST_MMI_ENTRY  Entries[3];
+  EFI_GUID        Missing;
+
+  ZeroMem (&Hash, sizeof (Hash));
+  ZeroMem (Entries, sizeof (Entries));
+  ZeroMem (&Missing, sizeof (Missing));
+
+  // A zero initialized hash is empty
+  UT_ASSERT_TRUE (MmiEntryHashFind (&Hash, &Missing) == NULL);
+
+  // GUIDs differing only in the second half, and in a single bit
+  Entries[0].HandlerType.Data1    = 0x12345678;
+  Entries[1].HandlerType.Data1    = 0x12345678;
+  Entries[1].HandlerType.Data4[7] = 0x01;
+  Entries[2].HandlerType.Data1    = 0x12345679;
+
+  MmiEntryHashInsert (&Hash, &Entries[0].HashNode, &Entries[0].HandlerType);
+  MmiEntryHashInsert (&Hash, &Entries[1].HashNode, &Entries[1].HandlerType);
+  MmiEntryHashInsert (&Hash, &Entries[2].HashNode, &Entries[2].HandlerType);
+
+  UT_ASSERT_TRUE (MmiEntryHashFind (&Hash, &Entries[0].HandlerType) == &Entries[0].HashNode);
+  UT_ASSERT_TRUE (MmiEntryHashFind (&Hash, &Entries[1].HandlerType) == &Entries[1].HashNode);
+  UT_ASSERT_TRUE (MmiEntryHashFind (&Hash, &Entries[2].HandlerType) == &Entries[2].HashNode);
+  UT_ASSERT_TRUE (MmiEntryHashFind (&Hash, &Missing) == NULL);
+
+  // Lookups compare the content of the key, not its address
+  CopyGuid (&Missing, &Entries[1].HandlerType);
+  UT_ASSERT_TRUE (MmiEntryHashFind (&Hash, &Missing) == &Entries[1].HashNode);
+
+  MmiEntryHashRemove (&Entries[1].HashNode);
+  UT_ASSERT_TRUE (MmiEntryHashFind (&Hash, &Entries[1].HandlerType) == NULL);
+  UT_ASSERT_TRUE (MmiEntryHashFind (&Hash, &Entries[0].HandlerType) == &Entries[0].HashNode);
+  UT_ASSERT_TRUE (MmiEntryHashFind (&Hash, &Entries[2].HandlerType) == &Entries[2].HashNode);
+
+  MmiEntryHashRemove (&Entries[0].HashNode);
+  MmiEntryHashRemove (&Entries[2].HashNode);
+  UT_ASSERT_TRUE (MmiEntryHashFind (&Hash, &Entries[0].HandlerType) == NULL);
+  UT_ASSERT_TRUE (MmiEntryHashFind (&Hash, &Entries[2].HandlerType) == NULL);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Random insertions and removals, the hash has to agree with which entries are
+  hashed after every operation.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+MmiEntryHashRandomOperations (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MMI_ENTRY_HASH       Hash;
+  TEST_MMI_ENTRY       *Entries;
+  MMI_ENTRY_HASH_NODE  *Node;
+  UINT32               Seed;
+  UINTN                Operation;
+  UINTN                Index;
+
+  ZeroMem (&Hash, sizeof (Hash));
+  Entries = AllocateZeroPool (RANDOM_ENTRY_COUNT * sizeof (TEST_MMI_ENTRY));
+  UT_ASSERT_NOT_NULL (Entries);
+
+  Seed = 0x5EED;
+  for (Index = 0; Index < RANDOM_ENTRY_COUNT; Index++) {
+    RandomGuid (&Entries[Index].HandlerType, &Seed);
+  }
+
+  for (Operation = 0; Operation < RANDOM_OPERATIONS; Operation++) {
+    Index = NextRandom (&Seed) % RANDOM_ENTRY_COUNT;
+    if (Entries[Index].Hashed) {
+      MmiEntryHashRemove (&Entries[Index].HashNode);
+    } else {
+      MmiEntryHashInsert (&Hash, &Entries[Index].HashNode, &Entries[Index].HandlerType);
+    }
+
+    Entries[Index].Hashed = (BOOLEAN)!Entries[Index].Hashed;
+
+    Index = NextRandom (&Seed) % RANDOM_ENTRY_COUNT;
+    Node  = MmiEntryHashFind (&Hash, &Entries[Index].HandlerType);
+    if (Node != (Entries[Index].Hashed ? &Entries[Index].HashNode : NULL)) {
+      UT_LOG_ERROR ("Hash disagrees on entry %d after %d operations\n", Index, Operation);
+      UT_ASSERT_TRUE (FALSE);
+    }
+  }
+
+  FreePool (Entries);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Benchmark of the hash lookup against the walk over every MMI entry that the
+  supervisor used before. Both have to find the same entry for every lookup,
+  one lookup in 8 is for a GUID without entry.
+
+  @param[in]  Context    Pointer to TEST_CONTEXT_BENCHMARK with the number of
+                         MMI entries.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+MmiEntryHashLookupBenchmark (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MMI_ENTRY_HASH       Hash;
+  LIST_ENTRY           EntryList;
+  TEST_MMI_ENTRY       *Entries;
+  EFI_GUID             *Keys;
+  TEST_MMI_ENTRY       **Found;
+  LIST_ENTRY           *Link;
+  TEST_MMI_ENTRY       *Item;
+  MMI_ENTRY_HASH_NODE  *Node;
+  UINTN                EntryCount;
+  UINTN                Index;
+  UINTN                Lookup;
+  UINT32               Seed;
+  clock_t              Start;
+  clock_t              WalkTicks;
+  clock_t              HashTicks;
+
+  EntryCount = ((TEST_CONTEXT_BENCHMARK *)Context)->EntryCount;
+  ZeroMem (&Hash, sizeof (Hash));
+  InitializeListHead (&EntryList);
+
+  Entries = AllocateZeroPool (EntryCount * sizeof (TEST_MMI_ENTRY));
+  Keys    = AllocatePool (BENCHMARK_LOOKUP_COUNT * sizeof (EFI_GUID));
+  Found   = AllocatePool (BENCHMARK_LOOKUP_COUNT * sizeof (TEST_MMI_ENTRY *));
+  UT_ASSERT_NOT_NULL (Entries);
+  UT_ASSERT_NOT_NULL (Keys);
+  UT_ASSERT_NOT_NULL (Found);
+
+  Seed = 0x1234567;
+  for (Index = 0; Index < EntryCount; Index++) {
+    RandomGuid (&Entries[Index].HandlerType, &Seed);
+    InsertTailList (&EntryList, &Entries[Index].AllEntries);
+    MmiEntryHashInsert (&Hash, &Entries[Index].HashNode, &Entries[Index].HandlerType);
+  }
+
+  for (Lookup = 0; Lookup < BENCHMARK_LOOKUP_COUNT; Lookup++) {
+    if ((Lookup % 8) == 7) {
+      RandomGuid (&Keys[Lookup], &Seed);
+    } else {
+      CopyGuid (&Keys[Lookup], &Entries[NextRandom (&Seed) % EntryCount].HandlerType);
+    }
+  }
+
+  Start = clock ();
+  for (Lookup = 0; Lookup < BENCHMARK_LOOKUP_COUNT; Lookup++) {
+    Found[Lookup] = NULL;
+    for (Link = EntryList.ForwardLink; Link != &EntryList; Link = Link->ForwardLink) {
+      Item = BASE_CR (Link, TEST_MMI_ENTRY, AllEntries);
+      if (CompareGuid (&Item->HandlerType, &Keys[Lookup])) {
+        Found[Lookup] = Item;
+        break;
+      }
+    }
+  }
+
+  WalkTicks = clock () - Start;
+
+  Start = clock ();
+  for (Lookup = 0; Lookup < BENCHMARK_LOOKUP_COUNT; Lookup++) {
+    Node = MmiEntryHashFind (&Hash, &Keys[Lookup]);
+    Item = (Node == NULL) ? NULL : BASE_CR (Node, TEST_MMI_ENTRY, HashNode);
+    if (Item != Found[Lookup]) {
+      UT_LOG_ERROR ("Hash lookup mismatch on lookup %d\n", Lookup);
+      UT_ASSERT_TRUE (FALSE);
+    }
+  }
+
+  HashTicks = clock () - Start;
+  UT_LOG_INFO (
+    "%d MMI entries: %d lookups, walk %d us, hash %d us\n",
+    EntryCount,
+    BENCHMARK_LOOKUP_COUNT,
+    (UINT32)(WalkTicks * 1000000 / CLOCKS_PER_SEC),
+    (UINT32)(HashTicks * 1000000 / CLOCKS_PER_SEC)
+    );
+
+  FreePool (Found);
+  FreePool (Keys);
+  FreePool (Entries);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  MMI entry hash and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      HashTests;
+  UNIT_TEST_SUITE_HANDLE      BenchmarkTests;
+  TEST_CONTEXT_BENCHMARK      BenchmarkContext[3];
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the MMI entry hash Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&HashTests, Framework, "MMI Entry Hash Tests", "MmiEntryHash.Lookup", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for HashTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (HashTests, "Hash should only find entries with their own GUID", "InsertFindRemove", MmiEntryHashInsertFindRemove, NULL, NULL, NULL);
+  AddTestCase (HashTests, "Hash should agree with the hashed entries on random operations", "Random", MmiEntryHashRandomOperations, NULL, NULL, NULL);
+
+  //
+  // Populate the lookup benchmark suite, comparing the entry list walk against the hash.
+  //
+  Status = CreateUnitTestSuite (&BenchmarkTests, Framework, "MMI Entry Hash Benchmark", "MmiEntryHash.Benchmark", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BenchmarkTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  BenchmarkContext[0].EntryCount = 10;
+  BenchmarkContext[1].EntryCount = 100;
+  BenchmarkContext[2].EntryCount = 1000;
+  AddTestCase (BenchmarkTests, "Entry lookup with 10 MMI entries", "Lookup10", MmiEntryHashLookupBenchmark, NULL, NULL, &BenchmarkContext[0]);
+  AddTestCase (BenchmarkTests, "Entry lookup with 100 MMI entries", "Lookup100", MmiEntryHashLookupBenchmark, NULL, NULL, &BenchmarkContext[1]);
+  AddTestCase (BenchmarkTests, "Entry lookup with 1000 MMI entries", "Lookup1000", MmiEntryHashLookupBenchmark, NULL, NULL, &BenchmarkContext[2]);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
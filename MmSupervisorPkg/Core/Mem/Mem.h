@@ -357,6 +357,21 @@ SmmSetMemoryAttributes (
   IN  UINT64                Attributes
   );
 
+/**
+  Copy a buffer into pages that are mapped read-only, without changing the
+  page table.
+
+  @param[in]  Destination   The read-only destination of the copy.
+  @param[in]  Source        The source of the copy.
+  @param[in]  Length        The number of bytes to copy.
+**/
+VOID
+CopyMemToReadOnlyPages (
+  OUT VOID        *Destination,
+  IN  CONST VOID  *Source,
+  IN  UINTN       Length
+  );
+
 /**
   This function clears the attributes for the memory region specified by BaseAddress and
   Length from their current attributes to the attributes specified by Attributes.
@@ -627,6 +642,107 @@ GenSmmPageTable (
   IN UINT8        PhysicalAddressBits
   );
 
+/**
+  Return page table entry to match the address.
+
+  @param[in]   PageTableBase      The page table base.
+  @param[in]   Enable5LevelPaging If PML5 paging is enabled.
+  @param[in]   Address            The address to be checked.
+  @param[out]  PageAttributes     The page attribute of the page entry.
+
+  @return The page entry.
+**/
+VOID *
+GetPageTableEntry (
+  IN  UINTN             PageTableBase,
+  IN  BOOLEAN           Enable5LevelPaging,
+  IN  PHYSICAL_ADDRESS  Address,
+  OUT PAGE_ATTRIBUTE    *PageAttribute
+  );
+
+/**
+  Return memory attributes of page entry.
+
+  @param[in]  PageEntry        The page entry.
+
+  @return Memory attributes of page entry.
+**/
+UINT64
+GetAttributesFromPageEntry (
+  IN  UINT64  *PageEntry
+  );
+
+/**
+  Retrieve the attributes of the memory range specified by BaseAddress and
+  Length from the page table. If different attributes are got from different
+  part of the memory range, EFI_NO_MAPPING will be returned.
+
+  @param[in]  PageTableBase       The page table base.
+  @param[in]  Enable5LevelPaging  If PML5 paging is enabled.
+  @param[in]  BaseAddress         The start address of the memory range.
+  @param[in]  Length              The size in bytes of the memory range, must not be 0.
+  @param[out] Attributes          Pointer to attributes returned.
+  @param[out] EntriesRead         Number of page table entries read by the walk,
+                                  for diagnostics.
+
+  @retval EFI_SUCCESS           The attributes got for the memory range.
+  @retval EFI_NO_MAPPING        Attributes are not consistent cross the memory range.
+  @retval EFI_UNSUPPORTED       Part of the memory range is not mapped.
+**/
+EFI_STATUS
+GetPageTableRangeAttributes (
+  IN  UINTN                 PageTableBase,
+  IN  BOOLEAN               Enable5LevelPaging,
+  IN  EFI_PHYSICAL_ADDRESS  BaseAddress,
+  IN  UINT64                Length,
+  OUT UINT64                *Attributes,
+  OUT UINTN                 *EntriesRead  OPTIONAL
+  );
+
+/**
+  Allocate the per CPU page attribute caches, with PcdMmSupervisorPageAttributeCacheEntries
+  rounded down to a power of two entries each.
+
+  @param[in]  NumberOfCpus    Total number of CPUs need to be supported.
+
+  @retval EFI_SUCCESS             The caches are ready, or not enabled.
+  @retval EFI_OUT_OF_RESOURCES    Not enough memory for the caches.
+**/
+EFI_STATUS
+PageAttributeCacheInit (
+  IN UINTN  NumberOfCpus
+  );
+
+/**
+  Drop all the entries of the page attribute caches of all processors. Must be
+  called after any change to the page table.
+**/
+VOID
+InvalidatePageAttributeCache (
+  VOID
+  );
+
+/**
+  Get the attributes of the memory range [Address, Address + Length), from the
+  page attribute cache of the executing CPU when possible. On a miss the range
+  is walked in one pass with GetPageTableRangeAttributes and the result is
+  cached.
+
+  @param[in]  Address       The start address of the range, page aligned.
+  @param[in]  Length        The size in bytes of the range, page aligned and not 0.
+  @param[out] Attributes    The EFI memory attributes shared by the whole range.
+
+  @retval EFI_SUCCESS       The attributes are got for the range.
+  @retval EFI_NO_MAPPING    Attributes are not consistent across the range.
+  @retval EFI_UNSUPPORTED   Part of the range is not mapped.
+**/
+EFI_STATUS
+GetCachedRangeAttributes (
+  IN  EFI_PHYSICAL_ADDRESS  Address,
+  IN  UINT64                Length,
+  OUT UINT64                *Attributes
+  );
+
 /**
   Helper function that will evaluate the page where the input address is located belongs to a
   user page that is mapped inside MM.
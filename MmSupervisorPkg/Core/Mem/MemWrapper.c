@@ -167,13 +167,14 @@ InspectTargetRangeOwnership (
 
   Size &= ~(EFI_PAGE_SIZE - 1);
 
-  // Go through page table and grab the entry attribute
-  Status = SmmGetMemoryAttributes (AlignedAddress, Size, &Attributes);
-  if (!EFI_ERROR (Status)) {
-    *IsUserRange = ((Attributes & EFI_MEMORY_SP) == 0);
+  // All the mappings covering the range need to share the same attributes
+  Status = GetCachedRangeAttributes (AlignedAddress, Size, &Attributes);
+  if (EFI_ERROR (Status)) {
     goto Done;
   }
 
+  *IsUserRange = ((Attributes & EFI_MEMORY_SP) == 0);
+
 Done:
   return Status;
 }
@@ -0,0 +1,246 @@
+/** @file
+  Per processor software TLB of the page attributes used for buffer ownership checks.
+
+  Every pool operation, MMI dispatch and syscall argument check inspects the
+  U/S attribute of the buffers involved, which used to cost a walk of the
+  whole page table each time. Each processor keeps a small direct mapped cache
+  of the ranges it checked, tagged with a generation that is bumped whenever
+  the page table is modified. Misses are resolved with a single range walk of
+  the page table, whose result fills the cache.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Guid/MmSupervisorRequestData.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/SynchronizationLib.h>
+
+#include "MmSupervisorCore.h"
+#include "Mem.h"
+#include "Relocate/Relocate.h"
+#include "Request/Request.h"
+
+typedef struct {
+  //
+  // The range the entry was filled from, all of it shares Attributes. An
+  // entry with Size 0 is empty.
+  //
+  EFI_PHYSICAL_ADDRESS    Base;
+  UINT64                  Size;
+  UINT64                  Attributes;
+  UINT32                  Generation;
+  UINT32                  Reserved;
+} PAGE_ATTRIBUTE_CACHE_ENTRY;
+
+typedef struct {
+  UINT64                        Hits;
+  UINT64                        Misses;
+  PAGE_ATTRIBUTE_CACHE_ENTRY    Entries[1];
+} PAGE_ATTRIBUTE_CACHE;
+
+UINT8            *mPageAttributeCaches         = NULL;
+UINTN            mPageAttributeCacheSize       = 0;
+UINTN            mPageAttributeCacheEntries    = 0;
+UINTN            mPageAttributeCacheCpuCount   = 0;
+volatile UINT32  mPageAttributeCacheGeneration = 1;
+
+/**
+  Get the page attribute cache of the executing CPU.
+
+  Every processor runs on its own SMM stack, both in the supervisor and while
+  serving a syscall, so the stack address identifies the processor without
+  reading the APIC ID.
+
+  @return The cache of the executing CPU, or NULL if the CPU cannot be told.
+**/
+STATIC
+PAGE_ATTRIBUTE_CACHE *
+GetPageAttributeCache (
+  VOID
+  )
+{
+  UINTN  StackAddress;
+  UINTN  CpuIndex;
+
+  StackAddress = (UINTN)&CpuIndex;
+  if ((mSmmStackArrayBase == 0) || (StackAddress < mSmmStackArrayBase)) {
+    return NULL;
+  }
+
+  CpuIndex = (StackAddress - mSmmStackArrayBase) / (mSmmStackSize + mSmmShadowStackSize);
+  if (CpuIndex >= mPageAttributeCacheCpuCount) {
+    return NULL;
+  }
+
+  return (PAGE_ATTRIBUTE_CACHE *)(mPageAttributeCaches + CpuIndex * mPageAttributeCacheSize);
+}
+
+/**
+  Allocate the per CPU page attribute caches, with PcdMmSupervisorPageAttributeCacheEntries
+  rounded down to a power of two entries each.
+
+  @param[in]  NumberOfCpus    Total number of CPUs need to be supported.
+
+  @retval EFI_SUCCESS             The caches are ready, or not enabled.
+  @retval EFI_OUT_OF_RESOURCES    Not enough memory for the caches.
+**/
+EFI_STATUS
+PageAttributeCacheInit (
+  IN UINTN  NumberOfCpus
+  )
+{
+  if (FixedPcdGet32 (PcdMmSupervisorPageAttributeCacheEntries) == 0) {
+    return EFI_SUCCESS;
+  }
+
+  mPageAttributeCacheEntries = GetPowerOfTwo32 (FixedPcdGet32 (PcdMmSupervisorPageAttributeCacheEntries));
+
+  // Keep the caches of different processors on different cache lines
+  mPageAttributeCacheSize = ALIGN_VALUE (
+                              OFFSET_OF (PAGE_ATTRIBUTE_CACHE, Entries) +
+                              sizeof (PAGE_ATTRIBUTE_CACHE_ENTRY) * mPageAttributeCacheEntries,
+                              64
+                              );
+
+  mPageAttributeCaches = AllocateZeroPool (mPageAttributeCacheSize * NumberOfCpus);
+  if (mPageAttributeCaches == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mPageAttributeCacheCpuCount = NumberOfCpus;
+  return EFI_SUCCESS;
+}
+
+/**
+  Drop all the entries of the page attribute caches of all processors. Must be
+  called after any change to the page table.
+**/
+VOID
+InvalidatePageAttributeCache (
+  VOID
+  )
+{
+  InterlockedIncrement (&mPageAttributeCacheGeneration);
+}
+
+/**
+  Get the attributes of the memory range [Address, Address + Length), from the
+  page attribute cache of the executing CPU when possible. On a miss the range
+  is walked in one pass with GetPageTableRangeAttributes and the result is
+  cached.
+
+  @param[in]  Address       The start address of the range, page aligned.
+  @param[in]  Length        The size in bytes of the range, page aligned and not 0.
+  @param[out] Attributes    The EFI memory attributes shared by the whole range.
+
+  @retval EFI_SUCCESS       The attributes are got for the range.
+  @retval EFI_NO_MAPPING    Attributes are not consistent across the range.
+  @retval EFI_UNSUPPORTED   Part of the range is not mapped.
+**/
+EFI_STATUS
+GetCachedRangeAttributes (
+  IN  EFI_PHYSICAL_ADDRESS  Address,
+  IN  UINT64                Length,
+  OUT UINT64                *Attributes
+  )
+{
+  EFI_STATUS                  Status;
+  PAGE_ATTRIBUTE_CACHE        *Cache;
+  PAGE_ATTRIBUTE_CACHE_ENTRY  *Entry;
+  UINT32                      Generation;
+  UINTN                       PageTableBase;
+  BOOLEAN                     EnablePML5Paging;
+
+  // The page table is still being built and may not be the active one before the core is done
+  Cache = NULL;
+  Entry = NULL;
+  if (mCoreInitializationComplete && (mPageAttributeCaches != NULL)) {
+    Cache = GetPageAttributeCache ();
+  }
+
+  // Read the generation before the walk, so that an update racing with it leaves a stale entry
+  Generation = mPageAttributeCacheGeneration;
+  if (Cache != NULL) {
+    Entry = &Cache->Entries[(UINTN)RShiftU64 (Address, EFI_PAGE_SHIFT) & (mPageAttributeCacheEntries - 1)];
+    if ((Entry->Generation == Generation) &&
+        (Address >= Entry->Base) &&
+        (Length <= Entry->Size) &&
+        (Address - Entry->Base <= Entry->Size - Length))
+    {
+      Cache->Hits++;
+      *Attributes = Entry->Attributes;
+      return EFI_SUCCESS;
+    }
+
+    Cache->Misses++;
+  }
+
+  GetPageTable (&PageTableBase, &EnablePML5Paging);
+  Status = GetPageTableRangeAttributes (PageTableBase, EnablePML5Paging, Address, Length, Attributes, NULL);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (Entry != NULL) {
+    Entry->Base       = Address;
+    Entry->Size       = Length;
+    Entry->Attributes = *Attributes;
+    Entry->Generation = Generation;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Routine used to report the hit rate of the page attribute caches, summed up
+  over all processors.
+
+  @param[in, out] CacheBuffer   Buffer to hold the counters. The counters are
+                                cleared if MM_SUPERVISOR_PAGE_ATTRIBUTE_CACHE_RESET
+                                is set in its Flags.
+
+  @retval EFI_SUCCESS             The counters are copied out.
+  @retval EFI_INVALID_PARAMETER   CacheBuffer is NULL.
+  @retval EFI_UNSUPPORTED         The page attribute cache is not enabled.
+**/
+EFI_STATUS
+ProcessPageAttributeCacheRequest (
+  IN OUT MM_SUPERVISOR_PAGE_ATTRIBUTE_CACHE_BUFFER  *CacheBuffer
+  )
+{
+  PAGE_ATTRIBUTE_CACHE  *Cache;
+  UINTN                 CpuIndex;
+
+  if (CacheBuffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (mPageAttributeCaches == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+
+  CacheBuffer->Hits          = 0;
+  CacheBuffer->Misses        = 0;
+  CacheBuffer->Invalidations = mPageAttributeCacheGeneration - 1;
+  for (CpuIndex = 0; CpuIndex < mPageAttributeCacheCpuCount; CpuIndex++) {
+    Cache                = (PAGE_ATTRIBUTE_CACHE *)(mPageAttributeCaches + CpuIndex * mPageAttributeCacheSize);
+    CacheBuffer->Hits   += Cache->Hits;
+    CacheBuffer->Misses += Cache->Misses;
+    if ((CacheBuffer->Flags & MM_SUPERVISOR_PAGE_ATTRIBUTE_CACHE_RESET) != 0) {
+      Cache->Hits   = 0;
+      Cache->Misses = 0;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
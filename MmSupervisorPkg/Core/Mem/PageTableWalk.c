@@ -0,0 +1,152 @@
+/** @file
+  Range walk of the MM page table.
+
+  The attributes of a memory range used to be collected with one root to leaf
+  walk for every page of the range. The range walk below descends once, then
+  moves sideways across the sibling entries of each level and only climbs up
+  when a table has been walked to its end.
+
+  Copyright (c) 2016 - 2023, Intel Corporation. All rights reserved.<BR>
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Library/BaseLib.h>
+
+#include "Mem.h"
+
+/**
+  Return memory attributes of page entry.
+
+  @param[in]  PageEntry        The page entry.
+
+  @return Memory attributes of page entry.
+**/
+UINT64
+GetAttributesFromPageEntry (
+  IN  UINT64  *PageEntry
+  )
+{
+  UINT64  Attributes;
+
+  Attributes = 0;
+  if ((*PageEntry & IA32_PG_P) == 0) {
+    Attributes |= EFI_MEMORY_RP;
+  }
+
+  if ((*PageEntry & IA32_PG_RW) == 0) {
+    Attributes |= EFI_MEMORY_RO;
+  }
+
+  if ((*PageEntry & IA32_PG_NX) != 0) {
+    Attributes |= EFI_MEMORY_XP;
+  }
+
+  if ((*PageEntry & IA32_PG_U) == 0) {
+    // UINT64  UserSupervisor:1;         // 0 = Supervisor, 1=User
+    Attributes |= EFI_MEMORY_SP;
+  }
+
+  return Attributes;
+}
+
+/**
+  Retrieve the attributes of the memory range specified by BaseAddress and
+  Length from the page table. If different attributes are got from different
+  part of the memory range, EFI_NO_MAPPING will be returned.
+
+  @param[in]  PageTableBase       The page table base.
+  @param[in]  Enable5LevelPaging  If PML5 paging is enabled.
+  @param[in]  BaseAddress         The start address of the memory range.
+  @param[in]  Length              The size in bytes of the memory range, must not be 0.
+  @param[out] Attributes          Pointer to attributes returned.
+  @param[out] EntriesRead         Number of page table entries read by the walk,
+                                  for diagnostics.
+
+  @retval EFI_SUCCESS           The attributes got for the memory range.
+  @retval EFI_NO_MAPPING        Attributes are not consistent cross the memory range.
+  @retval EFI_UNSUPPORTED       Part of the memory range is not mapped.
+**/
+EFI_STATUS
+GetPageTableRangeAttributes (
+  IN  UINTN                 PageTableBase,
+  IN  BOOLEAN               Enable5LevelPaging,
+  IN  EFI_PHYSICAL_ADDRESS  BaseAddress,
+  IN  UINT64                Length,
+  OUT UINT64                *Attributes,
+  OUT UINTN                 *EntriesRead  OPTIONAL
+  )
+{
+  EFI_STATUS  Status;
+  UINT64      *Tables[6];
+  UINTN       TopLevel;
+  UINTN       Level;
+  UINTN       Shift;
+  UINT64      Entry;
+  UINT64      MemAttr;
+  UINT64      Step;
+  UINTN       Reads;
+
+  if (sizeof (UINTN) == sizeof (UINT64)) {
+    TopLevel = Enable5LevelPaging ? 5 : 4;
+  } else {
+    TopLevel = 3;
+  }
+
+  // Tables[Level] is the table walked at Level, level 1 holds the 4K entries
+  Tables[TopLevel] = (UINT64 *)PageTableBase;
+  Level            = TopLevel;
+  MemAttr          = MAX_UINT64;
+  Reads            = 0;
+  Status           = EFI_SUCCESS;
+
+  while (TRUE) {
+    Shift = 12 + 9 * (Level - 1);
+    Entry = Tables[Level][(UINTN)RShiftU64 (BaseAddress, Shift) & PAGING_PAE_INDEX_MASK];
+    Reads++;
+
+    // A zero 4K entry still maps address 0 as not present
+    if ((Entry == 0) && ((Level > 1) || (BaseAddress != 0))) {
+      Status = EFI_UNSUPPORTED;
+      break;
+    }
+
+    // Only 1G and 2M entries can be leaves above level 1
+    if ((Level > 3) || ((Level > 1) && ((Entry & IA32_PG_PS) == 0))) {
+      Tables[Level - 1] = (UINT64 *)(UINTN)(Entry & ~mAddressEncMask & PAGING_4K_ADDRESS_MASK_64);
+      Level--;
+      continue;
+    }
+
+    *Attributes = GetAttributesFromPageEntry (&Entry);
+    if ((MemAttr != MAX_UINT64) && (*Attributes != MemAttr)) {
+      Status = EFI_NO_MAPPING;
+      break;
+    }
+
+    MemAttr = *Attributes;
+
+    Step = LShiftU64 (1, Shift) - (BaseAddress & (LShiftU64 (1, Shift) - 1));
+    if (Step >= Length) {
+      break;
+    }
+
+    BaseAddress += Step;
+    Length      -= Step;
+
+    // Move to the next sibling, climbing up past every table walked to its end
+    while ((Level < TopLevel) && (((UINTN)RShiftU64 (BaseAddress, 12 + 9 * (Level - 1)) & PAGING_PAE_INDEX_MASK) == 0)) {
+      Level++;
+    }
+  }
+
+  if (EntriesRead != NULL) {
+    *EntriesRead = Reads;
+  }
+
+  return Status;
+}
@@ -147,6 +147,31 @@ SmmWriteProtectReadOnlyPage (
   }
 }
 
+/**
+  Copy a buffer into pages that are mapped read-only, without changing the
+  page table.
+
+  @param[in]  Destination   The read-only destination of the copy.
+  @param[in]  Source        The source of the copy.
+  @param[in]  Length        The number of bytes to copy.
+**/
+VOID
+CopyMemToReadOnlyPages (
+  OUT VOID        *Destination,
+  IN  CONST VOID  *Source,
+  IN  UINTN       Length
+  )
+{
+  BOOLEAN  WriteProtect;
+  BOOLEAN  CetEnabled;
+
+  WRITE_UNPROTECT_RO_PAGES (WriteProtect, CetEnabled);
+
+  CopyMem (Destination, Source, Length);
+
+  WRITE_PROTECT_RO_PAGES (WriteProtect, CetEnabled);
+}
+
 /**
   Initialize a buffer pool for page table use only.
 
@@ -375,41 +400,6 @@ GetPageTableEntry (
   return &L1PageTable[Index1];
 }
 
-/**
-  Return memory attributes of page entry.
-
-  @param[in]  PageEntry        The page entry.
-
-  @return Memory attributes of page entry.
-**/
-UINT64
-GetAttributesFromPageEntry (
-  IN  UINT64  *PageEntry
-  )
-{
-  UINT64  Attributes;
-
-  Attributes = 0;
-  if ((*PageEntry & IA32_PG_P) == 0) {
-    Attributes |= EFI_MEMORY_RP;
-  }
-
-  if ((*PageEntry & IA32_PG_RW) == 0) {
-    Attributes |= EFI_MEMORY_RO;
-  }
-
-  if ((*PageEntry & IA32_PG_NX) != 0) {
-    Attributes |= EFI_MEMORY_XP;
-  }
-
-  if ((*PageEntry & IA32_PG_U) == 0) {
-    // UINT64  UserSupervisor:1;         // 0 = Supervisor, 1=User
-    Attributes |= EFI_MEMORY_SP;
-  }
-
-  return Attributes;
-}
-
 /**
   This function modifies the page attributes for the memory region specified by BaseAddress and
   Length from their current attributes to the attributes specified by Attributes.
@@ -575,6 +565,10 @@ ConvertMemoryPageAttributes (
 
   WRITE_PROTECT_RO_PAGES (WriteProtect, CetEnabled);
 
+  if ((IsModified == NULL) || *IsModified) {
+    InvalidatePageAttributeCache ();
+  }
+
   if (Status == RETURN_INVALID_PARAMETER) {
     //
     // The only reason that PageTableMap returns RETURN_INVALID_PARAMETER here is to modify other attributes
@@ -613,6 +607,7 @@ FlushTlbForAll (
 {
   UINTN  Index;
 
+  InvalidatePageAttributeCache ();
   FlushTlbOnCurrentProcessor (NULL);
 
   for (Index = 0; Index < gMmCoreMmst.NumberOfCpus; Index++) {
@@ -1535,14 +1530,10 @@ SmmGetMemoryAttributes (
   OUT UINT64                *Attributes
   )
 {
-  EFI_PHYSICAL_ADDRESS  Address;
-  UINT64                *PageEntry;
-  UINT64                MemAttr;
-  PAGE_ATTRIBUTE        PageAttr;
-  INT64                 Size;
-  UINTN                 PageTableBase;
-  BOOLEAN               EnablePML5Paging;
-  EFI_STATUS            Status;   // MU_CHANGE: Avoid Length overflow for INT64
+  INT64       Size;
+  UINTN       PageTableBase;
+  BOOLEAN     EnablePML5Paging;
+  EFI_STATUS  Status;             // MU_CHANGE: Avoid Length overflow for INT64
 
   if ((Length < SIZE_4KB) || (Attributes == NULL)) {
     return EFI_INVALID_PARAMETER;
@@ -1557,52 +1548,15 @@ SmmGetMemoryAttributes (
   }
 
   // MU_CHANGE Ends
-  MemAttr = (UINT64)-1;
 
   GetPageTable (&PageTableBase, &EnablePML5Paging);
 
-  do {
-    PageEntry = GetPageTableEntry (PageTableBase, EnablePML5Paging, BaseAddress, &PageAttr);
-    if ((PageEntry == NULL) || (PageAttr == PageNone)) {
-      return EFI_UNSUPPORTED;
-    }
-
-    //
-    // If the memory range is cross page table boundary, make sure they
-    // share the same attribute. Return EFI_NO_MAPPING if not.
-    //
-    *Attributes = GetAttributesFromPageEntry (PageEntry);
-    if ((MemAttr != (UINT64)-1) && (*Attributes != MemAttr)) {
-      return EFI_NO_MAPPING;
-    }
-
-    switch (PageAttr) {
-      case Page4K:
-        Address      = *PageEntry & ~mAddressEncMask & PAGING_4K_ADDRESS_MASK_64;
-        Size        -= (SIZE_4KB - (BaseAddress - Address));
-        BaseAddress += (SIZE_4KB - (BaseAddress - Address));
-        break;
-
-      case Page2M:
-        Address      = *PageEntry & ~mAddressEncMask & PAGING_2M_ADDRESS_MASK_64;
-        Size        -= SIZE_2MB - (BaseAddress - Address);
-        BaseAddress += SIZE_2MB - (BaseAddress - Address);
-        break;
-
-      case Page1G:
-        Address      = *PageEntry & ~mAddressEncMask & PAGING_1G_ADDRESS_MASK_64;
-        Size        -= SIZE_1GB - (BaseAddress - Address);
-        BaseAddress += SIZE_1GB - (BaseAddress - Address);
-        break;
-
-      default:
-        return EFI_UNSUPPORTED;
-    }
-
-    MemAttr = *Attributes;
-  } while (Size > 0);
-
-  return EFI_SUCCESS;
+  //
+  // Walk the range in one pass over the page table. If the memory range is
+  // cross page table boundary, make sure they share the same attribute.
+  // Return EFI_NO_MAPPING if not.
+  //
+  return GetPageTableRangeAttributes (PageTableBase, EnablePML5Paging, BaseAddress, Length, Attributes, NULL);
 }
 
 /**
@@ -267,6 +267,7 @@ DebugExceptionHandler (
   //
   // Flush TLB
   //
+  InvalidatePageAttributeCache ();
   CpuFlushTlb ();
 
   //
@@ -1235,6 +1236,7 @@ GuardPagePFHandler (
   //
   // Flush TLB
   //
+  InvalidatePageAttributeCache ();
   CpuFlushTlb ();
 }
 
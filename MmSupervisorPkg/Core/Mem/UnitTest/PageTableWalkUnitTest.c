@@ -0,0 +1,721 @@
+/** @file
+  Unit tests of the page table range walk used by SmmGetMemoryAttributes
+
+  The range walk is checked against the former per page root to leaf walk on
+  synthetic identity mapped page tables, for both the attributes reported and
+  the number of page table entries read.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include <PiMm.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../Mem.h"
+
+#define UNIT_TEST_APP_NAME     "Page Table Range Walk Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_TABLE_POOL_PAGES  2048
+#define TEST_WINDOW_SIZE       SIZE_4GB
+#define RANDOM_QUERIES         20000
+#define BENCHMARK_ROUNDS       50
+
+//
+// The core masks the page table entries with it, it is not encrypting anything here.
+//
+UINT64  mAddressEncMask = 0;
+
+typedef struct {
+  UINT8    *Base;
+  UINTN    Used;
+} TEST_TABLE_POOL;
+
+typedef struct {
+  BOOLEAN    Enable5LevelPaging;
+} TEST_CONTEXT_PAGING;
+
+TEST_TABLE_POOL  mTablePool;
+
+/**
+  Advance a linear congruential generator.
+
+  @param[in, out] Seed    The generator state.
+
+  @return The next pseudo random value.
+**/
+STATIC
+UINT32
+NextRandom (
+  IN OUT UINT32  *Seed
+  )
+{
+  *Seed = *Seed * 1103515245 + 12345;
+  return *Seed >> 8;
+}
+
+/**
+  Hand out one zeroed page table from the test pool.
+
+  @return The new table, or NULL if the pool is exhausted.
+**/
+STATIC
+UINT64 *
+AllocateTestTable (
+  VOID
+  )
+{
+  UINT64  *Table;
+
+  if (mTablePool.Used >= TEST_TABLE_POOL_PAGES) {
+    return NULL;
+  }
+
+  Table = (UINT64 *)(mTablePool.Base + EFI_PAGES_TO_SIZE (mTablePool.Used++));
+  ZeroMem (Table, EFI_PAGE_SIZE);
+  return Table;
+}
+
+/**
+  Get the level of the root table for the paging mode.
+
+  @param[in]  Enable5LevelPaging  If PML5 paging is enabled.
+
+  @return The level of the root table.
+**/
+STATIC
+UINTN
+GetTopLevel (
+  IN BOOLEAN  Enable5LevelPaging
+  )
+{
+  return Enable5LevelPaging ? 5 : 4;
+}
+
+/**
+  Identity map one page of LeafLevel into the synthetic page table, creating
+  the intermediate tables on the way.
+
+  @param[in]  Root                The root table.
+  @param[in]  Enable5LevelPaging  If PML5 paging is enabled.
+  @param[in]  Address             The address to map, aligned on the page size.
+  @param[in]  LeafLevel           1 for 4K, 2 for 2M, 3 for 1G pages.
+  @param[in]  Flags               The IA32_PG_* bits of the leaf entry.
+
+  @retval TRUE    The page is mapped.
+  @retval FALSE   The table pool is exhausted.
+**/
+STATIC
+BOOLEAN
+MapTestPage (
+  IN UINT64                *Root,
+  IN BOOLEAN               Enable5LevelPaging,
+  IN EFI_PHYSICAL_ADDRESS  Address,
+  IN UINTN                 LeafLevel,
+  IN UINT64                Flags
+  )
+{
+  UINT64  *Table;
+  UINT64  *Next;
+  UINTN   Level;
+  UINTN   Index;
+
+  Table = Root;
+  for (Level = GetTopLevel (Enable5LevelPaging); Level > LeafLevel; Level--) {
+    Index = (UINTN)RShiftU64 (Address, 12 + 9 * (Level - 1)) & PAGING_PAE_INDEX_MASK;
+    if (Table[Index] == 0) {
+      Next = AllocateTestTable ();
+      if (Next == NULL) {
+        return FALSE;
+      }
+
+      Table[Index] = (UINT64)(UINTN)Next | IA32_PG_P | IA32_PG_RW | IA32_PG_U;
+    }
+
+    Table = (UINT64 *)(UINTN)(Table[Index] & PAGING_4K_ADDRESS_MASK_64);
+  }
+
+  Index        = (UINTN)RShiftU64 (Address, 12 + 9 * (LeafLevel - 1)) & PAGING_PAE_INDEX_MASK;
+  Table[Index] = Address | Flags | ((LeafLevel > 1) ? IA32_PG_PS : 0);
+  return TRUE;
+}
+
+/**
+  Pick the flags of a leaf entry, mostly keeping the ones of its parent so that
+  ranges of identical attributes exist across page sizes.
+
+  @param[in, out] Seed    The generator state.
+  @param[in]      Parent  The flags to inherit.
+
+  @return The IA32_PG_* bits of the leaf entry.
+**/
+STATIC
+UINT64
+PickTestFlags (
+  IN OUT UINT32  *Seed,
+  IN     UINT64  Parent
+  )
+{
+  UINT32  Random;
+
+  Random = NextRandom (Seed);
+  if ((Random % 64) != 0) {
+    return Parent;
+  }
+
+  // Mostly present pages, with the occasional not present one
+  Random >>= 6;
+  return (((Random & (BIT0 | BIT1 | BIT2)) != 0) ? IA32_PG_P : 0) |
+         (((Random & BIT3) != 0) ? IA32_PG_RW : 0) |
+         (((Random & BIT4) != 0) ? IA32_PG_U : 0) |
+         (((Random & BIT5) != 0) ? IA32_PG_NX : 0);
+}
+
+/**
+  Build a synthetic page table identity mapping a window of TEST_WINDOW_SIZE
+  centered on Boundary with a random mix of 1G, 2M and 4K pages and holes.
+
+  @param[in]  Seed                The seed of the layout.
+  @param[in]  Enable5LevelPaging  If PML5 paging is enabled.
+  @param[in]  Boundary            The center of the window.
+
+  @return The root table, or NULL if the table pool is exhausted.
+**/
+STATIC
+UINT64 *
+BuildTestPageTable (
+  IN UINT32                Seed,
+  IN BOOLEAN               Enable5LevelPaging,
+  IN EFI_PHYSICAL_ADDRESS  Boundary
+  )
+{
+  UINT64                *Root;
+  EFI_PHYSICAL_ADDRESS  Address1G;
+  EFI_PHYSICAL_ADDRESS  Address2M;
+  EFI_PHYSICAL_ADDRESS  Address4K;
+  UINT64                Flags1G;
+  UINT64                Flags2M;
+  UINT32                Random;
+
+  mTablePool.Used = 0;
+  Root            = AllocateTestTable ();
+  if (Root == NULL) {
+    return NULL;
+  }
+
+  Flags1G = IA32_PG_P | IA32_PG_RW | IA32_PG_U;
+  for (Address1G = Boundary - TEST_WINDOW_SIZE / 2; Address1G < Boundary + TEST_WINDOW_SIZE / 2; Address1G += SIZE_1GB) {
+    Flags1G = PickTestFlags (&Seed, Flags1G);
+    Random  = NextRandom (&Seed) % 8;
+    if (Random == 0) {
+      continue;
+    }
+
+    if (Random < 3) {
+      if (!MapTestPage (Root, Enable5LevelPaging, Address1G, 3, Flags1G)) {
+        return NULL;
+      }
+
+      continue;
+    }
+
+    Flags2M = Flags1G;
+    for (Address2M = Address1G; Address2M < Address1G + SIZE_1GB; Address2M += SIZE_2MB) {
+      Flags2M = PickTestFlags (&Seed, Flags2M);
+      Random  = NextRandom (&Seed) % 32;
+      if (Random == 0) {
+        continue;
+      }
+
+      if (Random < 20) {
+        if (!MapTestPage (Root, Enable5LevelPaging, Address2M, 2, Flags2M)) {
+          return NULL;
+        }
+
+        continue;
+      }
+
+      for (Address4K = Address2M; Address4K < Address2M + SIZE_2MB; Address4K += SIZE_4KB) {
+        if ((NextRandom (&Seed) % 1024) == 0) {
+          continue;
+        }
+
+        if (!MapTestPage (Root, Enable5LevelPaging, Address4K, 1, PickTestFlags (&Seed, Flags2M))) {
+          return NULL;
+        }
+      }
+    }
+  }
+
+  return Root;
+}
+
+/**
+  The former page table lookup of SmmGetMemoryAttributes, one root to leaf
+  walk per call.
+
+  @param[in]   PageTableBase      The page table base.
+  @param[in]   Enable5LevelPaging If PML5 paging is enabled.
+  @param[in]   Address            The address to be checked.
+  @param[out]  PageAttribute      The page attribute of the page entry.
+  @param[in, out] EntriesRead     Incremented for every entry read.
+
+  @return The page entry.
+**/
+STATIC
+UINT64 *
+ReferenceGetPageTableEntry (
+  IN     UINTN             PageTableBase,
+  IN     BOOLEAN           Enable5LevelPaging,
+  IN     PHYSICAL_ADDRESS  Address,
+  OUT    PAGE_ATTRIBUTE    *PageAttribute,
+  IN OUT UINTN             *EntriesRead
+  )
+{
+  UINT64  *Table;
+  UINTN   Level;
+  UINTN   Index;
+
+  Table = (UINT64 *)PageTableBase;
+  for (Level = GetTopLevel (Enable5LevelPaging); Level > 1; Level--) {
+    Index = (UINTN)RShiftU64 (Address, 12 + 9 * (Level - 1)) & PAGING_PAE_INDEX_MASK;
+    (*EntriesRead)++;
+    if (Table[Index] == 0) {
+      *PageAttribute = PageNone;
+      return NULL;
+    }
+
+    if ((Level <= 3) && ((Table[Index] & IA32_PG_PS) != 0)) {
+      *PageAttribute = (Level == 3) ? Page1G : Page2M;
+      return &Table[Index];
+    }
+
+    Table = (UINT64 *)(UINTN)(Table[Index] & ~mAddressEncMask & PAGING_4K_ADDRESS_MASK_64);
+  }
+
+  Index = (UINTN)RShiftU64 (Address, 12) & PAGING_PAE_INDEX_MASK;
+  (*EntriesRead)++;
+  if ((Table[Index] == 0) && (Address != 0)) {
+    *PageAttribute = PageNone;
+    return NULL;
+  }
+
+  *PageAttribute = Page4K;
+  return &Table[Index];
+}
+
+/**
+  The former range loop of SmmGetMemoryAttributes.
+
+  @param[in]  PageTableBase       The page table base.
+  @param[in]  Enable5LevelPaging  If PML5 paging is enabled.
+  @param[in]  BaseAddress         The start address of the memory range.
+  @param[in]  Length              The size in bytes of the memory range.
+  @param[out] Attributes          Pointer to attributes returned.
+  @param[out] EntriesRead         Number of page table entries read.
+
+  @return The status SmmGetMemoryAttributes used to return.
+**/
+STATIC
+EFI_STATUS
+ReferenceGetRangeAttributes (
+  IN  UINTN                 PageTableBase,
+  IN  BOOLEAN               Enable5LevelPaging,
+  IN  EFI_PHYSICAL_ADDRESS  BaseAddress,
+  IN  UINT64                Length,
+  OUT UINT64                *Attributes,
+  OUT UINTN                 *EntriesRead
+  )
+{
+  EFI_PHYSICAL_ADDRESS  Address;
+  UINT64                *PageEntry;
+  UINT64                MemAttr;
+  PAGE_ATTRIBUTE        PageAttr;
+  INT64                 Size;
+
+  Size         = (INT64)Length;
+  MemAttr      = (UINT64)-1;
+  *EntriesRead = 0;
+
+  do {
+    PageEntry = ReferenceGetPageTableEntry (PageTableBase, Enable5LevelPaging, BaseAddress, &PageAttr, EntriesRead);
+    if ((PageEntry == NULL) || (PageAttr == PageNone)) {
+      return EFI_UNSUPPORTED;
+    }
+
+    *Attributes = GetAttributesFromPageEntry (PageEntry);
+    if ((MemAttr != (UINT64)-1) && (*Attributes != MemAttr)) {
+      return EFI_NO_MAPPING;
+    }
+
+    switch (PageAttr) {
+      case Page4K:
+        Address      = *PageEntry & ~mAddressEncMask & PAGING_4K_ADDRESS_MASK_64;
+        Size        -= (SIZE_4KB - (BaseAddress - Address));
+        BaseAddress += (SIZE_4KB - (BaseAddress - Address));
+        break;
+
+      case Page2M:
+        Address      = *PageEntry & ~mAddressEncMask & PAGING_2M_ADDRESS_MASK_64;
+        Size        -= SIZE_2MB - (BaseAddress - Address);
+        BaseAddress += SIZE_2MB - (BaseAddress - Address);
+        break;
+
+      case Page1G:
+        Address      = *PageEntry & ~mAddressEncMask & PAGING_1G_ADDRESS_MASK_64;
+        Size        -= SIZE_1GB - (BaseAddress - Address);
+        BaseAddress += SIZE_1GB - (BaseAddress - Address);
+        break;
+
+      default:
+        return EFI_UNSUPPORTED;
+    }
+
+    MemAttr = *Attributes;
+  } while (Size > 0);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the boundary the synthetic window is centered on, so that the walks have
+  to climb up to the root table in the middle of the window.
+
+  @param[in]  Enable5LevelPaging  If PML5 paging is enabled.
+
+  @return The window center.
+**/
+STATIC
+EFI_PHYSICAL_ADDRESS
+GetTestBoundary (
+  IN BOOLEAN  Enable5LevelPaging
+  )
+{
+  return Enable5LevelPaging ? LShiftU64 (1, 48) : LShiftU64 (1, 39);
+}
+
+/**
+  A range of 4K pages crossing the boundary of two root entries has to be
+  walked with one read per entry of every level, instead of one full walk
+  per page.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RangeWalkReadsEachEntryOnce (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT64                *Root;
+  EFI_PHYSICAL_ADDRESS  Boundary;
+  EFI_PHYSICAL_ADDRESS  Address;
+  UINT64                Attributes;
+  UINT64                ReferenceAttributes;
+  UINTN                 EntriesRead;
+  UINTN                 ReferenceEntriesRead;
+
+  mTablePool.Used = 0;
+  Root            = AllocateTestTable ();
+  UT_ASSERT_NOT_NULL (Root);
+
+  // 8MB of 4K pages on each side of the boundary
+  Boundary = GetTestBoundary (FALSE);
+  for (Address = Boundary - SIZE_8MB; Address < Boundary + SIZE_8MB; Address += SIZE_4KB) {
+    UT_ASSERT_TRUE (MapTestPage (Root, FALSE, Address, 1, IA32_PG_P | IA32_PG_RW | IA32_PG_NX));
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (GetPageTableRangeAttributes ((UINTN)Root, FALSE, Boundary - SIZE_8MB, SIZE_16MB, &Attributes, &EntriesRead));
+  UT_ASSERT_NOT_EFI_ERROR (ReferenceGetRangeAttributes ((UINTN)Root, FALSE, Boundary - SIZE_8MB, SIZE_16MB, &ReferenceAttributes, &ReferenceEntriesRead));
+  UT_ASSERT_EQUAL (Attributes, EFI_MEMORY_XP | EFI_MEMORY_SP);
+  UT_ASSERT_EQUAL (Attributes, ReferenceAttributes);
+
+  // 2 root entries, 2 1G entries, 8 2M entries and 4096 4K entries
+  UT_ASSERT_EQUAL (EntriesRead, 2 + 2 + 8 + 4096);
+  UT_ASSERT_EQUAL (ReferenceEntriesRead, 4 * 4096);
+
+  // Holes and attribute changes stop the walk on the first offending page
+  Root[1] = 0;
+  UT_ASSERT_STATUS_EQUAL (GetPageTableRangeAttributes ((UINTN)Root, FALSE, Boundary - SIZE_8MB, SIZE_16MB, &Attributes, NULL), EFI_UNSUPPORTED);
+  UT_ASSERT_NOT_EFI_ERROR (GetPageTableRangeAttributes ((UINTN)Root, FALSE, Boundary - SIZE_8MB, SIZE_8MB, &Attributes, NULL));
+
+  UT_ASSERT_TRUE (MapTestPage (Root, FALSE, Boundary - SIZE_4MB, 1, IA32_PG_P | IA32_PG_NX));
+  UT_ASSERT_STATUS_EQUAL (GetPageTableRangeAttributes ((UINTN)Root, FALSE, Boundary - SIZE_8MB, SIZE_8MB, &Attributes, NULL), EFI_NO_MAPPING);
+  UT_ASSERT_NOT_EFI_ERROR (GetPageTableRangeAttributes ((UINTN)Root, FALSE, Boundary - SIZE_8MB, SIZE_4MB, &Attributes, NULL));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Random ranges over a random mix of page sizes, holes and attributes have to
+  get the same result from the range walk as from the per page walk, without
+  ever reading more entries.
+
+  @param[in]  Context    The paging mode to test.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RangeWalkMatchesReference (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  BOOLEAN               Enable5LevelPaging;
+  UINT64                *Root;
+  EFI_PHYSICAL_ADDRESS  WindowBase;
+  EFI_PHYSICAL_ADDRESS  BaseAddress;
+  UINT64                Length;
+  UINT64                Attributes;
+  UINT64                ReferenceAttributes;
+  UINTN                 EntriesRead;
+  UINTN                 ReferenceEntriesRead;
+  UINTN                 TotalEntriesRead;
+  UINTN                 TotalReferenceEntriesRead;
+  EFI_STATUS            Status;
+  EFI_STATUS            ReferenceStatus;
+  UINT32                Seed;
+  UINTN                 Query;
+
+  Enable5LevelPaging = ((TEST_CONTEXT_PAGING *)Context)->Enable5LevelPaging;
+  Root               = BuildTestPageTable (0xC0FFEE, Enable5LevelPaging, GetTestBoundary (Enable5LevelPaging));
+  UT_ASSERT_NOT_NULL (Root);
+
+  WindowBase                = GetTestBoundary (Enable5LevelPaging) - TEST_WINDOW_SIZE / 2;
+  TotalEntriesRead          = 0;
+  TotalReferenceEntriesRead = 0;
+  Seed                      = 0x5EED;
+  for (Query = 0; Query < RANDOM_QUERIES; Query++) {
+    BaseAddress = WindowBase + ((UINT64)NextRandom (&Seed) << 8) % (TEST_WINDOW_SIZE - SIZE_1GB);
+    if ((Query % 4) != 0) {
+      BaseAddress &= ~(UINT64)(SIZE_4KB - 1);
+    }
+
+    switch (Query % 3) {
+      case 0:
+        Length = SIZE_4KB + NextRandom (&Seed) % SIZE_64KB;
+        break;
+      case 1:
+        Length = SIZE_4KB + NextRandom (&Seed) % SIZE_16MB;
+        break;
+      default:
+        Length = SIZE_4KB + ((UINT64)NextRandom (&Seed) << 6) % SIZE_1GB;
+        break;
+    }
+
+    Status          = GetPageTableRangeAttributes ((UINTN)Root, Enable5LevelPaging, BaseAddress, Length, &Attributes, &EntriesRead);
+    ReferenceStatus = ReferenceGetRangeAttributes ((UINTN)Root, Enable5LevelPaging, BaseAddress, Length, &ReferenceAttributes, &ReferenceEntriesRead);
+    if ((Status != ReferenceStatus) || (!EFI_ERROR (Status) && (Attributes != ReferenceAttributes))) {
+      UT_LOG_ERROR (
+        "0x%lx + 0x%lx: %r 0x%lx, expected %r 0x%lx\n",
+        BaseAddress,
+        Length,
+        Status,
+        Attributes,
+        ReferenceStatus,
+        ReferenceAttributes
+        );
+      UT_ASSERT_TRUE (FALSE);
+    }
+
+    UT_ASSERT_TRUE (EntriesRead <= ReferenceEntriesRead);
+    TotalEntriesRead          += EntriesRead;
+    TotalReferenceEntriesRead += ReferenceEntriesRead;
+  }
+
+  UT_LOG_INFO (
+    "%d level paging, %d ranges: %ld entries read, %ld with per page walks\n",
+    GetTopLevel (Enable5LevelPaging),
+    RANDOM_QUERIES,
+    (UINT64)TotalEntriesRead,
+    (UINT64)TotalReferenceEntriesRead
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Time the validation of a 64MB buffer of 4K pages with both walks.
+
+  @param[in]  Context    The paging mode to test.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RangeWalkBenchmark (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  BOOLEAN               Enable5LevelPaging;
+  UINT64                *Root;
+  EFI_PHYSICAL_ADDRESS  Boundary;
+  EFI_PHYSICAL_ADDRESS  Address;
+  UINT64                Attributes;
+  UINTN                 EntriesRead;
+  UINTN                 ReferenceEntriesRead;
+  UINTN                 Round;
+  clock_t               Start;
+  clock_t               WalkTicks;
+  clock_t               ReferenceTicks;
+
+  Enable5LevelPaging = ((TEST_CONTEXT_PAGING *)Context)->Enable5LevelPaging;
+  mTablePool.Used    = 0;
+  Root               = AllocateTestTable ();
+  UT_ASSERT_NOT_NULL (Root);
+
+  Boundary = GetTestBoundary (Enable5LevelPaging);
+  for (Address = Boundary - SIZE_32MB; Address < Boundary + SIZE_32MB; Address += SIZE_4KB) {
+    UT_ASSERT_TRUE (MapTestPage (Root, Enable5LevelPaging, Address, 1, IA32_PG_P | IA32_PG_RW | IA32_PG_U | IA32_PG_NX));
+  }
+
+  Start = clock ();
+  for (Round = 0; Round < BENCHMARK_ROUNDS; Round++) {
+    UT_ASSERT_NOT_EFI_ERROR (ReferenceGetRangeAttributes ((UINTN)Root, Enable5LevelPaging, Boundary - SIZE_32MB, SIZE_64MB, &Attributes, &ReferenceEntriesRead));
+  }
+
+  ReferenceTicks = clock () - Start;
+
+  Start = clock ();
+  for (Round = 0; Round < BENCHMARK_ROUNDS; Round++) {
+    UT_ASSERT_NOT_EFI_ERROR (GetPageTableRangeAttributes ((UINTN)Root, Enable5LevelPaging, Boundary - SIZE_32MB, SIZE_64MB, &Attributes, &EntriesRead));
+  }
+
+  WalkTicks = clock () - Start;
+
+  UT_LOG_INFO (
+    "%d level paging, 64MB of 4K pages: per page walks %d us (%ld entries), range walk %d us (%ld entries)\n",
+    GetTopLevel (Enable5LevelPaging),
+    (UINT32)(ReferenceTicks * 1000000 / CLOCKS_PER_SEC / BENCHMARK_ROUNDS),
+    (UINT64)ReferenceEntriesRead,
+    (UINT32)(WalkTicks * 1000000 / CLOCKS_PER_SEC / BENCHMARK_ROUNDS),
+    (UINT64)EntriesRead
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  page table range walk and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      WalkTests;
+  UNIT_TEST_SUITE_HANDLE      BenchmarkTests;
+  TEST_CONTEXT_PAGING         PagingContext[2];
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  mTablePool.Base = AllocateAlignedPages (TEST_TABLE_POOL_PAGES, EFI_PAGE_SIZE);
+  if (mTablePool.Base == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the range walk Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&WalkTests, Framework, "Page Table Range Walk Tests", "PageTableWalk.Range", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for WalkTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  PagingContext[0].Enable5LevelPaging = FALSE;
+  PagingContext[1].Enable5LevelPaging = TRUE;
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (WalkTests, "Range walk should read every entry once", "ReadsEachEntryOnce", RangeWalkReadsEachEntryOnce, NULL, NULL, NULL);
+  AddTestCase (WalkTests, "Range walk should match per page walks with 4 level paging", "Reference4Level", RangeWalkMatchesReference, NULL, NULL, &PagingContext[0]);
+  AddTestCase (WalkTests, "Range walk should match per page walks with 5 level paging", "Reference5Level", RangeWalkMatchesReference, NULL, NULL, &PagingContext[1]);
+
+  //
+  // Populate the benchmark suite, comparing the per page walks against the range walk.
+  //
+  Status = CreateUnitTestSuite (&BenchmarkTests, Framework, "Page Table Range Walk Benchmark", "PageTableWalk.Benchmark", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BenchmarkTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (BenchmarkTests, "64MB range walk with 4 level paging", "Walk4Level", RangeWalkBenchmark, NULL, NULL, &PagingContext[0]);
+  AddTestCase (BenchmarkTests, "64MB range walk with 5 level paging", "Walk5Level", RangeWalkBenchmark, NULL, NULL, &PagingContext[1]);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  if (mTablePool.Base != NULL) {
+    FreeAlignedPages (mTablePool.Base, TEST_TABLE_POOL_PAGES);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,92 @@
+/** @file
+  Internal copies of the communicate buffers of synchronous MMIs.
+
+  The handlers of a synchronous MMI work on a copy of its communicate buffer
+  held in MMRAM. Instead of clearing the whole copy on every MMI, the core
+  tracks how far the copy may hold data of earlier MMIs and only zeroes what
+  the next message does not overwrite.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+
+#include "CommBufferCopy.h"
+
+VOID                                    *mInternalCommBufferCopy[MM_OPEN_BUFFER_CNT];
+UINT64                                  mInternalCommBufferDirtySize[MM_OPEN_BUFFER_CNT];
+MM_SUPERVISOR_COMM_BUFFER_STATS_BUFFER  mCommBufferStats;
+
+/**
+  Copy the communicate buffer of a synchronous MMI into the internal copy of its
+  channel, so that the handlers do not see changes made to it by the non-MM
+  environment while they run.
+
+  Only the part of the copy that an earlier MMI may have written beyond BufferSize
+  is zeroed, rather than the whole copy.
+
+  @param[in]  BufferType            The channel, MM_USER_BUFFER_T or MM_SUPERVISOR_BUFFER_T.
+  @param[in]  CommunicationBuffer   The communicate buffer of the non-MM environment.
+  @param[in]  BufferSize            The size in bytes of the message, already checked
+                                    against the size of the channel.
+
+  @return The internal copy of the message.
+**/
+EFI_MM_COMMUNICATE_HEADER *
+CopyInCommBuffer (
+  IN UINTN                 BufferType,
+  IN EFI_PHYSICAL_ADDRESS  CommunicationBuffer,
+  IN UINT64                BufferSize
+  )
+{
+  UINT8  *BufferCopy;
+
+  BufferCopy = mInternalCommBufferCopy[BufferType];
+  CopyMem (BufferCopy, (VOID *)(UINTN)CommunicationBuffer, (UINTN)BufferSize);
+  if (mInternalCommBufferDirtySize[BufferType] > BufferSize) {
+    ZeroMem (BufferCopy + BufferSize, (UINTN)(mInternalCommBufferDirtySize[BufferType] - BufferSize));
+    mCommBufferStats.BytesZeroed += mInternalCommBufferDirtySize[BufferType] - BufferSize;
+  }
+
+  mInternalCommBufferDirtySize[BufferType] = BufferSize;
+  mCommBufferStats.Mmis++;
+  mCommBufferStats.BytesCopied += BufferSize;
+
+  return (EFI_MM_COMMUNICATE_HEADER *)BufferCopy;
+}
+
+/**
+  Copy the response of a synchronous MMI from the internal copy of its channel
+  back to the communicate buffer, only as many bytes as the handler reported.
+
+  The handlers could write to all of the message they were handed, whatever
+  size they report back, so the copy stays dirty up to the larger of the
+  incoming message and the response.
+
+  @param[in]  BufferType            The channel, MM_USER_BUFFER_T or MM_SUPERVISOR_BUFFER_T.
+  @param[in]  CommunicationBuffer   The communicate buffer of the non-MM environment.
+  @param[in]  IncomingSize          The size in bytes of the message handed to the handlers.
+  @param[in]  BufferSize            The size in bytes of the response, already checked
+                                    against the size of the channel.
+**/
+VOID
+CopyOutCommBuffer (
+  IN UINTN                 BufferType,
+  IN EFI_PHYSICAL_ADDRESS  CommunicationBuffer,
+  IN UINT64                IncomingSize,
+  IN UINT64                BufferSize
+  )
+{
+  CopyMem ((VOID *)(UINTN)CommunicationBuffer, mInternalCommBufferCopy[BufferType], (UINTN)BufferSize);
+  mInternalCommBufferDirtySize[BufferType] = MAX (
+                                               mInternalCommBufferDirtySize[BufferType],
+                                               MAX (IncomingSize, BufferSize)
+                                               );
+  mCommBufferStats.BytesCopied += BufferSize;
+}
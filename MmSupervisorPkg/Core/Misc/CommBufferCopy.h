@@ -0,0 +1,64 @@
+/** @file
+  Internal copies of the communicate buffers of synchronous MMIs.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MM_CORE_COMM_BUFFER_COPY_H_
+#define _MM_CORE_COMM_BUFFER_COPY_H_
+
+#include <Protocol/MmCommunication.h>
+#include <Guid/MmCommonRegion.h>
+#include <Guid/MmSupervisorRequestData.h>
+
+//
+// Bytes at the start of each internal communicate buffer copy that may still hold data
+// of an earlier MMI, the rest of the copy is known to be zero.
+//
+extern UINT64                                  mInternalCommBufferDirtySize[MM_OPEN_BUFFER_CNT];
+extern MM_SUPERVISOR_COMM_BUFFER_STATS_BUFFER  mCommBufferStats;
+
+/**
+  Copy the communicate buffer of a synchronous MMI into the internal copy of its
+  channel, so that the handlers do not see changes made to it by the non-MM
+  environment while they run.
+
+  Only the part of the copy that an earlier MMI may have written beyond BufferSize
+  is zeroed, rather than the whole copy.
+
+  @param[in]  BufferType            The channel, MM_USER_BUFFER_T or MM_SUPERVISOR_BUFFER_T.
+  @param[in]  CommunicationBuffer   The communicate buffer of the non-MM environment.
+  @param[in]  BufferSize            The size in bytes of the message, already checked
+                                    against the size of the channel.
+
+  @return The internal copy of the message.
+**/
+EFI_MM_COMMUNICATE_HEADER *
+CopyInCommBuffer (
+  IN UINTN                 BufferType,
+  IN EFI_PHYSICAL_ADDRESS  CommunicationBuffer,
+  IN UINT64                BufferSize
+  );
+
+/**
+  Copy the response of a synchronous MMI from the internal copy of its channel
+  back to the communicate buffer, only as many bytes as the handler reported.
+
+  @param[in]  BufferType            The channel, MM_USER_BUFFER_T or MM_SUPERVISOR_BUFFER_T.
+  @param[in]  CommunicationBuffer   The communicate buffer of the non-MM environment.
+  @param[in]  IncomingSize          The size in bytes of the message handed to the handlers.
+  @param[in]  BufferSize            The size in bytes of the response, already checked
+                                    against the size of the channel.
+**/
+VOID
+CopyOutCommBuffer (
+  IN UINTN                 BufferType,
+  IN EFI_PHYSICAL_ADDRESS  CommunicationBuffer,
+  IN UINT64                IncomingSize,
+  IN UINT64                BufferSize
+  );
+
+#endif // _MM_CORE_COMM_BUFFER_COPY_H_
@@ -0,0 +1,306 @@
+/** @file
+  Per processor timeline of the phases of the SMIs.
+
+  The MP perf-logging keeps one Begin/End pair per procedure and processor,
+  overwritten by every SMI. Here every processor appends each phase it goes
+  through to a ring of its own, so the history of many SMIs can be drained in
+  binary form through the supervisor channel, and folds the cycles from its
+  arrival to the phase into a histogram for the min/avg/max/p99 statistics.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Guid/MmSupervisorRequestData.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+
+#include "SmiTimeline.h"
+#include "Request/Request.h"
+
+typedef struct {
+  UINT64    Count;
+  UINT64    TotalCycles;
+  UINT64    MinCycles;
+  UINT64    MaxCycles;
+  UINT32    Histogram[SMI_TIMELINE_BUCKETS];
+} SMI_PHASE_COUNTERS;
+
+typedef struct {
+  //
+  // Number of events ever written to this ring, only updated by its owner.
+  //
+  volatile UINT64                     Head;
+  //
+  // Number of events ever drained from this ring, only updated by the drainer.
+  //
+  UINT64                              Tail;
+  //
+  // TSC value of the arrival of the owner in its current SMI, and the number of SMIs it entered.
+  //
+  UINT64                              ArrivalTsc;
+  UINT32                              Smis;
+  UINT32                              Reserved;
+  SMI_PHASE_COUNTERS                  Phases[MM_SUPERVISOR_SMI_PHASE_COUNT];
+  MM_SUPERVISOR_SMI_TIMELINE_ENTRY    Entries[1];
+} SMI_TIMELINE_RING;
+
+UINT8  *mSmiTimelineRings      = NULL;
+UINTN  mSmiTimelineRingSize    = 0;
+UINTN  mSmiTimelineRingEntries = 0;
+UINTN  mSmiTimelineCpuCount    = 0;
+
+//
+// Histogram of one phase summed up over all processors, only used by the request handler.
+//
+UINT64  mSmiTimelineHistogram[SMI_TIMELINE_BUCKETS];
+
+/**
+  Get the timeline ring of a CPU.
+
+  @param[in]  CpuIndex    The index of the CPU.
+
+  @return The timeline ring of CpuIndex.
+**/
+STATIC
+SMI_TIMELINE_RING *
+GetSmiTimelineRing (
+  IN UINTN  CpuIndex
+  )
+{
+  return (SMI_TIMELINE_RING *)(mSmiTimelineRings + CpuIndex * mSmiTimelineRingSize);
+}
+
+/**
+  Allocate the per CPU SMI timeline rings, with PcdMmSupervisorSmiTimelineEntries
+  events each.
+
+  @param[in]  NumberOfCpus    Total number of CPUs need to be supported.
+
+  @retval EFI_SUCCESS             The rings are ready, or not enabled.
+  @retval EFI_OUT_OF_RESOURCES    Not enough memory for the rings.
+**/
+EFI_STATUS
+SmiTimelineInit (
+  IN UINTN  NumberOfCpus
+  )
+{
+  if (FixedPcdGet32 (PcdMmSupervisorSmiTimelineEntries) == 0) {
+    return EFI_SUCCESS;
+  }
+
+  mSmiTimelineRingEntries = FixedPcdGet32 (PcdMmSupervisorSmiTimelineEntries);
+
+  // Keep the rings of different processors on different cache lines
+  mSmiTimelineRingSize = ALIGN_VALUE (
+                           OFFSET_OF (SMI_TIMELINE_RING, Entries) +
+                           sizeof (MM_SUPERVISOR_SMI_TIMELINE_ENTRY) * mSmiTimelineRingEntries,
+                           64
+                           );
+
+  mSmiTimelineRings = AllocateZeroPool (mSmiTimelineRingSize * NumberOfCpus);
+  if (mSmiTimelineRings == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mSmiTimelineCpuCount = NumberOfCpus;
+  return EFI_SUCCESS;
+}
+
+/**
+  Record that a CPU reached a phase of the current SMI. No lock is taken, each
+  CPU only ever writes its own ring, and the oldest event is overwritten when
+  the ring is full.
+
+  @param[in]  CpuIndex    The index of the executing CPU.
+  @param[in]  Phase       One of MM_SUPERVISOR_SMI_PHASE_*.
+**/
+VOID
+SmiTimelineRecord (
+  IN UINTN  CpuIndex,
+  IN UINT8  Phase
+  )
+{
+  SMI_TIMELINE_RING                 *Ring;
+  MM_SUPERVISOR_SMI_TIMELINE_ENTRY  *Entry;
+  SMI_PHASE_COUNTERS                *Counters;
+  UINT64                            Timestamp;
+  UINT64                            Cycles;
+
+  if ((mSmiTimelineRings == NULL) || (CpuIndex >= mSmiTimelineCpuCount)) {
+    return;
+  }
+
+  ASSERT (Phase < MM_SUPERVISOR_SMI_PHASE_COUNT);
+
+  Timestamp = AsmReadTsc ();
+  Ring      = GetSmiTimelineRing (CpuIndex);
+
+  if (Phase == MM_SUPERVISOR_SMI_PHASE_ARRIVAL) {
+    Ring->ArrivalTsc = Timestamp;
+    Ring->Smis++;
+  } else {
+    Cycles   = Timestamp - Ring->ArrivalTsc;
+    Counters = &Ring->Phases[Phase];
+    if ((Counters->Count == 0) || (Cycles < Counters->MinCycles)) {
+      Counters->MinCycles = Cycles;
+    }
+
+    if (Cycles > Counters->MaxCycles) {
+      Counters->MaxCycles = Cycles;
+    }
+
+    Counters->Count++;
+    Counters->TotalCycles += Cycles;
+    Counters->Histogram[SmiTimelineBucket (Cycles)]++;
+  }
+
+  Entry = &Ring->Entries[Ring->Head % mSmiTimelineRingEntries];
+
+  Entry->Timestamp = Timestamp;
+  Entry->SmiIndex  = Ring->Smis - 1;
+  Entry->CpuIndex  = (UINT16)CpuIndex;
+  Entry->Phase     = Phase;
+  Entry->Reserved  = 0;
+
+  // Publish the event only once it is complete
+  MemoryFence ();
+  Ring->Head++;
+}
+
+/**
+  Routine used to drain the SMI timeline rings of all processors into the
+  supplied buffer, along with the statistics of each phase. Events that do
+  not fit are kept for the next request.
+
+  @param[in, out] TimelineBuffer  Input flags and output buffer header, the events
+                                  follow it. The statistics are cleared if
+                                  MM_SUPERVISOR_SMI_TIMELINE_RESET is set in its Flags.
+  @param[in]      BufferSize      Maximal buffer size supplied by caller,
+                                  including the buffer header.
+
+  @retval EFI_SUCCESS             The events are drained.
+  @retval EFI_INVALID_PARAMETER   TimelineBuffer is NULL or BufferSize cannot hold
+                                  the buffer header.
+  @retval EFI_UNSUPPORTED         The SMI timeline is not enabled.
+**/
+EFI_STATUS
+ProcessSmiTimelineRequest (
+  IN OUT MM_SUPERVISOR_SMI_TIMELINE_BUFFER  *TimelineBuffer,
+  IN     UINTN                              BufferSize
+  )
+{
+  MM_SUPERVISOR_SMI_TIMELINE_ENTRY  *Entries;
+  MM_SUPERVISOR_SMI_PHASE_STATS     *Stats;
+  SMI_PHASE_COUNTERS                *Counters;
+  SMI_TIMELINE_RING                 *Ring;
+  UINTN                             MaxEntries;
+  UINTN                             EntryCount;
+  UINTN                             CpuIndex;
+  UINTN                             Phase;
+  UINTN                             Bucket;
+  UINT64                            Head;
+  UINT64                            Dropped;
+  UINT64                            TotalCycles;
+
+  if ((TimelineBuffer == NULL) || (BufferSize < sizeof (MM_SUPERVISOR_SMI_TIMELINE_BUFFER))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (mSmiTimelineRings == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // Sum the statistics of each phase up over all processors
+  //
+  for (Phase = 0; Phase < MM_SUPERVISOR_SMI_PHASE_COUNT; Phase++) {
+    Stats = &TimelineBuffer->Phases[Phase];
+    ZeroMem (Stats, sizeof (*Stats));
+    ZeroMem (mSmiTimelineHistogram, sizeof (mSmiTimelineHistogram));
+    TotalCycles = 0;
+
+    for (CpuIndex = 0; CpuIndex < mSmiTimelineCpuCount; CpuIndex++) {
+      Counters = &GetSmiTimelineRing (CpuIndex)->Phases[Phase];
+      if (Counters->Count == 0) {
+        continue;
+      }
+
+      if ((Stats->Count == 0) || (Counters->MinCycles < Stats->MinCycles)) {
+        Stats->MinCycles = Counters->MinCycles;
+      }
+
+      Stats->MaxCycles = MAX (Stats->MaxCycles, Counters->MaxCycles);
+      Stats->Count    += Counters->Count;
+      TotalCycles     += Counters->TotalCycles;
+      for (Bucket = 0; Bucket < SMI_TIMELINE_BUCKETS; Bucket++) {
+        mSmiTimelineHistogram[Bucket] += Counters->Histogram[Bucket];
+      }
+    }
+
+    if (Stats->Count != 0) {
+      Stats->AvgCycles = DivU64x64Remainder (TotalCycles, Stats->Count, NULL);
+      Stats->P99Cycles = MIN (SmiTimelinePercentile (mSmiTimelineHistogram, Stats->Count, 99), Stats->MaxCycles);
+    }
+  }
+
+  if ((TimelineBuffer->Flags & MM_SUPERVISOR_SMI_TIMELINE_RESET) != 0) {
+    for (CpuIndex = 0; CpuIndex < mSmiTimelineCpuCount; CpuIndex++) {
+      Ring = GetSmiTimelineRing (CpuIndex);
+      ZeroMem (Ring->Phases, sizeof (Ring->Phases));
+    }
+  }
+
+  //
+  // Drain the events, the same way as the syscall trace rings
+  //
+  Entries    = (MM_SUPERVISOR_SMI_TIMELINE_ENTRY *)(TimelineBuffer + 1);
+  MaxEntries = (BufferSize - sizeof (MM_SUPERVISOR_SMI_TIMELINE_BUFFER)) / sizeof (MM_SUPERVISOR_SMI_TIMELINE_ENTRY);
+  EntryCount = 0;
+  Dropped    = 0;
+  for (CpuIndex = 0; CpuIndex < mSmiTimelineCpuCount; CpuIndex++) {
+    Ring = GetSmiTimelineRing (CpuIndex);
+    while (EntryCount < MaxEntries) {
+      Head = Ring->Head;
+      if (Head - Ring->Tail > mSmiTimelineRingEntries) {
+        // The owner lapped us, skip what has been overwritten
+        Dropped   += Head - Ring->Tail - mSmiTimelineRingEntries;
+        Ring->Tail = Head - mSmiTimelineRingEntries;
+      }
+
+      if (Ring->Tail == Head) {
+        break;
+      }
+
+      CopyMem (
+        &Entries[EntryCount],
+        &Ring->Entries[Ring->Tail % mSmiTimelineRingEntries],
+        sizeof (MM_SUPERVISOR_SMI_TIMELINE_ENTRY)
+        );
+
+      // Only keep the copy if the owner did not start overwriting it meanwhile
+      MemoryFence ();
+      if (Ring->Head - Ring->Tail < mSmiTimelineRingEntries) {
+        EntryCount++;
+      } else {
+        Dropped++;
+      }
+
+      Ring->Tail++;
+    }
+  }
+
+  TimelineBuffer->EntryCount = (UINT32)EntryCount;
+  TimelineBuffer->Dropped    = (UINT32)MIN (Dropped, MAX_UINT32);
+  TimelineBuffer->Reserved   = 0;
+
+  return EFI_SUCCESS;
+}
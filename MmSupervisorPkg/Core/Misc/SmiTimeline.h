@@ -0,0 +1,93 @@
+/** @file
+  Per processor timeline of the phases of the SMIs.
+
+  Every processor appends the phases it goes through in each SMI to a ring of
+  its own, with their TSC stamps, and folds the cycles from its arrival to
+  each phase into per phase statistics that outlive the ring.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MM_CORE_SMI_TIMELINE_H_
+#define _MM_CORE_SMI_TIMELINE_H_
+
+#include <Guid/MmSupervisorRequestData.h>
+
+//
+// Latency buckets of the phase statistics. Values below 4 have a bucket each, every
+// power of two above is cut into 4 buckets, and the last bucket also holds all longer
+// latencies.
+//
+#define SMI_TIMELINE_SUB_BUCKETS  4
+#define SMI_TIMELINE_BUCKETS      128
+
+/**
+  Get the latency bucket of a number of cycles.
+
+  @param[in]  Cycles      The latency.
+
+  @return The bucket counting Cycles.
+**/
+UINTN
+SmiTimelineBucket (
+  IN UINT64  Cycles
+  );
+
+/**
+  Get the largest latency counted in a bucket.
+
+  @param[in]  Bucket      The bucket.
+
+  @return The largest latency of Bucket, MAX_UINT64 for the last bucket.
+**/
+UINT64
+SmiTimelineBucketLimit (
+  IN UINTN  Bucket
+  );
+
+/**
+  Get an upper bound of a percentile of the latencies counted in a histogram.
+
+  @param[in]  Histogram   SMI_TIMELINE_BUCKETS counters.
+  @param[in]  Count       The sum of the counters.
+  @param[in]  Percent     The percentile, from 1 to 100.
+
+  @return The largest latency of the bucket holding the percentile, 0 if Count is 0.
+**/
+UINT64
+SmiTimelinePercentile (
+  IN CONST UINT64  *Histogram,
+  IN UINT64        Count,
+  IN UINTN         Percent
+  );
+
+/**
+  Allocate the per CPU SMI timeline rings, with PcdMmSupervisorSmiTimelineEntries
+  events each.
+
+  @param[in]  NumberOfCpus    Total number of CPUs need to be supported.
+
+  @retval EFI_SUCCESS             The rings are ready, or not enabled.
+  @retval EFI_OUT_OF_RESOURCES    Not enough memory for the rings.
+**/
+EFI_STATUS
+SmiTimelineInit (
+  IN UINTN  NumberOfCpus
+  );
+
+/**
+  Record that a CPU reached a phase of the current SMI.
+
+  @param[in]  CpuIndex    The index of the executing CPU.
+  @param[in]  Phase       One of MM_SUPERVISOR_SMI_PHASE_*.
+**/
+VOID
+SmiTimelineRecord (
+  IN UINTN  CpuIndex,
+  IN UINT8  Phase
+  );
+
+#endif
@@ -0,0 +1,110 @@
+/** @file
+  Latency histogram of the SMI timeline.
+
+  Each power of two is cut into a few buckets, so that a percentile read back
+  from the histogram is off by a fraction of its value rather than by up to
+  twice its value.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Library/BaseLib.h>
+
+#include "SmiTimeline.h"
+
+/**
+  Get the latency bucket of a number of cycles.
+
+  @param[in]  Cycles      The latency.
+
+  @return The bucket counting Cycles.
+**/
+UINTN
+SmiTimelineBucket (
+  IN UINT64  Cycles
+  )
+{
+  UINTN  Log;
+  UINTN  Bucket;
+
+  if (Cycles < SMI_TIMELINE_SUB_BUCKETS) {
+    return (UINTN)Cycles;
+  }
+
+  // The two bits below the highest one pick the bucket within the power of two
+  Log    = (UINTN)HighBitSet64 (Cycles);
+  Bucket = SMI_TIMELINE_SUB_BUCKETS * (Log - 1) + ((UINTN)RShiftU64 (Cycles, Log - 2) & (SMI_TIMELINE_SUB_BUCKETS - 1));
+
+  return MIN (Bucket, SMI_TIMELINE_BUCKETS - 1);
+}
+
+/**
+  Get the largest latency counted in a bucket.
+
+  @param[in]  Bucket      The bucket.
+
+  @return The largest latency of Bucket, MAX_UINT64 for the last bucket.
+**/
+UINT64
+SmiTimelineBucketLimit (
+  IN UINTN  Bucket
+  )
+{
+  UINTN  Log;
+  UINTN  Sub;
+
+  if (Bucket >= SMI_TIMELINE_BUCKETS - 1) {
+    return MAX_UINT64;
+  }
+
+  if (Bucket < SMI_TIMELINE_SUB_BUCKETS) {
+    return Bucket;
+  }
+
+  Log = Bucket / SMI_TIMELINE_SUB_BUCKETS + 1;
+  Sub = Bucket % SMI_TIMELINE_SUB_BUCKETS;
+
+  return LShiftU64 (SMI_TIMELINE_SUB_BUCKETS + Sub + 1, Log - 2) - 1;
+}
+
+/**
+  Get an upper bound of a percentile of the latencies counted in a histogram.
+
+  @param[in]  Histogram   SMI_TIMELINE_BUCKETS counters.
+  @param[in]  Count       The sum of the counters.
+  @param[in]  Percent     The percentile, from 1 to 100.
+
+  @return The largest latency of the bucket holding the percentile, 0 if Count is 0.
+**/
+UINT64
+SmiTimelinePercentile (
+  IN CONST UINT64  *Histogram,
+  IN UINT64        Count,
+  IN UINTN         Percent
+  )
+{
+  UINT64  Rank;
+  UINT64  Seen;
+  UINTN   Bucket;
+
+  if (Count == 0) {
+    return 0;
+  }
+
+  // The smallest latency that at least Percent percent of the samples do not exceed
+  Rank = DivU64x32 (MultU64x32 (Count, (UINT32)Percent) + 99, 100);
+  Seen = 0;
+  for (Bucket = 0; Bucket < SMI_TIMELINE_BUCKETS - 1; Bucket++) {
+    Seen += Histogram[Bucket];
+    if (Seen >= Rank) {
+      break;
+    }
+  }
+
+  return SmiTimelineBucketLimit (Bucket);
+}
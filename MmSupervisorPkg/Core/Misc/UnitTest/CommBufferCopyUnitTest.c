@@ -0,0 +1,278 @@
+/** @file
+  Unit tests of the internal copies of the communicate buffers
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../CommBufferCopy.h"
+
+#define UNIT_TEST_APP_NAME     "Communicate Buffer Copy Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define CHANNEL_SIZE  SIZE_4KB
+
+extern VOID  *mInternalCommBufferCopy[MM_OPEN_BUFFER_CNT];
+
+STATIC UINT8  mChannel[CHANNEL_SIZE];
+STATIC UINT8  mCopy[CHANNEL_SIZE];
+
+/**
+  Put the user channel in the state it has right after allocation, with the
+  whole copy holding garbage.
+
+  @param[in]  Context   Unused.
+
+  @retval UNIT_TEST_PASSED    The channel is set up.
+**/
+STATIC
+UNIT_TEST_STATUS
+EFIAPI
+ResetChannel (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SetMem (mCopy, sizeof (mCopy), 0xA5);
+  mInternalCommBufferCopy[MM_USER_BUFFER_T]      = mCopy;
+  mInternalCommBufferDirtySize[MM_USER_BUFFER_T] = sizeof (mCopy);
+  ZeroMem (&mCommBufferStats, sizeof (mCommBufferStats));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Send a message of Size bytes through the user channel, filled with Fill.
+
+  @param[in]  Size    The size in bytes of the message.
+  @param[in]  Fill    The value of every byte of the message.
+
+  @return The internal copy of the message.
+**/
+STATIC
+UINT8 *
+SendMessage (
+  IN UINTN  Size,
+  IN UINT8  Fill
+  )
+{
+  SetMem (mChannel, sizeof (mChannel), Fill);
+  return (UINT8 *)CopyInCommBuffer (MM_USER_BUFFER_T, (EFI_PHYSICAL_ADDRESS)(UINTN)mChannel, Size);
+}
+
+/**
+  Check that the copy holds the message of Size bytes filled with Fill, and
+  nothing but zeroes after it.
+
+  @param[in]  Size    The size in bytes of the message.
+  @param[in]  Fill    The value of every byte of the message.
+
+  @retval UNIT_TEST_PASSED              The copy is clean.
+  @retval UNIT_TEST_ERROR_TEST_FAILED   Data of an earlier MMI is left in the copy.
+**/
+STATIC
+UNIT_TEST_STATUS
+CheckCopyClean (
+  IN UINTN  Size,
+  IN UINT8  Fill
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < CHANNEL_SIZE; Index++) {
+    UT_ASSERT_EQUAL (mCopy[Index], (Index < Size) ? Fill : 0);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The first MMI should clear the garbage of the fresh copy.
+
+  @param[in]  Context   Unused.
+
+  @retval UNIT_TEST_PASSED              The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED   The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CommBufferCopyFirstMmi (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SendMessage (0x40, 0x11);
+  UT_ASSERT_EQUAL (CheckCopyClean (0x40, 0x11), UNIT_TEST_PASSED);
+  UT_ASSERT_EQUAL (mCommBufferStats.BytesZeroed, CHANNEL_SIZE - 0x40);
+  UT_ASSERT_EQUAL (mInternalCommBufferDirtySize[MM_USER_BUFFER_T], 0x40);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A handler that writes all of its message but reports a shorter response
+  should not leave the tail of its message to the next MMI.
+
+  @param[in]  Context   Unused.
+
+  @retval UNIT_TEST_PASSED              The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED   The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CommBufferCopyPastResponse (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8  *Copy;
+
+  Copy = SendMessage (0x800, 0x11);
+  SetMem (Copy, 0x800, 0xCC);
+  CopyOutCommBuffer (MM_USER_BUFFER_T, (EFI_PHYSICAL_ADDRESS)(UINTN)mChannel, 0x800, 0x20);
+  UT_ASSERT_EQUAL (mInternalCommBufferDirtySize[MM_USER_BUFFER_T], 0x800);
+  UT_ASSERT_MEM_EQUAL (mChannel, Copy, 0x20);
+  UT_ASSERT_EQUAL (mChannel[0x20], 0x11);
+
+  SendMessage (0x40, 0x22);
+  UT_ASSERT_EQUAL (CheckCopyClean (0x40, 0x22), UNIT_TEST_PASSED);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A handler that reports a response longer than its message should leave the
+  copy dirty up to the end of the response.
+
+  @param[in]  Context   Unused.
+
+  @retval UNIT_TEST_PASSED              The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED   The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CommBufferCopyLongResponse (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT8  *Copy;
+
+  Copy = SendMessage (0x40, 0x11);
+  SetMem (Copy, 0x600, 0xCC);
+  CopyOutCommBuffer (MM_USER_BUFFER_T, (EFI_PHYSICAL_ADDRESS)(UINTN)mChannel, 0x40, 0x600);
+  UT_ASSERT_EQUAL (mInternalCommBufferDirtySize[MM_USER_BUFFER_T], 0x600);
+
+  SendMessage (0x10, 0x22);
+  UT_ASSERT_EQUAL (CheckCopyClean (0x10, 0x22), UNIT_TEST_PASSED);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A message rejected before any response is copied out should still have all
+  of itself cleared by the next MMI.
+
+  @param[in]  Context   Unused.
+
+  @retval UNIT_TEST_PASSED              The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED   The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CommBufferCopyNoResponse (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SendMessage (0x300, 0x11);
+  SendMessage (0x8, 0x22);
+  UT_ASSERT_EQUAL (CheckCopyClean (0x8, 0x22), UNIT_TEST_PASSED);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  communicate buffer copies and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      CopyTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the communicate buffer copy Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&CopyTests, Framework, "Communicate Buffer Copy Tests", "CommBuffer.Copy", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for CopyTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (CopyTests, "The first MMI should clear the fresh copy", "FirstMmi", CommBufferCopyFirstMmi, ResetChannel, NULL, NULL);
+  AddTestCase (CopyTests, "Writes past the reported response should be cleared", "PastResponse", CommBufferCopyPastResponse, ResetChannel, NULL, NULL);
+  AddTestCase (CopyTests, "Responses longer than the message should be cleared", "LongResponse", CommBufferCopyLongResponse, ResetChannel, NULL, NULL);
+  AddTestCase (CopyTests, "Messages without a response should be cleared", "NoResponse", CommBufferCopyNoResponse, ResetChannel, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,251 @@
+/** @file
+  Unit tests of the latency histogram of the SMI timeline
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../SmiTimeline.h"
+
+#define UNIT_TEST_APP_NAME     "SMI Timeline Histogram Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define CONTIGUOUS_CYCLES  0x10000
+
+/**
+  Check that a latency is counted in a bucket whose range holds it.
+
+  @param[in]  Cycles      The latency.
+
+  @retval UNIT_TEST_PASSED              The bucket holds Cycles.
+  @retval UNIT_TEST_ERROR_TEST_FAILED   The bucket does not hold Cycles.
+**/
+STATIC
+UNIT_TEST_STATUS
+CheckBucketHolds (
+  IN UINT64  Cycles
+  )
+{
+  UINTN  Bucket;
+
+  Bucket = SmiTimelineBucket (Cycles);
+  UT_ASSERT_TRUE (Bucket < SMI_TIMELINE_BUCKETS);
+  UT_ASSERT_TRUE (SmiTimelineBucketLimit (Bucket) >= Cycles);
+  if (Bucket > 0) {
+    UT_ASSERT_TRUE (SmiTimelineBucketLimit (Bucket - 1) < Cycles);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The buckets should cover the small latencies without a gap, one after the other.
+
+  @param[in]  Context   Unused.
+
+  @retval UNIT_TEST_PASSED              The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED   The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SmiTimelineBucketContiguous (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT64  Cycles;
+  UINTN   Previous;
+  UINTN   Bucket;
+
+  Previous = 0;
+  for (Cycles = 0; Cycles < CONTIGUOUS_CYCLES; Cycles++) {
+    Bucket = SmiTimelineBucket (Cycles);
+    UT_ASSERT_TRUE ((Bucket == Previous) || (Bucket == Previous + 1));
+    UT_ASSERT_EQUAL (CheckBucketHolds (Cycles), UNIT_TEST_PASSED);
+
+    // A bucket is never wider than a quarter of the values it holds
+    if (Cycles >= SMI_TIMELINE_SUB_BUCKETS) {
+      UT_ASSERT_TRUE (SmiTimelineBucketLimit (Bucket) - Cycles <= Cycles / SMI_TIMELINE_SUB_BUCKETS);
+    }
+
+    Previous = Bucket;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The buckets should hold the latencies around every power of two, the last
+  bucket holding everything above.
+
+  @param[in]  Context   Unused.
+
+  @retval UNIT_TEST_PASSED              The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED   The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SmiTimelineBucketPowersOfTwo (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN   Log;
+  UINT64  Power;
+
+  for (Log = 2; Log < 64; Log++) {
+    Power = LShiftU64 (1, Log);
+    if (SmiTimelineBucket (Power - 1) < SMI_TIMELINE_BUCKETS - 1) {
+      UT_ASSERT_EQUAL (CheckBucketHolds (Power - 1), UNIT_TEST_PASSED);
+    }
+
+    if (SmiTimelineBucket (Power) < SMI_TIMELINE_BUCKETS - 1) {
+      UT_ASSERT_EQUAL (CheckBucketHolds (Power), UNIT_TEST_PASSED);
+      UT_ASSERT_EQUAL (SmiTimelineBucket (Power), SMI_TIMELINE_SUB_BUCKETS * (Log - 1));
+    }
+  }
+
+  UT_ASSERT_EQUAL (SmiTimelineBucket (MAX_UINT64), SMI_TIMELINE_BUCKETS - 1);
+  UT_ASSERT_EQUAL (SmiTimelineBucketLimit (SMI_TIMELINE_BUCKETS - 1), MAX_UINT64);
+  UT_ASSERT_TRUE (SmiTimelineBucketLimit (SMI_TIMELINE_BUCKETS - 2) < MAX_UINT64);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Percentiles should come from the bucket of the sample at their rank.
+
+  @param[in]  Context   Unused.
+
+  @retval UNIT_TEST_PASSED              The test passed.
+  @retval UNIT_TEST_ERROR_TEST_FAILED   The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SmiTimelinePercentiles (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINT64  Histogram[SMI_TIMELINE_BUCKETS];
+  UINT64  Cycles;
+
+  ZeroMem (Histogram, sizeof (Histogram));
+  UT_ASSERT_EQUAL (SmiTimelinePercentile (Histogram, 0, 99), 0);
+
+  // A single sample is every percentile
+  Histogram[SmiTimelineBucket (1000)] = 1;
+  UT_ASSERT_EQUAL (SmiTimelinePercentile (Histogram, 1, 1), SmiTimelineBucketLimit (SmiTimelineBucket (1000)));
+  UT_ASSERT_EQUAL (SmiTimelinePercentile (Histogram, 1, 99), SmiTimelineBucketLimit (SmiTimelineBucket (1000)));
+
+  // Latencies of 1 to 100 cycles
+  ZeroMem (Histogram, sizeof (Histogram));
+  for (Cycles = 1; Cycles <= 100; Cycles++) {
+    Histogram[SmiTimelineBucket (Cycles)]++;
+  }
+
+  UT_ASSERT_EQUAL (SmiTimelinePercentile (Histogram, 100, 50), SmiTimelineBucketLimit (SmiTimelineBucket (50)));
+  UT_ASSERT_EQUAL (SmiTimelinePercentile (Histogram, 100, 99), SmiTimelineBucketLimit (SmiTimelineBucket (99)));
+  UT_ASSERT_EQUAL (SmiTimelinePercentile (Histogram, 100, 100), SmiTimelineBucketLimit (SmiTimelineBucket (100)));
+
+  // One outlier in a thousand samples does not move the 99th percentile
+  ZeroMem (Histogram, sizeof (Histogram));
+  Histogram[SmiTimelineBucket (2000)]    = 999;
+  Histogram[SmiTimelineBucket (5000000)] = 1;
+  UT_ASSERT_EQUAL (SmiTimelinePercentile (Histogram, 1000, 99), SmiTimelineBucketLimit (SmiTimelineBucket (2000)));
+  UT_ASSERT_EQUAL (SmiTimelinePercentile (Histogram, 1000, 100), SmiTimelineBucketLimit (SmiTimelineBucket (5000000)));
+
+  // Samples beyond the last bucket read back as the largest latency
+  ZeroMem (Histogram, sizeof (Histogram));
+  Histogram[SmiTimelineBucket (MAX_UINT64)] = 10;
+  UT_ASSERT_EQUAL (SmiTimelinePercentile (Histogram, 10, 99), MAX_UINT64);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  SMI timeline histogram and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      HistogramTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the SMI timeline histogram Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&HistogramTests, Framework, "SMI Timeline Histogram Tests", "SmiTimeline.Histogram", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for HistogramTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (HistogramTests, "Buckets should cover small latencies one after the other", "Contiguous", SmiTimelineBucketContiguous, NULL, NULL, NULL);
+  AddTestCase (HistogramTests, "Buckets should hold the latencies around powers of two", "PowersOfTwo", SmiTimelineBucketPowersOfTwo, NULL, NULL, NULL);
+  AddTestCase (HistogramTests, "Percentiles should come from the bucket at their rank", "Percentiles", SmiTimelinePercentiles, NULL, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -16,11 +16,16 @@
 #include "Telemetry/Telemetry.h"
 #include "Policy/Policy.h"
 #include "Test/Test.h"
+#include "Request/Request.h"
+#include "Misc/SmiTimeline.h"
+#include "Misc/CommBufferCopy.h"
 
 #include <Protocol/MmBase.h>
 #include <Protocol/PiPcd.h>
 
 #include <Guid/MmCommonRegion.h>
+#include <Guid/MmCommunicateBatch.h>
+#include <Guid/MmSupervisorRequestData.h>
 
 EFI_STATUS
 MmCoreFfsFindMmDriver (
@@ -119,7 +124,6 @@ EFI_MM_DRIVER_ENTRY         *mMmCoreDriverEntry;
 MM_SUPV_USER_COMMON_BUFFER  *SupervisorToUserDataBuffer = NULL;
 BOOLEAN                     mMmReadyToLockDone          = FALSE;
 BOOLEAN                     mCoreInitializationComplete = FALSE;
-VOID                        *mInternalCommBufferCopy[MM_OPEN_BUFFER_CNT];
 
 /**
   Place holder function until all the MM System Table Service are available.
@@ -230,6 +234,9 @@ PrepareCommonBuffers (
         goto Exit;
       }
 
+      // The fresh pages are not zeroed, the first MMI will clear them all
+      mInternalCommBufferDirtySize[CommRegionHob->MmCommonRegionType] = EFI_PAGES_TO_SIZE (CommRegionHob->MmCommonRegionPages);
+
       mMmSupervisorAccessBuffer[CommRegionHob->MmCommonRegionType].VirtualStart = 0;
       DEBUG ((
         DEBUG_INFO,
@@ -407,6 +414,122 @@ InternalIsBufferOverlapped (
   return TRUE;
 }
 
+/**
+  Dispatch the messages of a batched communicate message from the user channel,
+  each to the handlers of its own HeaderGuid, and update the descriptors of the
+  batch with the size and status of the responses.
+
+  The descriptors are checked and kept in supervisor memory while the messages
+  are dispatched, since user handlers can write to the internal copy holding
+  the batch.
+
+  @param[in, out] Batch       The data of the batched communicate message.
+  @param[in]      BatchSize   The size in bytes of the data.
+
+  @retval EFI_SUCCESS             All messages were dispatched, the status of each
+                                  is in its descriptor.
+  @retval EFI_INVALID_PARAMETER   The batch is malformed, no message was dispatched.
+**/
+STATIC
+EFI_STATUS
+MmiManageCommunicateBatch (
+  IN OUT MM_COMMUNICATE_BATCH_HEADER  *Batch,
+  IN     UINT64                       BatchSize
+  )
+{
+  MM_COMMUNICATE_BATCH_ENTRY  Entries[MM_COMMUNICATE_BATCH_MAX_MESSAGES];
+  EFI_MM_COMMUNICATE_HEADER   *Message;
+  UINT32                      Count;
+  UINT64                      MessageEnd;
+  UINTN                       Index;
+  EFI_STATUS                  Status;
+
+  if (BatchSize < sizeof (MM_COMMUNICATE_BATCH_HEADER)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Count = Batch->Count;
+  if ((Batch->Signature != MM_COMMUNICATE_BATCH_SIGNATURE) ||
+      (Count == 0) ||
+      (Count > MM_COMMUNICATE_BATCH_MAX_MESSAGES) ||
+      (BatchSize < sizeof (MM_COMMUNICATE_BATCH_HEADER) + Count * sizeof (MM_COMMUNICATE_BATCH_ENTRY)))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  CopyMem (Entries, Batch + 1, Count * sizeof (MM_COMMUNICATE_BATCH_ENTRY));
+
+  // The messages follow the descriptors and each other, without overlapping
+  MessageEnd = sizeof (MM_COMMUNICATE_BATCH_HEADER) + Count * sizeof (MM_COMMUNICATE_BATCH_ENTRY);
+  for (Index = 0; Index < Count; Index++) {
+    if ((Entries[Index].Offset < MessageEnd) ||
+        (Entries[Index].Offset > BatchSize) ||
+        ((Entries[Index].Offset & (sizeof (UINT64) - 1)) != 0) ||
+        (Entries[Index].Size < OFFSET_OF (EFI_MM_COMMUNICATE_HEADER, Data)) ||
+        (Entries[Index].Size > BatchSize - Entries[Index].Offset))
+    {
+      return EFI_INVALID_PARAMETER;
+    }
+
+    MessageEnd = Entries[Index].Offset + Entries[Index].Size;
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    Message                                                    = (EFI_MM_COMMUNICATE_HEADER *)((UINT8 *)Batch + Entries[Index].Offset);
+    SupervisorToUserDataBuffer->gMmCorePrivateDummy.BufferSize = Entries[Index].Size - OFFSET_OF (EFI_MM_COMMUNICATE_HEADER, Data);
+    Status                                                     = MmiManage (
+                                                                   &Message->HeaderGuid,
+                                                                   NULL,
+                                                                   Message->Data,
+                                                                   (UINTN *)&(SupervisorToUserDataBuffer->gMmCorePrivateDummy.BufferSize)
+                                                                   );
+
+    // A response cannot grow into the next message
+    if (SupervisorToUserDataBuffer->gMmCorePrivateDummy.BufferSize > Entries[Index].Size - OFFSET_OF (EFI_MM_COMMUNICATE_HEADER, Data)) {
+      DEBUG ((DEBUG_ERROR, "%a Returned buffer size of message %d is larger than the message\n", __FUNCTION__, Index));
+      Entries[Index].ReturnStatus = EFI_BAD_BUFFER_SIZE;
+      continue;
+    }
+
+    Entries[Index].Size         = SupervisorToUserDataBuffer->gMmCorePrivateDummy.BufferSize + OFFSET_OF (EFI_MM_COMMUNICATE_HEADER, Data);
+    Entries[Index].ReturnStatus = (Status == EFI_SUCCESS) ? EFI_SUCCESS : EFI_NOT_FOUND;
+  }
+
+  CopyMem (Batch + 1, Entries, Count * sizeof (MM_COMMUNICATE_BATCH_ENTRY));
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Routine used to report the bytes copied and zeroed for the communicate
+  buffers of synchronous MMIs.
+
+  @param[in, out] StatsBuffer   Buffer to hold the counters. The counters are
+                                cleared if MM_SUPERVISOR_COMM_BUFFER_STATS_RESET
+                                is set in its Flags.
+
+  @retval EFI_SUCCESS             The counters are copied out.
+  @retval EFI_INVALID_PARAMETER   StatsBuffer is NULL.
+**/
+EFI_STATUS
+ProcessCommBufferStatsRequest (
+  IN OUT MM_SUPERVISOR_COMM_BUFFER_STATS_BUFFER  *StatsBuffer
+  )
+{
+  if (StatsBuffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  StatsBuffer->Mmis        = mCommBufferStats.Mmis;
+  StatsBuffer->BytesCopied = mCommBufferStats.BytesCopied;
+  StatsBuffer->BytesZeroed = mCommBufferStats.BytesZeroed;
+  if ((StatsBuffer->Flags & MM_SUPERVISOR_COMM_BUFFER_STATS_RESET) != 0) {
+    ZeroMem (&mCommBufferStats, sizeof (mCommBufferStats));
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
   The main entry point to MM Foundation.
 
@@ -427,6 +550,7 @@ MmEntryPoint (
   STATIC BOOLEAN             FirstMmi = TRUE;
   EFI_PHYSICAL_ADDRESS       CommunicationBuffer;
   UINT64                     BufferSize;
+  UINT64                     IncomingSize;
 
   PERF_FUNCTION_BEGIN ();
 
@@ -467,6 +591,7 @@ MmEntryPoint (
   //
   CommunicationBuffer = (EFI_PHYSICAL_ADDRESS)(UINTN)gMmCorePrivate->CommunicationBuffer;
   BufferSize          = gMmCorePrivate->BufferSize;
+  IncomingSize        = BufferSize;
   if ((VOID *)CommunicationBuffer != NULL) {
     //
     // Synchronous MMI for MM Core or request from Communicate protocol
@@ -477,9 +602,7 @@ MmEntryPoint (
       //
       // This should be user communicate channel, follow normal user channel iterations, but use ring 3 buffer to hold BufferSize changes
       //
-      ZeroMem (mInternalCommBufferCopy[MM_USER_BUFFER_T], EFI_PAGES_TO_SIZE (mMmSupervisorAccessBuffer[MM_USER_BUFFER_T].NumberOfPages));
-      CopyMem (mInternalCommBufferCopy[MM_USER_BUFFER_T], (VOID *)(UINTN)CommunicationBuffer, BufferSize);
-      CommunicateHeader = (EFI_MM_COMMUNICATE_HEADER *)(UINTN)mInternalCommBufferCopy[MM_USER_BUFFER_T];
+      CommunicateHeader = CopyInCommBuffer (MM_USER_BUFFER_T, CommunicationBuffer, BufferSize);
 
       Status = SafeUint64Sub (BufferSize, OFFSET_OF (EFI_MM_COMMUNICATE_HEADER, Data), &BufferSize);
       if (EFI_ERROR (Status)) {
@@ -490,13 +613,26 @@ MmEntryPoint (
         goto Cleanup;
       }
 
-      SupervisorToUserDataBuffer->gMmCorePrivateDummy.BufferSize = BufferSize;
-      Status                                                     = MmiManage (
-                                                                     &CommunicateHeader->HeaderGuid,
-                                                                     NULL,
-                                                                     CommunicateHeader->Data,
-                                                                     (UINTN *)&(SupervisorToUserDataBuffer->gMmCorePrivateDummy.BufferSize)
-                                                                     );
+      if (CompareGuid (&CommunicateHeader->HeaderGuid, &gMmCommunicateBatchGuid)) {
+        //
+        // Several messages in one MMI, their responses are written in place so the whole batch goes back
+        //
+        Status = MmiManageCommunicateBatch ((MM_COMMUNICATE_BATCH_HEADER *)CommunicateHeader->Data, BufferSize);
+        if (EFI_ERROR (Status)) {
+          DEBUG ((DEBUG_ERROR, "%a Malformed communicate batch - %r\n", __FUNCTION__, Status));
+        }
+
+        SupervisorToUserDataBuffer->gMmCorePrivateDummy.BufferSize = BufferSize;
+      } else {
+        SupervisorToUserDataBuffer->gMmCorePrivateDummy.BufferSize = BufferSize;
+        Status                                                     = MmiManage (
+                                                                       &CommunicateHeader->HeaderGuid,
+                                                                       NULL,
+                                                                       CommunicateHeader->Data,
+                                                                       (UINTN *)&(SupervisorToUserDataBuffer->gMmCorePrivateDummy.BufferSize)
+                                                                       );
+      }
+
       //
       // Update CommunicationBuffer, BufferSize and ReturnStatus
       // Communicate service finished, reset the pointer to CommBuffer to NULL
@@ -504,7 +640,7 @@ MmEntryPoint (
       BufferSize = SupervisorToUserDataBuffer->gMmCorePrivateDummy.BufferSize +
                    OFFSET_OF (EFI_MM_COMMUNICATE_HEADER, Data);
       if (BufferSize <= EFI_PAGES_TO_SIZE (mMmSupervisorAccessBuffer[MM_USER_BUFFER_T].NumberOfPages)) {
-        CopyMem ((VOID *)(UINTN)CommunicationBuffer, CommunicateHeader, BufferSize);
+        CopyOutCommBuffer (MM_USER_BUFFER_T, CommunicationBuffer, IncomingSize, BufferSize);
       } else {
         // The returned buffer size indicating the return buffer is larger than input buffer, need to panic here.
         DEBUG ((DEBUG_ERROR, "%a Returned buffer size is larger than maximal allowed size indicated in input, something is off...\n", __FUNCTION__));
@@ -520,9 +656,7 @@ MmEntryPoint (
       //
       // This should be supervisor communicate channel, everything can be ring 0 buffer fine
       //
-      ZeroMem (mInternalCommBufferCopy[MM_SUPERVISOR_BUFFER_T], EFI_PAGES_TO_SIZE (mMmSupervisorAccessBuffer[MM_SUPERVISOR_BUFFER_T].NumberOfPages));
-      CopyMem (mInternalCommBufferCopy[MM_SUPERVISOR_BUFFER_T], (VOID *)(UINTN)CommunicationBuffer, BufferSize);
-      CommunicateHeader = (EFI_MM_COMMUNICATE_HEADER *)(UINTN)mInternalCommBufferCopy[MM_SUPERVISOR_BUFFER_T];
+      CommunicateHeader = CopyInCommBuffer (MM_SUPERVISOR_BUFFER_T, CommunicationBuffer, BufferSize);
 
       Status = SafeUint64Sub (BufferSize, OFFSET_OF (EFI_MM_COMMUNICATE_HEADER, Data), &BufferSize);
       if (EFI_ERROR (Status)) {
@@ -543,7 +677,7 @@ MmEntryPoint (
       //
       BufferSize = BufferSize + OFFSET_OF (EFI_MM_COMMUNICATE_HEADER, Data);
       if (BufferSize <= EFI_PAGES_TO_SIZE (mMmSupervisorAccessBuffer[MM_SUPERVISOR_BUFFER_T].NumberOfPages)) {
-        CopyMem ((VOID *)(UINTN)mMmSupervisorAccessBuffer[MM_SUPERVISOR_BUFFER_T].PhysicalStart, CommunicateHeader, BufferSize);
+        CopyOutCommBuffer (MM_SUPERVISOR_BUFFER_T, mMmSupervisorAccessBuffer[MM_SUPERVISOR_BUFFER_T].PhysicalStart, IncomingSize, BufferSize);
       } else {
         // The returned buffer size indicating the return buffer is larger than input buffer, need to panic here.
         DEBUG ((DEBUG_ERROR, "%a Returned buffer size is larger than maximal allowed size indicated in input, something is off...\n", __FUNCTION__));
@@ -1008,6 +1142,14 @@ MmSupervisorMain (
 
   SyscallInterfaceInit (mNumberOfCpus);
 
+  if (EFI_ERROR (PageAttributeCacheInit (mNumberOfCpus))) {
+    DEBUG ((DEBUG_WARN, "%a Page attribute cache is not available\n", __FUNCTION__));
+  }
+
+  if (EFI_ERROR (SmiTimelineInit (mNumberOfCpus))) {
+    DEBUG ((DEBUG_WARN, "%a SMI timeline is not available\n", __FUNCTION__));
+  }
+
   CoalesceLooseExceptionHandlers ();
 
   LockMmCoreBeforeExit ();
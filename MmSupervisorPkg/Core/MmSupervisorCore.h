@@ -34,6 +34,8 @@
 #include <Guid/MmCoreProfileData.h>
 #include <Guid/MmCoreData.h>
 
+#include <MmiHandlerProfileStats.h>
+
 #include <Library/StandaloneMmCoreEntryPoint.h>
 #include <Library/BaseLib.h>
 #include <Library/FvLib.h>
@@ -53,6 +55,8 @@
 #include <Library/ResetSystemLib.h>
 #include <Library/PanicLib.h>
 
+#include "Handler/MmiEntryHash.h"
+
 //
 // Used to build a table of MMI Handlers that the MM Core registers
 //
@@ -201,24 +205,34 @@ typedef struct {
 #define MMI_ENTRY_SIGNATURE  SIGNATURE_32('m','m','i','e')
 
 typedef struct {
-  UINTN         Signature;
-  LIST_ENTRY    AllEntries; // All entries
+  UINTN                  Signature;
+  LIST_ENTRY             AllEntries; // All entries
 
-  EFI_GUID      HandlerType; // Type of interrupt
-  LIST_ENTRY    MmiHandlers; // All handlers
+  EFI_GUID               HandlerType;     // Type of interrupt
+  LIST_ENTRY             SupvMmiHandlers; // Supervisor handlers, in registration order
+  LIST_ENTRY             UserMmiHandlers; // User handlers, in registration order
+  MMI_ENTRY_HASH_NODE    HashNode;        // Node in mMmiEntryHash, keyed on HandlerType
 } MMI_ENTRY;
 
+//
+// The handler list of an MMI entry holding the handlers of the given ownership
+//
+#define MMI_ENTRY_HANDLERS(Entry, IsSupervisor) \
+  ((IsSupervisor) ? &(Entry)->SupvMmiHandlers : &(Entry)->UserMmiHandlers)
+
 #define MMI_HANDLER_SIGNATURE  SIGNATURE_32('m','m','i','h')
 
 typedef struct {
   UINTN                         Signature;
-  LIST_ENTRY                    Link;        // Link on MMI_ENTRY.MmiHandlers
+  LIST_ENTRY                    Link;        // Link on MMI_ENTRY_HANDLERS (MmiEntry, IsSupervisor)
   EFI_MM_HANDLER_ENTRY_POINT    Handler;     // The mm handler's entry point
   UINTN                         CallerAddr;  // The address of caller who register the SMI handler.
   MMI_ENTRY                     *MmiEntry;
   VOID                          *Context;     // for profile
   UINTN                         ContextSize;  // for profile
   BOOLEAN                       IsSupervisor; // for isolation
+  BOOLEAN                       ToRemove;     // Unregistered while MmiManage runs, freed once it returns
+  MMI_HANDLER_STATS             Stats;        // Dispatch statistics, always collected
 } MMI_HANDLER;
 
 #define DEFAULT_SUPV_TO_USER_BUFFER_PAGE  1  // Leave 4KB space known to the supervisor that is in CPL3
@@ -716,6 +730,35 @@ MmiHandlerUserUnRegister (
   IN  EFI_HANDLE  DispatchHandle
   );
 
+/**
+  Enumerate the handlers of an MMI entry, supervisor handlers first.
+
+  @param  MmiEntry    The MMI entry.
+  @param  MmiHandler  The handler returned by the previous call, or NULL to get the first one.
+
+  @return The handler after MmiHandler, or NULL if MmiHandler is the last one.
+
+**/
+MMI_HANDLER *
+GetNextMmiHandler (
+  IN MMI_ENTRY    *MmiEntry,
+  IN MMI_HANDLER  *MmiHandler  OPTIONAL
+  );
+
+/**
+  Allocate the user MMI batch, in pages that are read-only to user mode, and
+  the user writable page its handler statuses are returned in.
+
+  @retval EFI_SUCCESS           The batch is ready.
+  @retval EFI_ALREADY_STARTED   The batch was already allocated.
+  @retval EFI_OUT_OF_RESOURCES  Not enough memory for the batch.
+  @retval Others                The batch pages could not be made read-only.
+**/
+EFI_STATUS
+UserMmiBatchInit (
+  VOID
+  );
+
 /**
   Helper function that will look up the driver GUID from discovered list using loaded image address.
 
@@ -11,6 +11,10 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <PiMm.h>
 #include <SmmSecurePolicy.h>
 
+#include <Protocol/MmCpuIo.h>
+
+#include <Library/SmmPolicyGateLib.h>
+
 #include "MmSupervisorCore.h"
 #include "Policy/Policy.h"
 
@@ -594,6 +598,13 @@ InitializePolicy (
     goto Done;
   }
 
+  // Build the lookup index for syscall policy checks, without it the gate falls back to walking the descriptors
+  Status = CompileSecurityPolicy (FirmwarePolicy);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "%a Failed to compile firmware policy, lookups will walk the policy - %r\n", __FUNCTION__, Status));
+    Status = EFI_SUCCESS;
+  }
+
 Done:
   return Status;
 }
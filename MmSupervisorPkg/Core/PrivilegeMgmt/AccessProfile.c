@@ -0,0 +1,319 @@
+/** @file
+  Profile of the IO ports and MSRs accessed through syscalls.
+
+  Each accessed IO port and MSR is kept in a fixed capacity open addressed hash
+  table together with its read/write counters and the access widths seen. The
+  tables are exported through the supervisor channel so that deny-by-default
+  policies can be generated from a full workload.
+
+  Syscalls are recorded on any processor at the same time, so slots are
+  claimed with a compare exchange of their key and every counter is updated
+  with interlocked operations.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Guid/MmSupervisorRequestData.h>
+
+#include <Protocol/MmCpuIo.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/SynchronizationLib.h>
+
+#include "MmSupervisorCore.h"
+#include "PrivilegeMgmt.h"
+#include "Request/Request.h"
+
+//
+// Key of a claimed slot, a free slot has key 0.
+//
+#define ACCESS_PROFILE_KEY(Address)  (BIT32 | (UINT64)(Address))
+
+typedef struct {
+  volatile UINT64    Key;
+  volatile UINT64    ReadCount;
+  volatile UINT64    WriteCount;
+  volatile UINT32    WidthMask;
+  UINT32             Reserved;
+} ACCESS_PROFILE_SLOT;
+
+typedef struct {
+  ACCESS_PROFILE_SLOT    *Slots;
+  UINTN                  Capacity;
+  volatile UINT32        Count;
+  volatile UINT32        OverflowReported;
+} ACCESS_PROFILE_TABLE;
+
+ACCESS_PROFILE_TABLE  mIoProfile;
+ACCESS_PROFILE_TABLE  mMsrProfile;
+UINTN                 mAccessProfileMaxCount = 0;
+
+/**
+  Allocate the slots of one profile table.
+
+  @param[out] Table       The table to initialize.
+  @param[in]  Capacity    Number of slots, must be a power of two.
+
+  @retval EFI_SUCCESS             The table is ready.
+  @retval EFI_OUT_OF_RESOURCES    Not enough memory for the table.
+**/
+STATIC
+EFI_STATUS
+InitAccessProfileTable (
+  OUT ACCESS_PROFILE_TABLE  *Table,
+  IN  UINTN                 Capacity
+  )
+{
+  Table->Slots = AllocateZeroPool (sizeof (ACCESS_PROFILE_SLOT) * Capacity);
+  if (Table->Slots == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Table->Capacity         = Capacity;
+  Table->Count            = 0;
+  Table->OverflowReported = 0;
+  return EFI_SUCCESS;
+}
+
+/**
+  Atomically add one to a 64 bit counter.
+
+  @param[in, out] Counter   The counter to increment.
+**/
+STATIC
+VOID
+AccessProfileIncrement64 (
+  IN OUT volatile UINT64  *Counter
+  )
+{
+  UINT64  Value;
+
+  do {
+    Value = *Counter;
+  } while (InterlockedCompareExchange64 (Counter, Value, Value + 1) != Value);
+}
+
+/**
+  Atomically set bits of a 32 bit mask.
+
+  @param[in, out] Mask    The mask to update.
+  @param[in]      Bits    The bits to set.
+**/
+STATIC
+VOID
+AccessProfileOr32 (
+  IN OUT volatile UINT32  *Mask,
+  IN     UINT32           Bits
+  )
+{
+  UINT32  Value;
+
+  do {
+    Value = *Mask;
+    if ((Value & Bits) == Bits) {
+      return;
+    }
+  } while (InterlockedCompareExchange32 (Mask, Value, Value | Bits) != Value);
+}
+
+/**
+  Allocate the IO port and MSR profile tables when
+  PcdMmSupervisorPrintPortsEnable is set.
+
+  @retval EFI_SUCCESS             The tables are ready, or not enabled.
+  @retval EFI_OUT_OF_RESOURCES    Not enough memory for the tables.
+**/
+EFI_STATUS
+AccessProfileInit (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Capacity;
+
+  if (!FeaturePcdGet (PcdMmSupervisorPrintPortsEnable) || (FixedPcdGet16 (PcdMmSupervisorPrintPortsMaxSize) == 0)) {
+    return EFI_SUCCESS;
+  }
+
+  // Keep the load factor at or below one half so that probe sequences stay short
+  mAccessProfileMaxCount = FixedPcdGet16 (PcdMmSupervisorPrintPortsMaxSize);
+  Capacity               = GetPowerOfTwo32 ((UINT32)mAccessProfileMaxCount);
+  if (Capacity < mAccessProfileMaxCount) {
+    Capacity <<= 1;
+  }
+
+  Capacity <<= 1;
+
+  Status = InitAccessProfileTable (&mIoProfile, Capacity);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = InitAccessProfileTable (&mMsrProfile, Capacity);
+  if (EFI_ERROR (Status)) {
+    FreePool (mIoProfile.Slots);
+    mIoProfile.Slots = NULL;
+    return Status;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Account one IO port or MSR access in the profile. A new port or MSR is
+  printed the first time it is seen.
+
+  @param[in]  Address     The IO port or MSR index.
+  @param[in]  Width       The EFI_MM_IO_WIDTH of an IO access, ignored for MSR.
+  @param[in]  IsMsr       TRUE if Address is an MSR index, FALSE if it is an IO port.
+  @param[in]  IsWrite     TRUE if the access is a write, FALSE if it is a read.
+**/
+VOID
+RecordAccessProfile (
+  IN UINT32   Address,
+  IN UINTN    Width,
+  IN BOOLEAN  IsMsr,
+  IN BOOLEAN  IsWrite
+  )
+{
+  ACCESS_PROFILE_TABLE  *Table;
+  ACCESS_PROFILE_SLOT   *Slot;
+  UINT64                Key;
+  UINT64                Current;
+  UINTN                 Mask;
+  UINTN                 Index;
+
+  Table = IsMsr ? &mMsrProfile : &mIoProfile;
+  if (Table->Slots == NULL) {
+    return;
+  }
+
+  // Fibonacci hashing, linear probing
+  Key   = ACCESS_PROFILE_KEY (Address);
+  Mask  = Table->Capacity - 1;
+  Index = (UINTN)(((UINT32)(Address * 0x9E3779B1u)) & Mask);
+  while (TRUE) {
+    Slot    = &Table->Slots[Index];
+    Current = Slot->Key;
+    if (Current == Key) {
+      break;
+    }
+
+    if (Current == 0) {
+      // Reserve room before claiming, so that the load factor bound holds on every processor
+      if (InterlockedIncrement (&Table->Count) > mAccessProfileMaxCount) {
+        InterlockedDecrement (&Table->Count);
+        if (InterlockedCompareExchange32 (&Table->OverflowReported, 0, 1) == 0) {
+          DEBUG ((DEBUG_ERROR, "%a %a profile is full!\n", __FUNCTION__, IsMsr ? "MSR" : "IO"));
+        }
+
+        return;
+      }
+
+      Current = InterlockedCompareExchange64 (&Slot->Key, 0, Key);
+      if (Current == 0) {
+        DEBUG ((DEBUG_INFO, "%a First access to %a 0x%x\n", __FUNCTION__, IsMsr ? "MSR" : "IO port", Address));
+        break;
+      }
+
+      // Another processor claimed the slot first, possibly for the same address
+      InterlockedDecrement (&Table->Count);
+      if (Current == Key) {
+        break;
+      }
+    }
+
+    Index = (Index + 1) & Mask;
+  }
+
+  if (!IsMsr && (Width <= MM_IO_UINT64)) {
+    AccessProfileOr32 (&Slot->WidthMask, (UINT32)(1 << Width));
+  }
+
+  if (IsWrite) {
+    AccessProfileIncrement64 (&Slot->WriteCount);
+  } else {
+    AccessProfileIncrement64 (&Slot->ReadCount);
+  }
+}
+
+/**
+  Routine used to copy out the IO port and MSR access profile.
+
+  @param[in, out] ProfileBuffer   Output buffer header, the entries follow it.
+  @param[in]      BufferSize      Maximal buffer size supplied by caller,
+                                  including the buffer header.
+
+  @retval EFI_SUCCESS             The profile is copied out.
+  @retval EFI_INVALID_PARAMETER   ProfileBuffer is NULL or BufferSize cannot hold
+                                  the buffer header.
+  @retval EFI_UNSUPPORTED         Access profiling is not enabled.
+  @retval EFI_BUFFER_TOO_SMALL    The buffer cannot hold all entries, EntryCount
+                                  holds the number of entries needed.
+**/
+EFI_STATUS
+ProcessAccessProfileRequest (
+  IN OUT MM_SUPERVISOR_ACCESS_PROFILE_BUFFER  *ProfileBuffer,
+  IN     UINTN                                BufferSize
+  )
+{
+  MM_SUPERVISOR_ACCESS_PROFILE_ENTRY  *Entries;
+  ACCESS_PROFILE_TABLE                *Tables[2];
+  ACCESS_PROFILE_SLOT                 *Slot;
+  UINTN                               MaxEntries;
+  UINTN                               EntryCount;
+  UINTN                               TableIndex;
+  UINTN                               Index;
+
+  if ((ProfileBuffer == NULL) || (BufferSize < sizeof (MM_SUPERVISOR_ACCESS_PROFILE_BUFFER))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((mIoProfile.Slots == NULL) || (mMsrProfile.Slots == NULL)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  MaxEntries = (BufferSize - sizeof (MM_SUPERVISOR_ACCESS_PROFILE_BUFFER)) / sizeof (MM_SUPERVISOR_ACCESS_PROFILE_ENTRY);
+  EntryCount = mIoProfile.Count + mMsrProfile.Count;
+
+  ProfileBuffer->EntryCount = (UINT32)EntryCount;
+  if (EntryCount > MaxEntries) {
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  // Slots may still be claimed while copying, never go past the room checked above
+  Entries    = (MM_SUPERVISOR_ACCESS_PROFILE_ENTRY *)(ProfileBuffer + 1);
+  Tables[0]  = &mIoProfile;
+  Tables[1]  = &mMsrProfile;
+  MaxEntries = EntryCount;
+  EntryCount = 0;
+  for (TableIndex = 0; TableIndex < ARRAY_SIZE (Tables); TableIndex++) {
+    for (Index = 0; (Index < Tables[TableIndex]->Capacity) && (EntryCount < MaxEntries); Index++) {
+      Slot = &Tables[TableIndex]->Slots[Index];
+      if (Slot->Key == 0) {
+        continue;
+      }
+
+      ZeroMem (&Entries[EntryCount], sizeof (MM_SUPERVISOR_ACCESS_PROFILE_ENTRY));
+      Entries[EntryCount].Address    = (UINT32)Slot->Key;
+      Entries[EntryCount].Type       = (TableIndex == 0) ? MM_SUPERVISOR_ACCESS_PROFILE_IO : MM_SUPERVISOR_ACCESS_PROFILE_MSR;
+      Entries[EntryCount].WidthMask  = (UINT8)Slot->WidthMask;
+      Entries[EntryCount].Valid      = 1;
+      Entries[EntryCount].ReadCount  = Slot->ReadCount;
+      Entries[EntryCount].WriteCount = Slot->WriteCount;
+      EntryCount++;
+    }
+  }
+
+  ProfileBuffer->EntryCount = (UINT32)EntryCount;
+  return EFI_SUCCESS;
+}
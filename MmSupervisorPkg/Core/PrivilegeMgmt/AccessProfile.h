@@ -0,0 +1,42 @@
+/** @file
+  Profile of the IO ports and MSRs accessed through syscalls.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MM_ACCESS_PROFILE_H_
+#define _MM_ACCESS_PROFILE_H_
+
+/**
+  Allocate the IO port and MSR profile tables when
+  PcdMmSupervisorPrintPortsEnable is set.
+
+  @retval EFI_SUCCESS             The tables are ready, or not enabled.
+  @retval EFI_OUT_OF_RESOURCES    Not enough memory for the tables.
+**/
+EFI_STATUS
+AccessProfileInit (
+  VOID
+  );
+
+/**
+  Account one IO port or MSR access in the profile. A new port or MSR is
+  printed the first time it is seen.
+
+  @param[in]  Address     The IO port or MSR index.
+  @param[in]  Width       The EFI_MM_IO_WIDTH of an IO access, ignored for MSR.
+  @param[in]  IsMsr       TRUE if Address is an MSR index, FALSE if it is an IO port.
+  @param[in]  IsWrite     TRUE if the access is a write, FALSE if it is a read.
+**/
+VOID
+RecordAccessProfile (
+  IN UINT32   Address,
+  IN UINTN    Width,
+  IN BOOLEAN  IsMsr,
+  IN BOOLEAN  IsWrite
+  );
+
+#endif
@@ -26,6 +26,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 UINTN  RegisteredRing3JumpPointer = 0;
 UINTN  RegApRing3JumpPointer      = 0;
 UINTN  RegErrorReportJumpPointer  = 0;
+UINTN  RegUserMmiBatchJumpPointer = 0;
 
 // Helper function to patch the call gate
 STATIC
@@ -268,6 +269,38 @@ InvokeDemotedMmHandler (
            );
 }
 
+/**
+  Invoke all MM handlers of a prepared batch in CPL 3, with a single ring transition.
+**/
+EFI_STATUS
+EFIAPI
+InvokeDemotedMmHandlerBatch (
+  IN MM_USER_MMI_BATCH  *Batch,
+  IN CONST VOID         *Context         OPTIONAL,
+  IN OUT VOID           *CommBuffer      OPTIONAL,
+  IN OUT UINTN          *CommBufferSize  OPTIONAL
+  )
+{
+  if (Batch == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (((VOID *)RegisteredRing3JumpPointer == NULL) || ((VOID *)RegUserMmiBatchJumpPointer == NULL)) {
+    return EFI_NOT_READY;
+  }
+
+  return InvokeDemotedRoutine (
+           mSmmMpSyncData->BspIndex,
+           (EFI_PHYSICAL_ADDRESS)RegisteredRing3JumpPointer,
+           5,
+           Batch,
+           Context,
+           CommBuffer,
+           CommBufferSize,
+           RegUserMmiBatchJumpPointer
+           );
+}
+
 /**
   Invoke AP Procedure in CPL 3.
 **/
@@ -15,6 +15,9 @@
 #define _MM_PRIVILEGE_MGMT_H_
 
 #include <Library/SynchronizationLib.h>
+#include <Library/SysCallLib.h>
+
+#include "AccessProfile.h"
 
 // This needs to be in consistency with SmiException.nasm
 #define PROTECTED_DS      0x20
@@ -37,6 +40,7 @@ typedef struct {
 extern UINTN      RegisteredRing3JumpPointer;
 extern UINTN      RegApRing3JumpPointer;
 extern UINTN      RegErrorReportJumpPointer;
+extern UINTN      RegUserMmiBatchJumpPointer;
 extern SPIN_LOCK  *mCpuToken;
 
 // Function to set up syscall MSR for just one thread/core
@@ -67,6 +71,32 @@ RestoreBspCpl0MsrStar (
   VOID
   );
 
+/**
+  Keep the syscall MSRs of CpuIndex programmed from the first demoted call of
+  this SMI until EndSmiCpl0MsrStar, instead of programming and restoring them
+  around every demoted call. Nothing is done if
+  PcdMmSupervisorSyscallMsrPerSmi is not set.
+
+  @param[in]  CpuIndex    The index of the executing CPU.
+**/
+VOID
+EFIAPI
+BeginSmiCpl0MsrStar (
+  IN  UINTN  CpuIndex
+  );
+
+/**
+  Restore the runtime values of the syscall MSRs of CpuIndex if they were kept
+  programmed for this SMI. Must be called before leaving SMM.
+
+  @param[in]  CpuIndex    The index of the executing CPU.
+**/
+VOID
+EFIAPI
+EndSmiCpl0MsrStar (
+  IN  UINTN  CpuIndex
+  );
+
 /**
 
   Setup the pool for STAR MSR holders.
@@ -154,6 +184,18 @@ InvokeDemotedMmHandler (
   IN OUT UINTN    *CommBufferSize  OPTIONAL
   );
 
+/**
+  Invoke all MM handlers of a prepared batch in CPL 3, with a single ring transition.
+**/
+EFI_STATUS
+EFIAPI
+InvokeDemotedMmHandlerBatch (
+  IN MM_USER_MMI_BATCH  *Batch,
+  IN CONST VOID         *Context         OPTIONAL,
+  IN OUT VOID           *CommBuffer      OPTIONAL,
+  IN OUT UINTN          *CommBufferSize  OPTIONAL
+  );
+
 /**
   Invoke AP Procedure in CPL 3.
 **/
@@ -211,4 +253,88 @@ UpdateCpl0StackPtrForGs (
   IN EFI_PHYSICAL_ADDRESS  Cpl0StackPtr
   );
 
+/**
+  Get the index of the executing CPU while it is serving a syscall, based on
+  the per CPU syscall cache that GS points to in this context.
+
+  @return The index of the executing CPU, or mNumberOfCpus if GS does not
+          point into the syscall caches.
+**/
+UINTN
+EFIAPI
+GetSyscallCpuIndex (
+  VOID
+  );
+
+/**
+  Allocate the per CPU syscall counters when PcdMmSupervisorSyscallStatsEnable
+  is set.
+
+  @param[in]  NumberOfCpus    Total number of CPUs need to be supported.
+
+  @retval EFI_SUCCESS             The counters are ready, or not enabled.
+  @retval EFI_OUT_OF_RESOURCES    Not enough memory for the counters.
+**/
+EFI_STATUS
+SyscallStatsInit (
+  IN UINTN  NumberOfCpus
+  );
+
+/**
+  Account one syscall in the counters of the executing CPU. No lock is taken,
+  each CPU only ever updates its own counters.
+
+  A syscall failing with an error status never returns to user mode, so only
+  the requests rejected with their outcome handed back to the caller are
+  counted as denials.
+
+  @param[in]  CallIndex   The syscall index.
+  @param[in]  Denied      TRUE if the request was rejected by a policy check
+                          and the rejection is reported to the caller.
+  @param[in]  Ticks       The TSC ticks spent in the supervisor.
+**/
+VOID
+RecordSyscallStats (
+  IN UINTN    CallIndex,
+  IN BOOLEAN  Denied,
+  IN UINT64   Ticks
+  );
+
+/**
+  Allocate the per CPU syscall trace rings when PcdEnableSyscallLogs is set.
+
+  @param[in]  NumberOfCpus    Total number of CPUs need to be supported.
+
+  @retval EFI_SUCCESS             The rings are ready, or not enabled.
+  @retval EFI_OUT_OF_RESOURCES    Not enough memory for the rings.
+**/
+EFI_STATUS
+SyscallTraceInit (
+  IN UINTN  NumberOfCpus
+  );
+
+/**
+  Append one syscall to the trace ring of the executing CPU. No lock is taken,
+  each CPU only ever writes its own ring, and the oldest record is overwritten
+  when the ring is full.
+
+  @param[in]  Timestamp   The TSC value when the syscall is entered.
+  @param[in]  CallIndex   The syscall index.
+  @param[in]  Arg1        The first argument of the syscall.
+  @param[in]  Arg2        The second argument of the syscall.
+  @param[in]  Arg3        The third argument of the syscall.
+  @param[in]  CallerAddr  The return address of the syscall.
+  @param[in]  Status      The status the syscall is completed with.
+**/
+VOID
+RecordSyscallTrace (
+  IN UINT64      Timestamp,
+  IN UINTN       CallIndex,
+  IN UINTN       Arg1,
+  IN UINTN       Arg2,
+  IN UINTN       Arg3,
+  IN UINTN       CallerAddr,
+  IN EFI_STATUS  Status
+  );
+
 #endif
@@ -0,0 +1,245 @@
+/** @file
+  Execution of the records of a SMM_SC_BATCH syscall.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+#include <SmmSecurePolicy.h>
+
+#include <Protocol/MmCpuIo.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/IoLib.h>
+#include <Library/SmmPolicyGateLib.h>
+
+#include "AccessProfile.h"
+#include "SyscallBatch.h"
+#include "../Mem/Mem.h"
+#include "../Policy/Policy.h"
+
+/**
+  Execute one IO record of a SMM_SC_BATCH request after checking it against
+  the firmware policy.
+
+  @param[in, out] Entry     Private copy of the record, Value receives the
+                            value read for read and modify records.
+
+  @retval EFI_SUCCESS             The access is executed.
+  @retval EFI_INVALID_PARAMETER   The record is malformed.
+  @retval EFI_ACCESS_DENIED       The access is blocked by policy.
+**/
+STATIC
+EFI_STATUS
+ProcessBatchIoEntry (
+  IN OUT SMM_SC_BATCH_ENTRY  *Entry
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      Port;
+  UINT64      ReadValue;
+  UINT64      WriteValue;
+
+  if ((Entry->Width != MM_IO_UINT8) && (Entry->Width != MM_IO_UINT16) && (Entry->Width != MM_IO_UINT32)) {
+    DEBUG ((DEBUG_ERROR, "%a IO incompatible size - %d\n", __FUNCTION__, Entry->Width));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Entry->Address > MAX_UINT32) {
+    DEBUG ((DEBUG_ERROR, "%a Invalid IO port - 0x%lx\n", __FUNCTION__, Entry->Address));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Port = (UINT32)Entry->Address;
+  if (Entry->Operation != SMM_SC_BATCH_IO_WRITE) {
+    Status = IsIoReadWriteAllowed (FirmwarePolicy, Port, (EFI_MM_IO_WIDTH)Entry->Width, SECURE_POLICY_RESOURCE_ATTR_READ_DIS);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a Read IO port 0x%x with width type %d blocked by policy - %r\n", __FUNCTION__, Port, Entry->Width, Status));
+      return Status;
+    }
+  }
+
+  if (Entry->Operation != SMM_SC_BATCH_IO_READ) {
+    Status = IsIoReadWriteAllowed (FirmwarePolicy, Port, (EFI_MM_IO_WIDTH)Entry->Width, SECURE_POLICY_RESOURCE_ATTR_WRITE_DIS);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a Write IO port 0x%x with width type %d blocked by policy - %r\n", __FUNCTION__, Port, Entry->Width, Status));
+      return Status;
+    }
+  }
+
+  WriteValue = Entry->Value;
+  if (Entry->Operation != SMM_SC_BATCH_IO_WRITE) {
+    if (Entry->Width == MM_IO_UINT8) {
+      ReadValue = IoRead8 (Port);
+    } else if (Entry->Width == MM_IO_UINT16) {
+      ReadValue = IoRead16 (Port);
+    } else {
+      ReadValue = IoRead32 (Port);
+    }
+
+    WriteValue   = (ReadValue & Entry->AndMask) | Entry->Value;
+    Entry->Value = ReadValue;
+  }
+
+  if (Entry->Operation != SMM_SC_BATCH_IO_READ) {
+    if (Entry->Width == MM_IO_UINT8) {
+      IoWrite8 (Port, (UINT8)WriteValue);
+    } else if (Entry->Width == MM_IO_UINT16) {
+      IoWrite16 (Port, (UINT16)WriteValue);
+    } else {
+      IoWrite32 (Port, (UINT32)WriteValue);
+    }
+  }
+
+  if (FeaturePcdGet (PcdMmSupervisorPrintPortsEnable)) {
+    if (Entry->Operation != SMM_SC_BATCH_IO_WRITE) {
+      RecordAccessProfile (Port, Entry->Width, FALSE, FALSE);
+    }
+
+    if (Entry->Operation != SMM_SC_BATCH_IO_READ) {
+      RecordAccessProfile (Port, Entry->Width, FALSE, TRUE);
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Execute one MSR record of a SMM_SC_BATCH request after checking it against
+  the firmware policy.
+
+  @param[in, out] Entry     Private copy of the record, Value receives the
+                            value read for read and modify records.
+
+  @retval EFI_SUCCESS             The access is executed.
+  @retval EFI_INVALID_PARAMETER   The record is malformed.
+  @retval EFI_ACCESS_DENIED       The access is blocked by policy.
+**/
+STATIC
+EFI_STATUS
+ProcessBatchMsrEntry (
+  IN OUT SMM_SC_BATCH_ENTRY  *Entry
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      MsrIndex;
+  UINT64      ReadValue;
+  UINT64      WriteValue;
+
+  if (Entry->Address > MAX_UINT32) {
+    DEBUG ((DEBUG_ERROR, "%a Invalid MSR - 0x%lx\n", __FUNCTION__, Entry->Address));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  MsrIndex = (UINT32)Entry->Address;
+  if (Entry->Operation != SMM_SC_BATCH_MSR_WRITE) {
+    Status = IsMsrReadWriteAllowed (FirmwarePolicy, MsrIndex, SECURE_POLICY_RESOURCE_ATTR_READ_DIS);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a Read MSR 0x%x blocked by policy - %r\n", __FUNCTION__, MsrIndex, Status));
+      return Status;
+    }
+  }
+
+  if (Entry->Operation != SMM_SC_BATCH_MSR_READ) {
+    Status = IsMsrReadWriteAllowed (FirmwarePolicy, MsrIndex, SECURE_POLICY_RESOURCE_ATTR_WRITE_DIS);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a Write MSR 0x%x blocked by policy - %r\n", __FUNCTION__, MsrIndex, Status));
+      return Status;
+    }
+  }
+
+  WriteValue = Entry->Value;
+  if (Entry->Operation != SMM_SC_BATCH_MSR_WRITE) {
+    ReadValue    = AsmReadMsr64 (MsrIndex);
+    WriteValue   = (ReadValue & Entry->AndMask) | Entry->Value;
+    Entry->Value = ReadValue;
+  }
+
+  if (Entry->Operation != SMM_SC_BATCH_MSR_READ) {
+    AsmWriteMsr64 (MsrIndex, WriteValue);
+  }
+
+  if (FeaturePcdGet (PcdMmSupervisorPrintPortsEnable)) {
+    if (Entry->Operation != SMM_SC_BATCH_MSR_WRITE) {
+      RecordAccessProfile (MsrIndex, 0, TRUE, FALSE);
+    }
+
+    if (Entry->Operation != SMM_SC_BATCH_MSR_READ) {
+      RecordAccessProfile (MsrIndex, 0, TRUE, TRUE);
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Execute the records of a SMM_SC_BATCH request in order.
+
+  The record buffer is checked for user ownership once. Each record is then
+  copied out before it is checked and executed, so that other processors
+  altering the buffer cannot change a record after it passed the policy gate.
+
+  @param[in]  Buffer    The address of the SMM_SC_BATCH_ENTRY records.
+  @param[in]  Count     The number of records.
+
+  @retval EFI_SUCCESS             All records are executed.
+  @retval EFI_INVALID_PARAMETER   Count is out of range or a record is malformed.
+  @retval EFI_SECURITY_VIOLATION  The buffer is not owned by user.
+  @retval EFI_ACCESS_DENIED       A record is blocked by policy, the records
+                                  before it have been executed.
+**/
+EFI_STATUS
+ProcessSyscallBatch (
+  IN UINTN  Buffer,
+  IN UINTN  Count
+  )
+{
+  EFI_STATUS          Status;
+  SMM_SC_BATCH_ENTRY  *Entries;
+  SMM_SC_BATCH_ENTRY  Entry;
+  UINTN               Index;
+  BOOLEAN             IsUserRange;
+
+  if ((Count == 0) || (Count > SMM_SC_BATCH_MAX_ENTRIES)) {
+    DEBUG ((DEBUG_ERROR, "%a Invalid record count - %d\n", __FUNCTION__, Count));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (EFI_ERROR (InspectTargetRangeOwnership (Buffer, Count * sizeof (SMM_SC_BATCH_ENTRY), &IsUserRange)) || !IsUserRange) {
+    return EFI_SECURITY_VIOLATION;
+  }
+
+  Entries = (SMM_SC_BATCH_ENTRY *)Buffer;
+  for (Index = 0; Index < Count; Index++) {
+    CopyMem (&Entry, &Entries[Index], sizeof (Entry));
+    switch (Entry.Operation) {
+      case SMM_SC_BATCH_IO_READ:
+      case SMM_SC_BATCH_IO_WRITE:
+      case SMM_SC_BATCH_IO_MODIFY:
+        Status = ProcessBatchIoEntry (&Entry);
+        break;
+      case SMM_SC_BATCH_MSR_READ:
+      case SMM_SC_BATCH_MSR_WRITE:
+      case SMM_SC_BATCH_MSR_MODIFY:
+        Status = ProcessBatchMsrEntry (&Entry);
+        break;
+      default:
+        Status = EFI_INVALID_PARAMETER;
+        break;
+    }
+
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a Record %d of %d with operation %d failed - %r\n", __FUNCTION__, Index, Count, Entry.Operation, Status));
+      return Status;
+    }
+
+    Entries[Index].Value = Entry.Value;
+  }
+
+  return EFI_SUCCESS;
+}
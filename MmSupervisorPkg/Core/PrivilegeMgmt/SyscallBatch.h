@@ -0,0 +1,37 @@
+/** @file
+  Execution of the records of a SMM_SC_BATCH syscall.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MM_SYSCALL_BATCH_H_
+#define _MM_SYSCALL_BATCH_H_
+
+#include <Library/SysCallLib.h>
+
+/**
+  Execute the records of a SMM_SC_BATCH request in order.
+
+  The record buffer is checked for user ownership once. Each record is then
+  copied out before it is checked and executed, so that other processors
+  altering the buffer cannot change a record after it passed the policy gate.
+
+  @param[in]  Buffer    The address of the SMM_SC_BATCH_ENTRY records.
+  @param[in]  Count     The number of records.
+
+  @retval EFI_SUCCESS             All records are executed.
+  @retval EFI_INVALID_PARAMETER   Count is out of range or a record is malformed.
+  @retval EFI_SECURITY_VIOLATION  The buffer is not owned by user.
+  @retval EFI_ACCESS_DENIED       A record is blocked by policy, the records
+                                  before it have been executed.
+**/
+EFI_STATUS
+ProcessSyscallBatch (
+  IN UINTN  Buffer,
+  IN UINTN  Count
+  );
+
+#endif
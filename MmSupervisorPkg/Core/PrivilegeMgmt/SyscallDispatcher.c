@@ -22,135 +22,15 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include "MmSupervisorCore.h"
 #include "PrivilegeMgmt.h"
+#include "SyscallBatch.h"
 #include "Relocate/Relocate.h"
 #include "Handler/Handler.h"
+#include "Services/MpService/ParallelFor.h"
 #include "Mem/Mem.h"
 #include "Policy/Policy.h"
 
 EFI_MM_SYSTEM_TABLE  *gMmUserMmst = NULL;
 
-// Dictionary structure saving policy id and length
-struct Dict {
-  UINTN    id;
-  UINTN    width;
-};
-
-GLOBAL_REMOVE_IF_UNREFERENCED UINT8        mMaxDictSize = (UINT8)FixedPcdGet8 (PcdMmSupervisorPrintPortsMaxSize);
-GLOBAL_REMOVE_IF_UNREFERENCED UINT8        mMsrCurrSize = 0;
-GLOBAL_REMOVE_IF_UNREFERENCED UINT8        mIoCurrSize  = 0;
-GLOBAL_REMOVE_IF_UNREFERENCED BOOLEAN      mPcdCheck    = TRUE;
-GLOBAL_REMOVE_IF_UNREFERENCED BOOLEAN      mPrintInfo   = FALSE;
-GLOBAL_REMOVE_IF_UNREFERENCED BOOLEAN      mPrintEnabled;
-GLOBAL_REMOVE_IF_UNREFERENCED struct Dict  mMsrValues[FixedPcdGet8 (PcdMmSupervisorPrintPortsMaxSize)];
-GLOBAL_REMOVE_IF_UNREFERENCED struct Dict  mIoValues[FixedPcdGet8 (PcdMmSupervisorPrintPortsMaxSize)];
-
-VOID
-AddToDict (
-  UINTN    Id,
-  UINTN    Width,
-  BOOLEAN  IsMsr
-  );
-
-VOID
-PrintDict (
-  );
-
-/**
-  Adds an id/width entry to the one of the dictionary structures based on
-  the inputted identifier.  This is an internal function.
-
-  @param  Id          The address id of the used port.
-  @param  Width       The length of the used port.
-  @param  IsMsr       Boolean that is true if the function is given an MSR input
-                      and is false otherwise.
-
-**/
-VOID
-AddToDict (
-  UINTN    Id,
-  UINTN    Width,
-  BOOLEAN  IsMsr
-  )
-{
-  UINTN        Index;
-  UINT8        MaxSize;
-  UINT8        CurrSize;
-  struct Dict  Entry;
-
-  MaxSize = mMaxDictSize;
-
-  if (IsMsr) {
-    CurrSize = mMsrCurrSize;
-  } else {
-    CurrSize = mIoCurrSize;
-  }
-
-  for (Index = 0; Index < CurrSize; Index = Index + 1) {
-    if (IsMsr) {
-      if (mMsrValues[Index].id == Id) {
-        return;
-      }
-    } else {
-      if (mIoValues[Index].id == Id) {
-        return;
-      }
-    }
-  }
-
-  if (CurrSize >= MaxSize) {
-    DEBUG ((DEBUG_ERROR, "Dictionary is to large!\n"));
-    return;
-  }
-
-  Entry.id    = Id;
-  Entry.width = Width;
-  mPrintInfo  = TRUE;
-
-  if (IsMsr) {
-    mMsrValues[CurrSize] = Entry;
-    mMsrCurrSize         = mMsrCurrSize + 1;
-  } else {
-    mIoValues[CurrSize] = Entry;
-    mIoCurrSize         = mIoCurrSize + 1;
-  }
-
-  return;
-}
-
-/**
-  Prints out the two dictionaries containing the IO and MSR ports being used
-  by the currently specified policy.  This is an internal function.
-**/
-VOID
-PrintDict (
-  VOID
-  )
-{
-  UINTN  Index;
-
-  DEBUG ((DEBUG_INFO, "Printing MSR devices that are being used by the current policy:\n"));
-  for (Index = 0; Index < mMsrCurrSize; Index = Index + 1) {
-    DEBUG ((
-      DEBUG_INFO,
-      "Important info: Arg1: %lx, Arg2: %lx\n",
-      mMsrValues[Index].id,
-      mMsrValues[Index].width
-      ));
-  }
-
-  DEBUG ((DEBUG_INFO, "Printing IO devices that are being used by the current policy:\n"));
-  for (Index = 0; Index < mIoCurrSize; Index = Index + 1) {
-    DEBUG ((
-      DEBUG_INFO,
-      "Important info: Arg1: %lx, Arg2: %lx\n",
-      mIoValues[Index].id,
-      mIoValues[Index].width
-      ));
-  }
-
-  return;
-}
-
 VOID
 EFIAPI
 SyncMmEntryContextToCpl3 (
@@ -214,6 +94,154 @@ QueryHobStartFromConfTable (
   return HobList;
 }
 
+/**
+  Execute a SMM_SC_IO_READ_FIFO or SMM_SC_IO_WRITE_FIFO request. The port is
+  checked against the firmware policy and the buffer for user ownership once,
+  then the whole transfer is carried out by a single string IO instruction.
+
+  @param[in]  CallIndex   SMM_SC_IO_READ_FIFO or SMM_SC_IO_WRITE_FIFO.
+  @param[in]  PortArg     The port and element width, see SMM_SC_IO_FIFO_ARG.
+  @param[in]  Count       The number of elements to transfer.
+  @param[in]  Buffer      The user buffer receiving or holding the elements.
+
+  @retval EFI_SUCCESS             The transfer is done.
+  @retval EFI_INVALID_PARAMETER   The width or count is out of range.
+  @retval EFI_SECURITY_VIOLATION  The buffer is not owned by user.
+  @retval EFI_ACCESS_DENIED       The port is blocked by policy.
+**/
+STATIC
+EFI_STATUS
+ProcessIoFifo (
+  IN UINTN  CallIndex,
+  IN UINTN  PortArg,
+  IN UINTN  Count,
+  IN UINTN  Buffer
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      Port;
+  UINTN       Width;
+  BOOLEAN     IsUserRange;
+
+  Port  = SMM_SC_IO_FIFO_PORT (PortArg);
+  Width = SMM_SC_IO_FIFO_WIDTH (PortArg);
+  if ((Width != MM_IO_UINT8) && (Width != MM_IO_UINT16) && (Width != MM_IO_UINT32)) {
+    DEBUG ((DEBUG_ERROR, "%a IO FIFO incompatible size - %d\n", __FUNCTION__, Width));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Count == 0) {
+    return EFI_SUCCESS;
+  }
+
+  if (Count > (MAX_UINTN >> Width)) {
+    DEBUG ((DEBUG_ERROR, "%a IO FIFO count too large - 0x%lx\n", __FUNCTION__, Count));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = IsIoReadWriteAllowed (
+             FirmwarePolicy,
+             Port,
+             (EFI_MM_IO_WIDTH)Width,
+             (CallIndex == SMM_SC_IO_READ_FIFO) ? SECURE_POLICY_RESOURCE_ATTR_READ_DIS : SECURE_POLICY_RESOURCE_ATTR_WRITE_DIS
+             );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a IO FIFO port 0x%x with width type %d blocked by policy - %r\n", __FUNCTION__, Port, Width, Status));
+    return Status;
+  }
+
+  if (EFI_ERROR (InspectTargetRangeOwnership (Buffer, Count << Width, &IsUserRange)) || !IsUserRange) {
+    return EFI_SECURITY_VIOLATION;
+  }
+
+  if (CallIndex == SMM_SC_IO_READ_FIFO) {
+    if (Width == MM_IO_UINT8) {
+      IoReadFifo8 (Port, Count, (VOID *)Buffer);
+    } else if (Width == MM_IO_UINT16) {
+      IoReadFifo16 (Port, Count, (VOID *)Buffer);
+    } else {
+      IoReadFifo32 (Port, Count, (VOID *)Buffer);
+    }
+  } else {
+    if (Width == MM_IO_UINT8) {
+      IoWriteFifo8 (Port, Count, (VOID *)Buffer);
+    } else if (Width == MM_IO_UINT16) {
+      IoWriteFifo16 (Port, Count, (VOID *)Buffer);
+    } else {
+      IoWriteFifo32 (Port, Count, (VOID *)Buffer);
+    }
+  }
+
+  if (FeaturePcdGet (PcdMmSupervisorPrintPortsEnable)) {
+    RecordAccessProfile (Port, Width, FALSE, (BOOLEAN)(CallIndex == SMM_SC_IO_WRITE_FIFO));
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Execute a SMM_MP_PARALLEL_FOR request. The request is copied out of user
+  memory before it is checked, the procedure, the chunk descriptors and the
+  token must be owned by user, the context is only handed back to the procedure.
+
+  @param[in]  Buffer    The address of the SMM_MP_PARALLEL_FOR_REQUEST.
+  @param[out] Result    The status of the parallel for.
+
+  @retval EFI_SUCCESS             The request is checked, its outcome is in Result.
+  @retval EFI_SECURITY_VIOLATION  The request, procedure, chunks or token are not owned by user.
+**/
+STATIC
+EFI_STATUS
+ProcessParallelFor (
+  IN  UINTN   Buffer,
+  OUT UINT64  *Result
+  )
+{
+  SMM_MP_PARALLEL_FOR_REQUEST  Request;
+  BOOLEAN                      IsUserRange;
+  MM_COMPLETION                Token;
+
+  if (EFI_ERROR (InspectTargetRangeOwnership (Buffer, sizeof (Request), &IsUserRange)) || !IsUserRange) {
+    return EFI_SECURITY_VIOLATION;
+  }
+
+  CopyMem (&Request, (VOID *)Buffer, sizeof (Request));
+  if (EFI_ERROR (InspectTargetRangeOwnership (Request.Procedure, sizeof (UINTN), &IsUserRange)) || !IsUserRange) {
+    return EFI_SECURITY_VIOLATION;
+  }
+
+  if (EFI_ERROR (InspectTargetRangeOwnership (Request.Chunks, gMmCoreMmst.NumberOfCpus * sizeof (MM_PARALLEL_FOR_CHUNK), &IsUserRange)) || !IsUserRange) {
+    return EFI_SECURITY_VIOLATION;
+  }
+
+  if ((Request.Token != 0) &&
+      (EFI_ERROR (InspectTargetRangeOwnership (Request.Token, sizeof (MM_COMPLETION), &IsUserRange)) || !IsUserRange))
+  {
+    return EFI_SECURITY_VIOLATION;
+  }
+
+  // A procedure running on an AP cannot broadcast to the other APs
+  if (!AmIBsp ()) {
+    *Result = EFI_ACCESS_DENIED;
+    return EFI_SUCCESS;
+  }
+
+  *Result = InternalSmmParallelFor (
+              (MM_PARALLEL_FOR_PROCEDURE)Request.Procedure,
+              Request.Start,
+              Request.End,
+              Request.ChunkSize,
+              (VOID *)Request.Context,
+              (MM_PARALLEL_FOR_CHUNK *)Request.Chunks,
+              (Request.Token != 0) ? &Token : NULL
+              );
+  if ((Request.Token != 0) && (*Result == EFI_SUCCESS)) {
+    *(MM_COMPLETION *)Request.Token = Token;
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
   Conduct Syscall dispatch.
 **/
@@ -232,30 +260,11 @@ SyscallDispatcher (
   EFI_HANDLE  MmHandle;
   BOOLEAN     IsUserRange = FALSE;
   EFI_STATUS  Status      = EFI_SUCCESS;
+  UINT64      StartTsc    = 0;
+  BOOLEAN     Denied      = FALSE;
 
-  if (mPcdCheck) {
-    mPrintEnabled = FeaturePcdGet (PcdMmSupervisorPrintPortsEnable);
-    mPcdCheck     = FALSE;
-  }
-
-  if (FeaturePcdGet (PcdEnableSyscallLogs)) {
-    while (!AcquireSpinLockOrFail (mCpuToken)) {
-      CpuPause ();
-    }
-
-    DEBUG ((
-      DEBUG_INFO,
-      "%a Enter... CallIndex: %lx, Arg1: %lx, Arg2: %lx, Arg3: %lx, CallerAddr: %p, Ring3Stack %p\n",
-      __FUNCTION__,
-      CallIndex,
-      Arg1,
-      Arg2,
-      Arg3,
-      CallerAddr,
-      Ring3StackPointer
-      ));
-
-    ReleaseSpinLock (mCpuToken);
+  if (FeaturePcdGet (PcdMmSupervisorSyscallStatsEnable) || FeaturePcdGet (PcdEnableSyscallLogs)) {
+    StartTsc = AsmReadTsc ();
   }
 
   // The real policy come from DRTM event is copied over to FirmwarePolicy
@@ -273,8 +282,8 @@ SyscallDispatcher (
 
       Ret = AsmReadMsr64 ((UINT32)Arg1);
       DEBUG ((DEBUG_VERBOSE, "%a Read MSR %x got %x\n", __FUNCTION__, Arg1, Ret));
-      if (mPrintEnabled) {
-        AddToDict ((UINT32)Arg1, (UINT32)Arg2, TRUE);
+      if (FeaturePcdGet (PcdMmSupervisorPrintPortsEnable)) {
+        RecordAccessProfile ((UINT32)Arg1, 0, TRUE, FALSE);
       }
 
       break;
@@ -291,8 +300,8 @@ SyscallDispatcher (
 
       AsmWriteMsr64 ((UINT32)Arg1, (UINT64)Arg2);
       DEBUG ((DEBUG_VERBOSE, "%a Write MSR %x with %x\n", __FUNCTION__, Arg1, Arg2));
-      if (mPrintEnabled) {
-        AddToDict ((UINT32)Arg1, (UINT32)Arg2, TRUE);
+      if (FeaturePcdGet (PcdMmSupervisorPrintPortsEnable)) {
+        RecordAccessProfile ((UINT32)Arg1, 0, TRUE, TRUE);
       }
 
       break;
@@ -341,8 +350,8 @@ SyscallDispatcher (
       }
 
       DEBUG ((DEBUG_VERBOSE, "%x\n", Ret));
-      if (mPrintEnabled) {
-        AddToDict ((UINT32)Arg1, (UINT32)Arg2, FALSE);
+      if (FeaturePcdGet (PcdMmSupervisorPrintPortsEnable)) {
+        RecordAccessProfile ((UINT32)Arg1, Arg2, FALSE, FALSE);
       }
 
       break;
@@ -377,8 +386,8 @@ SyscallDispatcher (
       }
 
       DEBUG ((DEBUG_VERBOSE, "%a Write IO type %d at %x with %x\n", __FUNCTION__, Arg2, Arg1, Arg3));
-      if (mPrintEnabled) {
-        AddToDict ((UINT32)Arg1, (UINT32)Arg2, FALSE);
+      if (FeaturePcdGet (PcdMmSupervisorPrintPortsEnable)) {
+        RecordAccessProfile ((UINT32)Arg1, Arg2, FALSE, TRUE);
       }
 
       break;
@@ -450,12 +459,17 @@ SyscallDispatcher (
       {
         Status = EFI_ALREADY_STARTED;
       } else if ((EFI_ERROR (InspectTargetRangeOwnership (Arg1, sizeof (Arg1), &IsUserRange)) || !IsUserRange) ||
-                 (EFI_ERROR (InspectTargetRangeOwnership (Arg2, sizeof (Arg2), &IsUserRange)) || !IsUserRange))
+                 (EFI_ERROR (InspectTargetRangeOwnership (Arg2, sizeof (Arg2), &IsUserRange)) || !IsUserRange) ||
+                 ((Arg3 != 0) && (EFI_ERROR (InspectTargetRangeOwnership (Arg3, sizeof (Arg3), &IsUserRange)) || !IsUserRange)))
       {
         Status = EFI_SECURITY_VIOLATION;
       } else {
         RegisteredRing3JumpPointer = Arg1;
         RegApRing3JumpPointer      = Arg2;
+        // The batch dispatcher is optional, handlers are demoted one at a time without it
+        if ((Arg3 != 0) && !EFI_ERROR (UserMmiBatchInit ())) {
+          RegUserMmiBatchJumpPointer = Arg3;
+        }
       }
 
       break;
@@ -607,7 +621,8 @@ SyscallDispatcher (
         if (EFI_ERROR (InspectTargetRangeOwnership (Arg1, sizeof (EFI_GUID), &IsUserRange)) || !IsUserRange) {
           // If cannot determine the ownership, or the buffer is not in the user space, then return FALSE.
           // Note, we will not fail on the Status code here.
-          Ret = FALSE;
+          Ret    = FALSE;
+          Denied = TRUE;
         }
       }
 
@@ -615,15 +630,40 @@ SyscallDispatcher (
     case SMM_MM_IS_COMM_BUFF:
       Ret = (UINT64)VerifyRequestUserCommBuffer ((VOID *)(UINTN)Arg1, (UINTN)Arg2);
       break;
+    case SMM_SC_BATCH:
+      Status = ProcessSyscallBatch (Arg1, Arg2);
+      if (!EFI_ERROR (Status)) {
+        Ret = EFI_SUCCESS;
+      }
+
+      break;
+    case SMM_SC_IO_READ_FIFO:
+    case SMM_SC_IO_WRITE_FIFO:
+      Status = ProcessIoFifo (CallIndex, Arg1, Arg2, Arg3);
+      if (!EFI_ERROR (Status)) {
+        Ret = EFI_SUCCESS;
+      }
+
+      break;
+    case SMM_MP_PARALLEL_FOR:
+      Status = ProcessParallelFor (Arg1, &Ret);
+      Denied = (!EFI_ERROR (Status) && (Ret == EFI_ACCESS_DENIED));
+      break;
+    case SMM_MP_PARALLEL_FOR_CHECK:
+      Ret = InternalSmmCheckParallelFor ((MM_COMPLETION)Arg1);
+      break;
     default:
       Status = EFI_INVALID_PARAMETER;
       break;
   }
 
 Exit:
-  if (mPrintInfo) {
-    PrintDict ();
-    mPrintInfo = FALSE;
+  if (FeaturePcdGet (PcdMmSupervisorSyscallStatsEnable)) {
+    RecordSyscallStats (CallIndex, Denied, AsmReadTsc () - StartTsc);
+  }
+
+  if (FeaturePcdGet (PcdEnableSyscallLogs)) {
+    RecordSyscallTrace (StartTsc, CallIndex, Arg1, Arg2, Arg3, CallerAddr, Status);
   }
 
   if (EFI_ERROR (Status)) {
@@ -639,9 +679,5 @@ Exit:
     CpuDeadLoop ();
   }
 
-  if (FeaturePcdGet (PcdEnableSyscallLogs)) {
-    DEBUG ((DEBUG_INFO, "%a Exit...\n", __FUNCTION__));
-  }
-
   return Ret;
 }
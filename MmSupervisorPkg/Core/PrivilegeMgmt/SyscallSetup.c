@@ -9,49 +9,56 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
 
 #include <StandaloneMm.h>
+#include <Guid/MmSupervisorRequestData.h>
 #include <Library/BaseLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
 #include <Register/Msr.h>
 
 #include "MmSupervisorCore.h"
 #include "PrivilegeMgmt.h"
 #include "Relocate/Relocate.h"
+#include "Request/Request.h"
 #include "Services/MpService/MpService.h"
 
+//
+// MSR accesses done by programming the syscall MSRs (5 reads and 5 writes),
+// and by restoring the runtime values (5 writes).
+//
+#define CPL0_MSR_SETUP_ACCESSES    10
+#define CPL0_MSR_RESTORE_ACCESSES  5
+
+typedef struct {
+  UINT32     Depth;         // Number of demoted calls in flight on this CPU
+  BOOLEAN    Programmed;    // The syscall MSRs hold the supervisor values
+  BOOLEAN    HeldForSmi;    // Keep them programmed until EndSmiCpl0MsrStar
+  UINT64     Programs;
+  UINT64     AccessesSaved;
+} CPL0_MSR_STATE;
+
 // This needs to be in consistency with SmiException.nasm
 UINT64                 *mMsrStarStore   = NULL;
 UINT64                 *mMsrStar64Store = NULL;
 UINT64                 *mMsrEferStore   = NULL;
 MM_SUPV_SYSCALL_CACHE  *mMmSupvGsStore  = NULL;
 SPIN_LOCK              *mCpuToken       = NULL;
+CPL0_MSR_STATE         *mCpl0MsrState   = NULL;
 
-// Function to set up syscall MSR for just one thread/core
-EFI_STATUS
-EFIAPI
-SetupCpl0MsrStar (
+/**
+  Save the runtime values of the syscall MSRs of the executing CPU and program
+  the supervisor ones.
+
+  @param[in]  CpuIndex    The index of the executing CPU.
+**/
+STATIC
+VOID
+ProgramCpl0Msrs (
   IN  UINTN  CpuIndex
   )
 {
   UINT32                  Eax;
   UINT32                  Edx;
   MSR_IA32_EFER_REGISTER  TempEFER;
-  EFI_STATUS              Status;
-
-  if ((mMsrStarStore == NULL) ||
-      (mMsrStar64Store == NULL) ||
-      (mMsrEferStore == NULL) ||
-      (mMmSupvGsStore == NULL))
-  {
-    Status = EFI_NOT_READY;
-    ASSERT (FALSE);
-    goto Cleanup;
-  }
-
-  if (CpuIndex >= mNumberOfCpus) {
-    Status = EFI_INVALID_PARAMETER;
-    ASSERT (FALSE);
-    goto Cleanup;
-  }
 
   Eax                     = 0;
   Edx                     = 0;
@@ -76,6 +83,64 @@ SetupCpl0MsrStar (
   mMmSupvGsStore[CpuIndex].OsGsSwapBasePtr = (UINT64)AsmReadMsr64 (MSR_IA32_KERNEL_GS_BASE);
   AsmWriteMsr64 (MSR_IA32_KERNEL_GS_BASE, (UINTN)&mMmSupvGsStore[CpuIndex]);
 
+  mCpl0MsrState[CpuIndex].Programmed = TRUE;
+  mCpl0MsrState[CpuIndex].Programs++;
+}
+
+/**
+  Restore the runtime values of the syscall MSRs of the executing CPU.
+
+  @param[in]  CpuIndex    The index of the executing CPU.
+**/
+STATIC
+VOID
+RestoreRuntimeMsrs (
+  IN  UINTN  CpuIndex
+  )
+{
+  AsmWriteMsr64 (MSR_IA32_LSTAR, mMsrStar64Store[CpuIndex]);
+  AsmWriteMsr64 (MSR_IA32_STAR, mMsrStarStore[CpuIndex]);
+  AsmWriteMsr64 (MSR_IA32_EFER, mMsrEferStore[CpuIndex]);
+  AsmWriteMsr64 (MSR_IA32_GS_BASE, mMmSupvGsStore[CpuIndex].OsGsBasePtr);
+  AsmWriteMsr64 (MSR_IA32_KERNEL_GS_BASE, mMmSupvGsStore[CpuIndex].OsGsSwapBasePtr);
+
+  mCpl0MsrState[CpuIndex].Programmed = FALSE;
+}
+
+// Function to set up syscall MSR for just one thread/core
+EFI_STATUS
+EFIAPI
+SetupCpl0MsrStar (
+  IN  UINTN  CpuIndex
+  )
+{
+  EFI_STATUS  Status;
+
+  if ((mMsrStarStore == NULL) ||
+      (mMsrStar64Store == NULL) ||
+      (mMsrEferStore == NULL) ||
+      (mMmSupvGsStore == NULL) ||
+      (mCpl0MsrState == NULL))
+  {
+    Status = EFI_NOT_READY;
+    ASSERT (FALSE);
+    goto Cleanup;
+  }
+
+  if (CpuIndex >= mNumberOfCpus) {
+    Status = EFI_INVALID_PARAMETER;
+    ASSERT (FALSE);
+    goto Cleanup;
+  }
+
+  // Nested demotions and the ones held for the whole SMI find the MSRs already programmed
+  mCpl0MsrState[CpuIndex].Depth++;
+  if (mCpl0MsrState[CpuIndex].Programmed) {
+    mCpl0MsrState[CpuIndex].AccessesSaved += CPL0_MSR_SETUP_ACCESSES;
+  } else {
+    ProgramCpl0Msrs (CpuIndex);
+  }
+
   Status = EFI_SUCCESS;
 
 Cleanup:
@@ -108,7 +173,8 @@ RestoreCpl0MsrStar (
   if ((mMsrStarStore == NULL) ||
       (mMsrStar64Store == NULL) ||
       (mMsrEferStore == NULL) ||
-      (mMmSupvGsStore == NULL))
+      (mMmSupvGsStore == NULL) ||
+      (mCpl0MsrState == NULL))
   {
     Status = EFI_OUT_OF_RESOURCES;
     ASSERT (FALSE);
@@ -121,11 +187,16 @@ RestoreCpl0MsrStar (
     goto Cleanup;
   }
 
-  AsmWriteMsr64 (MSR_IA32_LSTAR, mMsrStar64Store[CpuIndex]);
-  AsmWriteMsr64 (MSR_IA32_STAR, mMsrStarStore[CpuIndex]);
-  AsmWriteMsr64 (MSR_IA32_EFER, mMsrEferStore[CpuIndex]);
-  AsmWriteMsr64 (MSR_IA32_GS_BASE, mMmSupvGsStore[CpuIndex].OsGsBasePtr);
-  AsmWriteMsr64 (MSR_IA32_KERNEL_GS_BASE, mMmSupvGsStore[CpuIndex].OsGsSwapBasePtr);
+  if (mCpl0MsrState[CpuIndex].Depth > 0) {
+    mCpl0MsrState[CpuIndex].Depth--;
+  }
+
+  // The outer demotion or the SMI exit restores them
+  if ((mCpl0MsrState[CpuIndex].Depth > 0) || mCpl0MsrState[CpuIndex].HeldForSmi) {
+    mCpl0MsrState[CpuIndex].AccessesSaved += CPL0_MSR_RESTORE_ACCESSES;
+  } else if (mCpl0MsrState[CpuIndex].Programmed) {
+    RestoreRuntimeMsrs (CpuIndex);
+  }
 
   Status = EFI_SUCCESS;
 
@@ -147,6 +218,52 @@ RestoreBspCpl0MsrStar (
   return Status;
 }
 
+/**
+  Keep the syscall MSRs of CpuIndex programmed from the first demoted call of
+  this SMI until EndSmiCpl0MsrStar, instead of programming and restoring them
+  around every demoted call. Nothing is done if
+  PcdMmSupervisorSyscallMsrPerSmi is not set.
+
+  @param[in]  CpuIndex    The index of the executing CPU.
+**/
+VOID
+EFIAPI
+BeginSmiCpl0MsrStar (
+  IN  UINTN  CpuIndex
+  )
+{
+  if (!FeaturePcdGet (PcdMmSupervisorSyscallMsrPerSmi) ||
+      (mCpl0MsrState == NULL) ||
+      (CpuIndex >= mNumberOfCpus))
+  {
+    return;
+  }
+
+  mCpl0MsrState[CpuIndex].HeldForSmi = TRUE;
+}
+
+/**
+  Restore the runtime values of the syscall MSRs of CpuIndex if they were kept
+  programmed for this SMI. Must be called before leaving SMM.
+
+  @param[in]  CpuIndex    The index of the executing CPU.
+**/
+VOID
+EFIAPI
+EndSmiCpl0MsrStar (
+  IN  UINTN  CpuIndex
+  )
+{
+  if ((mCpl0MsrState == NULL) || (CpuIndex >= mNumberOfCpus)) {
+    return;
+  }
+
+  mCpl0MsrState[CpuIndex].HeldForSmi = FALSE;
+  if ((mCpl0MsrState[CpuIndex].Depth == 0) && mCpl0MsrState[CpuIndex].Programmed) {
+    RestoreRuntimeMsrs (CpuIndex);
+  }
+}
+
 // Function to fetch CPL3 stack for BSP
 EFI_PHYSICAL_ADDRESS
 EFIAPI
@@ -232,11 +349,13 @@ SyscallInterfaceInit (
   mMsrStar64Store = AllocatePool (sizeof (UINT64) * NumberOfCpus);
   mMsrEferStore   = AllocatePool (sizeof (UINT64) * NumberOfCpus);
   mMmSupvGsStore  = AllocatePool (sizeof (MM_SUPV_SYSCALL_CACHE) * NumberOfCpus);
+  mCpl0MsrState   = AllocateZeroPool (sizeof (CPL0_MSR_STATE) * NumberOfCpus);
 
   if ((mMsrStarStore == NULL) ||
       (mMsrStar64Store == NULL) ||
       (mMsrEferStore == NULL) ||
-      (mMmSupvGsStore == NULL))
+      (mMmSupvGsStore == NULL) ||
+      (mCpl0MsrState == NULL))
   {
     Status = EFI_OUT_OF_RESOURCES;
     goto Exit;
@@ -256,8 +375,99 @@ SyscallInterfaceInit (
   }
 
   InitializeSpinLock (mCpuToken);
+
+  Status = SyscallStatsInit (NumberOfCpus);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "%a Syscall statistics are not available - %r\n", __FUNCTION__, Status));
+  }
+
+  Status = SyscallTraceInit (NumberOfCpus);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "%a Syscall trace is not available - %r\n", __FUNCTION__, Status));
+  }
+
+  Status = AccessProfileInit ();
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "%a IO and MSR access profile is not available - %r\n", __FUNCTION__, Status));
+  }
+
   Status = EFI_SUCCESS;
 
 Exit:
   return Status;
 }
+
+/**
+  Get the index of the executing CPU from inside the syscall dispatcher.
+
+  While a syscall is being served the GS base points to the entry of the
+  executing CPU in mMmSupvGsStore, which is cheaper to look up than walking
+  the APIC IDs.
+
+  @return The index of the executing CPU, or mNumberOfCpus if the GS base
+          does not point into mMmSupvGsStore.
+**/
+UINTN
+EFIAPI
+GetSyscallCpuIndex (
+  VOID
+  )
+{
+  UINTN  GsBase;
+  UINTN  CpuIndex;
+
+  GsBase = (UINTN)AsmReadMsr64 (MSR_IA32_GS_BASE);
+  if ((mMmSupvGsStore == NULL) || (GsBase < (UINTN)mMmSupvGsStore)) {
+    return mNumberOfCpus;
+  }
+
+  CpuIndex = (GsBase - (UINTN)mMmSupvGsStore) / sizeof (MM_SUPV_SYSCALL_CACHE);
+  if (CpuIndex >= mNumberOfCpus) {
+    return mNumberOfCpus;
+  }
+
+  return CpuIndex;
+}
+
+/**
+  Routine used to report how often the syscall MSRs were programmed and how
+  many MSR accesses were skipped because they were already programmed, summed
+  up over all processors.
+
+  @param[in, out] MsrBuffer     Buffer to hold the counters. The counters are
+                                cleared if MM_SUPERVISOR_SYSCALL_MSR_RESET is
+                                set in its Flags.
+
+  @retval EFI_SUCCESS             The counters are copied out.
+  @retval EFI_INVALID_PARAMETER   MsrBuffer is NULL.
+  @retval EFI_NOT_READY           The syscall interface is not initialized.
+**/
+EFI_STATUS
+ProcessSyscallMsrRequest (
+  IN OUT MM_SUPERVISOR_SYSCALL_MSR_BUFFER  *MsrBuffer
+  )
+{
+  UINTN  CpuIndex;
+
+  if (MsrBuffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (mCpl0MsrState == NULL) {
+    return EFI_NOT_READY;
+  }
+
+  MsrBuffer->PerSmi        = FeaturePcdGet (PcdMmSupervisorSyscallMsrPerSmi);
+  MsrBuffer->Programs      = 0;
+  MsrBuffer->AccessesSaved = 0;
+  for (CpuIndex = 0; CpuIndex < mNumberOfCpus; CpuIndex++) {
+    MsrBuffer->Programs      += mCpl0MsrState[CpuIndex].Programs;
+    MsrBuffer->AccessesSaved += mCpl0MsrState[CpuIndex].AccessesSaved;
+    if ((MsrBuffer->Flags & MM_SUPERVISOR_SYSCALL_MSR_RESET) != 0) {
+      mCpl0MsrState[CpuIndex].Programs      = 0;
+      mCpl0MsrState[CpuIndex].AccessesSaved = 0;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
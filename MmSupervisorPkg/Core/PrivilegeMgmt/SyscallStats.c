@@ -0,0 +1,245 @@
+/** @file
+  Per processor syscall counters and latency histograms.
+
+  Every processor only updates its own counters from the syscall dispatcher,
+  so no lock is needed on the syscall path. The counters are summed up over
+  all processors when they are requested through the supervisor channel.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Guid/MmSupervisorRequestData.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/SysCallLib.h>
+
+#include "MmSupervisorCore.h"
+#include "PrivilegeMgmt.h"
+#include "Request/Request.h"
+
+//
+// Syscall indices below SMM_SC_LEGACY_MAX and at or after SMM_REG_HDL_JMP map
+// to their own slot, everything else shares the last slot.
+//
+#define SYSCALL_STATS_LEGACY_SLOTS  16
+#define SYSCALL_STATS_SLOT_COUNT    80
+
+typedef struct {
+  UINT64    Count;
+  UINT64    Denials;
+  UINT32    Histogram[MM_SUPERVISOR_SYSCALL_STATS_BUCKETS];
+} SYSCALL_STATS_SLOT;
+
+SYSCALL_STATS_SLOT  *mSyscallStats         = NULL;
+UINTN               mSyscallStatsCpuCount = 0;
+
+/**
+  Map a syscall index to its counter slot.
+
+  @param[in]  CallIndex   The syscall index.
+
+  @return The slot of CallIndex in the counters of a CPU.
+**/
+STATIC
+UINTN
+SyscallStatsSlot (
+  IN UINTN  CallIndex
+  )
+{
+  if (CallIndex < SYSCALL_STATS_LEGACY_SLOTS) {
+    return CallIndex;
+  }
+
+  if ((CallIndex >= SMM_REG_HDL_JMP) &&
+      (CallIndex - SMM_REG_HDL_JMP < SYSCALL_STATS_SLOT_COUNT - SYSCALL_STATS_LEGACY_SLOTS - 1))
+  {
+    return SYSCALL_STATS_LEGACY_SLOTS + CallIndex - SMM_REG_HDL_JMP;
+  }
+
+  return SYSCALL_STATS_SLOT_COUNT - 1;
+}
+
+/**
+  Map a counter slot back to its syscall index.
+
+  @param[in]  Slot    The counter slot.
+
+  @return The syscall index, or MM_SUPERVISOR_SYSCALL_STATS_OTHER for the
+          shared slot.
+**/
+STATIC
+UINT64
+SyscallStatsCallIndex (
+  IN UINTN  Slot
+  )
+{
+  if (Slot < SYSCALL_STATS_LEGACY_SLOTS) {
+    return Slot;
+  }
+
+  if (Slot < SYSCALL_STATS_SLOT_COUNT - 1) {
+    return SMM_REG_HDL_JMP + Slot - SYSCALL_STATS_LEGACY_SLOTS;
+  }
+
+  return MM_SUPERVISOR_SYSCALL_STATS_OTHER;
+}
+
+/**
+  Allocate the per CPU syscall counters when PcdMmSupervisorSyscallStatsEnable
+  is set.
+
+  @param[in]  NumberOfCpus    Total number of CPUs need to be supported.
+
+  @retval EFI_SUCCESS             The counters are ready, or not enabled.
+  @retval EFI_OUT_OF_RESOURCES    Not enough memory for the counters.
+**/
+EFI_STATUS
+SyscallStatsInit (
+  IN UINTN  NumberOfCpus
+  )
+{
+  if (!FeaturePcdGet (PcdMmSupervisorSyscallStatsEnable)) {
+    return EFI_SUCCESS;
+  }
+
+  mSyscallStats = AllocateZeroPool (sizeof (SYSCALL_STATS_SLOT) * SYSCALL_STATS_SLOT_COUNT * NumberOfCpus);
+  if (mSyscallStats == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mSyscallStatsCpuCount = NumberOfCpus;
+  return EFI_SUCCESS;
+}
+
+/**
+  Account one syscall in the counters of the executing CPU. No lock is taken,
+  each CPU only ever updates its own counters.
+
+  A syscall failing with an error status never returns to user mode, so only
+  the requests rejected with their outcome handed back to the caller are
+  counted as denials.
+
+  @param[in]  CallIndex   The syscall index.
+  @param[in]  Denied      TRUE if the request was rejected by a policy check
+                          and the rejection is reported to the caller.
+  @param[in]  Ticks       The TSC ticks spent in the supervisor.
+**/
+VOID
+RecordSyscallStats (
+  IN UINTN    CallIndex,
+  IN BOOLEAN  Denied,
+  IN UINT64   Ticks
+  )
+{
+  SYSCALL_STATS_SLOT  *Slot;
+  UINTN               CpuIndex;
+  UINTN               Bucket;
+
+  if (mSyscallStats == NULL) {
+    return;
+  }
+
+  CpuIndex = GetSyscallCpuIndex ();
+  if (CpuIndex >= mSyscallStatsCpuCount) {
+    return;
+  }
+
+  Slot = &mSyscallStats[CpuIndex * SYSCALL_STATS_SLOT_COUNT + SyscallStatsSlot (CallIndex)];
+  Slot->Count++;
+  if (Denied) {
+    Slot->Denials++;
+  }
+
+  Bucket = (Ticks == 0) ? 0 : (UINTN)HighBitSet64 (Ticks);
+  if (Bucket >= MM_SUPERVISOR_SYSCALL_STATS_BUCKETS) {
+    Bucket = MM_SUPERVISOR_SYSCALL_STATS_BUCKETS - 1;
+  }
+
+  Slot->Histogram[Bucket]++;
+}
+
+/**
+  Routine used to copy out the syscall counters of all processors, summed up
+  per syscall index, and optionally clear them.
+
+  @param[in, out] StatsBuffer   Input flags and output entries, the entries
+                                follow the buffer header.
+  @param[in]      BufferSize    Maximal buffer size supplied by caller,
+                                including the buffer header.
+
+  @retval EFI_SUCCESS             The counters are copied out.
+  @retval EFI_INVALID_PARAMETER   StatsBuffer is NULL or BufferSize cannot hold
+                                  the buffer header.
+  @retval EFI_UNSUPPORTED         Syscall counters are not enabled.
+  @retval EFI_BUFFER_TOO_SMALL    The buffer cannot hold all entries, EntryCount
+                                  holds the number of entries needed.
+**/
+EFI_STATUS
+ProcessSyscallStatsRequest (
+  IN OUT MM_SUPERVISOR_SYSCALL_STATS_BUFFER  *StatsBuffer,
+  IN     UINTN                               BufferSize
+  )
+{
+  MM_SUPERVISOR_SYSCALL_STATS_ENTRY  *Entries;
+  MM_SUPERVISOR_SYSCALL_STATS_ENTRY  Entry;
+  SYSCALL_STATS_SLOT                 *Slot;
+  UINTN                              MaxEntries;
+  UINTN                              EntryCount;
+  UINTN                              SlotIndex;
+  UINTN                              CpuIndex;
+  UINTN                              Bucket;
+
+  if ((StatsBuffer == NULL) || (BufferSize < sizeof (MM_SUPERVISOR_SYSCALL_STATS_BUFFER))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (mSyscallStats == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Entries    = (MM_SUPERVISOR_SYSCALL_STATS_ENTRY *)(StatsBuffer + 1);
+  MaxEntries = (BufferSize - sizeof (MM_SUPERVISOR_SYSCALL_STATS_BUFFER)) / sizeof (MM_SUPERVISOR_SYSCALL_STATS_ENTRY);
+  EntryCount = 0;
+  for (SlotIndex = 0; SlotIndex < SYSCALL_STATS_SLOT_COUNT; SlotIndex++) {
+    ZeroMem (&Entry, sizeof (Entry));
+    for (CpuIndex = 0; CpuIndex < mSyscallStatsCpuCount; CpuIndex++) {
+      Slot           = &mSyscallStats[CpuIndex * SYSCALL_STATS_SLOT_COUNT + SlotIndex];
+      Entry.Count   += Slot->Count;
+      Entry.Denials += Slot->Denials;
+      for (Bucket = 0; Bucket < MM_SUPERVISOR_SYSCALL_STATS_BUCKETS; Bucket++) {
+        Entry.Histogram[Bucket] += Slot->Histogram[Bucket];
+      }
+    }
+
+    if (Entry.Count == 0) {
+      continue;
+    }
+
+    if (EntryCount < MaxEntries) {
+      Entry.CallIndex = SyscallStatsCallIndex (SlotIndex);
+      CopyMem (&Entries[EntryCount], &Entry, sizeof (Entry));
+    }
+
+    EntryCount++;
+  }
+
+  StatsBuffer->EntryCount = (UINT32)EntryCount;
+  if (EntryCount > MaxEntries) {
+    return EFI_BUFFER_TOO_SMALL;
+  }
+
+  if ((StatsBuffer->Flags & MM_SUPERVISOR_SYSCALL_STATS_RESET) != 0) {
+    ZeroMem (mSyscallStats, sizeof (SYSCALL_STATS_SLOT) * SYSCALL_STATS_SLOT_COUNT * mSyscallStatsCpuCount);
+  }
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,220 @@
+/** @file
+  Per processor syscall trace rings.
+
+  Every processor writes its own ring from the syscall dispatcher, so tracing
+  neither takes a lock nor formats any string on the syscall path. The rings
+  are drained in binary form through the supervisor channel.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Guid/MmSupervisorRequestData.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+
+#include "MmSupervisorCore.h"
+#include "PrivilegeMgmt.h"
+#include "Request/Request.h"
+
+typedef struct {
+  //
+  // Number of records ever written to this ring, only updated by its owner.
+  //
+  volatile UINT64                      Head;
+  //
+  // Number of records ever drained from this ring, only updated by the drainer.
+  //
+  UINT64                               Tail;
+  MM_SUPERVISOR_SYSCALL_TRACE_ENTRY    Entries[1];
+} SYSCALL_TRACE_RING;
+
+UINT8  *mSyscallTraceRings      = NULL;
+UINTN  mSyscallTraceRingSize    = 0;
+UINTN  mSyscallTraceRingEntries = 0;
+UINTN  mSyscallTraceCpuCount    = 0;
+
+/**
+  Get the trace ring of a CPU.
+
+  @param[in]  CpuIndex    The index of the CPU.
+
+  @return The trace ring of CpuIndex.
+**/
+STATIC
+SYSCALL_TRACE_RING *
+GetSyscallTraceRing (
+  IN UINTN  CpuIndex
+  )
+{
+  return (SYSCALL_TRACE_RING *)(mSyscallTraceRings + CpuIndex * mSyscallTraceRingSize);
+}
+
+/**
+  Allocate the per CPU syscall trace rings when PcdEnableSyscallLogs is set.
+
+  @param[in]  NumberOfCpus    Total number of CPUs need to be supported.
+
+  @retval EFI_SUCCESS             The rings are ready, or not enabled.
+  @retval EFI_OUT_OF_RESOURCES    Not enough memory for the rings.
+**/
+EFI_STATUS
+SyscallTraceInit (
+  IN UINTN  NumberOfCpus
+  )
+{
+  if (!FeaturePcdGet (PcdEnableSyscallLogs) || (FixedPcdGet32 (PcdMmSupervisorSyscallTraceEntries) == 0)) {
+    return EFI_SUCCESS;
+  }
+
+  mSyscallTraceRingEntries = FixedPcdGet32 (PcdMmSupervisorSyscallTraceEntries);
+  mSyscallTraceRingSize    = OFFSET_OF (SYSCALL_TRACE_RING, Entries) +
+                             sizeof (MM_SUPERVISOR_SYSCALL_TRACE_ENTRY) * mSyscallTraceRingEntries;
+
+  mSyscallTraceRings = AllocateZeroPool (mSyscallTraceRingSize * NumberOfCpus);
+  if (mSyscallTraceRings == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mSyscallTraceCpuCount = NumberOfCpus;
+  return EFI_SUCCESS;
+}
+
+/**
+  Append one syscall to the trace ring of the executing CPU. No lock is taken,
+  each CPU only ever writes its own ring, and the oldest record is overwritten
+  when the ring is full.
+
+  @param[in]  Timestamp   The TSC value when the syscall is entered.
+  @param[in]  CallIndex   The syscall index.
+  @param[in]  Arg1        The first argument of the syscall.
+  @param[in]  Arg2        The second argument of the syscall.
+  @param[in]  Arg3        The third argument of the syscall.
+  @param[in]  CallerAddr  The return address of the syscall.
+  @param[in]  Status      The status the syscall is completed with.
+**/
+VOID
+RecordSyscallTrace (
+  IN UINT64      Timestamp,
+  IN UINTN       CallIndex,
+  IN UINTN       Arg1,
+  IN UINTN       Arg2,
+  IN UINTN       Arg3,
+  IN UINTN       CallerAddr,
+  IN EFI_STATUS  Status
+  )
+{
+  SYSCALL_TRACE_RING                 *Ring;
+  MM_SUPERVISOR_SYSCALL_TRACE_ENTRY  *Entry;
+  UINTN                              CpuIndex;
+
+  if (mSyscallTraceRings == NULL) {
+    return;
+  }
+
+  CpuIndex = GetSyscallCpuIndex ();
+  if (CpuIndex >= mSyscallTraceCpuCount) {
+    return;
+  }
+
+  Ring  = GetSyscallTraceRing (CpuIndex);
+  Entry = &Ring->Entries[Ring->Head % mSyscallTraceRingEntries];
+
+  Entry->Timestamp  = Timestamp;
+  Entry->CallIndex  = CallIndex;
+  Entry->Arg1       = Arg1;
+  Entry->Arg2       = Arg2;
+  Entry->Arg3       = Arg3;
+  Entry->CallerAddr = CallerAddr;
+  Entry->Status     = Status;
+  Entry->CpuIndex   = (UINT32)CpuIndex;
+
+  // Publish the record only once it is complete
+  MemoryFence ();
+  Ring->Head++;
+}
+
+/**
+  Routine used to drain the syscall trace rings of all processors into the
+  supplied buffer. Records that do not fit are kept for the next request.
+
+  @param[in, out] TraceBuffer   Output buffer header, the entries follow it.
+  @param[in]      BufferSize    Maximal buffer size supplied by caller,
+                                including the buffer header.
+
+  @retval EFI_SUCCESS             The records are drained.
+  @retval EFI_INVALID_PARAMETER   TraceBuffer is NULL or BufferSize cannot hold
+                                  the buffer header.
+  @retval EFI_UNSUPPORTED         Syscall tracing is not enabled.
+**/
+EFI_STATUS
+ProcessSyscallTraceRequest (
+  IN OUT MM_SUPERVISOR_SYSCALL_TRACE_BUFFER  *TraceBuffer,
+  IN     UINTN                               BufferSize
+  )
+{
+  MM_SUPERVISOR_SYSCALL_TRACE_ENTRY  *Entries;
+  SYSCALL_TRACE_RING                 *Ring;
+  UINTN                              MaxEntries;
+  UINTN                              EntryCount;
+  UINTN                              CpuIndex;
+  UINT64                             Head;
+  UINT64                             Dropped;
+
+  if ((TraceBuffer == NULL) || (BufferSize < sizeof (MM_SUPERVISOR_SYSCALL_TRACE_BUFFER))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (mSyscallTraceRings == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Entries    = (MM_SUPERVISOR_SYSCALL_TRACE_ENTRY *)(TraceBuffer + 1);
+  MaxEntries = (BufferSize - sizeof (MM_SUPERVISOR_SYSCALL_TRACE_BUFFER)) / sizeof (MM_SUPERVISOR_SYSCALL_TRACE_ENTRY);
+  EntryCount = 0;
+  Dropped    = 0;
+  for (CpuIndex = 0; CpuIndex < mSyscallTraceCpuCount; CpuIndex++) {
+    Ring = GetSyscallTraceRing (CpuIndex);
+    while (EntryCount < MaxEntries) {
+      Head = Ring->Head;
+      if (Head - Ring->Tail > mSyscallTraceRingEntries) {
+        // The owner lapped us, skip what has been overwritten
+        Dropped   += Head - Ring->Tail - mSyscallTraceRingEntries;
+        Ring->Tail = Head - mSyscallTraceRingEntries;
+      }
+
+      if (Ring->Tail == Head) {
+        break;
+      }
+
+      CopyMem (
+        &Entries[EntryCount],
+        &Ring->Entries[Ring->Tail % mSyscallTraceRingEntries],
+        sizeof (MM_SUPERVISOR_SYSCALL_TRACE_ENTRY)
+        );
+
+      // Only keep the copy if the owner did not start overwriting it meanwhile
+      MemoryFence ();
+      if (Ring->Head - Ring->Tail < mSyscallTraceRingEntries) {
+        EntryCount++;
+      } else {
+        Dropped++;
+      }
+
+      Ring->Tail++;
+    }
+  }
+
+  TraceBuffer->EntryCount = (UINT32)EntryCount;
+  TraceBuffer->Dropped    = (UINT32)MIN (Dropped, MAX_UINT32);
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,529 @@
+/** @file
+  Unit tests of the SMM_SC_BATCH record execution of the MM supervisor core
+
+  The policy gate, the ownership check, the IO ports and the MSRs are replaced
+  by stand-ins, so that malformed and denied batches can be fed to
+  ProcessSyscallBatch and the accesses that reached the hardware observed.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <PiMm.h>
+#include <SmmSecurePolicy.h>
+
+#include <Protocol/MmCpuIo.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/IoLib.h>
+#include <Library/SmmPolicyGateLib.h>
+#include <Library/UnitTestHostBaseLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../SyscallBatch.h"
+
+#define UNIT_TEST_APP_NAME     "Syscall Batch Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_IO_SPACE_SIZE    0x10000
+#define TEST_MSR_COUNT        4
+#define TEST_DENIED_PORT      0xCF8
+#define TEST_DENIED_MSR       0x1B
+#define TEST_NO_DENIAL        MAX_UINT32
+
+SMM_SUPV_SECURE_POLICY_DATA_V1_0  *FirmwarePolicy = NULL;
+
+//
+// State of the stand-ins, reset before every test case
+//
+UINT8    mIoSpace[TEST_IO_SPACE_SIZE + sizeof (UINT32)];
+UINT64   mMsrValues[TEST_MSR_COUNT];
+UINTN    mIoReadCount;
+UINTN    mIoWriteCount;
+UINTN    mMsrReadCount;
+UINTN    mMsrWriteCount;
+BOOLEAN  mBufferIsUser;
+UINT32   mDeniedPort;
+UINT32   mDeniedPortMask;
+UINT32   mDeniedMsr;
+UINT32   mDeniedMsrMask;
+
+/**
+  Stand-in of the page table inspection, reports the ownership the test set up.
+**/
+EFI_STATUS
+InspectTargetRangeOwnership (
+  IN  EFI_PHYSICAL_ADDRESS  Address,
+  IN  UINTN                 Size,
+  OUT BOOLEAN               *IsUserRange
+  )
+{
+  *IsUserRange = mBufferIsUser;
+  return EFI_SUCCESS;
+}
+
+/**
+  Stand-in of the IO policy gate, denies the accesses of mDeniedPortMask to
+  mDeniedPort.
+**/
+EFI_STATUS
+EFIAPI
+IsIoReadWriteAllowed (
+  IN SMM_SUPV_SECURE_POLICY_DATA_V1_0  *SmmSecurityPolicy,
+  IN UINT32                            IoAddress,
+  IN EFI_MM_IO_WIDTH                   IoWidth,
+  IN UINT32                            AccessMask
+  )
+{
+  if ((IoAddress == mDeniedPort) && ((AccessMask & mDeniedPortMask) != 0)) {
+    return EFI_ACCESS_DENIED;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Stand-in of the MSR policy gate, denies the accesses of mDeniedMsrMask to
+  mDeniedMsr.
+**/
+EFI_STATUS
+EFIAPI
+IsMsrReadWriteAllowed (
+  IN SMM_SUPV_SECURE_POLICY_DATA_V1_0  *SmmSecurityPolicy,
+  IN UINT32                            MsrAddress,
+  IN UINT32                            AccessMask
+  )
+{
+  if ((MsrAddress == mDeniedMsr) && ((AccessMask & mDeniedMsrMask) != 0)) {
+    return EFI_ACCESS_DENIED;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Stand-in of the access profile, not enabled in this test.
+**/
+VOID
+RecordAccessProfile (
+  IN UINT32   Address,
+  IN UINTN    Width,
+  IN BOOLEAN  IsMsr,
+  IN BOOLEAN  IsWrite
+  )
+{
+}
+
+UINT8
+EFIAPI
+IoRead8 (
+  IN UINTN  Port
+  )
+{
+  mIoReadCount++;
+  return mIoSpace[Port];
+}
+
+UINT16
+EFIAPI
+IoRead16 (
+  IN UINTN  Port
+  )
+{
+  mIoReadCount++;
+  return ReadUnaligned16 ((UINT16 *)&mIoSpace[Port]);
+}
+
+UINT32
+EFIAPI
+IoRead32 (
+  IN UINTN  Port
+  )
+{
+  mIoReadCount++;
+  return ReadUnaligned32 ((UINT32 *)&mIoSpace[Port]);
+}
+
+UINT8
+EFIAPI
+IoWrite8 (
+  IN UINTN  Port,
+  IN UINT8  Value
+  )
+{
+  mIoWriteCount++;
+  mIoSpace[Port] = Value;
+  return Value;
+}
+
+UINT16
+EFIAPI
+IoWrite16 (
+  IN UINTN   Port,
+  IN UINT16  Value
+  )
+{
+  mIoWriteCount++;
+  return WriteUnaligned16 ((UINT16 *)&mIoSpace[Port], Value);
+}
+
+UINT32
+EFIAPI
+IoWrite32 (
+  IN UINTN   Port,
+  IN UINT32  Value
+  )
+{
+  mIoWriteCount++;
+  return WriteUnaligned32 ((UINT32 *)&mIoSpace[Port], Value);
+}
+
+/**
+  MSR read hook of the host BaseLib, MSRs are kept modulo TEST_MSR_COUNT.
+**/
+UINT64
+EFIAPI
+TestReadMsr64 (
+  IN UINT32  Index
+  )
+{
+  mMsrReadCount++;
+  return mMsrValues[Index % TEST_MSR_COUNT];
+}
+
+/**
+  MSR write hook of the host BaseLib, MSRs are kept modulo TEST_MSR_COUNT.
+**/
+UINT64
+EFIAPI
+TestWriteMsr64 (
+  IN UINT32  Index,
+  IN UINT64  Value
+  )
+{
+  mMsrWriteCount++;
+  mMsrValues[Index % TEST_MSR_COUNT] = Value;
+  return Value;
+}
+
+/**
+  Reset the IO space, the MSRs, the counters and the policy before a test.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED   The stand-ins are reset.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ResetBatchStandIns (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  ZeroMem (mIoSpace, sizeof (mIoSpace));
+  ZeroMem (mMsrValues, sizeof (mMsrValues));
+  mIoReadCount    = 0;
+  mIoWriteCount   = 0;
+  mMsrReadCount   = 0;
+  mMsrWriteCount  = 0;
+  mBufferIsUser   = TRUE;
+  mDeniedPort     = TEST_NO_DENIAL;
+  mDeniedPortMask = 0;
+  mDeniedMsr      = TEST_NO_DENIAL;
+  mDeniedMsrMask  = 0;
+
+  gUnitTestHostBaseLib.X86->AsmReadMsr64  = TestReadMsr64;
+  gUnitTestHostBaseLib.X86->AsmWriteMsr64 = TestWriteMsr64;
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Fill one batch record.
+**/
+STATIC
+VOID
+SetBatchEntry (
+  OUT SMM_SC_BATCH_ENTRY  *Entry,
+  IN  UINT32              Operation,
+  IN  UINT32              Width,
+  IN  UINT64              Address,
+  IN  UINT64              Value,
+  IN  UINT64              AndMask
+  )
+{
+  Entry->Operation = Operation;
+  Entry->Width     = Width;
+  Entry->Address   = Address;
+  Entry->Value     = Value;
+  Entry->AndMask   = AndMask;
+}
+
+/**
+  Records of every operation should execute in order, with read and modify
+  records returning the value read.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BatchExecutesInOrder (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_SC_BATCH_ENTRY  Entries[6];
+
+  mIoSpace[0x80] = 0x5A;
+  mMsrValues[1]  = 0xF0F0;
+
+  SetBatchEntry (&Entries[0], SMM_SC_BATCH_IO_WRITE, MM_IO_UINT16, 0x60, 0x1234, 0);
+  SetBatchEntry (&Entries[1], SMM_SC_BATCH_IO_READ, MM_IO_UINT16, 0x60, 0, 0);
+  SetBatchEntry (&Entries[2], SMM_SC_BATCH_IO_MODIFY, MM_IO_UINT8, 0x80, 0x01, 0xF0);
+  SetBatchEntry (&Entries[3], SMM_SC_BATCH_MSR_MODIFY, 0, 1, 0x0F, 0xFF00);
+  SetBatchEntry (&Entries[4], SMM_SC_BATCH_MSR_WRITE, 0, 2, 0xABCD, 0);
+  SetBatchEntry (&Entries[5], SMM_SC_BATCH_MSR_READ, 0, 2, 0, 0);
+
+  UT_ASSERT_NOT_EFI_ERROR (ProcessSyscallBatch ((UINTN)Entries, ARRAY_SIZE (Entries)));
+
+  UT_ASSERT_EQUAL (Entries[0].Value, 0x1234);
+  UT_ASSERT_EQUAL (Entries[1].Value, 0x1234);
+  UT_ASSERT_EQUAL (Entries[2].Value, 0x5A);
+  UT_ASSERT_EQUAL (mIoSpace[0x80], 0x51);
+  UT_ASSERT_EQUAL (Entries[3].Value, 0xF0F0);
+  UT_ASSERT_EQUAL (mMsrValues[1], 0xF00F);
+  UT_ASSERT_EQUAL (Entries[5].Value, 0xABCD);
+  UT_ASSERT_EQUAL (mIoReadCount, 2);
+  UT_ASSERT_EQUAL (mIoWriteCount, 2);
+  UT_ASSERT_EQUAL (mMsrReadCount, 2);
+  UT_ASSERT_EQUAL (mMsrWriteCount, 2);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A record count of zero or above SMM_SC_BATCH_MAX_ENTRIES, and a buffer not
+  owned by user, should be rejected before any record is looked at.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BatchRejectsBadCountAndBuffer (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_SC_BATCH_ENTRY  Entries[SMM_SC_BATCH_MAX_ENTRIES + 1];
+  UINTN               Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (Entries); Index++) {
+    SetBatchEntry (&Entries[Index], SMM_SC_BATCH_IO_WRITE, MM_IO_UINT8, 0x80, Index, 0);
+  }
+
+  UT_ASSERT_STATUS_EQUAL (ProcessSyscallBatch ((UINTN)Entries, 0), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (ProcessSyscallBatch ((UINTN)Entries, SMM_SC_BATCH_MAX_ENTRIES + 1), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (ProcessSyscallBatch ((UINTN)Entries, MAX_UINTN), EFI_INVALID_PARAMETER);
+
+  mBufferIsUser = FALSE;
+  UT_ASSERT_STATUS_EQUAL (ProcessSyscallBatch ((UINTN)Entries, 1), EFI_SECURITY_VIOLATION);
+
+  UT_ASSERT_EQUAL (mIoWriteCount, 0);
+
+  // The largest batch allowed goes through
+  mBufferIsUser = TRUE;
+  UT_ASSERT_NOT_EFI_ERROR (ProcessSyscallBatch ((UINTN)Entries, SMM_SC_BATCH_MAX_ENTRIES));
+  UT_ASSERT_EQUAL (mIoWriteCount, SMM_SC_BATCH_MAX_ENTRIES);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A record with an unknown operation, an IO width that is not supported or a
+  port or MSR index above 32 bits should stop the batch there, the records
+  before it having been executed.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BatchStopsAtMalformedRecord (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_SC_BATCH_ENTRY  Entries[3];
+  SMM_SC_BATCH_ENTRY  Malformed[5];
+  UINTN               Index;
+
+  SetBatchEntry (&Malformed[0], SMM_SC_BATCH_MSR_MODIFY + 1, MM_IO_UINT8, 0x80, 0, 0);
+  SetBatchEntry (&Malformed[1], MAX_UINT32, MM_IO_UINT8, 0x80, 0, 0);
+  SetBatchEntry (&Malformed[2], SMM_SC_BATCH_IO_WRITE, MM_IO_UINT64, 0x80, 0, 0);
+  SetBatchEntry (&Malformed[3], SMM_SC_BATCH_IO_READ, MM_IO_UINT8, BIT32 | 0x80, 0, 0);
+  SetBatchEntry (&Malformed[4], SMM_SC_BATCH_MSR_WRITE, 0, BIT32 | 1, 0, 0);
+
+  for (Index = 0; Index < ARRAY_SIZE (Malformed); Index++) {
+    ResetBatchStandIns (NULL);
+
+    SetBatchEntry (&Entries[0], SMM_SC_BATCH_IO_WRITE, MM_IO_UINT8, 0x70, 0x11, 0);
+    CopyMem (&Entries[1], &Malformed[Index], sizeof (Entries[1]));
+    SetBatchEntry (&Entries[2], SMM_SC_BATCH_IO_WRITE, MM_IO_UINT8, 0x71, 0x22, 0);
+
+    UT_ASSERT_STATUS_EQUAL (ProcessSyscallBatch ((UINTN)Entries, ARRAY_SIZE (Entries)), EFI_INVALID_PARAMETER);
+    UT_ASSERT_EQUAL (mIoSpace[0x70], 0x11);
+    UT_ASSERT_EQUAL (mIoSpace[0x71], 0);
+    UT_ASSERT_EQUAL (mIoReadCount, 0);
+    UT_ASSERT_EQUAL (mIoWriteCount, 1);
+    UT_ASSERT_EQUAL (mMsrWriteCount, 0);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A record denied by policy in the middle of a batch should stop it with
+  EFI_ACCESS_DENIED, which the dispatcher treats as fatal. The records before
+  it have been executed, the denied record and the ones after it never reach
+  the hardware, including the read half of a modify record that may only
+  write.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BatchStopsAtDeniedRecord (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_SC_BATCH_ENTRY  Entries[3];
+
+  // Denied IO port write behind an allowed read of the same port
+  mIoSpace[TEST_DENIED_PORT] = 0x33;
+  mDeniedPort                = TEST_DENIED_PORT;
+  mDeniedPortMask            = SECURE_POLICY_RESOURCE_ATTR_WRITE_DIS;
+
+  SetBatchEntry (&Entries[0], SMM_SC_BATCH_IO_READ, MM_IO_UINT8, TEST_DENIED_PORT, 0, 0);
+  SetBatchEntry (&Entries[1], SMM_SC_BATCH_IO_MODIFY, MM_IO_UINT8, TEST_DENIED_PORT, 0x01, 0);
+  SetBatchEntry (&Entries[2], SMM_SC_BATCH_IO_WRITE, MM_IO_UINT8, 0x80, 0x44, 0);
+
+  UT_ASSERT_STATUS_EQUAL (ProcessSyscallBatch ((UINTN)Entries, ARRAY_SIZE (Entries)), EFI_ACCESS_DENIED);
+  UT_ASSERT_EQUAL (Entries[0].Value, 0x33);
+  UT_ASSERT_EQUAL (Entries[1].Value, 0x01);
+  UT_ASSERT_EQUAL (mIoSpace[TEST_DENIED_PORT], 0x33);
+  UT_ASSERT_EQUAL (mIoSpace[0x80], 0);
+  UT_ASSERT_EQUAL (mIoReadCount, 1);
+  UT_ASSERT_EQUAL (mIoWriteCount, 0);
+
+  // Denied MSR read behind an allowed MSR write
+  ResetBatchStandIns (NULL);
+  mDeniedMsr     = TEST_DENIED_MSR;
+  mDeniedMsrMask = SECURE_POLICY_RESOURCE_ATTR_READ_DIS;
+
+  SetBatchEntry (&Entries[0], SMM_SC_BATCH_MSR_WRITE, 0, 2, 0x77, 0);
+  SetBatchEntry (&Entries[1], SMM_SC_BATCH_MSR_READ, 0, TEST_DENIED_MSR, 0, 0);
+  SetBatchEntry (&Entries[2], SMM_SC_BATCH_MSR_WRITE, 0, 1, 0x88, 0);
+
+  UT_ASSERT_STATUS_EQUAL (ProcessSyscallBatch ((UINTN)Entries, ARRAY_SIZE (Entries)), EFI_ACCESS_DENIED);
+  UT_ASSERT_EQUAL (mMsrValues[2], 0x77);
+  UT_ASSERT_EQUAL (mMsrValues[1], 0);
+  UT_ASSERT_EQUAL (mMsrReadCount, 0);
+  UT_ASSERT_EQUAL (mMsrWriteCount, 1);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  syscall batch and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      BatchTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the syscall batch Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&BatchTests, Framework, "Syscall Batch Tests", "SyscallBatch.Records", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BatchTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (BatchTests, "Batch should execute its records in order", "InOrder", BatchExecutesInOrder, ResetBatchStandIns, NULL, NULL);
+  AddTestCase (BatchTests, "Batch should reject bad counts and buffers not owned by user", "BadCount", BatchRejectsBadCountAndBuffer, ResetBatchStandIns, NULL, NULL);
+  AddTestCase (BatchTests, "Batch should stop at a malformed record", "Malformed", BatchStopsAtMalformedRecord, ResetBatchStandIns, NULL, NULL);
+  AddTestCase (BatchTests, "Batch should stop at a record denied by policy", "Denied", BatchStopsAtDeniedRecord, ResetBatchStandIns, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -235,23 +235,15 @@ typedef struct {
   volatile BOOLEAN    *AllCpusInSync;
   SPIN_LOCK           *PFLock;
   SPIN_LOCK           *CodeAccessCheckLock;
+  SPIN_LOCK           *TokenLock;
 } SMM_CPU_SEMAPHORE_GLOBAL;
 
 ///
-/// All semaphores for each processor
-///
-typedef struct {
-  SPIN_LOCK           *Busy;
-  volatile BOOLEAN    *Present;
-  SPIN_LOCK           *Token;
-} SMM_CPU_SEMAPHORE_CPU;
-
-///
-/// All semaphores' information
+/// All semaphores' information. The semaphores of each processor are in its
+/// SMM_CPU_DATA_BLOCK.
 ///
 typedef struct {
   SMM_CPU_SEMAPHORE_GLOBAL    SemaphoreGlobal;
-  SMM_CPU_SEMAPHORE_CPU       SemaphoreCpu;
 } SMM_CPU_SEMAPHORES;
 
 extern IA32_DESCRIPTOR       gcSmiGdtr;
@@ -636,7 +628,7 @@ InternalSmmStartupThisAp (
 **/
 BOOLEAN
 IsTokenInUse (
-  IN SPIN_LOCK  *Token
+  IN MM_COMPLETION  Token
   );
 
 /**
@@ -650,10 +642,11 @@ IsTokenInUse (
 
   @retval EFI_SUCCESS           Specified AP has finished task assigned by StartupThisAPs().
   @retval EFI_NOT_READY         Specified AP has not finished task and timeout has not expired.
+  @retval EFI_NOT_FOUND         Token is not currently in use.
 **/
 EFI_STATUS
 IsApReady (
-  IN SPIN_LOCK  *Token
+  IN MM_COMPLETION  Token
   );
 
 /**
@@ -670,6 +663,20 @@ IsPresentAp (
   IN UINTN  CpuIndex
   );
 
+/**
+  Check whether task has been finished by all APs.
+
+  @param       BlockMode   Whether did it in block mode or non-block mode.
+
+  @retval      TRUE        Task has been finished by all APs.
+  @retval      FALSE       Task not has been finished by all APs.
+
+**/
+BOOLEAN
+WaitForAllAPsNotBusy (
+  IN BOOLEAN  BlockMode
+  );
+
 /**
   Worker function to execute a caller provided function on all enabled APs.
 
@@ -95,4 +95,154 @@ ProcessUpdateCommBufferRequest (
   IN MM_SUPERVISOR_COMM_UPDATE_BUFFER  *UpdateCommBuffer
   );
 
+/**
+  Routine used to copy out the syscall counters of all processors, summed up
+  per syscall index, and optionally clear them.
+
+  @param[in, out] StatsBuffer   Input flags and output entries, the entries
+                                follow the buffer header.
+  @param[in]      BufferSize    Maximal buffer size supplied by caller,
+                                including the buffer header.
+
+  @retval EFI_SUCCESS             The counters are copied out.
+  @retval EFI_INVALID_PARAMETER   StatsBuffer is NULL or BufferSize cannot hold
+                                  the buffer header.
+  @retval EFI_UNSUPPORTED         Syscall counters are not enabled.
+  @retval EFI_BUFFER_TOO_SMALL    The buffer cannot hold all entries, EntryCount
+                                  holds the number of entries needed.
+**/
+EFI_STATUS
+ProcessSyscallStatsRequest (
+  IN OUT MM_SUPERVISOR_SYSCALL_STATS_BUFFER  *StatsBuffer,
+  IN     UINTN                               BufferSize
+  );
+
+/**
+  Routine used to drain the syscall trace rings of all processors into the
+  supplied buffer. Records that do not fit are kept for the next request.
+
+  @param[in, out] TraceBuffer   Output buffer header, the entries follow it.
+  @param[in]      BufferSize    Maximal buffer size supplied by caller,
+                                including the buffer header.
+
+  @retval EFI_SUCCESS             The records are drained.
+  @retval EFI_INVALID_PARAMETER   TraceBuffer is NULL or BufferSize cannot hold
+                                  the buffer header.
+  @retval EFI_UNSUPPORTED         Syscall tracing is not enabled.
+**/
+EFI_STATUS
+ProcessSyscallTraceRequest (
+  IN OUT MM_SUPERVISOR_SYSCALL_TRACE_BUFFER  *TraceBuffer,
+  IN     UINTN                               BufferSize
+  );
+
+/**
+  Routine used to copy out the IO port and MSR access profile.
+
+  @param[in, out] ProfileBuffer   Output buffer header, the entries follow it.
+  @param[in]      BufferSize      Maximal buffer size supplied by caller,
+                                  including the buffer header.
+
+  @retval EFI_SUCCESS             The profile is copied out.
+  @retval EFI_INVALID_PARAMETER   ProfileBuffer is NULL or BufferSize cannot hold
+                                  the buffer header.
+  @retval EFI_UNSUPPORTED         Access profiling is not enabled.
+  @retval EFI_BUFFER_TOO_SMALL    The buffer cannot hold all entries, EntryCount
+                                  holds the number of entries needed.
+**/
+EFI_STATUS
+ProcessAccessProfileRequest (
+  IN OUT MM_SUPERVISOR_ACCESS_PROFILE_BUFFER  *ProfileBuffer,
+  IN     UINTN                                BufferSize
+  );
+
+/**
+  Routine used to report the hit rate of the page attribute caches, summed up
+  over all processors.
+
+  @param[in, out] CacheBuffer   Buffer to hold the counters. The counters are
+                                cleared if MM_SUPERVISOR_PAGE_ATTRIBUTE_CACHE_RESET
+                                is set in its Flags.
+
+  @retval EFI_SUCCESS             The counters are copied out.
+  @retval EFI_INVALID_PARAMETER   CacheBuffer is NULL.
+  @retval EFI_UNSUPPORTED         The page attribute cache is not enabled.
+**/
+EFI_STATUS
+ProcessPageAttributeCacheRequest (
+  IN OUT MM_SUPERVISOR_PAGE_ATTRIBUTE_CACHE_BUFFER  *CacheBuffer
+  );
+
+/**
+  Routine used to report how often the syscall MSRs were programmed and how
+  many MSR accesses were skipped because they were already programmed, summed
+  up over all processors.
+
+  @param[in, out] MsrBuffer     Buffer to hold the counters. The counters are
+                                cleared if MM_SUPERVISOR_SYSCALL_MSR_RESET is
+                                set in its Flags.
+
+  @retval EFI_SUCCESS             The counters are copied out.
+  @retval EFI_INVALID_PARAMETER   MsrBuffer is NULL.
+  @retval EFI_NOT_READY           The syscall interface is not initialized.
+**/
+EFI_STATUS
+ProcessSyscallMsrRequest (
+  IN OUT MM_SUPERVISOR_SYSCALL_MSR_BUFFER  *MsrBuffer
+  );
+
+/**
+  Routine used to report the bytes copied and zeroed for the communicate
+  buffers of synchronous MMIs.
+
+  @param[in, out] StatsBuffer   Buffer to hold the counters. The counters are
+                                cleared if MM_SUPERVISOR_COMM_BUFFER_STATS_RESET
+                                is set in its Flags.
+
+  @retval EFI_SUCCESS             The counters are copied out.
+  @retval EFI_INVALID_PARAMETER   StatsBuffer is NULL.
+**/
+EFI_STATUS
+ProcessCommBufferStatsRequest (
+  IN OUT MM_SUPERVISOR_COMM_BUFFER_STATS_BUFFER  *StatsBuffer
+  );
+
+/**
+  Routine used to report the time the BSP spent gathering and releasing the APs
+  in the SMI rendezvous.
+
+  @param[in, out] StatsBuffer   Buffer to hold the counters. The counters are
+                                cleared if MM_SUPERVISOR_RENDEZVOUS_STATS_RESET
+                                is set in its Flags.
+
+  @retval EFI_SUCCESS             The counters are copied out.
+  @retval EFI_INVALID_PARAMETER   StatsBuffer is NULL.
+**/
+EFI_STATUS
+ProcessRendezvousStatsRequest (
+  IN OUT MM_SUPERVISOR_RENDEZVOUS_STATS_BUFFER  *StatsBuffer
+  );
+
+/**
+  Routine used to drain the SMI timeline rings of all processors into the
+  supplied buffer, along with the statistics of each phase. Events that do
+  not fit are kept for the next request.
+
+  @param[in, out] TimelineBuffer  Input flags and output buffer header, the events
+                                  follow it. The statistics are cleared if
+                                  MM_SUPERVISOR_SMI_TIMELINE_RESET is set in its Flags.
+  @param[in]      BufferSize      Maximal buffer size supplied by caller,
+                                  including the buffer header.
+
+  @retval EFI_SUCCESS             The events are drained.
+  @retval EFI_INVALID_PARAMETER   TimelineBuffer is NULL or BufferSize cannot hold
+                                  the buffer header.
+  @retval EFI_UNSUPPORTED         The SMI timeline is not enabled.
+**/
+EFI_STATUS
+ProcessSmiTimelineRequest (
+  IN OUT MM_SUPERVISOR_SMI_TIMELINE_BUFFER  *TimelineBuffer,
+  IN     UINTN                              BufferSize
+  );
+
 #endif // _MM_SUPV_REQUEST_H_
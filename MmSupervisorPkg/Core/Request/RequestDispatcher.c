@@ -148,6 +148,178 @@ MmSupvRequestHandler (
                                       );
       break;
 
+    case MM_SUPERVISOR_REQUEST_SYSCALL_STATS:
+      ExpectedSize += sizeof (MM_SUPERVISOR_SYSCALL_STATS_BUFFER);
+      if (*CommBufferSize < ExpectedSize) {
+        DEBUG ((
+          DEBUG_ERROR,
+          "%a - Syscall statistics query has bad comm buffer size! %d < %d\n",
+          __FUNCTION__,
+          *CommBufferSize,
+          ExpectedSize
+          ));
+        return EFI_INVALID_PARAMETER;
+      }
+
+      // Use the remainder of the common buffer to host the entries
+      MmSupvRequestHeader->Result = ProcessSyscallStatsRequest (
+                                      (MM_SUPERVISOR_SYSCALL_STATS_BUFFER *)(MmSupvRequestHeader + 1),
+                                      *CommBufferSize - sizeof (MM_SUPERVISOR_REQUEST_HEADER)
+                                      );
+      if (!EFI_ERROR (MmSupvRequestHeader->Result)) {
+        *CommBufferSize = ExpectedSize +
+                          ((MM_SUPERVISOR_SYSCALL_STATS_BUFFER *)(MmSupvRequestHeader + 1))->EntryCount * sizeof (MM_SUPERVISOR_SYSCALL_STATS_ENTRY);
+      }
+
+      break;
+
+    case MM_SUPERVISOR_REQUEST_SYSCALL_TRACE:
+      ExpectedSize += sizeof (MM_SUPERVISOR_SYSCALL_TRACE_BUFFER);
+      if (*CommBufferSize < ExpectedSize) {
+        DEBUG ((
+          DEBUG_ERROR,
+          "%a - Syscall trace drain has bad comm buffer size! %d < %d\n",
+          __FUNCTION__,
+          *CommBufferSize,
+          ExpectedSize
+          ));
+        return EFI_INVALID_PARAMETER;
+      }
+
+      // Use the remainder of the common buffer to host the records
+      MmSupvRequestHeader->Result = ProcessSyscallTraceRequest (
+                                      (MM_SUPERVISOR_SYSCALL_TRACE_BUFFER *)(MmSupvRequestHeader + 1),
+                                      *CommBufferSize - sizeof (MM_SUPERVISOR_REQUEST_HEADER)
+                                      );
+      if (!EFI_ERROR (MmSupvRequestHeader->Result)) {
+        *CommBufferSize = ExpectedSize +
+                          ((MM_SUPERVISOR_SYSCALL_TRACE_BUFFER *)(MmSupvRequestHeader + 1))->EntryCount * sizeof (MM_SUPERVISOR_SYSCALL_TRACE_ENTRY);
+      }
+
+      break;
+
+    case MM_SUPERVISOR_REQUEST_ACCESS_PROFILE:
+      ExpectedSize += sizeof (MM_SUPERVISOR_ACCESS_PROFILE_BUFFER);
+      if (*CommBufferSize < ExpectedSize) {
+        DEBUG ((
+          DEBUG_ERROR,
+          "%a - Access profile query has bad comm buffer size! %d < %d\n",
+          __FUNCTION__,
+          *CommBufferSize,
+          ExpectedSize
+          ));
+        return EFI_INVALID_PARAMETER;
+      }
+
+      // Use the remainder of the common buffer to host the entries
+      MmSupvRequestHeader->Result = ProcessAccessProfileRequest (
+                                      (MM_SUPERVISOR_ACCESS_PROFILE_BUFFER *)(MmSupvRequestHeader + 1),
+                                      *CommBufferSize - sizeof (MM_SUPERVISOR_REQUEST_HEADER)
+                                      );
+      if (!EFI_ERROR (MmSupvRequestHeader->Result)) {
+        *CommBufferSize = ExpectedSize +
+                          ((MM_SUPERVISOR_ACCESS_PROFILE_BUFFER *)(MmSupvRequestHeader + 1))->EntryCount * sizeof (MM_SUPERVISOR_ACCESS_PROFILE_ENTRY);
+      }
+
+      break;
+
+    case MM_SUPERVISOR_REQUEST_PAGE_ATTRIBUTE_CACHE:
+      ExpectedSize += sizeof (MM_SUPERVISOR_PAGE_ATTRIBUTE_CACHE_BUFFER);
+      if (*CommBufferSize < ExpectedSize) {
+        DEBUG ((
+          DEBUG_ERROR,
+          "%a - Page attribute cache query has bad comm buffer size! %d < %d\n",
+          __FUNCTION__,
+          *CommBufferSize,
+          ExpectedSize
+          ));
+        return EFI_INVALID_PARAMETER;
+      }
+
+      MmSupvRequestHeader->Result = ProcessPageAttributeCacheRequest (
+                                      (MM_SUPERVISOR_PAGE_ATTRIBUTE_CACHE_BUFFER *)(MmSupvRequestHeader + 1)
+                                      );
+      break;
+
+    case MM_SUPERVISOR_REQUEST_SYSCALL_MSR:
+      ExpectedSize += sizeof (MM_SUPERVISOR_SYSCALL_MSR_BUFFER);
+      if (*CommBufferSize < ExpectedSize) {
+        DEBUG ((
+          DEBUG_ERROR,
+          "%a - Syscall MSR query has bad comm buffer size! %d < %d\n",
+          __FUNCTION__,
+          *CommBufferSize,
+          ExpectedSize
+          ));
+        return EFI_INVALID_PARAMETER;
+      }
+
+      MmSupvRequestHeader->Result = ProcessSyscallMsrRequest (
+                                      (MM_SUPERVISOR_SYSCALL_MSR_BUFFER *)(MmSupvRequestHeader + 1)
+                                      );
+      break;
+
+    case MM_SUPERVISOR_REQUEST_COMM_BUFFER_STATS:
+      ExpectedSize += sizeof (MM_SUPERVISOR_COMM_BUFFER_STATS_BUFFER);
+      if (*CommBufferSize < ExpectedSize) {
+        DEBUG ((
+          DEBUG_ERROR,
+          "%a - Comm buffer stats query has bad comm buffer size! %d < %d\n",
+          __FUNCTION__,
+          *CommBufferSize,
+          ExpectedSize
+          ));
+        return EFI_INVALID_PARAMETER;
+      }
+
+      MmSupvRequestHeader->Result = ProcessCommBufferStatsRequest (
+                                      (MM_SUPERVISOR_COMM_BUFFER_STATS_BUFFER *)(MmSupvRequestHeader + 1)
+                                      );
+      break;
+
+    case MM_SUPERVISOR_REQUEST_RENDEZVOUS_STATS:
+      ExpectedSize += sizeof (MM_SUPERVISOR_RENDEZVOUS_STATS_BUFFER);
+      if (*CommBufferSize < ExpectedSize) {
+        DEBUG ((
+          DEBUG_ERROR,
+          "%a - Rendezvous stats query has bad comm buffer size! %d < %d\n",
+          __FUNCTION__,
+          *CommBufferSize,
+          ExpectedSize
+          ));
+        return EFI_INVALID_PARAMETER;
+      }
+
+      MmSupvRequestHeader->Result = ProcessRendezvousStatsRequest (
+                                      (MM_SUPERVISOR_RENDEZVOUS_STATS_BUFFER *)(MmSupvRequestHeader + 1)
+                                      );
+      break;
+
+    case MM_SUPERVISOR_REQUEST_SMI_TIMELINE:
+      ExpectedSize += sizeof (MM_SUPERVISOR_SMI_TIMELINE_BUFFER);
+      if (*CommBufferSize < ExpectedSize) {
+        DEBUG ((
+          DEBUG_ERROR,
+          "%a - SMI timeline drain has bad comm buffer size! %d < %d\n",
+          __FUNCTION__,
+          *CommBufferSize,
+          ExpectedSize
+          ));
+        return EFI_INVALID_PARAMETER;
+      }
+
+      // Use the remainder of the common buffer to host the events
+      MmSupvRequestHeader->Result = ProcessSmiTimelineRequest (
+                                      (MM_SUPERVISOR_SMI_TIMELINE_BUFFER *)(MmSupvRequestHeader + 1),
+                                      *CommBufferSize - sizeof (MM_SUPERVISOR_REQUEST_HEADER)
+                                      );
+      if (!EFI_ERROR (MmSupvRequestHeader->Result)) {
+        *CommBufferSize = ExpectedSize +
+                          ((MM_SUPERVISOR_SMI_TIMELINE_BUFFER *)(MmSupvRequestHeader + 1))->EntryCount * sizeof (MM_SUPERVISOR_SMI_TIMELINE_ENTRY);
+      }
+
+      break;
+
     default:
       // Mark unknown requested command as EFI_UNSUPPORTED.
       DEBUG ((DEBUG_ERROR, "%a - Invalid command requested! %d\n", __FUNCTION__, MmSupvRequestHeader->Request));
@@ -18,6 +18,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include "MmSupervisorCore.h"
 #include "Mem/Mem.h"
+#include "UnblockMemoryIndex.h"
 
 typedef struct {
   LIST_ENTRY                             Link;
@@ -26,9 +27,13 @@ typedef struct {
 
 LIST_ENTRY  mUnblockedMemoryList = INITIALIZE_LIST_HEAD_VARIABLE (mUnblockedMemoryList);
 
+// Coalesced view of mUnblockedMemoryList, used to answer range queries
+UNBLOCKED_RANGE_INDEX  mUnblockedRangeIndex = { NULL, 0, 0 };
+
 /**
   Helper function to check if range requested is within boundary of unblocked lists.
-  This routine is simple and do not merge adjacent regions from two entries into one.
+  Adjacent regions from different entries are merged, so a range spanning them is
+  considered within boundary.
 
   @param Buffer  The buffer start address to be checked.
   @param Length  The buffer length to be checked.
@@ -44,12 +49,6 @@ IsWithinUnblockedRegion (
   IN UINT64                Length
   )
 {
-  UNBLOCKED_MEM_LIST                   *UnblockedListEntry;
-  MM_SUPERVISOR_UNBLOCK_MEMORY_PARAMS  UnblockedMemEntry;
-  LIST_ENTRY                           *Node;
-  UINT64                               StartAddress;
-  UINT64                               EndAddress;
-
   if (!mCoreInitializationComplete) {
     // Everything is open prior to exiting the core's main routine.
     return TRUE;
@@ -60,22 +59,7 @@ IsWithinUnblockedRegion (
     return FALSE;
   }
 
-  Node = mUnblockedMemoryList.ForwardLink;
-  while (Node != &mUnblockedMemoryList) {
-    UnblockedListEntry = BASE_CR (Node, UNBLOCKED_MEM_LIST, Link);
-    UnblockedMemEntry  = UnblockedListEntry->UnblockMemData;
-    StartAddress       = UnblockedMemEntry.MemoryDescriptor.PhysicalStart;
-    // EndAddress cannot exceed 64-bit boundary due to paging limitation
-    EndAddress = StartAddress + EFI_PAGES_TO_SIZE (UnblockedMemEntry.MemoryDescriptor.NumberOfPages);
-
-    if ((StartAddress <= Buffer) && (Buffer + Length <= EndAddress)) {
-      return TRUE;
-    }
-
-    Node = Node->ForwardLink;
-  }
-
-  return FALSE;
+  return IsRangeInUnblockedIndex (&mUnblockedRangeIndex, Buffer, Length);
 }
 
 /**
@@ -320,6 +304,17 @@ ProcessBlockPages (
   RemoveEntryList (Node);
   FreePool (UnblockedListEntry);
 
+  Status = RemoveUnblockedRange (
+             &mUnblockedRangeIndex,
+             UnblockedMemEntry.MemoryDescriptor.PhysicalStart,
+             UnblockedMemEntry.MemoryDescriptor.PhysicalStart + EFI_PAGES_TO_SIZE (UnblockedMemEntry.MemoryDescriptor.NumberOfPages)
+             );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to remove blocked region from index %r!\n", __FUNCTION__, Status));
+    ASSERT_EFI_ERROR (Status);
+    return Status;
+  }
+
   return EFI_SUCCESS;
 }
 
@@ -442,6 +437,18 @@ ProcessUnblockPages (
     return EFI_OUT_OF_RESOURCES;
   }
 
+  Status = InsertUnblockedRange (
+             &mUnblockedRangeIndex,
+             UnblockMemParams->MemoryDescriptor.PhysicalStart,
+             UnblockMemParams->MemoryDescriptor.PhysicalStart + EFI_PAGES_TO_SIZE (UnblockMemParams->MemoryDescriptor.NumberOfPages)
+             );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a - Failed to index unblocked region %r!\n", __FUNCTION__, Status));
+    ASSERT_EFI_ERROR (Status);
+    FreePool (UnblockListEntry);
+    return Status;
+  }
+
   CopyMem (&UnblockListEntry->UnblockMemData, UnblockMemParams, sizeof (*UnblockMemParams));
   InsertTailList (&mUnblockedMemoryList, &UnblockListEntry->Link);
 
@@ -0,0 +1,238 @@
+/** @file
+  Sorted and coalesced index of the unblocked memory regions.
+
+  The index keeps the unblocked regions as a sorted array of disjoint ranges,
+  so that the buffer validation on every communicate and SMM_MM_UNBLOCKED
+  syscall is a binary search instead of a walk over all unblocked entries.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include "UnblockMemoryIndex.h"
+
+#define UNBLOCKED_RANGE_INDEX_INITIAL_CAPACITY  16
+
+/**
+  Find the first range whose End is at or after Address.
+
+  @param[in]  Index     The index to search.
+  @param[in]  Address   The address to look for.
+
+  @return The position of the first range with End >= Address, or Index->Count
+          if there is none.
+**/
+STATIC
+UINTN
+LowerBoundUnblockedRange (
+  IN CONST UNBLOCKED_RANGE_INDEX  *Index,
+  IN       EFI_PHYSICAL_ADDRESS   Address
+  )
+{
+  UINTN  Low;
+  UINTN  High;
+  UINTN  Middle;
+
+  Low  = 0;
+  High = Index->Count;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (Index->Ranges[Middle].End < Address) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  return Low;
+}
+
+/**
+  Make sure the index can hold at least one more range.
+
+  @param[in, out] Index   The index to grow.
+
+  @retval EFI_SUCCESS             There is room for one more range.
+  @retval EFI_OUT_OF_RESOURCES    The index could not grow.
+**/
+STATIC
+EFI_STATUS
+ReserveUnblockedRange (
+  IN OUT UNBLOCKED_RANGE_INDEX  *Index
+  )
+{
+  UNBLOCKED_RANGE  *NewRanges;
+  UINTN            NewCapacity;
+
+  if (Index->Count < Index->Capacity) {
+    return EFI_SUCCESS;
+  }
+
+  NewCapacity = (Index->Capacity == 0) ? UNBLOCKED_RANGE_INDEX_INITIAL_CAPACITY : Index->Capacity * 2;
+  NewRanges   = AllocatePool (NewCapacity * sizeof (UNBLOCKED_RANGE));
+  if (NewRanges == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (Index->Ranges != NULL) {
+    CopyMem (NewRanges, Index->Ranges, Index->Count * sizeof (UNBLOCKED_RANGE));
+    FreePool (Index->Ranges);
+  }
+
+  Index->Ranges   = NewRanges;
+  Index->Capacity = NewCapacity;
+  return EFI_SUCCESS;
+}
+
+/**
+  Add [Start, End) to the index, merging it with all ranges it overlaps or
+  touches.
+
+  @param[in, out] Index   The index to update.
+  @param[in]      Start   The first address of the range.
+  @param[in]      End     The address right after the range.
+
+  @retval EFI_SUCCESS             The range is added.
+  @retval EFI_INVALID_PARAMETER   Index is NULL or the range is empty.
+  @retval EFI_OUT_OF_RESOURCES    The index could not grow.
+**/
+EFI_STATUS
+InsertUnblockedRange (
+  IN OUT UNBLOCKED_RANGE_INDEX  *Index,
+  IN     EFI_PHYSICAL_ADDRESS   Start,
+  IN     EFI_PHYSICAL_ADDRESS   End
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       First;
+  UINTN       Last;
+
+  if ((Index == NULL) || (Start >= End)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  // Ranges in [First, Last) overlap or touch the new one and fold into it
+  First = LowerBoundUnblockedRange (Index, Start);
+  Last  = First;
+  while ((Last < Index->Count) && (Index->Ranges[Last].Start <= End)) {
+    Last++;
+  }
+
+  if (First == Last) {
+    Status = ReserveUnblockedRange (Index);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    CopyMem (&Index->Ranges[First + 1], &Index->Ranges[First], (Index->Count - First) * sizeof (UNBLOCKED_RANGE));
+    Index->Ranges[First].Start = Start;
+    Index->Ranges[First].End   = End;
+    Index->Count++;
+    return EFI_SUCCESS;
+  }
+
+  Index->Ranges[First].Start = MIN (Start, Index->Ranges[First].Start);
+  Index->Ranges[First].End   = MAX (End, Index->Ranges[Last - 1].End);
+  CopyMem (&Index->Ranges[First + 1], &Index->Ranges[Last], (Index->Count - Last) * sizeof (UNBLOCKED_RANGE));
+  Index->Count -= Last - First - 1;
+  return EFI_SUCCESS;
+}
+
+/**
+  Remove [Start, End) from the index, splitting the range covering it if
+  needed.
+
+  @param[in, out] Index   The index to update.
+  @param[in]      Start   The first address of the range.
+  @param[in]      End     The address right after the range.
+
+  @retval EFI_SUCCESS             The range is removed.
+  @retval EFI_INVALID_PARAMETER   Index is NULL or the range is empty.
+  @retval EFI_NOT_FOUND           The range is not fully covered by the index.
+  @retval EFI_OUT_OF_RESOURCES    The index could not grow to hold a split range.
+**/
+EFI_STATUS
+RemoveUnblockedRange (
+  IN OUT UNBLOCKED_RANGE_INDEX  *Index,
+  IN     EFI_PHYSICAL_ADDRESS   Start,
+  IN     EFI_PHYSICAL_ADDRESS   End
+  )
+{
+  EFI_STATUS       Status;
+  UINTN            Position;
+  UNBLOCKED_RANGE  *Range;
+
+  if ((Index == NULL) || (Start >= End)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (!IsRangeInUnblockedIndex (Index, Start, End - Start)) {
+    return EFI_NOT_FOUND;
+  }
+
+  // Ranges touching at Start are merged, so the one covering Start is the first ending after it
+  Position = LowerBoundUnblockedRange (Index, Start + 1);
+  Range    = &Index->Ranges[Position];
+
+  if ((Range->Start == Start) && (Range->End == End)) {
+    CopyMem (Range, Range + 1, (Index->Count - Position - 1) * sizeof (UNBLOCKED_RANGE));
+    Index->Count--;
+  } else if (Range->Start == Start) {
+    Range->Start = End;
+  } else if (Range->End == End) {
+    Range->End = Start;
+  } else {
+    Status = ReserveUnblockedRange (Index);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    Range = &Index->Ranges[Position];
+    CopyMem (Range + 1, Range, (Index->Count - Position) * sizeof (UNBLOCKED_RANGE));
+    Range[0].End   = Start;
+    Range[1].Start = End;
+    Index->Count++;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Check if [Buffer, Buffer + Length) is fully covered by the index.
+
+  @param[in]  Index   The index to query.
+  @param[in]  Buffer  The buffer start address to be checked.
+  @param[in]  Length  The buffer length to be checked.
+
+  @return TRUE      The queried region is within one indexed range.
+  @return FALSE     The queried region is empty or not fully covered.
+**/
+BOOLEAN
+IsRangeInUnblockedIndex (
+  IN CONST UNBLOCKED_RANGE_INDEX  *Index,
+  IN       EFI_PHYSICAL_ADDRESS   Buffer,
+  IN       UINT64                 Length
+  )
+{
+  UINTN                  Position;
+  CONST UNBLOCKED_RANGE  *Range;
+
+  if ((Index == NULL) || (Length == 0) || (Buffer == MAX_UINT64)) {
+    return FALSE;
+  }
+
+  Position = LowerBoundUnblockedRange (Index, Buffer + 1);
+  if (Position >= Index->Count) {
+    return FALSE;
+  }
+
+  Range = &Index->Ranges[Position];
+  return (BOOLEAN)((Range->Start <= Buffer) && (Range->End - Buffer >= Length));
+}
@@ -0,0 +1,89 @@
+/** @file
+  Sorted and coalesced index of the unblocked memory regions.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MM_SUPV_UNBLOCK_MEMORY_INDEX_H_
+#define _MM_SUPV_UNBLOCK_MEMORY_INDEX_H_
+
+/**
+  One contiguous unblocked range, covering [Start, End).
+
+**/
+typedef struct {
+  EFI_PHYSICAL_ADDRESS    Start;
+  EFI_PHYSICAL_ADDRESS    End;
+} UNBLOCKED_RANGE;
+
+/**
+  Ranges sorted by Start address. Overlapping and adjacent ranges are always
+  merged, so the ranges are disjoint and separated by at least one byte.
+
+**/
+typedef struct {
+  UNBLOCKED_RANGE    *Ranges;
+  UINTN              Count;
+  UINTN              Capacity;
+} UNBLOCKED_RANGE_INDEX;
+
+/**
+  Add [Start, End) to the index, merging it with all ranges it overlaps or
+  touches.
+
+  @param[in, out] Index   The index to update.
+  @param[in]      Start   The first address of the range.
+  @param[in]      End     The address right after the range.
+
+  @retval EFI_SUCCESS             The range is added.
+  @retval EFI_INVALID_PARAMETER   Index is NULL or the range is empty.
+  @retval EFI_OUT_OF_RESOURCES    The index could not grow.
+**/
+EFI_STATUS
+InsertUnblockedRange (
+  IN OUT UNBLOCKED_RANGE_INDEX  *Index,
+  IN     EFI_PHYSICAL_ADDRESS   Start,
+  IN     EFI_PHYSICAL_ADDRESS   End
+  );
+
+/**
+  Remove [Start, End) from the index, splitting the range covering it if
+  needed.
+
+  @param[in, out] Index   The index to update.
+  @param[in]      Start   The first address of the range.
+  @param[in]      End     The address right after the range.
+
+  @retval EFI_SUCCESS             The range is removed.
+  @retval EFI_INVALID_PARAMETER   Index is NULL or the range is empty.
+  @retval EFI_NOT_FOUND           The range is not fully covered by the index.
+  @retval EFI_OUT_OF_RESOURCES    The index could not grow to hold a split range.
+**/
+EFI_STATUS
+RemoveUnblockedRange (
+  IN OUT UNBLOCKED_RANGE_INDEX  *Index,
+  IN     EFI_PHYSICAL_ADDRESS   Start,
+  IN     EFI_PHYSICAL_ADDRESS   End
+  );
+
+/**
+  Check if [Buffer, Buffer + Length) is fully covered by the index.
+
+  @param[in]  Index   The index to query.
+  @param[in]  Buffer  The buffer start address to be checked.
+  @param[in]  Length  The buffer length to be checked.
+
+  @return TRUE      The queried region is within one indexed range.
+  @return FALSE     The queried region is empty or not fully covered.
+**/
+BOOLEAN
+IsRangeInUnblockedIndex (
+  IN CONST UNBLOCKED_RANGE_INDEX  *Index,
+  IN       EFI_PHYSICAL_ADDRESS   Buffer,
+  IN       UINT64                 Length
+  );
+
+#endif // _MM_SUPV_UNBLOCK_MEMORY_INDEX_H_
@@ -0,0 +1,434 @@
+/** @file
+  Unit tests of the unblocked memory range index used by the MM supervisor core
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../UnblockMemoryIndex.h"
+
+#define UNIT_TEST_APP_NAME     "Unblocked Memory Index Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define RANDOM_PAGE_SPACE       512
+#define RANDOM_OPERATIONS       2000
+#define RANDOM_QUERIES          64
+#define BENCHMARK_QUERY_COUNT   200000
+#define TEST_BASE_ADDRESS       0x80000000ULL
+
+typedef struct {
+  UINTN    RegionCount;
+} TEST_CONTEXT_BENCHMARK;
+
+/**
+  Release the ranges held by an index.
+
+  @param[in, out] Index   The index to clear.
+**/
+STATIC
+VOID
+FreeUnblockedIndex (
+  IN OUT UNBLOCKED_RANGE_INDEX  *Index
+  )
+{
+  if (Index->Ranges != NULL) {
+    FreePool (Index->Ranges);
+  }
+
+  ZeroMem (Index, sizeof (*Index));
+}
+
+/**
+  Advance a linear congruential generator.
+
+  @param[in, out] Seed    The generator state.
+
+  @return The next pseudo random value.
+**/
+STATIC
+UINT32
+NextRandom (
+  IN OUT UINT32  *Seed
+  )
+{
+  *Seed = *Seed * 1103515245 + 12345;
+  return *Seed >> 8;
+}
+
+/**
+  Queries should only succeed for buffers fully inside one unblocked region.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+UnblockedIndexQueryBoundaries (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNBLOCKED_RANGE_INDEX  Index;
+
+  ZeroMem (&Index, sizeof (Index));
+  UT_ASSERT_FALSE (IsRangeInUnblockedIndex (&Index, 0x1000, 1));
+
+  UT_ASSERT_NOT_EFI_ERROR (InsertUnblockedRange (&Index, 0x1000, 0x3000));
+  UT_ASSERT_TRUE (IsRangeInUnblockedIndex (&Index, 0x1000, 0x2000));
+  UT_ASSERT_TRUE (IsRangeInUnblockedIndex (&Index, 0x2FFF, 1));
+  UT_ASSERT_FALSE (IsRangeInUnblockedIndex (&Index, 0xFFF, 2));
+  UT_ASSERT_FALSE (IsRangeInUnblockedIndex (&Index, 0x2FFF, 2));
+  UT_ASSERT_FALSE (IsRangeInUnblockedIndex (&Index, 0x3000, 1));
+  UT_ASSERT_FALSE (IsRangeInUnblockedIndex (&Index, 0x1000, 0));
+  UT_ASSERT_FALSE (IsRangeInUnblockedIndex (&Index, 0x2000, MAX_UINT64));
+
+  UT_ASSERT_STATUS_EQUAL (InsertUnblockedRange (&Index, 0x1000, 0x1000), EFI_INVALID_PARAMETER);
+
+  FreeUnblockedIndex (&Index);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Adjacent and overlapping regions should be merged, and removing a region
+  should split the merged range again.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+UnblockedIndexMergeAndSplit (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNBLOCKED_RANGE_INDEX  Index;
+
+  ZeroMem (&Index, sizeof (Index));
+
+  UT_ASSERT_NOT_EFI_ERROR (InsertUnblockedRange (&Index, 0x5000, 0x6000));
+  UT_ASSERT_NOT_EFI_ERROR (InsertUnblockedRange (&Index, 0x1000, 0x2000));
+  UT_ASSERT_NOT_EFI_ERROR (InsertUnblockedRange (&Index, 0x3000, 0x4000));
+  UT_ASSERT_EQUAL (Index.Count, 3);
+  UT_ASSERT_FALSE (IsRangeInUnblockedIndex (&Index, 0x1000, 0x3000));
+
+  // Filling both gaps folds everything into one range
+  UT_ASSERT_NOT_EFI_ERROR (InsertUnblockedRange (&Index, 0x2000, 0x3000));
+  UT_ASSERT_NOT_EFI_ERROR (InsertUnblockedRange (&Index, 0x4000, 0x5000));
+  UT_ASSERT_EQUAL (Index.Count, 1);
+  UT_ASSERT_EQUAL (Index.Ranges[0].Start, 0x1000);
+  UT_ASSERT_EQUAL (Index.Ranges[0].End, 0x6000);
+  UT_ASSERT_TRUE (IsRangeInUnblockedIndex (&Index, 0x1800, 0x4000));
+
+  // Removing the middle splits it back
+  UT_ASSERT_NOT_EFI_ERROR (RemoveUnblockedRange (&Index, 0x3000, 0x4000));
+  UT_ASSERT_EQUAL (Index.Count, 2);
+  UT_ASSERT_TRUE (IsRangeInUnblockedIndex (&Index, 0x1000, 0x2000));
+  UT_ASSERT_FALSE (IsRangeInUnblockedIndex (&Index, 0x2FFF, 2));
+  UT_ASSERT_FALSE (IsRangeInUnblockedIndex (&Index, 0x3000, 1));
+  UT_ASSERT_TRUE (IsRangeInUnblockedIndex (&Index, 0x4000, 0x2000));
+
+  // Trimming either end keeps the range count
+  UT_ASSERT_NOT_EFI_ERROR (RemoveUnblockedRange (&Index, 0x1000, 0x2000));
+  UT_ASSERT_NOT_EFI_ERROR (RemoveUnblockedRange (&Index, 0x5000, 0x6000));
+  UT_ASSERT_EQUAL (Index.Count, 2);
+  UT_ASSERT_EQUAL (Index.Ranges[0].Start, 0x2000);
+  UT_ASSERT_EQUAL (Index.Ranges[1].End, 0x5000);
+
+  UT_ASSERT_STATUS_EQUAL (RemoveUnblockedRange (&Index, 0x2000, 0x4000), EFI_NOT_FOUND);
+
+  UT_ASSERT_NOT_EFI_ERROR (RemoveUnblockedRange (&Index, 0x2000, 0x3000));
+  UT_ASSERT_NOT_EFI_ERROR (RemoveUnblockedRange (&Index, 0x4000, 0x5000));
+  UT_ASSERT_EQUAL (Index.Count, 0);
+
+  FreeUnblockedIndex (&Index);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Random unblock and block requests, the index has to agree with a per page
+  bitmap of the unblocked space after every request.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+UnblockedIndexRandomRequests (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNBLOCKED_RANGE_INDEX  Index;
+  BOOLEAN                Pages[RANDOM_PAGE_SPACE];
+  UINT32                 Seed;
+  UINTN                  Operation;
+  UINTN                  Query;
+  UINTN                  First;
+  UINTN                  Count;
+  UINTN                  Page;
+  BOOLEAN                Expected;
+  EFI_STATUS             Status;
+  EFI_PHYSICAL_ADDRESS   Buffer;
+  UINT64                 Length;
+
+  ZeroMem (&Index, sizeof (Index));
+  ZeroMem (Pages, sizeof (Pages));
+  Seed = 0x5EED;
+
+  for (Operation = 0; Operation < RANDOM_OPERATIONS; Operation++) {
+    First = NextRandom (&Seed) % RANDOM_PAGE_SPACE;
+    Count = 1 + NextRandom (&Seed) % 8;
+    Count = MIN (Count, RANDOM_PAGE_SPACE - First);
+
+    // Like the supervisor, only unblock free pages and only block what was unblocked
+    Expected = TRUE;
+    for (Page = First; Page < First + Count; Page++) {
+      Expected = (BOOLEAN)(Expected && (Pages[Page] == Pages[First]));
+    }
+
+    if (!Expected) {
+      continue;
+    }
+
+    if (Pages[First]) {
+      Status = RemoveUnblockedRange (&Index, TEST_BASE_ADDRESS + EFI_PAGES_TO_SIZE (First), TEST_BASE_ADDRESS + EFI_PAGES_TO_SIZE (First + Count));
+    } else {
+      Status = InsertUnblockedRange (&Index, TEST_BASE_ADDRESS + EFI_PAGES_TO_SIZE (First), TEST_BASE_ADDRESS + EFI_PAGES_TO_SIZE (First + Count));
+    }
+
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    for (Page = First; Page < First + Count; Page++) {
+      Pages[Page] = (BOOLEAN)!Pages[Page];
+    }
+
+    for (Query = 0; Query < RANDOM_QUERIES; Query++) {
+      Buffer = NextRandom (&Seed) % EFI_PAGES_TO_SIZE (RANDOM_PAGE_SPACE);
+      Length = 1 + NextRandom (&Seed) % EFI_PAGES_TO_SIZE (4);
+      if (Buffer + Length > EFI_PAGES_TO_SIZE (RANDOM_PAGE_SPACE)) {
+        Length = EFI_PAGES_TO_SIZE (RANDOM_PAGE_SPACE) - Buffer;
+      }
+
+      Expected = TRUE;
+      for (Page = Buffer / EFI_PAGE_SIZE; Page <= (Buffer + Length - 1) / EFI_PAGE_SIZE; Page++) {
+        Expected = (BOOLEAN)(Expected && Pages[Page]);
+      }
+
+      if (IsRangeInUnblockedIndex (&Index, TEST_BASE_ADDRESS + Buffer, Length) != Expected) {
+        UT_LOG_ERROR ("Index disagrees on 0x%lx + 0x%lx after %d requests\n", Buffer, Length, Operation);
+        UT_ASSERT_TRUE (FALSE);
+      }
+    }
+  }
+
+  FreeUnblockedIndex (&Index);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Benchmark of the range query against the walk over every unblocked region
+  that the supervisor used before. Regions are one page apart so that they do
+  not merge, both paths have to reach the same verdict for every query.
+
+  @param[in]  Context    Pointer to TEST_CONTEXT_BENCHMARK with the number of
+                         unblocked regions.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+UnblockedIndexQueryBenchmark (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNBLOCKED_RANGE_INDEX  Index;
+  UNBLOCKED_RANGE        *Regions;
+  EFI_PHYSICAL_ADDRESS   *Buffers;
+  BOOLEAN                *Verdicts;
+  UINTN                  RegionCount;
+  UINTN                  Region;
+  UINTN                  Query;
+  UINT32                 Seed;
+  clock_t                Start;
+  clock_t                WalkTicks;
+  clock_t                IndexTicks;
+
+  RegionCount = ((TEST_CONTEXT_BENCHMARK *)Context)->RegionCount;
+  ZeroMem (&Index, sizeof (Index));
+
+  Regions  = AllocatePool (RegionCount * sizeof (UNBLOCKED_RANGE));
+  Buffers  = AllocatePool (BENCHMARK_QUERY_COUNT * sizeof (EFI_PHYSICAL_ADDRESS));
+  Verdicts = AllocatePool (BENCHMARK_QUERY_COUNT * sizeof (BOOLEAN));
+  UT_ASSERT_NOT_NULL (Regions);
+  UT_ASSERT_NOT_NULL (Buffers);
+  UT_ASSERT_NOT_NULL (Verdicts);
+
+  // Unblock in reverse order to exercise insertion in front of the array
+  for (Region = RegionCount; Region > 0; Region--) {
+    Regions[Region - 1].Start = TEST_BASE_ADDRESS + EFI_PAGES_TO_SIZE ((Region - 1) * 3);
+    Regions[Region - 1].End   = Regions[Region - 1].Start + EFI_PAGES_TO_SIZE (2);
+    UT_ASSERT_NOT_EFI_ERROR (InsertUnblockedRange (&Index, Regions[Region - 1].Start, Regions[Region - 1].End));
+  }
+
+  UT_ASSERT_EQUAL (Index.Count, RegionCount);
+
+  Seed = 0x1234567;
+  for (Query = 0; Query < BENCHMARK_QUERY_COUNT; Query++) {
+    Buffers[Query] = TEST_BASE_ADDRESS + ((NextRandom (&Seed) % EFI_PAGES_TO_SIZE (RegionCount * 3)) & ~(EFI_PHYSICAL_ADDRESS)0xFF);
+  }
+
+  Start = clock ();
+  for (Query = 0; Query < BENCHMARK_QUERY_COUNT; Query++) {
+    Verdicts[Query] = FALSE;
+    for (Region = 0; Region < RegionCount; Region++) {
+      if ((Regions[Region].Start <= Buffers[Query]) && (Buffers[Query] + 0x100 <= Regions[Region].End)) {
+        Verdicts[Query] = TRUE;
+        break;
+      }
+    }
+  }
+
+  WalkTicks = clock () - Start;
+
+  Start = clock ();
+  for (Query = 0; Query < BENCHMARK_QUERY_COUNT; Query++) {
+    if (IsRangeInUnblockedIndex (&Index, Buffers[Query], 0x100) != Verdicts[Query]) {
+      UT_LOG_ERROR ("Index verdict mismatch on 0x%lx\n", Buffers[Query]);
+      UT_ASSERT_TRUE (FALSE);
+    }
+  }
+
+  IndexTicks = clock () - Start;
+  UT_LOG_INFO (
+    "%d unblocked regions: %d queries, walk %d us, index %d us\n",
+    RegionCount,
+    BENCHMARK_QUERY_COUNT,
+    (UINT32)(WalkTicks * 1000000 / CLOCKS_PER_SEC),
+    (UINT32)(IndexTicks * 1000000 / CLOCKS_PER_SEC)
+    );
+
+  FreeUnblockedIndex (&Index);
+  FreePool (Verdicts);
+  FreePool (Buffers);
+  FreePool (Regions);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  unblocked memory index and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      IndexTests;
+  UNIT_TEST_SUITE_HANDLE      BenchmarkTests;
+  TEST_CONTEXT_BENCHMARK      BenchmarkContext[3];
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the unblocked memory index Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&IndexTests, Framework, "Unblocked Memory Index Tests", "UnblockMemoryIndex.Query", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for IndexTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (IndexTests, "Index should only cover buffers inside an unblocked region", "Boundaries", UnblockedIndexQueryBoundaries, NULL, NULL, NULL);
+  AddTestCase (IndexTests, "Index should merge adjacent regions and split them on removal", "MergeSplit", UnblockedIndexMergeAndSplit, NULL, NULL, NULL);
+  AddTestCase (IndexTests, "Index should agree with a page bitmap on random requests", "Random", UnblockedIndexRandomRequests, NULL, NULL, NULL);
+
+  //
+  // Populate the query benchmark suite, comparing the region walk against the index.
+  //
+  Status = CreateUnitTestSuite (&BenchmarkTests, Framework, "Unblocked Memory Index Benchmark", "UnblockMemoryIndex.Benchmark", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BenchmarkTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  BenchmarkContext[0].RegionCount = 10;
+  BenchmarkContext[1].RegionCount = 100;
+  BenchmarkContext[2].RegionCount = 1000;
+  AddTestCase (BenchmarkTests, "Range query with 10 unblocked regions", "Query10", UnblockedIndexQueryBenchmark, NULL, NULL, &BenchmarkContext[0]);
+  AddTestCase (BenchmarkTests, "Range query with 100 unblocked regions", "Query100", UnblockedIndexQueryBenchmark, NULL, NULL, &BenchmarkContext[1]);
+  AddTestCase (BenchmarkTests, "Range query with 1000 unblocked regions", "Query1000", UnblockedIndexQueryBenchmark, NULL, NULL, &BenchmarkContext[2]);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -13,9 +13,14 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "MmSupervisorCore.h"
 #include "Services/CpuService/CpuService.h"
 #include "Services/MpService/MpService.h"
+#include "Services/MpService/ParallelFor.h"
 #include "Relocate/Relocate.h"
 #include "Mem/Mem.h"
 #include "PrivilegeMgmt/PrivilegeMgmt.h"
+#include "Request/Request.h"
+#include "Misc/SmiTimeline.h"
+
+#include <Guid/MmSupervisorRequestData.h>
 
 #include <Library/MmMemoryProtectionHobLib.h> // MU_CHANGE
 
@@ -46,7 +51,9 @@ SMM_CPU_PRIVATE_DATA  mSmmCpuPrivateData = {
     RegisterSmmEntry                            // SmmConfiguration.RegisterSmmEntry
   },
   NULL,                                         // pointer to Ap Wrapper Func array
-  { NULL, NULL },                               // List_Entry for Tokens.
+  { NULL, NULL },                               // List_Entry for free Tokens.
+  NULL,                                         // Pointer to Token table
+  0                                             // Token count
 };
 
 //
@@ -68,6 +75,11 @@ SMM_CPU_SYNC_MODE            mCpuSmmSyncMode;
 BOOLEAN                      mMachineCheckSupported = FALSE;
 MM_COMPLETION                mSmmStartupThisApToken;
 
+//
+// TSC cycles the BSP spent in the rendezvous, only updated by the BSP.
+//
+MM_SUPERVISOR_RENDEZVOUS_STATS_BUFFER  mRendezvousStats;
+
 //
 // Processor specified by mPackageFirstThreadIndex[PackageIndex] will do the package-scope register check.
 //
@@ -382,6 +394,78 @@ SmmWaitForApArrival (
   PERF_FUNCTION_END ();
 }
 
+/**
+  Add the cycles elapsed since Start to a rendezvous counter and its maximum.
+
+  @param[in, out] Total       The counter to add the cycles to.
+  @param[in, out] Max         The longest single measure of the counter.
+  @param[in]      Start       The TSC value at the start of the measure.
+
+**/
+STATIC
+VOID
+RecordRendezvousCycles (
+  IN OUT UINT64  *Total,
+  IN OUT UINT64  *Max,
+  IN     UINT64  Start
+  )
+{
+  UINT64  Cycles;
+
+  Cycles  = AsmReadTsc () - Start;
+  *Total += Cycles;
+  if (Cycles > *Max) {
+    *Max = Cycles;
+  }
+}
+
+/**
+  Routine used to report the time the BSP spent gathering and releasing the APs
+  in the SMI rendezvous, running the handlers, and how often the waiting APs
+  were woken up.
+
+  @param[in, out] StatsBuffer   Buffer to hold the counters. The counters are
+                                cleared if MM_SUPERVISOR_RENDEZVOUS_STATS_RESET
+                                is set in its Flags.
+
+  @retval EFI_SUCCESS             The counters are copied out.
+  @retval EFI_INVALID_PARAMETER   StatsBuffer is NULL.
+**/
+EFI_STATUS
+ProcessRendezvousStatsRequest (
+  IN OUT MM_SUPERVISOR_RENDEZVOUS_STATS_BUFFER  *StatsBuffer
+  )
+{
+  if (StatsBuffer == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  StatsBuffer->Smis             = mRendezvousStats.Smis;
+  StatsBuffer->EntryCycles      = mRendezvousStats.EntryCycles;
+  StatsBuffer->MaxEntryCycles   = mRendezvousStats.MaxEntryCycles;
+  StatsBuffer->ExitCycles       = mRendezvousStats.ExitCycles;
+  StatsBuffer->MaxExitCycles    = mRendezvousStats.MaxExitCycles;
+  StatsBuffer->HandlerCycles    = mRendezvousStats.HandlerCycles;
+  StatsBuffer->MaxHandlerCycles = mRendezvousStats.MaxHandlerCycles;
+  StatsBuffer->FastExits        = mRendezvousStats.FastExits;
+
+  //
+  // Only counted when the APs wait with MWAIT, the counters stay 0 otherwise
+  //
+  SmmCpuSyncGetWaitStatistics (
+    mSmmMpSyncData->SyncContext,
+    (StatsBuffer->Flags & MM_SUPERVISOR_RENDEZVOUS_STATS_RESET) != 0,
+    &StatsBuffer->Wakeups,
+    &StatsBuffer->SpuriousWakeups
+    );
+
+  if ((StatsBuffer->Flags & MM_SUPERVISOR_RENDEZVOUS_STATS_RESET) != 0) {
+    ZeroMem (&mRendezvousStats, sizeof (mRendezvousStats));
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
   Replace OS MTRR's with SMI MTRR's.
 
@@ -461,38 +545,51 @@ IsPresentAp (
 /**
   Clean up the status flags used during executing the procedure.
 
-  @param   CpuIndex      The AP index which calls this function.
+  The last AP to finish the procedure of a token puts the token back on the free
+  list. Its handle stays valid, and reports the procedure as completed, until the
+  token is handed out again.
+
+  @param   Token         The token of the procedure completed by the calling AP.
 
 **/
 VOID
 ReleaseToken (
-  IN UINTN  CpuIndex
+  IN PROCEDURE_TOKEN  *Token
   )
 {
-  PROCEDURE_TOKEN  *Token;
-
-  Token = mSmmMpSyncData->CpuData[CpuIndex].Token;
-
   if (InterlockedDecrement (&Token->RunningApCount) == 0) {
     ReleaseSpinLock (Token->SpinLock);
-  }
 
-  mSmmMpSyncData->CpuData[CpuIndex].Token = NULL;
+    AcquireSpinLock (mSmmCpuSemaphores.SemaphoreGlobal.TokenLock);
+    InsertTailList (&gSmmCpuPrivate->FreeTokenList, &Token->Link);
+    ReleaseSpinLock (mSmmCpuSemaphores.SemaphoreGlobal.TokenLock);
+  }
 }
 
 /**
-  Free the tokens in the maintained list.
+  Check if the APs can be released to exit the SMI by clearing InsideSmm alone,
+  when no procedure was queued on any AP during the SMI.
+
+  Only the relaxed flow without MTRR programming qualifies, the other flows
+  hand the APs through more rounds of their Run semaphores on the way out.
+  APs that sleep in MWAIT on their Run semaphore are not woken up by the flag,
+  so the fast exit is not used with PcdMmSupervisorCpuSyncMwait.
+
+  @param     SyncMode         SMM MP sync mode
+
+  @retval    TRUE             The APs watch InsideSmm while they are idle.
+  @retval    FALSE            The APs wait on their Run semaphore while they are idle.
 
 **/
-VOID
-ResetTokens (
-  VOID
+STATIC
+BOOLEAN
+IsRelaxedFastExit (
+  IN SMM_CPU_SYNC_MODE  SyncMode
   )
 {
-  //
-  // Reset the FirstFreeToken to the beginning of token list upon exiting SMI.
-  //
-  gSmmCpuPrivate->FirstFreeToken = GetFirstNode (&gSmmCpuPrivate->TokenList);
+  return (BOOLEAN)((SyncMode != SmmCpuSyncModeTradition) &&
+                   !SmmCpuFeaturesNeedConfigureMtrrs () &&
+                   !FeaturePcdGet (PcdMmSupervisorCpuSyncMwait));
 }
 
 /**
@@ -514,6 +611,7 @@ BSPHandler (
   UINTN          ApCount;
   BOOLEAN        ClearTopLevelSmiResult;
   UINTN          PresentCount;
+  UINT64         RendezvousStart;
 
   ASSERT (CpuIndex == mSmmMpSyncData->BspIndex);
   CpuCount = 0;
@@ -521,6 +619,13 @@ BSPHandler (
 
   PERF_FUNCTION_BEGIN ();
 
+  RendezvousStart = AsmReadTsc ();
+
+  //
+  // No procedure queued on the APs yet, set by QueueApProcedure()
+  //
+  mSmmMpSyncData->ApProcedureQueued = FALSE;
+
   //
   // Flag BSP's presence
   //
@@ -572,6 +677,8 @@ BSPHandler (
     //
     SmmCpuSyncWaitForAPs (mSmmMpSyncData->SyncContext, ApCount, CpuIndex);
 
+    RecordRendezvousCycles (&mRendezvousStats.EntryCycles, &mRendezvousStats.MaxEntryCycles, RendezvousStart);
+
     if (SmmCpuFeaturesNeedConfigureMtrrs ()) {
       //
       // Signal all APs it's time for backup MTRRs
@@ -617,22 +724,31 @@ BSPHandler (
   //
   AcquireSpinLock (mSmmMpSyncData->CpuData[CpuIndex].Busy);
 
+  SmiTimelineRecord (CpuIndex, MM_SUPERVISOR_SMI_PHASE_SYNC_DONE);
+
   //
   // Invoke SMM Foundation EntryPoint with the processor information context.
   //
+  RendezvousStart = AsmReadTsc ();
+  SmiTimelineRecord (CpuIndex, MM_SUPERVISOR_SMI_PHASE_DISPATCH_START);
   gSmmCpuPrivate->SmmCoreEntry (&gSmmCpuPrivate->SmmCoreEntryContext);
+  SmiTimelineRecord (CpuIndex, MM_SUPERVISOR_SMI_PHASE_DISPATCH_END);
 
   //
   // Make sure all APs have completed their pending none-block tasks
   //
   WaitForAllAPsNotBusy (TRUE);
 
+  RecordRendezvousCycles (&mRendezvousStats.HandlerCycles, &mRendezvousStats.MaxHandlerCycles, RendezvousStart);
+
   //
   // If Relaxed-AP Sync Mode: gather all available APs after BSP SMM handlers are done, and
   // make those APs to exit SMI synchronously. APs which arrive later will be excluded and
   // will run through freely.
   //
   if ((SyncMode != SmmCpuSyncModeTradition) && !SmmCpuFeaturesNeedConfigureMtrrs ()) {
+    RendezvousStart = AsmReadTsc ();
+
     //
     // Lock door for late coming CPU checkin and retrieve the Arrived number of APs
     //
@@ -657,13 +773,22 @@ BSPHandler (
         break;
       }
     }
+
+    RecordRendezvousCycles (&mRendezvousStats.EntryCycles, &mRendezvousStats.MaxEntryCycles, RendezvousStart);
   }
 
   //
-  // Notify all APs to exit
+  // Notify all APs to exit. The idle APs of a fast exit see InsideSmm cleared without
+  // a release, the round of releases is kept once any AP has been handed a procedure.
   //
+  RendezvousStart = AsmReadTsc ();
+  SmiTimelineRecord (CpuIndex, MM_SUPERVISOR_SMI_PHASE_RELEASE);
   *mSmmMpSyncData->InsideSmm = FALSE;
-  ReleaseAllAPs ();
+  if (!IsRelaxedFastExit (SyncMode) || mSmmMpSyncData->ApProcedureQueued) {
+    ReleaseAllAPs ();
+  } else {
+    mRendezvousStats.FastExits++;
+  }
 
   if (SmmCpuFeaturesNeedConfigureMtrrs ()) {
     //
@@ -717,6 +842,9 @@ BSPHandler (
   //
   SmmCpuSyncWaitForAPs (mSmmMpSyncData->SyncContext, ApCount, CpuIndex);
 
+  RecordRendezvousCycles (&mRendezvousStats.ExitCycles, &mRendezvousStats.MaxExitCycles, RendezvousStart);
+  mRendezvousStats.Smis++;
+
   //
   // At this point, all APs should have exited from APHandler().
   // Migrate the SMM MP performance logging to standard SMM performance logging.
@@ -726,11 +854,6 @@ BSPHandler (
     MigrateMpPerf (gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus, CpuIndex);
     );
 
-  //
-  // Reset the tokens buffer.
-  //
-  ResetTokens ();
-
   //
   // Reset BspIndex to MAX_UINT32, meaning BSP has not been elected.
   //
@@ -763,10 +886,11 @@ APHandler (
   IN      SMM_CPU_SYNC_MODE  SyncMode
   )
 {
-  UINT64         Timer;
-  UINTN          BspIndex;
-  MTRR_SETTINGS  Mtrrs;
-  EFI_STATUS     ProcedureStatus;
+  UINT64            Timer;
+  UINTN             BspIndex;
+  MTRR_SETTINGS     Mtrrs;
+  EFI_STATUS        ProcedureStatus;
+  SMM_AP_PROCEDURE  ApProcedure;
 
   //
   // Timeout BSP
@@ -876,7 +1000,23 @@ APHandler (
     SmmCpuSyncReleaseBsp (mSmmMpSyncData->SyncContext, CpuIndex, BspIndex);
   }
 
+  SmiTimelineRecord (CpuIndex, MM_SUPERVISOR_SMI_PHASE_SYNC_DONE);
+
   while (TRUE) {
+    if (IsRelaxedFastExit (SyncMode)) {
+      //
+      // Watch for a procedure queued on this AP or the BSP leaving SMM. The BSP
+      // only releases the Run semaphore on exit if a procedure was queued on any AP.
+      //
+      while ((mSmmMpSyncData->CpuData[CpuIndex].QueueLine.Queue.Pending == 0) && *mSmmMpSyncData->InsideSmm) {
+        CpuPause ();
+      }
+
+      if ((mSmmMpSyncData->CpuData[CpuIndex].QueueLine.Queue.Pending == 0) && !mSmmMpSyncData->ApProcedureQueued) {
+        break;
+      }
+    }
+
     //
     // Wait for something to happen
     //
@@ -890,39 +1030,59 @@ APHandler (
     }
 
     //
-    // BUSY should be acquired by SmmStartupThisAp()
+    // BUSY should be acquired by QueueApProcedure()
     //
     ASSERT (
       !AcquireSpinLockOrFail (mSmmMpSyncData->CpuData[CpuIndex].Busy)
       );
 
     //
-    // Invoke the scheduled procedure
+    // The BSP releases this AP once per procedure queued, take the oldest one.
+    // The entry may be reused as soon as Pending drops, so it is copied first.
+    //
+    CopyMem (
+      &ApProcedure,
+      &mSmmMpSyncData->CpuData[CpuIndex].Queue[mSmmMpSyncData->CpuData[CpuIndex].QueueLine.Queue.Head % SMM_AP_PROCEDURE_QUEUE_DEPTH],
+      sizeof (ApProcedure)
+      );
+    mSmmMpSyncData->CpuData[CpuIndex].QueueLine.Queue.Head++;
+
+    //
+    // Invoke the scheduled procedure, only the supervisor procedures below run in CPL 0
     //
-    if (mSmmMpSyncData->CpuData[CpuIndex].Procedure == ProcedureWrapper) {
-      ProcedureStatus = ProcedureWrapper ((VOID *)mSmmMpSyncData->CpuData[CpuIndex].Parameter);
+    SmiTimelineRecord (CpuIndex, MM_SUPERVISOR_SMI_PHASE_DISPATCH_START);
+    if (ApProcedure.Procedure == ProcedureWrapper) {
+      ProcedureStatus = ProcedureWrapper (ApProcedure.Parameter);
+    } else if (ApProcedure.Procedure == ParallelForWorker) {
+      ProcedureStatus = ParallelForWorker (ApProcedure.Parameter);
     } else {
       ProcedureStatus = InvokeDemotedApProcedure (
                           CpuIndex,
-                          mSmmMpSyncData->CpuData[CpuIndex].Procedure,
-                          (VOID *)mSmmMpSyncData->CpuData[CpuIndex].Parameter
+                          ApProcedure.Procedure,
+                          ApProcedure.Parameter
                           );
     }
 
-    if (mSmmMpSyncData->CpuData[CpuIndex].Status != NULL) {
-      *mSmmMpSyncData->CpuData[CpuIndex].Status = ProcedureStatus;
+    SmiTimelineRecord (CpuIndex, MM_SUPERVISOR_SMI_PHASE_DISPATCH_END);
+
+    if (ApProcedure.Status != NULL) {
+      *ApProcedure.Status = ProcedureStatus;
     }
 
-    if (mSmmMpSyncData->CpuData[CpuIndex].Token != NULL) {
-      ReleaseToken (CpuIndex);
+    if (ApProcedure.Token != NULL) {
+      ReleaseToken (ApProcedure.Token);
     }
 
     //
-    // Release BUSY
+    // Release BUSY once the queue is drained
     //
-    ReleaseSpinLock (mSmmMpSyncData->CpuData[CpuIndex].Busy);
+    if (InterlockedDecrement (&mSmmMpSyncData->CpuData[CpuIndex].QueueLine.Queue.Pending) == 0) {
+      ReleaseSpinLock (mSmmMpSyncData->CpuData[CpuIndex].Busy);
+    }
   }
 
+  SmiTimelineRecord (CpuIndex, MM_SUPERVISOR_SMI_PHASE_RELEASE);
+
   if (SmmCpuFeaturesNeedConfigureMtrrs ()) {
     //
     // Notify BSP the readiness of this AP to program MTRRs
@@ -965,49 +1125,73 @@ APHandler (
 }
 
 /**
-  Checks whether the input token is the current used token.
+  Get the token a handle was handed out for.
 
-  @param[in]  Token      This parameter describes the token that was passed into DispatchProcedure or
-                         BroadcastProcedure.
+  @param[in]  Token      The handle returned by DispatchProcedure or BroadcastProcedure.
 
-  @retval TRUE           The input token is the current used token.
-  @retval FALSE          The input token is not the current used token.
+  The table is looked up under TokenLock, since AllocateTokenBuffer may swap in a
+  larger table and free the old one at any time. The tokens themselves are never
+  freed, so the one returned stays valid after the lock is released.
+
+  @return The token, or NULL if the handle is not valid or the token has been
+          handed out again since.
 **/
-BOOLEAN
-IsTokenInUse (
-  IN SPIN_LOCK  *Token
+STATIC
+PROCEDURE_TOKEN *
+GetProcedureToken (
+  IN MM_COMPLETION  Token
   )
 {
-  LIST_ENTRY       *Link;
+  UINTN            Index;
+  UINTN            Generation;
   PROCEDURE_TOKEN  *ProcToken;
 
-  if (Token == NULL) {
-    return FALSE;
+  Index      = (UINTN)Token & PROCEDURE_TOKEN_MAX_COUNT;
+  Generation = (UINTN)Token >> PROCEDURE_TOKEN_INDEX_BITS;
+  if ((Index == 0) || (Generation == 0)) {
+    return NULL;
   }
 
-  Link = GetFirstNode (&gSmmCpuPrivate->TokenList);
-  //
-  // Only search used tokens.
-  //
-  while (Link != gSmmCpuPrivate->FirstFreeToken) {
-    ProcToken = PROCEDURE_TOKEN_FROM_LINK (Link);
+  ProcToken = NULL;
+  AcquireSpinLock (mSmmCpuSemaphores.SemaphoreGlobal.TokenLock);
+  if (Index <= gSmmCpuPrivate->TokenCount) {
+    ProcToken = gSmmCpuPrivate->TokenTable[Index - 1];
+  }
 
-    if (ProcToken->SpinLock == Token) {
-      return TRUE;
-    }
+  ReleaseSpinLock (mSmmCpuSemaphores.SemaphoreGlobal.TokenLock);
 
-    Link = GetNextNode (&gSmmCpuPrivate->TokenList, Link);
+  if ((ProcToken == NULL) || (ProcToken->Generation != Generation)) {
+    return NULL;
   }
 
-  return FALSE;
+  return ProcToken;
+}
+
+/**
+  Checks whether the input token is the current used token.
+
+  @param[in]  Token      This parameter describes the token that was passed into DispatchProcedure or
+                         BroadcastProcedure.
+
+  @retval TRUE           The input token is the current used token.
+  @retval FALSE          The input token is not the current used token.
+**/
+BOOLEAN
+IsTokenInUse (
+  IN MM_COMPLETION  Token
+  )
+{
+  return GetProcedureToken (Token) != NULL;
 }
 
 /**
-  Allocate buffer for the SPIN_LOCK and PROCEDURE_TOKEN.
+  Allocate buffer for the SPIN_LOCK and PROCEDURE_TOKEN, add the new tokens to
+  the token table and to the free token list.
 
-  @return First token of the token buffer.
+  @retval EFI_SUCCESS             New tokens are on the free token list.
+  @retval EFI_OUT_OF_RESOURCES    The tokens could not be allocated.
 **/
-LIST_ENTRY *
+EFI_STATUS
 AllocateTokenBuffer (
   VOID
   )
@@ -1018,6 +1202,8 @@ AllocateTokenBuffer (
   SPIN_LOCK        *SpinLock;
   UINT8            *SpinLockBuffer;
   PROCEDURE_TOKEN  *ProcTokens;
+  PROCEDURE_TOKEN  **TokenTable;
+  PROCEDURE_TOKEN  **OldTokenTable;
 
   SpinLockSize = GetSpinLockProperties ();
 
@@ -1036,6 +1222,18 @@ AllocateTokenBuffer (
 
   DEBUG ((DEBUG_INFO, "CpuSmm: SpinLock Size = 0x%x, PcdCpuSmmMpTokenCountPerChunk = 0x%x\n", SpinLockSize, TokenCountPerChunk));
 
+  if (gSmmCpuPrivate->TokenCount + TokenCountPerChunk > PROCEDURE_TOKEN_MAX_COUNT) {
+    DEBUG ((DEBUG_ERROR, "Procedure token table is full, %d tokens in use\n", gSmmCpuPrivate->TokenCount));
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  TokenTable = AllocatePool (sizeof (PROCEDURE_TOKEN *) * (gSmmCpuPrivate->TokenCount + TokenCountPerChunk));
+  if (TokenTable == NULL) {
+    DEBUG ((DEBUG_ERROR, "Failed to allocate memory for procedure token table\n"));
+    ASSERT (FALSE);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
   //
   // Separate the Spin_lock and Proc_token because the alignment requires by Spin_Lock.
   //
@@ -1043,14 +1241,21 @@ AllocateTokenBuffer (
   if (SpinLockBuffer == NULL) {
     DEBUG ((DEBUG_ERROR, "Failed to allocate memory for spin lock buffer\n"));
     ASSERT (FALSE);
-    return NULL;
+    FreePool (TokenTable);
+    return EFI_OUT_OF_RESOURCES;
   }
 
   ProcTokens = AllocatePool (sizeof (PROCEDURE_TOKEN) * TokenCountPerChunk);
   if (ProcTokens == NULL) {
     DEBUG ((DEBUG_ERROR, "Failed to allocate memory for procedure token buffer\n"));
     ASSERT (FALSE);
-    return NULL;
+    FreePool (SpinLockBuffer);
+    FreePool (TokenTable);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (gSmmCpuPrivate->TokenTable != NULL) {
+    CopyMem (TokenTable, gSmmCpuPrivate->TokenTable, sizeof (PROCEDURE_TOKEN *) * gSmmCpuPrivate->TokenCount);
   }
 
   for (Index = 0; Index < TokenCountPerChunk; Index++) {
@@ -1060,21 +1265,38 @@ AllocateTokenBuffer (
     ProcTokens[Index].Signature      = PROCEDURE_TOKEN_SIGNATURE;
     ProcTokens[Index].SpinLock       = SpinLock;
     ProcTokens[Index].RunningApCount = 0;
+    ProcTokens[Index].Index          = (UINT32)(gSmmCpuPrivate->TokenCount + Index);
+    ProcTokens[Index].Generation     = 0;
+
+    TokenTable[ProcTokens[Index].Index] = &ProcTokens[Index];
+  }
+
+  AcquireSpinLock (mSmmCpuSemaphores.SemaphoreGlobal.TokenLock);
+  for (Index = 0; Index < TokenCountPerChunk; Index++) {
+    InsertTailList (&gSmmCpuPrivate->FreeTokenList, &ProcTokens[Index].Link);
+  }
+
+  OldTokenTable               = gSmmCpuPrivate->TokenTable;
+  gSmmCpuPrivate->TokenTable  = TokenTable;
+  gSmmCpuPrivate->TokenCount += TokenCountPerChunk;
+  ReleaseSpinLock (mSmmCpuSemaphores.SemaphoreGlobal.TokenLock);
 
-    InsertTailList (&gSmmCpuPrivate->TokenList, &ProcTokens[Index].Link);
+  if (OldTokenTable != NULL) {
+    FreePool (OldTokenTable);
   }
 
-  return &ProcTokens[0].Link;
+  return EFI_SUCCESS;
 }
 
 /**
   Get the free token.
 
-  If no free token, allocate new tokens then return the free one.
+  Tokens are recycled as soon as their procedure completes on all APs. New tokens
+  are only allocated when all of them are in use.
 
   @param RunningApsCount    The Running Aps count for this token.
 
-  @retval    return the first free PROCEDURE_TOKEN.
+  @retval    return the first free PROCEDURE_TOKEN, NULL if no token could be allocated.
 
 **/
 PROCEDURE_TOKEN *
@@ -1083,18 +1305,32 @@ GetFreeToken (
   )
 {
   PROCEDURE_TOKEN  *NewToken;
+  LIST_ENTRY       *Link;
+
+  AcquireSpinLock (mSmmCpuSemaphores.SemaphoreGlobal.TokenLock);
+  if (IsListEmpty (&gSmmCpuPrivate->FreeTokenList)) {
+    ReleaseSpinLock (mSmmCpuSemaphores.SemaphoreGlobal.TokenLock);
+    if (EFI_ERROR (AllocateTokenBuffer ())) {
+      return NULL;
+    }
+
+    AcquireSpinLock (mSmmCpuSemaphores.SemaphoreGlobal.TokenLock);
+  }
+
+  Link = GetFirstNode (&gSmmCpuPrivate->FreeTokenList);
+  RemoveEntryList (Link);
+  ReleaseSpinLock (mSmmCpuSemaphores.SemaphoreGlobal.TokenLock);
+
+  NewToken = PROCEDURE_TOKEN_FROM_LINK (Link);
 
   //
-  // If FirstFreeToken meets the end of token list, enlarge the token list.
-  // Set FirstFreeToken to the first free token.
+  // Generation 0 is never handed out, so that no handle matches a token that was never used
   //
-  if (gSmmCpuPrivate->FirstFreeToken == &gSmmCpuPrivate->TokenList) {
-    gSmmCpuPrivate->FirstFreeToken = AllocateTokenBuffer ();
+  NewToken->Generation = (NewToken->Generation + 1) & PROCEDURE_TOKEN_GENERATION_MASK;
+  if (NewToken->Generation == 0) {
+    NewToken->Generation = 1;
   }
 
-  NewToken                       = PROCEDURE_TOKEN_FROM_LINK (gSmmCpuPrivate->FirstFreeToken);
-  gSmmCpuPrivate->FirstFreeToken = GetNextNode (&gSmmCpuPrivate->TokenList, gSmmCpuPrivate->FirstFreeToken);
-
   NewToken->RunningApCount = RunningApsCount;
   AcquireSpinLock (NewToken->SpinLock);
 
@@ -1112,20 +1348,85 @@ GetFreeToken (
 
   @retval EFI_SUCCESS           Specified AP has finished task assigned by StartupThisAPs().
   @retval EFI_NOT_READY         Specified AP has not finished task and timeout has not expired.
+  @retval EFI_NOT_FOUND         Token is not currently in use.
 **/
 EFI_STATUS
 IsApReady (
-  IN SPIN_LOCK  *Token
+  IN MM_COMPLETION  Token
   )
 {
-  if (AcquireSpinLockOrFail (Token)) {
-    ReleaseSpinLock (Token);
+  PROCEDURE_TOKEN  *ProcToken;
+
+  ProcToken = GetProcedureToken (Token);
+  if (ProcToken == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (AcquireSpinLockOrFail (ProcToken->SpinLock)) {
+    ReleaseSpinLock (ProcToken->SpinLock);
     return EFI_SUCCESS;
   }
 
   return EFI_NOT_READY;
 }
 
+/**
+  Queue a procedure on an AP. The AP runs it once the caller releases the AP,
+  after the procedures queued before it.
+
+  Only the BSP queues procedures. When the queue is full, this waits for the AP
+  to complete the oldest procedure.
+
+  @param[in]       CpuIndex                 Target CPU Index
+  @param[in]       Procedure                The address of the procedure to run
+  @param[in]       Parameter                The parameter to pass to the procedure
+  @param[in]       Token                    The token to release once the procedure completes, or NULL.
+  @param[in,out]   CpuStatus                Receives the status of the procedure, or NULL.
+
+**/
+STATIC
+VOID
+QueueApProcedure (
+  IN      UINTN              CpuIndex,
+  IN      EFI_AP_PROCEDURE2  Procedure,
+  IN      VOID               *Parameter,
+  IN      PROCEDURE_TOKEN    *Token,
+  IN OUT  EFI_STATUS         *CpuStatus
+  )
+{
+  SMM_CPU_DATA_BLOCK  *CpuData;
+  SMM_AP_PROCEDURE    *Entry;
+
+  CpuData = &mSmmMpSyncData->CpuData[CpuIndex];
+  while (CpuData->QueueLine.Queue.Pending >= SMM_AP_PROCEDURE_QUEUE_DEPTH) {
+    CpuPause ();
+  }
+
+  //
+  // The APs take the full exit handshake from now on
+  //
+  mSmmMpSyncData->ApProcedureQueued = TRUE;
+
+  Entry            = &CpuData->Queue[CpuData->Tail % SMM_AP_PROCEDURE_QUEUE_DEPTH];
+  Entry->Procedure = Procedure;
+  Entry->Parameter = Parameter;
+  Entry->Token     = Token;
+  Entry->Status    = CpuStatus;
+  if (CpuStatus != NULL) {
+    *CpuStatus = EFI_NOT_READY;
+  }
+
+  CpuData->Tail++;
+
+  //
+  // The AP releases BUSY when it drains its queue, so BUSY is acquired again when
+  // the queue was empty. The AP may still be on its way to release it.
+  //
+  if (InterlockedIncrement (&CpuData->QueueLine.Queue.Pending) == 1) {
+    AcquireSpinLock (CpuData->Busy);
+  }
+}
+
 /**
   Schedule a procedure to run on the specified CPU.
 
@@ -1157,8 +1458,8 @@ IsApReady (
   @retval EFI_INVALID_PARAMETER    CpuNumber not valid
   @retval EFI_INVALID_PARAMETER    CpuNumber specifying BSP
   @retval EFI_INVALID_PARAMETER    The AP specified by CpuNumber did not enter SMM
-  @retval EFI_INVALID_PARAMETER    The AP specified by CpuNumber is busy
-  @retval EFI_SUCCESS              The procedure has been successfully scheduled
+  @retval EFI_SUCCESS              The procedure has been successfully scheduled, behind the
+                                   procedures already queued on the AP
 
 **/
 EFI_STATUS
@@ -1212,38 +1513,33 @@ InternalSmmStartupThisAp (
     return EFI_INVALID_PARAMETER;
   }
 
-  AcquireSpinLock (mSmmMpSyncData->CpuData[CpuIndex].Busy);
-
-  mSmmMpSyncData->CpuData[CpuIndex].Procedure = Procedure;
-  mSmmMpSyncData->CpuData[CpuIndex].Parameter = ProcArguments;
-  if (Token != NULL) {
-    if (Token != &mSmmStartupThisApToken) {
-      //
-      // When Token points to mSmmStartupThisApToken, this routine is called
-      // from SmmStartupThisAp() in non-blocking mode (PcdCpuSmmBlockStartupThisAp == FALSE).
-      //
-      // In this case, caller wants to startup AP procedure in non-blocking
-      // mode and cannot get the completion status from the Token because there
-      // is no way to return the Token to caller from SmmStartupThisAp().
-      // Caller needs to use its implementation specific way to query the completion status.
-      //
-      // There is no need to allocate a token for such case so the 3 overheads
-      // can be avoided:
-      // 1. Call AllocateTokenBuffer() when there is no free token.
-      // 2. Get a free token from the token buffer.
-      // 3. Call ReleaseToken() in APHandler().
-      //
-      ProcToken                               = GetFreeToken (1);
-      mSmmMpSyncData->CpuData[CpuIndex].Token = ProcToken;
-      *Token                                  = (MM_COMPLETION)ProcToken->SpinLock;
+  ProcToken = NULL;
+  if ((Token != NULL) && (Token != &mSmmStartupThisApToken)) {
+    //
+    // When Token points to mSmmStartupThisApToken, this routine is called
+    // from SmmStartupThisAp() in non-blocking mode (PcdCpuSmmBlockStartupThisAp == FALSE).
+    //
+    // In this case, caller wants to startup AP procedure in non-blocking
+    // mode and cannot get the completion status from the Token because there
+    // is no way to return the Token to caller from SmmStartupThisAp().
+    // Caller needs to use its implementation specific way to query the completion status.
+    //
+    // There is no need to allocate a token for such case so the 3 overheads
+    // can be avoided:
+    // 1. Call AllocateTokenBuffer() when there is no free token.
+    // 2. Get a free token from the token buffer.
+    // 3. Call ReleaseToken() in APHandler().
+    //
+    ProcToken = GetFreeToken (1);
+    if (ProcToken == NULL) {
+      return EFI_OUT_OF_RESOURCES;
     }
-  }
 
-  mSmmMpSyncData->CpuData[CpuIndex].Status = CpuStatus;
-  if (mSmmMpSyncData->CpuData[CpuIndex].Status != NULL) {
-    *mSmmMpSyncData->CpuData[CpuIndex].Status = EFI_NOT_READY;
+    *Token = PROCEDURE_TOKEN_HANDLE (ProcToken);
   }
 
+  QueueApProcedure (CpuIndex, Procedure, ProcArguments, ProcToken, CpuStatus);
+
   SmmCpuSyncReleaseOneAp (mSmmMpSyncData->SyncContext, CpuIndex, gSmmCpuPrivate->SmmCoreEntryContext.CurrentlyExecutingCpu);
 
   if (Token == NULL) {
@@ -1329,38 +1625,27 @@ InternalSmmStartupAllAPs (
 
   if (Token != NULL) {
     ProcToken = GetFreeToken ((UINT32)mMaxNumberOfCpus);
-    *Token    = (MM_COMPLETION)ProcToken->SpinLock;
+    if (ProcToken == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    *Token = PROCEDURE_TOKEN_HANDLE (ProcToken);
   } else {
     ProcToken = NULL;
   }
 
   //
-  // Make sure all BUSY should be acquired.
-  //
-  // Because former code already check mSmmMpSyncData->CpuData[***].Busy for each AP.
-  // Here code always use AcquireSpinLock instead of AcquireSpinLockOrFail for not
-  // block mode.
+  // All APs are idle as checked above, so queueing acquires every BUSY.
   //
   for (Index = 0; Index < mMaxNumberOfCpus; Index++) {
     if (IsPresentAp (Index)) {
-      AcquireSpinLock (mSmmMpSyncData->CpuData[Index].Busy);
-    }
-  }
-
-  for (Index = 0; Index < mMaxNumberOfCpus; Index++) {
-    if (IsPresentAp (Index)) {
-      mSmmMpSyncData->CpuData[Index].Procedure = (EFI_AP_PROCEDURE2)Procedure;
-      mSmmMpSyncData->CpuData[Index].Parameter = ProcedureArguments;
-      if (ProcToken != NULL) {
-        mSmmMpSyncData->CpuData[Index].Token = ProcToken;
-      }
-
-      if (CPUStatus != NULL) {
-        mSmmMpSyncData->CpuData[Index].Status = &CPUStatus[Index];
-        if (mSmmMpSyncData->CpuData[Index].Status != NULL) {
-          *mSmmMpSyncData->CpuData[Index].Status = EFI_NOT_READY;
-        }
-      }
+      QueueApProcedure (
+        Index,
+        Procedure,
+        ProcedureArguments,
+        ProcToken,
+        (CPUStatus != NULL) ? &CPUStatus[Index] : NULL
+        );
     } else {
       //
       // PI spec requirement:
@@ -1502,8 +1787,23 @@ SmmStartupThisAp (
   IN OUT  VOID              *ProcArguments OPTIONAL
   )
 {
-  gSmmCpuPrivate->ApWrapperFunc[CpuIndex].Procedure         = Procedure;
-  gSmmCpuPrivate->ApWrapperFunc[CpuIndex].ProcedureArgument = ProcArguments;
+  PROCEDURE_WRAPPER  *Wrapper;
+
+  if (CpuIndex >= gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // Every queue entry has a wrapper of its own, use the one of the entry the
+  // procedure goes to, once the AP is done with it.
+  //
+  while (mSmmMpSyncData->CpuData[CpuIndex].QueueLine.Queue.Pending >= SMM_AP_PROCEDURE_QUEUE_DEPTH) {
+    CpuPause ();
+  }
+
+  Wrapper                    = &gSmmCpuPrivate->ApWrapperFunc[CpuIndex * SMM_AP_PROCEDURE_QUEUE_DEPTH + mSmmMpSyncData->CpuData[CpuIndex].Tail % SMM_AP_PROCEDURE_QUEUE_DEPTH];
+  Wrapper->Procedure         = Procedure;
+  Wrapper->ProcedureArgument = ProcArguments;
 
   //
   // Use wrapper function to convert EFI_AP_PROCEDURE to EFI_AP_PROCEDURE2.
@@ -1511,7 +1811,7 @@ SmmStartupThisAp (
   return InternalSmmStartupThisAp (
            ProcedureWrapper,
            CpuIndex,
-           &gSmmCpuPrivate->ApWrapperFunc[CpuIndex],
+           Wrapper,
            FeaturePcdGet (PcdCpuSmmBlockStartupThisAp) ? NULL : &mSmmStartupThisApToken,
            0,
            NULL
@@ -1630,6 +1930,8 @@ SmiRendezvous (
     return;
   }
 
+  SmiTimelineRecord (CpuIndex, MM_SUPERVISOR_SMI_PHASE_ARRIVAL);
+
   //
   // Call the user register Startup function first.
   //
@@ -1702,9 +2004,15 @@ SmiRendezvous (
       // E.g., with Relaxed AP flow, SmmStartupThisAp() may be called immediately
       // after AP's present flag is detected.
       //
+      ASSERT (mSmmMpSyncData->CpuData[CpuIndex].QueueLine.Queue.Pending == 0);
       InitializeSpinLock (mSmmMpSyncData->CpuData[CpuIndex].Busy);
     }
 
+    //
+    // Demoted handlers and procedures of this SMI share one setup of the syscall MSRs.
+    //
+    BeginSmiCpl0MsrStar (CpuIndex);
+
     // if (FeaturePcdGet (PcdCpuSmmProfileEnable)) {
     //   ActivateSmmProfile (CpuIndex);
     // }
@@ -1788,6 +2096,11 @@ SmiRendezvous (
   }
 
 Exit:
+  //
+  // Give the syscall MSRs back to the OS if demoted calls of this SMI left them programmed.
+  //
+  EndSmiCpl0MsrStar (CpuIndex);
+
   //
   // Note: SmmRendezvousExit perf-logging entry is the only one that will be
   //       migrated to standard perf-logging database in next SMI by BSPHandler().
@@ -1803,6 +2116,8 @@ Exit:
     MpPerfEnd (CpuIndex, SMM_MP_PERF_PROCEDURE_ID (SmmRendezvousExit));
     );
 
+  SmiTimelineRecord (CpuIndex, MM_SUPERVISOR_SMI_PHASE_EXIT);
+
   //
   // Restore Cr2
   //
@@ -1861,16 +2176,21 @@ InitializeDataForMmMp (
 {
   UINTN  Index;
 
-  gSmmCpuPrivate->ApWrapperFunc = AllocatePool (sizeof (PROCEDURE_WRAPPER) * gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus);
+  //
+  // One wrapper per entry of the procedure queue of every CPU
+  //
+  gSmmCpuPrivate->ApWrapperFunc = AllocatePool (sizeof (PROCEDURE_WRAPPER) * gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus * SMM_AP_PROCEDURE_QUEUE_DEPTH);
   ASSERT (gSmmCpuPrivate->ApWrapperFunc != NULL);
 
-  for (Index = 0; Index < gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus; Index++) {
-    gSmmCpuPrivate->ApWrapperFunc[Index].CpuIndex = Index;
+  for (Index = 0; Index < gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus * SMM_AP_PROCEDURE_QUEUE_DEPTH; Index++) {
+    gSmmCpuPrivate->ApWrapperFunc[Index].CpuIndex = Index / SMM_AP_PROCEDURE_QUEUE_DEPTH;
   }
 
-  InitializeListHead (&gSmmCpuPrivate->TokenList);
+  InitializeListHead (&gSmmCpuPrivate->FreeTokenList);
+
+  AllocateTokenBuffer ();
 
-  gSmmCpuPrivate->FirstFreeToken = AllocateTokenBuffer ();
+  InitializeParallelFor (gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus);
 }
 
 /**
@@ -1882,20 +2202,20 @@ InitializeSmmCpuSemaphores (
   VOID
   )
 {
-  UINTN  ProcessorCount;
   UINTN  TotalSize;
   UINTN  GlobalSemaphoresSize;
-  UINTN  CpuSemaphoresSize;
   UINTN  SemaphoreSize;
   UINTN  Pages;
   UINTN  *SemaphoreBlock;
   UINTN  SemaphoreAddr;
 
-  SemaphoreSize        = GetSpinLockProperties ();
-  ProcessorCount       = gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus;
+  SemaphoreSize = GetSpinLockProperties ();
+  //
+  // The per CPU semaphores are laid out with SMM_CPU_SYNC_LINE_SIZE in SMM_CPU_DATA_BLOCK
+  //
+  ASSERT (SemaphoreSize <= SMM_CPU_SYNC_LINE_SIZE);
   GlobalSemaphoresSize = (sizeof (SMM_CPU_SEMAPHORE_GLOBAL) / sizeof (VOID *)) * SemaphoreSize;
-  CpuSemaphoresSize    = (sizeof (SMM_CPU_SEMAPHORE_CPU) / sizeof (VOID *)) * ProcessorCount * SemaphoreSize;
-  TotalSize            = GlobalSemaphoresSize + CpuSemaphoresSize;
+  TotalSize            = GlobalSemaphoresSize;
   DEBUG ((DEBUG_INFO, "One Semaphore Size    = 0x%x\n", SemaphoreSize));
   DEBUG ((DEBUG_INFO, "Total Semaphores Size = 0x%x\n", TotalSize));
   Pages          = EFI_SIZE_TO_PAGES (TotalSize);
@@ -1917,11 +2237,11 @@ InitializeSmmCpuSemaphores (
   mSmmCpuSemaphores.SemaphoreGlobal.CodeAccessCheckLock
                  = (SPIN_LOCK *)SemaphoreAddr;
   SemaphoreAddr += SemaphoreSize;
+  mSmmCpuSemaphores.SemaphoreGlobal.TokenLock
+                 = (SPIN_LOCK *)SemaphoreAddr;
+  SemaphoreAddr += SemaphoreSize;
 
-  SemaphoreAddr                          = (UINTN)SemaphoreBlock + GlobalSemaphoresSize;
-  mSmmCpuSemaphores.SemaphoreCpu.Busy    = (SPIN_LOCK *)SemaphoreAddr;
-  SemaphoreAddr                         += ProcessorCount * SemaphoreSize;
-  mSmmCpuSemaphores.SemaphoreCpu.Present = (BOOLEAN *)SemaphoreAddr;
+  InitializeSpinLock (mSmmCpuSemaphores.SemaphoreGlobal.TokenLock);
 
   mPFLock                       = mSmmCpuSemaphores.SemaphoreGlobal.PFLock;
   mConfigSmmCodeAccessCheckLock = mSmmCpuSemaphores.SemaphoreGlobal.CodeAccessCheckLock;
@@ -1941,15 +2261,16 @@ InitializeMpSyncData (
 {
   RETURN_STATUS  Status;
 
-  UINTN  CpuIndex;
+  UINTN   CpuIndex;
+  UINT32  *CpuPackage;
 
   if (mSmmMpSyncData != NULL) {
     //
     // mSmmMpSyncDataSize includes one structure of SMM_DISPATCHER_MP_SYNC_DATA, one
-    // CpuData array of SMM_CPU_DATA_BLOCK and one CandidateBsp array of BOOLEAN.
+    // line aligned CpuData array of SMM_CPU_DATA_BLOCK and one CandidateBsp array of BOOLEAN.
     //
     ZeroMem (mSmmMpSyncData, mSmmMpSyncDataSize);
-    mSmmMpSyncData->CpuData      = (SMM_CPU_DATA_BLOCK *)((UINT8 *)mSmmMpSyncData + sizeof (SMM_DISPATCHER_MP_SYNC_DATA));
+    mSmmMpSyncData->CpuData      = (SMM_CPU_DATA_BLOCK *)((UINT8 *)mSmmMpSyncData + SMM_MP_SYNC_DATA_CPU_DATA_OFFSET);
     mSmmMpSyncData->CandidateBsp = (BOOLEAN *)(mSmmMpSyncData->CpuData + gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus);
     if (FeaturePcdGet (PcdCpuSmmEnableBspElection)) {
       //
@@ -1979,6 +2300,25 @@ InitializeMpSyncData (
 
     ASSERT (mSmmMpSyncData->SyncContext != NULL);
 
+    //
+    // Let the sync library group the rendezvous by package, it falls back to the flat mode on error
+    //
+    if (FeaturePcdGet (PcdMmSupervisorCpuSyncHierarchical)) {
+      CpuPackage = AllocatePool (gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus * sizeof (UINT32));
+      if (CpuPackage != NULL) {
+        for (CpuIndex = 0; CpuIndex < gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus; CpuIndex++) {
+          CpuPackage[CpuIndex] = gSmmCpuPrivate->ProcessorInfo[CpuIndex].Location.Package;
+        }
+
+        Status = SmmCpuSyncSetPackageLayout (mSmmMpSyncData->SyncContext, CpuPackage);
+        if (EFI_ERROR (Status)) {
+          DEBUG ((DEBUG_WARN, "InitializeMpSyncData: SmmCpuSyncSetPackageLayout return error %r!\n", Status));
+        }
+
+        FreePool (CpuPackage);
+      }
+    }
+
     mSmmMpSyncData->InsideSmm     = mSmmCpuSemaphores.SemaphoreGlobal.InsideSmm;
     mSmmMpSyncData->AllCpusInSync = mSmmCpuSemaphores.SemaphoreGlobal.AllCpusInSync;
     ASSERT (
@@ -1991,10 +2331,8 @@ InitializeMpSyncData (
     mSmmMpSyncData->AllApArrivedWithException = FALSE;
 
     for (CpuIndex = 0; CpuIndex < gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus; CpuIndex++) {
-      mSmmMpSyncData->CpuData[CpuIndex].Busy =
-        (SPIN_LOCK *)((UINTN)mSmmCpuSemaphores.SemaphoreCpu.Busy + mSemaphoreSize * CpuIndex);
-      mSmmMpSyncData->CpuData[CpuIndex].Present =
-        (BOOLEAN *)((UINTN)mSmmCpuSemaphores.SemaphoreCpu.Present + mSemaphoreSize * CpuIndex);
+      mSmmMpSyncData->CpuData[CpuIndex].Busy    = &mSmmMpSyncData->CpuData[CpuIndex].BusyLine.Lock;
+      mSmmMpSyncData->CpuData[CpuIndex].Present = &mSmmMpSyncData->CpuData[CpuIndex].PresentLine.Flag;
       *(mSmmMpSyncData->CpuData[CpuIndex].Busy)    = 0;
       *(mSmmMpSyncData->CpuData[CpuIndex].Present) = FALSE;
     }
@@ -2038,7 +2376,7 @@ InitializeMpServiceData (
   //
   // Initialize mSmmMpSyncData
   //
-  mSmmMpSyncDataSize = sizeof (SMM_DISPATCHER_MP_SYNC_DATA) +
+  mSmmMpSyncDataSize = SMM_MP_SYNC_DATA_CPU_DATA_OFFSET +
                        (sizeof (SMM_CPU_DATA_BLOCK) + sizeof (BOOLEAN)) * gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus;
   mSmmMpSyncData = (SMM_DISPATCHER_MP_SYNC_DATA *)AllocatePages (EFI_SIZE_TO_PAGES (mSmmMpSyncDataSize));
   ASSERT (mSmmMpSyncData != NULL);
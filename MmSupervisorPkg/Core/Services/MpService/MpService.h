@@ -16,6 +16,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include <Library/SynchronizationLib.h>
 #include <Library/SmmCpuSyncLib.h>
+#include <Library/SmmCpuSyncTopologyLib.h>
+#include <Library/SmmCpuSyncWaitLib.h>
 
 #define INVALID_APIC_ID  0xFFFFFFFFFFFFFFFFULL
 
@@ -36,10 +38,27 @@ typedef struct {
 
   SPIN_LOCK          *SpinLock;
   volatile UINT32    RunningApCount;
+  //
+  // Index of the token in TokenTable, and generation bumped each time the token is handed out.
+  //
+  UINT32             Index;
+  UINTN              Generation;
 } PROCEDURE_TOKEN;
 
 #define PROCEDURE_TOKEN_FROM_LINK(a)  CR (a, PROCEDURE_TOKEN, Link, PROCEDURE_TOKEN_SIGNATURE)
 
+//
+// The MM_COMPLETION handed out for a token holds its index in TokenTable plus one in the
+// low bits and its generation above them. A handle is checked without walking the tokens,
+// and the handle of a token that has since been recycled no longer matches its generation.
+//
+#define PROCEDURE_TOKEN_INDEX_BITS       16
+#define PROCEDURE_TOKEN_MAX_COUNT        ((1 << PROCEDURE_TOKEN_INDEX_BITS) - 1)
+#define PROCEDURE_TOKEN_GENERATION_MASK  (MAX_UINTN >> PROCEDURE_TOKEN_INDEX_BITS)
+
+#define PROCEDURE_TOKEN_HANDLE(Token) \
+  ((MM_COMPLETION)(((Token)->Generation << PROCEDURE_TOKEN_INDEX_BITS) | ((UINTN)(Token)->Index + 1)))
+
 //
 // Private structure for the SMM CPU module that is stored in DXE Runtime memory
 // Contains the SMM Configuration Protocols that is produced.
@@ -64,22 +83,77 @@ typedef struct {
   EFI_SMM_CONFIGURATION_PROTOCOL    SmmConfiguration;
 
   PROCEDURE_WRAPPER                 *ApWrapperFunc;
-  LIST_ENTRY                        TokenList;
-  LIST_ENTRY                        *FirstFreeToken;
+  LIST_ENTRY                        FreeTokenList;
+  PROCEDURE_TOKEN                   **TokenTable;
+  UINTN                             TokenCount;
 } SMM_CPU_PRIVATE_DATA;
 
 extern SMM_CPU_PRIVATE_DATA  *gSmmCpuPrivate;
 
+///
+/// Size of the lines the per CPU synchronization data is padded to. It must not be
+/// smaller than the semaphore size returned by GetSpinLockProperties().
+///
+#define SMM_CPU_SYNC_LINE_SIZE  64
+
+///
+/// One line of the per CPU synchronization data, holding a single semaphore.
+///
+typedef union {
+  SPIN_LOCK           Lock;
+  volatile BOOLEAN    Flag;
+  UINT8               Line[SMM_CPU_SYNC_LINE_SIZE];
+} SMM_CPU_SYNC_LINE;
+
+///
+/// Number of procedures the BSP can queue on one AP, must be a power of two.
+///
+#define SMM_AP_PROCEDURE_QUEUE_DEPTH  8
+
+///
+/// A procedure queued on an AP.
+///
+typedef struct {
+  EFI_AP_PROCEDURE2    Procedure;
+  VOID                 *Parameter;
+  PROCEDURE_TOKEN      *Token;
+  EFI_STATUS           *Status;
+} SMM_AP_PROCEDURE;
+
+///
+/// The line of the procedure queue of an AP written by the AP. Pending counts
+/// the procedures queued and not completed yet, Head is the next one to run.
+///
+typedef union {
+  struct {
+    volatile UINT32    Pending;
+    UINT32             Head;
+  }        Queue;
+  UINT8    Line[SMM_CPU_SYNC_LINE_SIZE];
+} SMM_CPU_QUEUE_LINE;
+
 ///
 /// The type of SMM CPU Information
 ///
+/// The block of each CPU is contiguous and made of whole lines. The first line holds
+/// the fields only written by the BSP, the Busy lock and the Present flag that are spun
+/// on or written during the rendezvous have a line of their own after it. Busy and
+/// Present point to them.
+///
+/// Procedures are queued on an AP in a single producer single consumer ring: the BSP
+/// fills the entry at Tail and the AP runs the one at Head, both only count up. Busy
+/// is held from the time a procedure is queued on an idle AP to the time the AP
+/// completes the last procedure queued.
+///
 typedef struct {
-  SPIN_LOCK                     *Busy;
-  volatile EFI_AP_PROCEDURE2    Procedure;
-  volatile VOID                 *Parameter;
-  volatile BOOLEAN              *Present;
-  PROCEDURE_TOKEN               *Token;
-  EFI_STATUS                    *Status;
+  SPIN_LOCK             *Busy;
+  volatile BOOLEAN      *Present;
+  UINT32                Tail;
+  UINT8                 Reserved[SMM_CPU_SYNC_LINE_SIZE - 2 * sizeof (VOID *) - sizeof (UINT32)];
+  SMM_CPU_SYNC_LINE     BusyLine;
+  SMM_CPU_SYNC_LINE     PresentLine;
+  SMM_CPU_QUEUE_LINE    QueueLine;
+  SMM_AP_PROCEDURE      Queue[SMM_AP_PROCEDURE_QUEUE_DEPTH];
 } SMM_CPU_DATA_BLOCK;
 
 typedef enum {
@@ -90,8 +164,11 @@ typedef enum {
 
 typedef struct {
   //
-  // Pointer to an array. The array should be located immediately after this structure
-  // so that UC cache-ability can be set together.
+  // Pointer to an array of one block per CPU, in the same allocation as this structure
+  // so that UC cache-ability can be set together. The array starts on the first line
+  // boundary after this structure, SMM_MP_SYNC_DATA_CPU_DATA_OFFSET bytes from its start,
+  // so that no block shares a line with the fields below or with another block. The
+  // CandidateBsp array follows the last block.
   //
   SMM_CPU_DATA_BLOCK            *CpuData;
   volatile UINT32               BspIndex;
@@ -101,11 +178,18 @@ typedef struct {
   volatile BOOLEAN              SwitchBsp;
   volatile BOOLEAN              *CandidateBsp;
   volatile BOOLEAN              AllApArrivedWithException;
+  volatile BOOLEAN              ApProcedureQueued;
   EFI_AP_PROCEDURE              StartupProcedure;
   VOID                          *StartupProcArgs;
   SMM_CPU_SYNC_CONTEXT          *SyncContext;
 } SMM_DISPATCHER_MP_SYNC_DATA;
 
+///
+/// Offset of the CpuData array from the start of the SMM_DISPATCHER_MP_SYNC_DATA
+/// allocation, so that no CPU block shares a line with the common fields.
+///
+#define SMM_MP_SYNC_DATA_CPU_DATA_OFFSET  ALIGN_VALUE (sizeof (SMM_DISPATCHER_MP_SYNC_DATA), SMM_CPU_SYNC_LINE_SIZE)
+
 extern SMM_DISPATCHER_MP_SYNC_DATA  *mSmmMpSyncData;
 extern UINT64                       gPhyMask;
 
@@ -239,4 +323,28 @@ SmmWaitForApArrival (
   VOID
   );
 
+/**
+  Get the free token.
+
+  @param RunningApsCount    The Running Aps count for this token.
+
+  @retval    return the first free PROCEDURE_TOKEN, NULL if no token could be allocated.
+
+**/
+PROCEDURE_TOKEN *
+GetFreeToken (
+  IN UINT32  RunningApsCount
+  );
+
+/**
+  Clean up the status flags used during executing the procedure.
+
+  @param   Token         The token of the procedure completed by the calling AP.
+
+**/
+VOID
+ReleaseToken (
+  IN PROCEDURE_TOKEN  *Token
+  );
+
 #endif //_MM_CORE_MP_H_
@@ -0,0 +1,255 @@
+/** @file
+  Parallel for on top of the broadcast of a procedure to all APs.
+
+  One parallel for runs at a time, it takes all present APs the same way
+  InternalSmmStartupAllAPs does. In non-blocking mode it completes through a
+  token of its own, released by the last AP to run out of chunks.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include "MmSupervisorCore.h"
+#include "Services/CpuService/CpuService.h"
+#include "Services/MpService/MpService.h"
+#include "Services/MpService/ParallelFor.h"
+#include "Relocate/Relocate.h"
+#include "PrivilegeMgmt/PrivilegeMgmt.h"
+
+typedef struct {
+  PARALLEL_FOR_SCHEDULE        Schedule;
+  MM_PARALLEL_FOR_PROCEDURE    Procedure;
+  VOID                         *Context;
+  MM_PARALLEL_FOR_CHUNK        *Chunks;
+  EFI_STATUS                   Status;
+  PROCEDURE_TOKEN              *Token;
+  MM_COMPLETION                Completion;
+} PARALLEL_FOR_STATE;
+
+PARALLEL_FOR_STATE  mParallelFor;
+PARALLEL_FOR_SLOT   *mParallelForSlots   = NULL;
+BOOLEAN             *mParallelForWorkers = NULL;
+
+/**
+  Allocate the slots of the parallel for.
+
+  @param[in]  NumberOfCpus    Total number of CPUs need to be supported.
+**/
+VOID
+InitializeParallelFor (
+  IN UINTN  NumberOfCpus
+  )
+{
+  mParallelForSlots = AllocateAlignedPages (EFI_SIZE_TO_PAGES (sizeof (PARALLEL_FOR_SLOT) * NumberOfCpus), PARALLEL_FOR_SLOT_SIZE);
+  ASSERT (mParallelForSlots != NULL);
+
+  mParallelForWorkers = AllocateZeroPool (sizeof (BOOLEAN) * NumberOfCpus);
+  ASSERT (mParallelForWorkers != NULL);
+}
+
+/**
+  The procedure broadcast to the APs by InternalSmmParallelFor, claiming and
+  running chunks in CPL 3 until none are left. The last AP to retire releases
+  the token of a non-blocking parallel for.
+
+  @param[in]  Buffer    The state of the parallel for.
+
+  @return EFI_SUCCESS, or the last error returned by the procedure for a chunk.
+**/
+EFI_STATUS
+EFIAPI
+ParallelForWorker (
+  IN VOID  *Buffer
+  )
+{
+  PARALLEL_FOR_STATE     *State;
+  MM_PARALLEL_FOR_CHUNK  Chunk;
+  EFI_STATUS             Status;
+  EFI_STATUS             ChunkStatus;
+
+  State  = Buffer;
+  Status = SmmWhoAmI (NULL, &Chunk.CpuIndex);
+  if (EFI_ERROR (Status)) {
+    ASSERT (FALSE);
+    goto Done;
+  }
+
+  Chunk.Context = State->Context;
+  while (ParallelForClaimChunk (&State->Schedule, (UINT32)Chunk.CpuIndex, &Chunk.Start, &Chunk.End)) {
+    CopyMem (&State->Chunks[Chunk.CpuIndex], &Chunk, sizeof (Chunk));
+    ChunkStatus = InvokeDemotedApProcedure (
+                    Chunk.CpuIndex,
+                    (EFI_AP_PROCEDURE2)State->Procedure,
+                    &State->Chunks[Chunk.CpuIndex]
+                    );
+
+    if (EFI_ERROR (ChunkStatus)) {
+      DEBUG ((DEBUG_ERROR, "%a Chunk [0x%lx, 0x%lx) on CPU %d failed - %r\n", __FUNCTION__, (UINT64)Chunk.Start, (UINT64)Chunk.End, Chunk.CpuIndex, ChunkStatus));
+      Status        = ChunkStatus;
+      State->Status = ChunkStatus;
+    }
+  }
+
+Done:
+  if (ParallelForRetireWorker (&State->Schedule) && (State->Token != NULL)) {
+    ReleaseToken (State->Token);
+  }
+
+  return Status;
+}
+
+/**
+  Run the user procedure Procedure on the chunks of [Start, End) on all present
+  APs. The BSP does not take chunks, CPL 3 cannot be entered again from the
+  syscall of the request.
+
+  @param[in]      Procedure     The user procedure to run on every chunk.
+  @param[in]      Start         The first item of the range.
+  @param[in]      End           One past the last item of the range.
+  @param[in]      ChunkSize     The number of items of a chunk.
+  @param[in]      Context       Passed to Procedure in every chunk.
+  @param[in]      Chunks        Procedure gets the chunk of processor N in Chunks[N].
+  @param[out]     Token         If NULL the call returns when all chunks are
+                                processed, otherwise it returns at once and the
+                                token completes when the last AP retires.
+
+  @retval EFI_SUCCESS             All chunks are processed, or dispatched in non-blocking mode.
+  @retval EFI_INVALID_PARAMETER   Procedure or Chunks is NULL, the range is empty, or ChunkSize is 0.
+  @retval EFI_NOT_READY           A parallel for or other procedure is still running.
+  @retval EFI_NOT_STARTED         No AP is available to run the chunks.
+  @retval EFI_OUT_OF_RESOURCES    No token is available for a non-blocking call.
+  @retval Others                  The error returned by Procedure for a chunk.
+**/
+EFI_STATUS
+InternalSmmParallelFor (
+  IN     MM_PARALLEL_FOR_PROCEDURE  Procedure,
+  IN     UINTN                      Start,
+  IN     UINTN                      End,
+  IN     UINTN                      ChunkSize,
+  IN     VOID                       *Context  OPTIONAL,
+  IN     MM_PARALLEL_FOR_CHUNK      *Chunks,
+  OUT    MM_COMPLETION              *Token    OPTIONAL
+  )
+{
+  EFI_STATUS       Status;
+  MM_COMPLETION    ApToken;
+  PROCEDURE_TOKEN  *ProcToken;
+  UINTN            ApCount;
+  UINTN            Index;
+
+  if ((Procedure == NULL) || (Chunks == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((mParallelForSlots == NULL) || (mParallelFor.Schedule.ActiveWorkers != 0)) {
+    return EFI_NOT_READY;
+  }
+
+  ApCount = 0;
+  for (Index = 0; Index < mMaxNumberOfCpus; Index++) {
+    mParallelForWorkers[Index] = IsPresentAp (Index);
+    if (mParallelForWorkers[Index]) {
+      ApCount++;
+    }
+  }
+
+  if (ApCount == 0) {
+    return EFI_NOT_STARTED;
+  }
+
+  Status = ParallelForScheduleInit (
+             &mParallelFor.Schedule,
+             mParallelForSlots,
+             (UINT32)mMaxNumberOfCpus,
+             mParallelForWorkers,
+             Start,
+             End,
+             ChunkSize
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  ProcToken = NULL;
+  if (Token != NULL) {
+    ProcToken = GetFreeToken (1);
+    if (ProcToken == NULL) {
+      mParallelFor.Schedule.ActiveWorkers = 0;
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  mParallelFor.Procedure  = Procedure;
+  mParallelFor.Context    = Context;
+  mParallelFor.Chunks     = Chunks;
+  mParallelFor.Status     = EFI_SUCCESS;
+  mParallelFor.Token      = ProcToken;
+  mParallelFor.Completion = (ProcToken == NULL) ? NULL : PROCEDURE_TOKEN_HANDLE (ProcToken);
+
+  //
+  // The broadcast is only waited for in blocking mode, a non-blocking caller
+  // waits for the token of the parallel for instead.
+  //
+  Status = InternalSmmStartupAllAPs (
+             ParallelForWorker,
+             0,
+             &mParallelFor,
+             (Token != NULL) ? &ApToken : NULL,
+             NULL
+             );
+  if (EFI_ERROR (Status)) {
+    mParallelFor.Schedule.ActiveWorkers = 0;
+    mParallelFor.Completion             = NULL;
+    if (ProcToken != NULL) {
+      ReleaseToken (ProcToken);
+    }
+
+    return Status;
+  }
+
+  if (Token != NULL) {
+    *Token = mParallelFor.Completion;
+    return EFI_SUCCESS;
+  }
+
+  DEBUG ((DEBUG_VERBOSE, "%a %d chunks, %d steals - %r\n", __FUNCTION__, mParallelFor.Schedule.ChunkCount, mParallelFor.Schedule.Steals, mParallelFor.Status));
+  return mParallelFor.Status;
+}
+
+/**
+  Check on a parallel for started in non-blocking mode.
+
+  @param[in]  Token   The token returned by InternalSmmParallelFor.
+
+  @retval EFI_NOT_READY           Chunks are still being processed.
+  @retval EFI_NOT_FOUND           Token is not the one of the last parallel for.
+  @retval EFI_SUCCESS             All chunks are processed.
+  @retval Others                  The error returned by Procedure for a chunk.
+**/
+EFI_STATUS
+InternalSmmCheckParallelFor (
+  IN MM_COMPLETION  Token
+  )
+{
+  EFI_STATUS  Status;
+
+  if ((Token == NULL) || (Token != mParallelFor.Completion)) {
+    return EFI_NOT_FOUND;
+  }
+
+  Status = IsApReady (Token);
+  if (Status != EFI_SUCCESS) {
+    return Status;
+  }
+
+  return mParallelFor.Status;
+}
@@ -0,0 +1,183 @@
+/** @file
+  Parallel for on top of the broadcast of a procedure to all APs.
+
+  The range of a parallel for is cut into chunks. Every processor owns a
+  contiguous run of chunks, kept as a packed [Next, End) pair that the owner
+  takes from the front and other processors steal half of from the back once
+  their own run is done. A processor retires once no chunk is left to claim,
+  the last one to retire completes the parallel for.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MM_CORE_PARALLEL_FOR_H_
+#define _MM_CORE_PARALLEL_FOR_H_
+
+#include <Protocol/MmParallelFor.h>
+
+#define PARALLEL_FOR_SLOT_SIZE  64
+
+//
+// The run of chunks of one processor, Next in bits 0..31 and End in bits 32..63.
+//
+#define PARALLEL_FOR_RANGE(Next, End)   (LShiftU64 ((End), 32) | (Next))
+#define PARALLEL_FOR_RANGE_NEXT(Range)  ((UINT32)(Range))
+#define PARALLEL_FOR_RANGE_END(Range)   ((UINT32)RShiftU64 ((Range), 32))
+
+//
+// Runs of different processors are kept on different cache lines.
+//
+typedef union {
+  volatile UINT64    Range;
+  UINT8              Line[PARALLEL_FOR_SLOT_SIZE];
+} PARALLEL_FOR_SLOT;
+
+typedef struct {
+  UINTN                Start;
+  UINTN                End;
+  UINTN                ChunkSize;
+  UINT32               ChunkCount;
+  UINT32               SlotCount;
+  PARALLEL_FOR_SLOT    *Slots;
+  volatile UINT32      Steals;
+  volatile UINT32      ActiveWorkers;
+} PARALLEL_FOR_SCHEDULE;
+
+/**
+  Cut the range [Start, End) into chunks of ChunkSize items, and give every
+  participating slot an even share of them. All participating slots start
+  active.
+
+  @param[out] Schedule        The schedule to initialize.
+  @param[in]  Slots           SlotCount slots, one per processor.
+  @param[in]  SlotCount       The number of slots.
+  @param[in]  Participating   Which slots take part, all of them if NULL.
+  @param[in]  Start           The first item of the range.
+  @param[in]  End             One past the last item of the range.
+  @param[in]  ChunkSize       The number of items of a chunk.
+
+  @retval EFI_SUCCESS             The chunks are distributed.
+  @retval EFI_INVALID_PARAMETER   The range is empty, ChunkSize is 0, there are
+                                  more than MAX_UINT32 chunks, or no slot takes part.
+**/
+EFI_STATUS
+ParallelForScheduleInit (
+  OUT PARALLEL_FOR_SCHEDULE  *Schedule,
+  IN  PARALLEL_FOR_SLOT      *Slots,
+  IN  UINT32                 SlotCount,
+  IN  CONST BOOLEAN          *Participating OPTIONAL,
+  IN  UINTN                  Start,
+  IN  UINTN                  End,
+  IN  UINTN                  ChunkSize
+  );
+
+/**
+  Claim the next chunk for a slot, from its own run first and then by stealing
+  the upper half of the largest run left to another slot.
+
+  @param[in, out] Schedule      The schedule to claim from.
+  @param[in]      SlotIndex     The slot of the executing processor.
+  @param[out]     ChunkStart    The first item of the chunk.
+  @param[out]     ChunkEnd      One past the last item of the chunk.
+
+  @retval TRUE    A chunk is claimed.
+  @retval FALSE   All chunks are claimed.
+**/
+BOOLEAN
+ParallelForClaimChunk (
+  IN OUT PARALLEL_FOR_SCHEDULE  *Schedule,
+  IN     UINT32                 SlotIndex,
+  OUT    UINTN                  *ChunkStart,
+  OUT    UINTN                  *ChunkEnd
+  );
+
+/**
+  Retire a slot that ran out of chunks. A slot whose chunks are all processed
+  may only retire once, and only after ParallelForClaimChunk returned FALSE.
+
+  @param[in, out] Schedule      The schedule of the slot.
+
+  @retval TRUE    The caller retired last, all chunks are processed.
+  @retval FALSE   Other slots may still be processing chunks.
+**/
+BOOLEAN
+ParallelForRetireWorker (
+  IN OUT PARALLEL_FOR_SCHEDULE  *Schedule
+  );
+
+/**
+  Allocate the slots of the parallel for.
+
+  @param[in]  NumberOfCpus    Total number of CPUs need to be supported.
+**/
+VOID
+InitializeParallelFor (
+  IN UINTN  NumberOfCpus
+  );
+
+/**
+  The procedure broadcast to the APs by InternalSmmParallelFor, claiming and
+  running chunks until none are left.
+
+  @param[in]  Buffer    The state of the parallel for.
+
+  @return EFI_SUCCESS, or the last error returned by the procedure for a chunk.
+**/
+EFI_STATUS
+EFIAPI
+ParallelForWorker (
+  IN VOID  *Buffer
+  );
+
+/**
+  Run the user procedure Procedure on the chunks of [Start, End) on all present
+  APs. The BSP does not take chunks, CPL 3 cannot be entered again from the
+  syscall of the request.
+
+  @param[in]      Procedure     The user procedure to run on every chunk.
+  @param[in]      Start         The first item of the range.
+  @param[in]      End           One past the last item of the range.
+  @param[in]      ChunkSize     The number of items of a chunk.
+  @param[in]      Context       Passed to Procedure in every chunk.
+  @param[in]      Chunks        Procedure gets the chunk of processor N in Chunks[N].
+  @param[out]     Token         If NULL the call returns when all chunks are
+                                processed, otherwise it returns at once and the
+                                token completes when the last AP retires.
+
+  @retval EFI_SUCCESS             All chunks are processed, or dispatched in non-blocking mode.
+  @retval EFI_INVALID_PARAMETER   Procedure or Chunks is NULL, the range is empty, or ChunkSize is 0.
+  @retval EFI_NOT_READY           A parallel for or other procedure is still running.
+  @retval EFI_NOT_STARTED         No AP is available to run the chunks.
+  @retval EFI_OUT_OF_RESOURCES    No token is available for a non-blocking call.
+  @retval Others                  The error returned by Procedure for a chunk.
+**/
+EFI_STATUS
+InternalSmmParallelFor (
+  IN     MM_PARALLEL_FOR_PROCEDURE  Procedure,
+  IN     UINTN                      Start,
+  IN     UINTN                      End,
+  IN     UINTN                      ChunkSize,
+  IN     VOID                       *Context  OPTIONAL,
+  IN     MM_PARALLEL_FOR_CHUNK      *Chunks,
+  OUT    MM_COMPLETION              *Token    OPTIONAL
+  );
+
+/**
+  Check on a parallel for started in non-blocking mode.
+
+  @param[in]  Token   The token returned by InternalSmmParallelFor.
+
+  @retval EFI_NOT_READY           Chunks are still being processed.
+  @retval EFI_NOT_FOUND           Token is not the one of the last parallel for.
+  @retval EFI_SUCCESS             All chunks are processed.
+  @retval Others                  The error returned by Procedure for a chunk.
+**/
+EFI_STATUS
+InternalSmmCheckParallelFor (
+  IN MM_COMPLETION  Token
+  );
+
+#endif //_MM_CORE_PARALLEL_FOR_H_
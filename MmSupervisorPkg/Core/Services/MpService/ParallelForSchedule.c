@@ -0,0 +1,232 @@
+/** @file
+  Chunk scheduler of the parallel for.
+
+  Claims only touch the run of one processor with a single compare exchange,
+  so processors that keep to their own run never write to a shared line.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiMm.h>
+
+#include <Library/BaseLib.h>
+#include <Library/SynchronizationLib.h>
+
+#include "ParallelFor.h"
+
+/**
+  Cut the range [Start, End) into chunks of ChunkSize items, and give every
+  participating slot an even share of them. All participating slots start
+  active.
+
+  @param[out] Schedule        The schedule to initialize.
+  @param[in]  Slots           SlotCount slots, one per processor.
+  @param[in]  SlotCount       The number of slots.
+  @param[in]  Participating   Which slots take part, all of them if NULL.
+  @param[in]  Start           The first item of the range.
+  @param[in]  End             One past the last item of the range.
+  @param[in]  ChunkSize       The number of items of a chunk.
+
+  @retval EFI_SUCCESS             The chunks are distributed.
+  @retval EFI_INVALID_PARAMETER   The range is empty, ChunkSize is 0, there are
+                                  more than MAX_UINT32 chunks, or no slot takes part.
+**/
+EFI_STATUS
+ParallelForScheduleInit (
+  OUT PARALLEL_FOR_SCHEDULE  *Schedule,
+  IN  PARALLEL_FOR_SLOT      *Slots,
+  IN  UINT32                 SlotCount,
+  IN  CONST BOOLEAN          *Participating OPTIONAL,
+  IN  UINTN                  Start,
+  IN  UINTN                  End,
+  IN  UINTN                  ChunkSize
+  )
+{
+  UINTN   ChunkCount;
+  UINT32  Workers;
+  UINT32  Worker;
+  UINT32  Share;
+  UINT32  Next;
+  UINT32  Index;
+
+  if ((Schedule == NULL) || (Slots == NULL) || (SlotCount == 0) || (Start >= End) || (ChunkSize == 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ChunkCount = (End - Start) / ChunkSize;
+  if ((End - Start) % ChunkSize != 0) {
+    ChunkCount++;
+  }
+
+  if (ChunkCount > MAX_UINT32) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Workers = 0;
+  for (Index = 0; Index < SlotCount; Index++) {
+    if ((Participating == NULL) || Participating[Index]) {
+      Workers++;
+    }
+  }
+
+  if (Workers == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Schedule->Start      = Start;
+  Schedule->End        = End;
+  Schedule->ChunkSize  = ChunkSize;
+  Schedule->ChunkCount = (UINT32)ChunkCount;
+  Schedule->SlotCount  = SlotCount;
+  Schedule->Slots      = Slots;
+  Schedule->Steals     = 0;
+
+  Schedule->ActiveWorkers = Workers;
+
+  // The first ChunkCount % Workers participants take one more chunk than the others
+  Next   = 0;
+  Worker = 0;
+  for (Index = 0; Index < SlotCount; Index++) {
+    if ((Participating != NULL) && !Participating[Index]) {
+      Slots[Index].Range = PARALLEL_FOR_RANGE (0, 0);
+      continue;
+    }
+
+    Share = Schedule->ChunkCount / Workers;
+    if (Worker < Schedule->ChunkCount % Workers) {
+      Share++;
+    }
+
+    Slots[Index].Range = PARALLEL_FOR_RANGE (Next, Next + Share);
+    Next              += Share;
+    Worker++;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Claim the next chunk for a slot, from its own run first and then by stealing
+  the upper half of the largest run left to another slot.
+
+  @param[in, out] Schedule      The schedule to claim from.
+  @param[in]      SlotIndex     The slot of the executing processor.
+  @param[out]     ChunkStart    The first item of the chunk.
+  @param[out]     ChunkEnd      One past the last item of the chunk.
+
+  @retval TRUE    A chunk is claimed.
+  @retval FALSE   All chunks are claimed.
+**/
+BOOLEAN
+ParallelForClaimChunk (
+  IN OUT PARALLEL_FOR_SCHEDULE  *Schedule,
+  IN     UINT32                 SlotIndex,
+  OUT    UINTN                  *ChunkStart,
+  OUT    UINTN                  *ChunkEnd
+  )
+{
+  PARALLEL_FOR_SLOT  *Own;
+  PARALLEL_FOR_SLOT  *Victim;
+  UINT64             Range;
+  UINT64             Original;
+  UINT32             Next;
+  UINT32             End;
+  UINT32             Middle;
+  UINT32             Largest;
+  UINT32             Index;
+  UINT32             Chunk;
+
+  if (SlotIndex >= Schedule->SlotCount) {
+    return FALSE;
+  }
+
+  Own   = &Schedule->Slots[SlotIndex];
+  Range = Own->Range;
+  while (PARALLEL_FOR_RANGE_NEXT (Range) < PARALLEL_FOR_RANGE_END (Range)) {
+    Next     = PARALLEL_FOR_RANGE_NEXT (Range);
+    Original = InterlockedCompareExchange64 (&Own->Range, Range, PARALLEL_FOR_RANGE (Next + 1, PARALLEL_FOR_RANGE_END (Range)));
+    if (Original == Range) {
+      Chunk = Next;
+      goto Claimed;
+    }
+
+    Range = Original;
+  }
+
+  while (TRUE) {
+    Victim  = NULL;
+    Largest = 0;
+    for (Index = 0; Index < Schedule->SlotCount; Index++) {
+      Range = Schedule->Slots[Index].Range;
+      if ((Index != SlotIndex) &&
+          (PARALLEL_FOR_RANGE_END (Range) - PARALLEL_FOR_RANGE_NEXT (Range) > Largest) &&
+          (PARALLEL_FOR_RANGE_NEXT (Range) < PARALLEL_FOR_RANGE_END (Range)))
+      {
+        Victim  = &Schedule->Slots[Index];
+        Largest = PARALLEL_FOR_RANGE_END (Range) - PARALLEL_FOR_RANGE_NEXT (Range);
+      }
+    }
+
+    if (Victim == NULL) {
+      // Chunks stolen by others and not yet published are run by their thieves
+      return FALSE;
+    }
+
+    Range = Victim->Range;
+    Next  = PARALLEL_FOR_RANGE_NEXT (Range);
+    End   = PARALLEL_FOR_RANGE_END (Range);
+    if (Next >= End) {
+      continue;
+    }
+
+    // The victim keeps [Next, Middle), a single chunk left is taken whole
+    Middle = Next + (End - Next) / 2;
+    if (InterlockedCompareExchange64 (&Victim->Range, Range, PARALLEL_FOR_RANGE (Next, Middle)) != Range) {
+      continue;
+    }
+
+    InterlockedIncrement (&Schedule->Steals);
+    Chunk = Middle;
+
+    //
+    // Only the owner writes an empty run, others only exchange runs that still
+    // hold chunks, so the rest of the stolen half can be published directly.
+    //
+    Own->Range = PARALLEL_FOR_RANGE (Middle + 1, End);
+    break;
+  }
+
+Claimed:
+  *ChunkStart = Schedule->Start + (UINTN)Chunk * Schedule->ChunkSize;
+  if (Schedule->End - *ChunkStart > Schedule->ChunkSize) {
+    *ChunkEnd = *ChunkStart + Schedule->ChunkSize;
+  } else {
+    *ChunkEnd = Schedule->End;
+  }
+
+  return TRUE;
+}
+
+/**
+  Retire a slot that ran out of chunks. A slot whose chunks are all processed
+  may only retire once, and only after ParallelForClaimChunk returned FALSE.
+
+  A slot only runs out of chunks once no run holds any, and every chunk
+  stolen but not published yet is run by its thief before the thief retires,
+  so the last slot to retire also saw the last chunk complete.
+
+  @param[in, out] Schedule      The schedule of the slot.
+
+  @retval TRUE    The caller retired last, all chunks are processed.
+  @retval FALSE   Other slots may still be processing chunks.
+**/
+BOOLEAN
+ParallelForRetireWorker (
+  IN OUT PARALLEL_FOR_SCHEDULE  *Schedule
+  )
+{
+  return (BOOLEAN)(InterlockedDecrement (&Schedule->ActiveWorkers) == 0);
+}
@@ -294,11 +294,11 @@ SmmMpCheckForProcedure (
     return EFI_INVALID_PARAMETER;
   }
 
-  if (!IsTokenInUse ((SPIN_LOCK *)Token)) {
+  if (!IsTokenInUse (Token)) {
     return EFI_NOT_FOUND;
   }
 
-  return IsApReady ((SPIN_LOCK *)Token);
+  return IsApReady (Token);
 }
 
 /**
@@ -0,0 +1,238 @@
+/** @file
+  Unit tests of the layout of the per CPU synchronization data
+
+  The blocks of SMM_CPU_DATA_BLOCK are built the way InitializeMpServiceData and
+  InitializeMpSyncData do, then every line an AP spins on or writes during the
+  rendezvous is checked to belong to that AP alone.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <PiMm.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../MpService.h"
+
+#define UNIT_TEST_APP_NAME     "MP Sync Data Layout Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+//
+// Lines of one CPU block ahead of the procedure queue: the BSP line, the Busy line,
+// the Present line and the queue line of the AP
+//
+#define TEST_LINES_PER_CPU  4
+
+typedef struct {
+  UINTN    NumberOfCpus;
+} TEST_CONTEXT_LAYOUT;
+
+/**
+  Every field of the CPU block should start a line of its own, with the
+  fields written by the BSP together on the first one and the procedure
+  queue last.
+
+  @param[in]  Context   Unused.
+
+  @retval UNIT_TEST_PASSED              The structure is padded as expected.
+  @retval UNIT_TEST_ERROR_TEST_FAILED   A field shares a line with another one.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CpuDataBlockIsPadded (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UT_ASSERT_EQUAL (sizeof (SMM_CPU_SYNC_LINE), SMM_CPU_SYNC_LINE_SIZE);
+  UT_ASSERT_EQUAL (sizeof (SMM_CPU_QUEUE_LINE), SMM_CPU_SYNC_LINE_SIZE);
+  UT_ASSERT_EQUAL (sizeof (SMM_CPU_DATA_BLOCK) % SMM_CPU_SYNC_LINE_SIZE, 0);
+
+  UT_ASSERT_TRUE (OFFSET_OF (SMM_CPU_DATA_BLOCK, Tail) + sizeof (UINT32) <= SMM_CPU_SYNC_LINE_SIZE);
+  UT_ASSERT_EQUAL (OFFSET_OF (SMM_CPU_DATA_BLOCK, BusyLine), SMM_CPU_SYNC_LINE_SIZE);
+  UT_ASSERT_EQUAL (OFFSET_OF (SMM_CPU_DATA_BLOCK, PresentLine), 2 * SMM_CPU_SYNC_LINE_SIZE);
+  UT_ASSERT_EQUAL (OFFSET_OF (SMM_CPU_DATA_BLOCK, QueueLine), 3 * SMM_CPU_SYNC_LINE_SIZE);
+  UT_ASSERT_EQUAL (OFFSET_OF (SMM_CPU_DATA_BLOCK, Queue), TEST_LINES_PER_CPU * SMM_CPU_SYNC_LINE_SIZE);
+
+  // The queue indexes only count up and wrap around
+  UT_ASSERT_EQUAL (SMM_AP_PROCEDURE_QUEUE_DEPTH & (SMM_AP_PROCEDURE_QUEUE_DEPTH - 1), 0);
+
+  UT_ASSERT_EQUAL (SMM_MP_SYNC_DATA_CPU_DATA_OFFSET % SMM_CPU_SYNC_LINE_SIZE, 0);
+  UT_ASSERT_TRUE (SMM_MP_SYNC_DATA_CPU_DATA_OFFSET >= sizeof (SMM_DISPATCHER_MP_SYNC_DATA));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Lay out the synchronization data of a number of CPUs like the core does, and
+  check that the lines of each CPU are contiguous and not shared with another
+  CPU or with the common fields.
+
+  @param[in]  Context   The TEST_CONTEXT_LAYOUT giving the number of CPUs.
+
+  @retval UNIT_TEST_PASSED              Each line belongs to a single owner.
+  @retval UNIT_TEST_ERROR_TEST_FAILED   Two owners share a line.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+CpuDataLinesAreNotShared (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CONTEXT_LAYOUT          *Layout;
+  UINTN                        SyncDataSize;
+  SMM_DISPATCHER_MP_SYNC_DATA  *SyncData;
+  UINTN                        *Owner;
+  UINTN                        LineCount;
+  UINTN                        Line;
+  UINTN                        CpuIndex;
+  UINTN                        Base;
+  UINTN                        Lines[TEST_LINES_PER_CPU];
+  UINTN                        Index;
+
+  Layout       = (TEST_CONTEXT_LAYOUT *)Context;
+  SyncDataSize = SMM_MP_SYNC_DATA_CPU_DATA_OFFSET + (sizeof (SMM_CPU_DATA_BLOCK) + sizeof (BOOLEAN)) * Layout->NumberOfCpus;
+  SyncData     = AllocatePages (EFI_SIZE_TO_PAGES (SyncDataSize));
+  UT_ASSERT_NOT_NULL (SyncData);
+  ZeroMem (SyncData, SyncDataSize);
+
+  SyncData->CpuData      = (SMM_CPU_DATA_BLOCK *)((UINT8 *)SyncData + SMM_MP_SYNC_DATA_CPU_DATA_OFFSET);
+  SyncData->CandidateBsp = (BOOLEAN *)(SyncData->CpuData + Layout->NumberOfCpus);
+  for (CpuIndex = 0; CpuIndex < Layout->NumberOfCpus; CpuIndex++) {
+    SyncData->CpuData[CpuIndex].Busy    = &SyncData->CpuData[CpuIndex].BusyLine.Lock;
+    SyncData->CpuData[CpuIndex].Present = &SyncData->CpuData[CpuIndex].PresentLine.Flag;
+  }
+
+  //
+  // Owner of each line, 0 for the common fields and CpuIndex + 1 for the CPUs
+  //
+  Base      = (UINTN)SyncData;
+  LineCount = (SyncDataSize + SMM_CPU_SYNC_LINE_SIZE - 1) / SMM_CPU_SYNC_LINE_SIZE;
+  Owner     = AllocatePool (LineCount * sizeof (UINTN));
+  UT_ASSERT_NOT_NULL (Owner);
+  SetMem (Owner, LineCount * sizeof (UINTN), 0xFF);
+
+  for (Line = 0; Line * SMM_CPU_SYNC_LINE_SIZE < sizeof (SMM_DISPATCHER_MP_SYNC_DATA); Line++) {
+    Owner[Line] = 0;
+  }
+
+  for (CpuIndex = 0; CpuIndex < Layout->NumberOfCpus; CpuIndex++) {
+    UT_ASSERT_EQUAL (((UINTN)&SyncData->CpuData[CpuIndex] - Base) % SMM_CPU_SYNC_LINE_SIZE, 0);
+
+    Lines[0] = ((UINTN)&SyncData->CpuData[CpuIndex].Tail - Base) / SMM_CPU_SYNC_LINE_SIZE;
+    Lines[1] = ((UINTN)SyncData->CpuData[CpuIndex].Busy - Base) / SMM_CPU_SYNC_LINE_SIZE;
+    Lines[2] = ((UINTN)SyncData->CpuData[CpuIndex].Present - Base) / SMM_CPU_SYNC_LINE_SIZE;
+    Lines[3] = ((UINTN)&SyncData->CpuData[CpuIndex].QueueLine.Queue.Pending - Base) / SMM_CPU_SYNC_LINE_SIZE;
+
+    for (Index = 0; Index < TEST_LINES_PER_CPU; Index++) {
+      // The lines of one CPU follow each other
+      UT_ASSERT_EQUAL (Lines[Index], Lines[0] + Index);
+      UT_ASSERT_TRUE (Lines[Index] < LineCount);
+      UT_ASSERT_EQUAL (Owner[Lines[Index]], MAX_UINTN);
+      Owner[Lines[Index]] = CpuIndex + 1;
+    }
+
+    // The procedure queue follows them up to the end of the block
+    for (Line = Lines[TEST_LINES_PER_CPU - 1] + 1; Line * SMM_CPU_SYNC_LINE_SIZE < (UINTN)&SyncData->CpuData[CpuIndex + 1] - Base; Line++) {
+      UT_ASSERT_TRUE (Line < LineCount);
+      UT_ASSERT_EQUAL (Owner[Line], MAX_UINTN);
+      Owner[Line] = CpuIndex + 1;
+    }
+  }
+
+  // The BSP election flags come after the last CPU block
+  UT_ASSERT_TRUE ((UINTN)SyncData->CandidateBsp - Base >= Line * SMM_CPU_SYNC_LINE_SIZE);
+
+  FreePool (Owner);
+  FreePages (SyncData, EFI_SIZE_TO_PAGES (SyncDataSize));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  per CPU synchronization data layout and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      LayoutTests;
+  TEST_CONTEXT_LAYOUT         LayoutContext[2];
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the MP sync data layout Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&LayoutTests, Framework, "MP Sync Data Layout Tests", "MpSyncData.Layout", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for LayoutTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  LayoutContext[0].NumberOfCpus = 1;
+  LayoutContext[1].NumberOfCpus = 224;
+  AddTestCase (LayoutTests, "CPU block fields should each start a line", "Padding", CpuDataBlockIsPadded, NULL, NULL, NULL);
+  AddTestCase (LayoutTests, "Lines of 1 CPU should not be shared", "Lines1", CpuDataLinesAreNotShared, NULL, NULL, &LayoutContext[0]);
+  AddTestCase (LayoutTests, "Lines of 224 CPUs should not be shared", "Lines224", CpuDataLinesAreNotShared, NULL, NULL, &LayoutContext[1]);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
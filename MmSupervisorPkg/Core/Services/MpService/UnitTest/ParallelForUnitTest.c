@@ -0,0 +1,443 @@
+/** @file
+  Unit tests of the chunk scheduler of the parallel for
+
+  Host threads stand in for the processors, they claim chunks concurrently
+  and every item of the range is checked to be handed out exactly once, and
+  to be processed by the time the last thread to retire releases the token.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <PiMm.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SynchronizationLib.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "../ParallelFor.h"
+#include "TestThread.h"
+
+#define UNIT_TEST_APP_NAME     "Parallel For Unit Tests"
+#define UNIT_TEST_APP_VERSION  "1.0"
+
+#define TEST_MAX_WORKERS  16
+
+typedef struct {
+  UINT32     Workers;
+  UINTN      Start;
+  UINTN      End;
+  UINTN      ChunkSize;
+  //
+  // Worker 0 yields this many times per item, so that the others run out of chunks first
+  //
+  UINTN      SlowYields;
+  BOOLEAN    ExpectSteals;
+} TEST_CONTEXT_PARALLEL_FOR;
+
+typedef struct {
+  PARALLEL_FOR_SCHEDULE    *Schedule;
+  UINT32                   SlotIndex;
+  UINTN                    SlowYields;
+  volatile UINT32          *Hits;
+  volatile UINT32          *Go;
+  volatile UINT32          *Token;
+  BOOLEAN                  BadChunk;
+  BOOLEAN                  Retired;
+  BOOLEAN                  ReleasedEarly;
+  UINTN                    Chunks;
+} TEST_WORKER;
+
+/**
+  Claim and process chunks until none are left, counting the hits of every item,
+  then retire. The thread retiring last releases the token.
+
+  @param[in]  Argument    The TEST_WORKER of the thread.
+
+  @return NULL.
+**/
+STATIC
+VOID *
+TestWorkerThread (
+  IN VOID  *Argument
+  )
+{
+  TEST_WORKER            *Worker;
+  PARALLEL_FOR_SCHEDULE  *Schedule;
+  UINTN                  ChunkStart;
+  UINTN                  ChunkEnd;
+  UINTN                  Item;
+  UINTN                  Yield;
+
+  Worker   = Argument;
+  Schedule = Worker->Schedule;
+
+  // Let all threads be created before any of them claims
+  while (*Worker->Go == 0) {
+    TestThreadYield ();
+  }
+
+  while (ParallelForClaimChunk (Schedule, Worker->SlotIndex, &ChunkStart, &ChunkEnd)) {
+    Worker->Chunks++;
+    if ((ChunkStart < Schedule->Start) || (ChunkStart >= ChunkEnd) || (ChunkEnd > Schedule->End) ||
+        ((ChunkStart - Schedule->Start) % Schedule->ChunkSize != 0) ||
+        ((ChunkEnd - ChunkStart != Schedule->ChunkSize) && (ChunkEnd != Schedule->End)))
+    {
+      Worker->BadChunk = TRUE;
+      continue;
+    }
+
+    for (Item = ChunkStart; Item < ChunkEnd; Item++) {
+      InterlockedIncrement (&Worker->Hits[Item - Schedule->Start]);
+      for (Yield = 0; Yield < Worker->SlowYields; Yield++) {
+        TestThreadYield ();
+      }
+    }
+  }
+
+  if (ParallelForRetireWorker (Schedule)) {
+    Worker->Retired = TRUE;
+    for (Item = 0; Item < Schedule->End - Schedule->Start; Item++) {
+      if (Worker->Hits[Item] != 1) {
+        Worker->ReleasedEarly = TRUE;
+      }
+    }
+
+    InterlockedIncrement (Worker->Token);
+  }
+
+  return NULL;
+}
+
+/**
+  The chunks should be shared evenly by the participating slots, in slot order.
+
+  @param[in]  Context   Unused.
+
+  @retval UNIT_TEST_PASSED              The runs are as expected.
+  @retval UNIT_TEST_ERROR_TEST_FAILED   A run is not.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ScheduleInitSharesEvenly (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  PARALLEL_FOR_SCHEDULE  Schedule;
+  PARALLEL_FOR_SLOT      Slots[4];
+  BOOLEAN                Participating[4] = { TRUE, FALSE, TRUE, TRUE };
+
+  UT_ASSERT_EQUAL (sizeof (PARALLEL_FOR_SLOT), PARALLEL_FOR_SLOT_SIZE);
+
+  // 29 items in chunks of 3, the last chunk holds 2 items
+  UT_ASSERT_NOT_EFI_ERROR (ParallelForScheduleInit (&Schedule, Slots, 4, Participating, 10, 39, 3));
+  UT_ASSERT_EQUAL (Schedule.ChunkCount, 10);
+  UT_ASSERT_EQUAL (Schedule.ActiveWorkers, 3);
+  UT_ASSERT_EQUAL (Slots[0].Range, PARALLEL_FOR_RANGE (0, 4));
+  UT_ASSERT_EQUAL (Slots[1].Range, PARALLEL_FOR_RANGE (0, 0));
+  UT_ASSERT_EQUAL (Slots[2].Range, PARALLEL_FOR_RANGE (4, 7));
+  UT_ASSERT_EQUAL (Slots[3].Range, PARALLEL_FOR_RANGE (7, 10));
+
+  // Fewer chunks than slots leave the last slots empty
+  UT_ASSERT_NOT_EFI_ERROR (ParallelForScheduleInit (&Schedule, Slots, 4, NULL, 0, 2, 1));
+  UT_ASSERT_EQUAL (Slots[0].Range, PARALLEL_FOR_RANGE (0, 1));
+  UT_ASSERT_EQUAL (Slots[1].Range, PARALLEL_FOR_RANGE (1, 2));
+  UT_ASSERT_EQUAL (Slots[2].Range, PARALLEL_FOR_RANGE (2, 2));
+  UT_ASSERT_EQUAL (Slots[3].Range, PARALLEL_FOR_RANGE (2, 2));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Empty ranges, empty chunks, too many chunks and no participant are rejected.
+
+  @param[in]  Context   Unused.
+
+  @retval UNIT_TEST_PASSED              All bad parameters are rejected.
+  @retval UNIT_TEST_ERROR_TEST_FAILED   One of them is accepted.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ScheduleInitRejectsBadParameters (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  PARALLEL_FOR_SCHEDULE  Schedule;
+  PARALLEL_FOR_SLOT      Slots[2];
+  BOOLEAN                Participating[2] = { FALSE, FALSE };
+
+  UT_ASSERT_STATUS_EQUAL (ParallelForScheduleInit (&Schedule, Slots, 2, NULL, 5, 5, 1), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (ParallelForScheduleInit (&Schedule, Slots, 2, NULL, 6, 5, 1), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (ParallelForScheduleInit (&Schedule, Slots, 2, NULL, 0, 5, 0), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (ParallelForScheduleInit (&Schedule, Slots, 0, NULL, 0, 5, 1), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (ParallelForScheduleInit (&Schedule, Slots, 2, Participating, 0, 5, 1), EFI_INVALID_PARAMETER);
+  if (sizeof (UINTN) > sizeof (UINT32)) {
+    UT_ASSERT_STATUS_EQUAL (ParallelForScheduleInit (&Schedule, Slots, 2, NULL, 0, MAX_UINTN, 1), EFI_INVALID_PARAMETER);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  A slot that ran out of chunks takes over the upper half of the run of
+  another slot, down to its last chunk.
+
+  @param[in]  Context   Unused.
+
+  @retval UNIT_TEST_PASSED              The chunks are claimed in the expected order.
+  @retval UNIT_TEST_ERROR_TEST_FAILED   They are not.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ClaimStealsHalfOfLargestRun (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  PARALLEL_FOR_SCHEDULE  Schedule;
+  PARALLEL_FOR_SLOT      Slots[3];
+  BOOLEAN                Participating[3] = { TRUE, TRUE, FALSE };
+  UINTN                  ChunkStart;
+  UINTN                  ChunkEnd;
+
+  // 10 items in chunks of 2, slot 0 owns chunks 0..2 and slot 1 chunks 3..4
+  UT_ASSERT_NOT_EFI_ERROR (ParallelForScheduleInit (&Schedule, Slots, 3, Participating, 0, 10, 2));
+
+  // Slot 2 takes no part, and steals chunk 1 of the 3 chunks left to slot 0
+  UT_ASSERT_TRUE (ParallelForClaimChunk (&Schedule, 2, &ChunkStart, &ChunkEnd));
+  UT_ASSERT_EQUAL (ChunkStart, 2);
+  UT_ASSERT_EQUAL (ChunkEnd, 4);
+  UT_ASSERT_EQUAL (Slots[0].Range, PARALLEL_FOR_RANGE (0, 1));
+  UT_ASSERT_EQUAL (Slots[2].Range, PARALLEL_FOR_RANGE (2, 3));
+
+  // The rest of the stolen half is its own now
+  UT_ASSERT_TRUE (ParallelForClaimChunk (&Schedule, 2, &ChunkStart, &ChunkEnd));
+  UT_ASSERT_EQUAL (ChunkStart, 4);
+  UT_ASSERT_EQUAL (ChunkEnd, 6);
+
+  // Slot 1 claims its own run, the last chunk is cut at the end of the range
+  UT_ASSERT_TRUE (ParallelForClaimChunk (&Schedule, 1, &ChunkStart, &ChunkEnd));
+  UT_ASSERT_EQUAL (ChunkStart, 6);
+  UT_ASSERT_TRUE (ParallelForClaimChunk (&Schedule, 1, &ChunkStart, &ChunkEnd));
+  UT_ASSERT_EQUAL (ChunkStart, 8);
+  UT_ASSERT_EQUAL (ChunkEnd, 10);
+
+  // A single chunk left is taken whole
+  UT_ASSERT_TRUE (ParallelForClaimChunk (&Schedule, 1, &ChunkStart, &ChunkEnd));
+  UT_ASSERT_EQUAL (ChunkStart, 0);
+  UT_ASSERT_EQUAL (Slots[0].Range, PARALLEL_FOR_RANGE (0, 0));
+
+  UT_ASSERT_FALSE (ParallelForClaimChunk (&Schedule, 0, &ChunkStart, &ChunkEnd));
+  UT_ASSERT_FALSE (ParallelForClaimChunk (&Schedule, 1, &ChunkStart, &ChunkEnd));
+  UT_ASSERT_FALSE (ParallelForClaimChunk (&Schedule, 2, &ChunkStart, &ChunkEnd));
+  UT_ASSERT_FALSE (ParallelForClaimChunk (&Schedule, 3, &ChunkStart, &ChunkEnd));
+  UT_ASSERT_EQUAL (Schedule.Steals, 2);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Only the last participating slot to retire completes the parallel for.
+
+  @param[in]  Context   Unused.
+
+  @retval UNIT_TEST_PASSED              Only the last slot completes it.
+  @retval UNIT_TEST_ERROR_TEST_FAILED   Another slot does.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+RetireCompletesOnLastWorker (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  PARALLEL_FOR_SCHEDULE  Schedule;
+  PARALLEL_FOR_SLOT      Slots[3];
+  BOOLEAN                Participating[3] = { TRUE, FALSE, TRUE };
+
+  UT_ASSERT_NOT_EFI_ERROR (ParallelForScheduleInit (&Schedule, Slots, 3, Participating, 0, 4, 1));
+  UT_ASSERT_EQUAL (Schedule.ActiveWorkers, 2);
+  UT_ASSERT_FALSE (ParallelForRetireWorker (&Schedule));
+  UT_ASSERT_TRUE (ParallelForRetireWorker (&Schedule));
+  UT_ASSERT_EQUAL (Schedule.ActiveWorkers, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Threads claiming chunks concurrently should hand out every item of the
+  range exactly once. The test waits on the token like a non-blocking caller,
+  every item should be processed once the token is released, and the token
+  should be released by one thread only.
+
+  @param[in]  Context   The TEST_CONTEXT_PARALLEL_FOR to run.
+
+  @retval UNIT_TEST_PASSED              Every item is processed once before the token is released.
+  @retval UNIT_TEST_ERROR_TEST_FAILED   An item is skipped or processed twice, or the token is released early.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ConcurrentClaimsCoverRangeOnce (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  TEST_CONTEXT_PARALLEL_FOR  *Test;
+  PARALLEL_FOR_SCHEDULE      Schedule;
+  PARALLEL_FOR_SLOT          *Slots;
+  TEST_WORKER                Workers[TEST_MAX_WORKERS];
+  TEST_THREAD                Threads[TEST_MAX_WORKERS];
+  volatile UINT32            *Hits;
+  volatile UINT32            Go;
+  volatile UINT32            Token;
+  UINTN                      Chunks;
+  UINTN                      Retired;
+  UINTN                      Index;
+
+  Test = (TEST_CONTEXT_PARALLEL_FOR *)Context;
+  UT_ASSERT_TRUE (Test->Workers <= TEST_MAX_WORKERS);
+
+  Slots = AllocateAlignedPages (EFI_SIZE_TO_PAGES (sizeof (PARALLEL_FOR_SLOT) * Test->Workers), PARALLEL_FOR_SLOT_SIZE);
+  Hits  = AllocateZeroPool (sizeof (UINT32) * (Test->End - Test->Start));
+  UT_ASSERT_NOT_NULL (Slots);
+  UT_ASSERT_NOT_NULL ((VOID *)Hits);
+
+  UT_ASSERT_NOT_EFI_ERROR (ParallelForScheduleInit (&Schedule, Slots, Test->Workers, NULL, Test->Start, Test->End, Test->ChunkSize));
+
+  Go    = 0;
+  Token = 0;
+  ZeroMem (Workers, sizeof (Workers));
+  for (Index = 0; Index < Test->Workers; Index++) {
+    Workers[Index].Schedule   = &Schedule;
+    Workers[Index].SlotIndex  = (UINT32)Index;
+    Workers[Index].SlowYields = (Index == 0) ? Test->SlowYields : 0;
+    Workers[Index].Hits       = Hits;
+    Workers[Index].Go         = &Go;
+    Workers[Index].Token      = &Token;
+    UT_ASSERT_EQUAL (TestThreadStart (&Threads[Index], TestWorkerThread, &Workers[Index]), 0);
+  }
+
+  InterlockedIncrement (&Go);
+
+  // Every item is processed once the token is released, before any thread is joined
+  while (Token == 0) {
+    TestThreadYield ();
+  }
+
+  for (Index = 0; Index < Test->End - Test->Start; Index++) {
+    UT_ASSERT_EQUAL (Hits[Index], 1);
+  }
+
+  Chunks  = 0;
+  Retired = 0;
+  for (Index = 0; Index < Test->Workers; Index++) {
+    UT_ASSERT_EQUAL (TestThreadJoin (Threads[Index]), 0);
+    UT_ASSERT_FALSE (Workers[Index].BadChunk);
+    UT_ASSERT_FALSE (Workers[Index].ReleasedEarly);
+    Chunks  += Workers[Index].Chunks;
+    Retired += Workers[Index].Retired ? 1 : 0;
+  }
+
+  UT_ASSERT_EQUAL (Chunks, Schedule.ChunkCount);
+  UT_ASSERT_EQUAL (Retired, 1);
+  UT_ASSERT_EQUAL (Token, 1);
+
+  if (Test->ExpectSteals) {
+    UT_ASSERT_TRUE (Schedule.Steals > 0);
+  }
+
+  FreePool ((VOID *)Hits);
+  FreeAlignedPages (Slots, EFI_SIZE_TO_PAGES (sizeof (PARALLEL_FOR_SLOT) * Test->Workers));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  parallel for scheduler and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      ScheduleTests;
+  TEST_CONTEXT_PARALLEL_FOR   ConcurrentContext[3] = {
+    { 8,  1000, 101000, 7, 0,   FALSE },
+    { 16, 0,    5000,   1, 0,   FALSE },
+    { 8,  0,    2048,   4, 100, TRUE  },
+  };
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Populate the parallel for scheduler Unit Test Suite.
+  //
+  Status = CreateUnitTestSuite (&ScheduleTests, Framework, "Parallel For Schedule Tests", "ParallelFor.Schedule", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for ScheduleTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  //
+  // --------------Suite-----------Description--------------Name----------Function--------Pre---Post-------------------Context-----------
+  //
+  AddTestCase (ScheduleTests, "Chunks should be shared evenly", "Init", ScheduleInitSharesEvenly, NULL, NULL, NULL);
+  AddTestCase (ScheduleTests, "Bad parameters should be rejected", "InitBad", ScheduleInitRejectsBadParameters, NULL, NULL, NULL);
+  AddTestCase (ScheduleTests, "Idle slots should steal half of the largest run", "Steal", ClaimStealsHalfOfLargestRun, NULL, NULL, NULL);
+  AddTestCase (ScheduleTests, "The last slot to retire should complete the run", "Retire", RetireCompletesOnLastWorker, NULL, NULL, NULL);
+  AddTestCase (ScheduleTests, "8 threads should claim every item once", "Threads8", ConcurrentClaimsCoverRangeOnce, NULL, NULL, &ConcurrentContext[0]);
+  AddTestCase (ScheduleTests, "16 threads should claim every item once", "Threads16", ConcurrentClaimsCoverRangeOnce, NULL, NULL, &ConcurrentContext[1]);
+  AddTestCase (ScheduleTests, "Threads should steal from a slow thread", "ThreadsSlow", ConcurrentClaimsCoverRangeOnce, NULL, NULL, &ConcurrentContext[2]);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int   argc,
+  char  *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
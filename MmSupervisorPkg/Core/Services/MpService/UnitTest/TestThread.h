@@ -0,0 +1,59 @@
+/** @file
+  Minimal threads for the host based unit tests of the parallel for.
+
+  Only plain C types are used here, the Windows implementation cannot include
+  the UEFI headers along with windows.h.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _PARALLEL_FOR_TEST_THREAD_H_
+#define _PARALLEL_FOR_TEST_THREAD_H_
+
+typedef void *TEST_THREAD;
+
+typedef void *(*TEST_THREAD_ENTRY)(
+  void  *Argument
+  );
+
+/**
+  Start a thread running Entry (Argument).
+
+  @param[out] Thread      The thread, to be joined with TestThreadJoin.
+  @param[in]  Entry       The function run by the thread.
+  @param[in]  Argument    Passed to Entry.
+
+  @retval 0         The thread is started.
+  @retval Others    The thread could not be started.
+**/
+int
+TestThreadStart (
+  TEST_THREAD        *Thread,
+  TEST_THREAD_ENTRY  Entry,
+  void               *Argument
+  );
+
+/**
+  Wait for a thread to return and release it.
+
+  @param[in]  Thread      The thread started by TestThreadStart.
+
+  @retval 0         The thread returned.
+  @retval Others    The thread could not be joined.
+**/
+int
+TestThreadJoin (
+  TEST_THREAD  Thread
+  );
+
+/**
+  Let another thread run on the processor of the caller.
+**/
+void
+TestThreadYield (
+  void
+  );
+
+#endif // _PARALLEL_FOR_TEST_THREAD_H_
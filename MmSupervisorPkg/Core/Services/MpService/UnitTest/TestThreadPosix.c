@@ -0,0 +1,79 @@
+/** @file
+  Minimal threads for the host based unit tests of the parallel for, on pthreads.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#include "TestThread.h"
+
+/**
+  Start a thread running Entry (Argument).
+
+  @param[out] Thread      The thread, to be joined with TestThreadJoin.
+  @param[in]  Entry       The function run by the thread.
+  @param[in]  Argument    Passed to Entry.
+
+  @retval 0         The thread is started.
+  @retval Others    The thread could not be started.
+**/
+int
+TestThreadStart (
+  TEST_THREAD        *Thread,
+  TEST_THREAD_ENTRY  Entry,
+  void               *Argument
+  )
+{
+  pthread_t  *Handle;
+  int        Result;
+
+  Handle = malloc (sizeof (*Handle));
+  if (Handle == NULL) {
+    return -1;
+  }
+
+  Result = pthread_create (Handle, NULL, Entry, Argument);
+  if (Result != 0) {
+    free (Handle);
+    return Result;
+  }
+
+  *Thread = Handle;
+  return 0;
+}
+
+/**
+  Wait for a thread to return and release it.
+
+  @param[in]  Thread      The thread started by TestThreadStart.
+
+  @retval 0         The thread returned.
+  @retval Others    The thread could not be joined.
+**/
+int
+TestThreadJoin (
+  TEST_THREAD  Thread
+  )
+{
+  int  Result;
+
+  Result = pthread_join (*(pthread_t *)Thread, NULL);
+  free (Thread);
+  return Result;
+}
+
+/**
+  Let another thread run on the processor of the caller.
+**/
+void
+TestThreadYield (
+  void
+  )
+{
+  sched_yield ();
+}
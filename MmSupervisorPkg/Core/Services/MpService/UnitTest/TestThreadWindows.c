@@ -0,0 +1,108 @@
+/** @file
+  Minimal threads for the host based unit tests of the parallel for, on Win32.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <windows.h>
+#include <stdlib.h>
+
+#include "TestThread.h"
+
+typedef struct {
+  TEST_THREAD_ENTRY    Entry;
+  void                 *Argument;
+} TEST_THREAD_START;
+
+/**
+  Win32 thread procedure calling the entry of the test thread.
+
+  @param[in]  Parameter   The TEST_THREAD_START of the thread, freed here.
+
+  @return 0.
+**/
+static
+DWORD
+WINAPI
+TestThreadTrampoline (
+  LPVOID  Parameter
+  )
+{
+  TEST_THREAD_START  Start;
+
+  Start = *(TEST_THREAD_START *)Parameter;
+  free (Parameter);
+  Start.Entry (Start.Argument);
+  return 0;
+}
+
+/**
+  Start a thread running Entry (Argument).
+
+  @param[out] Thread      The thread, to be joined with TestThreadJoin.
+  @param[in]  Entry       The function run by the thread.
+  @param[in]  Argument    Passed to Entry.
+
+  @retval 0         The thread is started.
+  @retval Others    The thread could not be started.
+**/
+int
+TestThreadStart (
+  TEST_THREAD        *Thread,
+  TEST_THREAD_ENTRY  Entry,
+  void               *Argument
+  )
+{
+  TEST_THREAD_START  *Start;
+  HANDLE             Handle;
+
+  Start = malloc (sizeof (*Start));
+  if (Start == NULL) {
+    return -1;
+  }
+
+  Start->Entry    = Entry;
+  Start->Argument = Argument;
+
+  Handle = CreateThread (NULL, 0, TestThreadTrampoline, Start, 0, NULL);
+  if (Handle == NULL) {
+    free (Start);
+    return -1;
+  }
+
+  *Thread = Handle;
+  return 0;
+}
+
+/**
+  Wait for a thread to return and release it.
+
+  @param[in]  Thread      The thread started by TestThreadStart.
+
+  @retval 0         The thread returned.
+  @retval Others    The thread could not be joined.
+**/
+int
+TestThreadJoin (
+  TEST_THREAD  Thread
+  )
+{
+  DWORD  Wait;
+
+  Wait = WaitForSingleObject ((HANDLE)Thread, INFINITE);
+  CloseHandle ((HANDLE)Thread);
+  return (Wait == WAIT_OBJECT_0) ? 0 : -1;
+}
+
+/**
+  Let another thread run on the processor of the caller.
+**/
+void
+TestThreadYield (
+  void
+  )
+{
+  SwitchToThread ();
+}
@@ -15,12 +15,14 @@
 #include <Protocol/SmmControl2.h>
 #include <Protocol/DxeSmmReadyToLock.h>
 #include <Protocol/MmSupervisorCommunication.h>
+#include <Protocol/MmCommunicateBatch.h>
 
 #include <Guid/EventGroup.h>
 #include <Guid/MmCoreData.h>
 #include <Guid/MmCommonRegion.h>
 #include <Guid/PiSmmCommunicationRegionTable.h>
 #include <Guid/MmSupervisorRequestData.h> // MU_CHANGE: MM_SUPV: Added MM Supervisor request data structure
+#include <Guid/MmCommunicateBatch.h>
 
 #include <Library/BaseLib.h>
 #include <Library/HobLib.h>
@@ -31,6 +33,7 @@
 #include <Library/UefiRuntimeLib.h>
 #include <Library/ReportStatusCodeLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/SafeIntLib.h>
 
 #include "Common/MmIplCommon.h"
 
@@ -177,6 +180,50 @@ SupvCommunicationCommunicate (
   IN OUT UINTN                                   *CommSize OPTIONAL
   );
 
+/**
+  Queues a message for a registered handler, to be sent on the next Flush.
+
+  @param[in] This                 The MM_COMMUNICATE_BATCH_PROTOCOL instance.
+  @param[in, out] CommBuffer      A pointer to the message, starting with EFI_MM_COMMUNICATE_HEADER.
+                                  Updated with the response on Flush.
+  @param[in, out] CommSize        The size of the message. Updated with the size of the response on
+                                  Flush. This parameter is optional and may be NULL.
+  @param[out] ReturnStatus        Updated with the status of the message on Flush.
+
+  @retval EFI_SUCCESS             The message is queued.
+  @retval EFI_INVALID_PARAMETER   CommBuffer or ReturnStatus is NULL, or CommSize is too small.
+  @retval EFI_OUT_OF_RESOURCES    The queue is full, or the message does not fit in the
+                                  communicate buffer with the messages already queued.
+  @retval EFI_BAD_BUFFER_SIZE     The message alone does not fit in the communicate buffer.
+  @retval EFI_UNSUPPORTED         The caller runs above TPL_NOTIFY.
+
+**/
+EFI_STATUS
+EFIAPI
+MmCommunicateBatchQueue (
+  IN CONST MM_COMMUNICATE_BATCH_PROTOCOL  *This,
+  IN OUT VOID                             *CommBuffer,
+  IN OUT UINTN                            *CommSize OPTIONAL,
+  OUT EFI_STATUS                          *ReturnStatus
+  );
+
+/**
+  Sends all queued messages to MM with a single MMI and empties the queue.
+
+  @param[in] This                 The MM_COMMUNICATE_BATCH_PROTOCOL instance.
+
+  @retval EFI_SUCCESS             The queued messages were sent, or the queue was empty.
+  @retval EFI_UNSUPPORTED         The caller runs above TPL_NOTIFY, the queue is kept.
+  @retval Others                  The batch could not be sent, every ReturnStatus holds
+                                  this status too.
+
+**/
+EFI_STATUS
+EFIAPI
+MmCommunicateBatchFlush (
+  IN CONST MM_COMMUNICATE_BATCH_PROTOCOL  *This
+  );
+
 /**
   Event notification that is fired every time a DxeSmmReadyToLock protocol is added
   or if gEfiEventReadyToBootGuid is signalled.
@@ -288,6 +335,34 @@ MM_SUPERVISOR_COMMUNICATION_PROTOCOL  mMmSupvCommunication = {
   .Communicate = SupvCommunicationCommunicate
 };
 
+//
+// MM Communicate Batch Protocol instance
+//
+MM_COMMUNICATE_BATCH_PROTOCOL  mMmCommunicateBatch = {
+  MmCommunicateBatchQueue,
+  MmCommunicateBatchFlush
+};
+
+//
+// Messages queued on MM Communicate Batch Protocol, to be sent on the next flush
+//
+typedef struct {
+  VOID          *CommBuffer;
+  UINTN         *CommSize;
+  EFI_STATUS    *ReturnStatus;
+  UINTN         Size;
+} MM_COMMUNICATE_BATCH_QUEUED_MESSAGE;
+
+MM_COMMUNICATE_BATCH_QUEUED_MESSAGE  mBatchQueue[MM_COMMUNICATE_BATCH_MAX_MESSAGES];
+UINTN                                mBatchQueueCount = 0;
+UINT64                               mBatchQueueSize  = 0;
+
+//
+// Private buffer the batch is laid out in, the queued messages may live in the user
+// communicate buffer itself, so the batch is only copied there in one go on flush.
+//
+VOID  *mBatchStagingBuffer = NULL;
+
 // MU_CHANGE: MM_SUPV: Designated a pointer for core private data as it is allocated runtime
 //
 // Global pointer used to access mSmmCorePrivateData from outside and inside SMM
@@ -559,6 +634,203 @@ SmmCommunicationMmCommunicate2 (
            );
 }
 
+/**
+  Size of the batch holding Count messages, of QueuedSize bytes once aligned.
+
+  @param[in] Count          Number of messages.
+  @param[in] QueuedSize     Total size of the messages, each aligned to 8 bytes.
+
+  @return Size of the communicate buffer needed to send the batch.
+
+**/
+STATIC
+UINT64
+GetCommunicateBatchSize (
+  IN UINTN   Count,
+  IN UINT64  QueuedSize
+  )
+{
+  return OFFSET_OF (EFI_MM_COMMUNICATE_HEADER, Data) +
+         sizeof (MM_COMMUNICATE_BATCH_HEADER) +
+         Count * sizeof (MM_COMMUNICATE_BATCH_ENTRY) +
+         QueuedSize;
+}
+
+/**
+  Queues a message for a registered handler, to be sent on the next Flush.
+
+  The buffers passed in are only read and updated by Flush, they must stay
+  valid until then.
+
+  @param[in] This                 The MM_COMMUNICATE_BATCH_PROTOCOL instance.
+  @param[in, out] CommBuffer      A pointer to the message, starting with EFI_MM_COMMUNICATE_HEADER.
+                                  Updated with the response on Flush.
+  @param[in, out] CommSize        The size of the message. Updated with the size of the response on
+                                  Flush. This parameter is optional and may be NULL.
+  @param[out] ReturnStatus        Updated with the status of the message on Flush.
+
+  @retval EFI_SUCCESS             The message is queued.
+  @retval EFI_INVALID_PARAMETER   CommBuffer or ReturnStatus is NULL, or CommSize is too small.
+  @retval EFI_OUT_OF_RESOURCES    The queue is full, or the message does not fit in the
+                                  communicate buffer with the messages already queued.
+  @retval EFI_BAD_BUFFER_SIZE     The message alone does not fit in the communicate buffer.
+  @retval EFI_UNSUPPORTED         The caller runs above TPL_NOTIFY.
+
+**/
+EFI_STATUS
+EFIAPI
+MmCommunicateBatchQueue (
+  IN CONST MM_COMMUNICATE_BATCH_PROTOCOL  *This,
+  IN OUT VOID                             *CommBuffer,
+  IN OUT UINTN                            *CommSize OPTIONAL,
+  OUT EFI_STATUS                          *ReturnStatus
+  )
+{
+  EFI_STATUS                 Status;
+  EFI_MM_COMMUNICATE_HEADER  *CommunicateHeader;
+  UINT64                     MessageSize;
+  EFI_TPL                    OldTpl;
+
+  if ((CommBuffer == NULL) || (ReturnStatus == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (EfiGetCurrentTpl () > TPL_NOTIFY) {
+    return EFI_UNSUPPORTED;
+  }
+
+  CommunicateHeader = (EFI_MM_COMMUNICATE_HEADER *)CommBuffer;
+  if (CommSize == NULL) {
+    Status = SafeUint64Add (OFFSET_OF (EFI_MM_COMMUNICATE_HEADER, Data), CommunicateHeader->MessageLength, &MessageSize);
+    if (EFI_ERROR (Status)) {
+      return EFI_INVALID_PARAMETER;
+    }
+  } else {
+    MessageSize = *CommSize;
+    if (MessageSize < OFFSET_OF (EFI_MM_COMMUNICATE_HEADER, Data)) {
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  if (MessageSize > EFI_PAGES_TO_SIZE (mMmUserCommonBufferPages)) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  // Keep the queue consistent against a Queue or Flush from an event notification
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+
+  if ((mBatchQueueCount == MM_COMMUNICATE_BATCH_MAX_MESSAGES) ||
+      (GetCommunicateBatchSize (mBatchQueueCount + 1, mBatchQueueSize + ALIGN_VALUE (MessageSize, sizeof (UINT64))) >
+       EFI_PAGES_TO_SIZE (mMmUserCommonBufferPages)))
+  {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  mBatchQueue[mBatchQueueCount].CommBuffer   = CommBuffer;
+  mBatchQueue[mBatchQueueCount].CommSize     = CommSize;
+  mBatchQueue[mBatchQueueCount].ReturnStatus = ReturnStatus;
+  mBatchQueue[mBatchQueueCount].Size         = (UINTN)MessageSize;
+  mBatchQueueSize                           += ALIGN_VALUE (MessageSize, sizeof (UINT64));
+  mBatchQueueCount++;
+  Status = EFI_SUCCESS;
+
+Done:
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+/**
+  Sends all queued messages to MM with a single MMI and empties the queue.
+
+  The messages are laid out back to back in a private staging buffer, behind a
+  batch header and one descriptor per message, copied to the user communicate
+  buffer in one go and dispatched one by one by the supervisor. The responses
+  come back through the staging buffer too, so queued messages may themselves
+  live in the user communicate buffer.
+
+  @param[in] This                 The MM_COMMUNICATE_BATCH_PROTOCOL instance.
+
+  @retval EFI_SUCCESS             The queued messages were sent, or the queue was empty.
+  @retval EFI_UNSUPPORTED         The caller runs above TPL_NOTIFY, the queue is kept.
+  @retval Others                  The batch could not be sent, every ReturnStatus holds
+                                  this status too.
+
+**/
+EFI_STATUS
+EFIAPI
+MmCommunicateBatchFlush (
+  IN CONST MM_COMMUNICATE_BATCH_PROTOCOL  *This
+  )
+{
+  EFI_STATUS                   Status;
+  EFI_MM_COMMUNICATE_HEADER    *CommunicateHeader;
+  MM_COMMUNICATE_BATCH_HEADER  *Batch;
+  MM_COMMUNICATE_BATCH_ENTRY   *Entries;
+  UINT64                       Offset;
+  UINTN                        CommSize;
+  UINTN                        Size;
+  UINTN                        Index;
+  EFI_TPL                      OldTpl;
+
+  if (EfiGetCurrentTpl () > TPL_NOTIFY) {
+    return EFI_UNSUPPORTED;
+  }
+
+  // Keep the queue consistent against a Queue or Flush from an event notification
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+
+  if (mBatchQueueCount == 0) {
+    gBS->RestoreTPL (OldTpl);
+    return EFI_SUCCESS;
+  }
+
+  CommunicateHeader = (EFI_MM_COMMUNICATE_HEADER *)mBatchStagingBuffer;
+  CopyGuid (&CommunicateHeader->HeaderGuid, &gMmCommunicateBatchGuid);
+  Batch            = (MM_COMMUNICATE_BATCH_HEADER *)CommunicateHeader->Data;
+  Batch->Signature = MM_COMMUNICATE_BATCH_SIGNATURE;
+  Batch->Count     = (UINT32)mBatchQueueCount;
+  Entries          = (MM_COMMUNICATE_BATCH_ENTRY *)(Batch + 1);
+
+  Offset = sizeof (MM_COMMUNICATE_BATCH_HEADER) + mBatchQueueCount * sizeof (MM_COMMUNICATE_BATCH_ENTRY);
+  for (Index = 0; Index < mBatchQueueCount; Index++) {
+    Entries[Index].Offset       = Offset;
+    Entries[Index].Size         = mBatchQueue[Index].Size;
+    Entries[Index].ReturnStatus = 0;
+    CopyMem ((UINT8 *)Batch + Offset, mBatchQueue[Index].CommBuffer, mBatchQueue[Index].Size);
+    Offset += ALIGN_VALUE (mBatchQueue[Index].Size, sizeof (UINT64));
+  }
+
+  CommunicateHeader->MessageLength = Offset;
+  CommSize                         = (UINTN)GetCommunicateBatchSize (mBatchQueueCount, mBatchQueueSize);
+  Status                           = SmmCommunicationCommunicateWorker (FALSE, CommunicateHeader, &CommSize);
+
+  for (Index = 0; Index < mBatchQueueCount; Index++) {
+    if (EFI_ERROR (Status)) {
+      *mBatchQueue[Index].ReturnStatus = Status;
+      continue;
+    }
+
+    // The supervisor never grows a response past its message
+    Size = (UINTN)MIN (Entries[Index].Size, mBatchQueue[Index].Size);
+    CopyMem (mBatchQueue[Index].CommBuffer, (UINT8 *)Batch + Entries[Index].Offset, Size);
+    if (mBatchQueue[Index].CommSize != NULL) {
+      *mBatchQueue[Index].CommSize = Size;
+    }
+
+    *mBatchQueue[Index].ReturnStatus = EFI_SUCCESS;
+    if ((UINTN)Entries[Index].ReturnStatus != 0) {
+      *mBatchQueue[Index].ReturnStatus = ENCODE_ERROR ((UINTN)Entries[Index].ReturnStatus);
+    }
+  }
+
+  mBatchQueueCount = 0;
+  mBatchQueueSize  = 0;
+
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
 /**
   Event notification that is fired when GUIDed Event Group is signaled.
 
@@ -1074,6 +1346,12 @@ MmDxeSupportEntry (
     return Status;
   }
 
+  mBatchStagingBuffer = AllocatePool (EFI_PAGES_TO_SIZE (mMmUserCommonBufferPages));
+  if (mBatchStagingBuffer == NULL) {
+    ASSERT (mBatchStagingBuffer != NULL);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
   // MU_CHANGE: Since we already set up everything, directly move to protocol installation.
   //
   // Install SMM Base2 Protocol and SMM Communication Protocol
@@ -1088,6 +1366,8 @@ MmDxeSupportEntry (
                   &mMmCommunication2,
                   &gMmSupervisorCommunicationProtocolGuid,
                   &mMmSupvCommunication,                                          // MU_CHANGE: MM_SUPV
+                  &gMmCommunicateBatchProtocolGuid,
+                  &mMmCommunicateBatch,
                   NULL
                   );
   if (EFI_ERROR (Status)) {
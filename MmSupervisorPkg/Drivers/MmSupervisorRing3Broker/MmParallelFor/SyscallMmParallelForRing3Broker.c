@@ -0,0 +1,83 @@
+/** @file
+
+  Copyright (c), Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+
+#include <Pi/PiMmCis.h>
+#include <Protocol/MmParallelFor.h>
+
+#include <Library/DebugLib.h>
+#include <Library/SysCallLib.h>
+
+#include "MmSupervisorRing3Broker.h"
+#include "SyscallMmParallelForRing3Broker.h"
+
+///
+/// MM Parallel For Protocol instance
+///
+MM_PARALLEL_FOR_PROTOCOL  mMmParallelFor = {
+  SyscallMmParallelFor,
+  SyscallMmCheckOnParallelFor
+};
+
+//
+// Chunk descriptors handed to the procedure, one per processor
+//
+MM_PARALLEL_FOR_CHUNK  *mMmParallelForChunks = NULL;
+
+EFI_STATUS
+EFIAPI
+SyscallMmParallelFor (
+  IN CONST MM_PARALLEL_FOR_PROTOCOL   *This,
+  IN       MM_PARALLEL_FOR_PROCEDURE  Procedure,
+  IN       UINTN                      Start,
+  IN       UINTN                      End,
+  IN       UINTN                      ChunkSize,
+  IN       VOID                       *Context OPTIONAL,
+  OUT      MM_COMPLETION              *Token   OPTIONAL
+  )
+{
+  EFI_STATUS                   Status;
+  SMM_MP_PARALLEL_FOR_REQUEST  Request;
+
+  if ((Procedure == NULL) || (Start >= End) || (ChunkSize == 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (mMmParallelForChunks == NULL) {
+    Status = MmAllocateUserPool (
+               EfiRuntimeServicesData,
+               sizeof (MM_PARALLEL_FOR_CHUNK) * gMmShimMmst.NumberOfCpus,
+               (VOID **)&mMmParallelForChunks
+               );
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a Failed to allocate chunk descriptors - %r\n", __FUNCTION__, Status));
+      return Status;
+    }
+  }
+
+  Request.Procedure = (UINTN)Procedure;
+  Request.Start     = Start;
+  Request.End       = End;
+  Request.ChunkSize = ChunkSize;
+  Request.Context   = (UINTN)Context;
+  Request.Chunks    = (UINTN)mMmParallelForChunks;
+  Request.Token     = (UINTN)Token;
+
+  return (EFI_STATUS)SysCall (SMM_MP_PARALLEL_FOR, (UINTN)&Request, 0, 0);
+}
+
+EFI_STATUS
+EFIAPI
+SyscallMmCheckOnParallelFor (
+  IN CONST MM_PARALLEL_FOR_PROTOCOL  *This,
+  IN       MM_COMPLETION             Token
+  )
+{
+  return (EFI_STATUS)SysCall (SMM_MP_PARALLEL_FOR_CHECK, (UINTN)Token, 0, 0);
+}
@@ -0,0 +1,33 @@
+/** @file
+  Internal header with function declarations for Syscall MM parallel for protocol
+
+  Copyright (c), Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _SYSCALL_MM_PARALLEL_FOR_RING3_SHIM_H_
+#define _SYSCALL_MM_PARALLEL_FOR_RING3_SHIM_H_
+
+extern MM_PARALLEL_FOR_PROTOCOL  mMmParallelFor;
+
+EFI_STATUS
+EFIAPI
+SyscallMmParallelFor (
+  IN CONST MM_PARALLEL_FOR_PROTOCOL   *This,
+  IN       MM_PARALLEL_FOR_PROCEDURE  Procedure,
+  IN       UINTN                      Start,
+  IN       UINTN                      End,
+  IN       UINTN                      ChunkSize,
+  IN       VOID                       *Context OPTIONAL,
+  OUT      MM_COMPLETION              *Token   OPTIONAL
+  );
+
+EFI_STATUS
+EFIAPI
+SyscallMmCheckOnParallelFor (
+  IN CONST MM_PARALLEL_FOR_PROTOCOL  *This,
+  IN       MM_COMPLETION             Token
+  );
+
+#endif
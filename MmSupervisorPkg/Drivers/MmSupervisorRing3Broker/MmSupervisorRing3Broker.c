@@ -10,11 +10,13 @@
 #include <Pi/PiMmCis.h>
 
 #include <Protocol/MmCpu.h>
+#include <Protocol/MmParallelFor.h>
 #include <Protocol/MmReadyToLock.h>
 #include <Protocol/DxeMmReadyToLock.h>
 
 #include <Guid/EventGroup.h>
 
+#include <Library/BaseLib.h>
 #include <Library/DebugLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/MmServicesTableLib.h>
@@ -23,6 +25,7 @@
 
 #include "MmSupervisorRing3Broker.h"
 #include "MmCpu/SyscallMmCpuRing3Broker.h"
+#include "MmParallelFor/SyscallMmParallelForRing3Broker.h"
 #include "Handler/MmHandlerProfileBroker.h"
 
 //
@@ -287,6 +290,54 @@ MmEndOfDxeHandler (
   return Status;
 }
 
+/**
+  Dispatch the user MMI handlers of a MM_USER_MMI_BATCH prepared by the
+  supervisor, so that all of them run within a single ring transition.
+
+  @param  DispatchHandle  The MM_USER_MMI_BATCH to dispatch.
+  @param  Context         Points to an optional handler context.
+  @param  CommBuffer      A pointer to a collection of data in memory that will
+                          be conveyed from a non-MM environment into an MM environment.
+  @param  CommBufferSize  The size of the CommBuffer.
+
+  @retval EFI_SUCCESS     The handlers are dispatched, their statuses are in the batch.
+**/
+EFI_STATUS
+EFIAPI
+UserMmiBatchDispatcher (
+  IN     EFI_HANDLE  DispatchHandle,
+  IN     CONST VOID  *Context         OPTIONAL,
+  IN OUT VOID        *CommBuffer      OPTIONAL,
+  IN OUT UINTN       *CommBufferSize  OPTIONAL
+  )
+{
+  CONST MM_USER_MMI_BATCH     *Batch;
+  EFI_MM_HANDLER_ENTRY_POINT  Handler;
+  EFI_STATUS                  Status;
+  UINTN                       Index;
+  UINT64                      StartTsc;
+
+  Batch = (CONST MM_USER_MMI_BATCH *)DispatchHandle;
+
+  for (Index = 0; (Index < Batch->Count) && (Index < MM_USER_MMI_BATCH_MAX_HANDLERS); Index++) {
+    Handler = (EFI_MM_HANDLER_ENTRY_POINT)Batch->Handlers[Index].Handler;
+    if (Handler == NULL) {
+      continue;
+    }
+
+    StartTsc               = AsmReadTsc ();
+    Status                 = Handler (Batch->Handlers[Index].DispatchHandle, Context, CommBuffer, CommBufferSize);
+    Batch->Cycles[Index]   = AsmReadTsc () - StartTsc;
+    Batch->Statuses[Index] = Status;
+
+    if (Batch->StopOnClaim && ((Status == EFI_SUCCESS) || (Status == EFI_INTERRUPT_PENDING))) {
+      break;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
 EFI_STATUS
 EFIAPI
 MmSupervisorRing3BrokerEntry (
@@ -295,14 +346,15 @@ MmSupervisorRing3BrokerEntry (
   )
 {
   EFI_STATUS  Status;
-  EFI_HANDLE  mMmCpuHandle = NULL;
-  EFI_HANDLE  MmHandle     = NULL;
-  UINTN       Index        = 0;
+  EFI_HANDLE  mMmCpuHandle         = NULL;
+  EFI_HANDLE  mMmParallelForHandle = NULL;
+  EFI_HANDLE  MmHandle             = NULL;
+  UINTN       Index                = 0;
 
   MmInitializeMemoryServices ();
 
   // Step 1: Register with MM Core with handler jump point
-  SysCall (SMM_REG_HDL_JMP, (UINTN)CentralRing3JumpPointer, (UINTN)ApRing3JumpPointer, 0);
+  SysCall (SMM_REG_HDL_JMP, (UINTN)CentralRing3JumpPointer, (UINTN)ApRing3JumpPointer, (UINTN)UserMmiBatchDispatcher);
 
   // Step 2: Register ring 3 version of gMmst
   SysCall (SMM_SET_CPL3_TBL, (UINTN)&gMmShimMmst, 0, 0);
@@ -315,6 +367,14 @@ MmSupervisorRing3BrokerEntry (
              &mMmCpu
              );
 
+  // Step 3.1: Install the MM parallel for protocol, the MMST has no room for it
+  Status = MmInstallUserProtocolInterface (
+             &mMmParallelForHandle,
+             &gMmParallelForProtocolGuid,
+             EFI_NATIVE_INTERFACE,
+             &mMmParallelFor
+             );
+
   // Step 4: Notify the completion of this driver just in case
   Status = MmInstallUserProtocolInterface (
              &MmHandle,
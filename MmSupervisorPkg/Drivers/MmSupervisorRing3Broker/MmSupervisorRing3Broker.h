@@ -80,7 +80,8 @@ typedef struct {
   LIST_ENTRY          *Position;
 } PROTOCOL_NOTIFY;
 
-extern LIST_ENTRY  gHandleList;
+extern LIST_ENTRY           gHandleList;
+extern EFI_MM_SYSTEM_TABLE  gMmShimMmst;
 
 EFI_STATUS
 EFIAPI
@@ -98,6 +99,27 @@ ApRing3JumpPointer (
   IN VOID               *ProcedureArgument
   );
 
+/**
+  Dispatch the user MMI handlers of a MM_USER_MMI_BATCH prepared by the
+  supervisor, so that all of them run within a single ring transition.
+
+  @param  DispatchHandle  The MM_USER_MMI_BATCH to dispatch.
+  @param  Context         Points to an optional handler context.
+  @param  CommBuffer      A pointer to a collection of data in memory that will
+                          be conveyed from a non-MM environment into an MM environment.
+  @param  CommBufferSize  The size of the CommBuffer.
+
+  @retval EFI_SUCCESS     The handlers are dispatched, their statuses are in the batch.
+**/
+EFI_STATUS
+EFIAPI
+UserMmiBatchDispatcher (
+  IN     EFI_HANDLE  DispatchHandle,
+  IN     CONST VOID  *Context         OPTIONAL,
+  IN OUT VOID        *CommBuffer      OPTIONAL,
+  IN OUT UINTN       *CommBufferSize  OPTIONAL
+  );
+
 EFI_STATUS
 EFIAPI
 SyscallMmInstallConfigurationTable (
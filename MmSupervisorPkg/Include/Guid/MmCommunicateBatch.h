@@ -0,0 +1,62 @@
+/** @file
+  Definitions of the batched communicate message, which carries several
+  EFI_MM_COMMUNICATE_HEADER messages through the user communicate buffer
+  in a single MMI.
+
+  The batch is itself a communicate message with gMmCommunicateBatchGuid as
+  HeaderGuid. Its data starts with MM_COMMUNICATE_BATCH_HEADER, followed by
+  Count MM_COMMUNICATE_BATCH_ENTRY descriptors, followed by the messages.
+  Each message is dispatched in turn to the handlers of its own HeaderGuid
+  and its response is written back in place.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MM_COMMUNICATE_BATCH_H_
+#define _MM_COMMUNICATE_BATCH_H_
+
+#define MM_COMMUNICATE_BATCH_GUID \
+  { \
+    0xad8e5fb0, 0x038d, 0x476e, { 0xbc, 0x00, 0x8d, 0xe0, 0x33, 0x3c, 0x4f, 0xe9 } \
+  }
+
+#define MM_COMMUNICATE_BATCH_SIGNATURE  SIGNATURE_32('M', 'C', 'B', 'T')
+
+//
+// Maximal number of messages in one batch.
+//
+#define MM_COMMUNICATE_BATCH_MAX_MESSAGES  32
+
+extern EFI_GUID  gMmCommunicateBatchGuid;
+
+#pragma pack(push, 1)
+
+typedef struct {
+  UINT32    Signature;
+  UINT32    Count;
+} MM_COMMUNICATE_BATCH_HEADER;
+
+/**
+  Descriptor of one message of the batch.
+
+  Offset is where the EFI_MM_COMMUNICATE_HEADER of the message starts, from the
+  start of MM_COMMUNICATE_BATCH_HEADER. It must be 8 byte aligned and the
+  messages must follow each other in the order of the descriptors.
+
+  Size is the size in bytes of the message, EFI_MM_COMMUNICATE_HEADER included.
+  On return it is the size of the response, which never exceeds the size of
+  the message. ReturnStatus is the status of the message, as it would have been
+  returned by a single MM communicate call.
+
+**/
+typedef struct {
+  UINT64    Offset;
+  UINT64    Size;
+  UINT64    ReturnStatus;
+} MM_COMMUNICATE_BATCH_ENTRY;
+
+#pragma pack(pop)
+
+#endif // _MM_COMMUNICATE_BATCH_H_
@@ -0,0 +1,44 @@
+/** @file
+  Extension of SmmCpuSyncLib that tells the library which processor package
+  each CPU belongs to.
+
+  With the package layout, an implementation can keep the arrival counters of
+  the CPUs of one package on lines of their own, so that only the BSP reads
+  across packages during the rendezvous.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef SMM_CPU_SYNC_TOPOLOGY_LIB_H_
+#define SMM_CPU_SYNC_TOPOLOGY_LIB_H_
+
+#include <Library/SmmCpuSyncLib.h>
+
+/**
+  Provide the package of each CPU to an SMM CPU Sync context.
+
+  Must be called right after SmmCpuSyncContextInit(), before any CPU checks in.
+  Implementations that do not use the layout ignore it.
+
+  If Context is NULL, then ASSERT().
+  If CpuPackage is NULL, then ASSERT().
+
+  @param[in,out]  Context           Pointer to the SMM CPU Sync context object.
+  @param[in]      CpuPackage        Package number of each CPU, indexed by CPU index, with as
+                                    many entries as the NumberOfCpus of the context.
+
+  @retval RETURN_SUCCESS            The layout is recorded, or not used by this implementation.
+  @retval RETURN_OUT_OF_RESOURCES   There are not enough resources to hold the layout, the
+                                    context keeps working without it.
+
+**/
+RETURN_STATUS
+EFIAPI
+SmmCpuSyncSetPackageLayout (
+  IN OUT SMM_CPU_SYNC_CONTEXT  *Context,
+  IN     CONST UINT32          *CpuPackage
+  );
+
+#endif
@@ -0,0 +1,47 @@
+/** @file
+  Extension of SmmCpuSyncLib that reports how the APs waited for the BSP.
+
+  An implementation may park the APs waiting for the BSP with MONITOR/MWAIT
+  on their semaphore instead of spinning with PAUSE, which leaves the
+  execution resources of a core to its sibling thread running the handlers.
+  The counters below tell how often the parked APs were woken up.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef SMM_CPU_SYNC_WAIT_LIB_H_
+#define SMM_CPU_SYNC_WAIT_LIB_H_
+
+#include <Library/SmmCpuSyncLib.h>
+
+/**
+  Get the wake up counters of the APs waiting for the BSP, summed up over all CPUs.
+
+  A wake up is spurious when the AP finds its semaphore still not released
+  after MWAIT returned.
+
+  If Context is NULL, then ASSERT().
+  If Wakeups is NULL, then ASSERT().
+  If SpuriousWakeups is NULL, then ASSERT().
+
+  @param[in,out]  Context           Pointer to the SMM CPU Sync context object.
+  @param[in]      Reset             TRUE to clear the counters once they are read.
+  @param[out]     Wakeups           Number of times a waiting AP was woken up.
+  @param[out]     SpuriousWakeups   Number of wake ups that did not release the AP.
+
+  @retval RETURN_SUCCESS            The counters are returned.
+  @retval RETURN_UNSUPPORTED        The APs wait with PAUSE, both counters are 0.
+
+**/
+RETURN_STATUS
+EFIAPI
+SmmCpuSyncGetWaitStatistics (
+  IN OUT SMM_CPU_SYNC_CONTEXT  *Context,
+  IN     BOOLEAN               Reset,
+  OUT    UINT64                *Wakeups,
+  OUT    UINT64                *SpuriousWakeups
+  );
+
+#endif
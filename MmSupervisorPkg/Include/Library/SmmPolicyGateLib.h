@@ -108,4 +108,29 @@ IsSaveStateWriteAllowed (
   IN UINT32                            SaveStateMapField
   );
 
+/**
+  Compile the IO and MSR descriptors of a secure policy into sorted lookup
+  tables, and cache the policy root of each descriptor type. Once compiled,
+  IsIoReadWriteAllowed, IsMsrReadWriteAllowed and IsInstructionExecutionAllowed
+  answer requests against this policy without walking the policy roots and
+  descriptors. Requests against any other policy keep using the walk.
+
+  The policy content must not change after it is compiled. Compiling a policy
+  releases the tables of the previously compiled one, compiling a NULL policy
+  only releases them.
+
+  @param[in]  SmmSecurityPolicy - The address of the SMM secure policy to compile,
+                                  or NULL to drop the current lookup tables.
+
+  @retval EFI_SUCCESS             The policy is compiled.
+          EFI_OUT_OF_RESOURCES    Not enough memory to build the lookup tables.
+          EFI_SECURITY_VIOLATION  The IO or MSR ranges overlap, the policy is
+                                  left uncompiled.
+**/
+EFI_STATUS
+EFIAPI
+CompileSecurityPolicy (
+  IN SMM_SUPV_SECURE_POLICY_DATA_V1_0  *SmmSecurityPolicy
+  );
+
 #endif
@@ -35,28 +35,123 @@ typedef enum {
   SMM_SC_LEGACY_MAX = 0xFFFF,
   // Below is for new supervisor interfaces only,
   // legacy supervisor should not write below this line
-  SMM_REG_HDL_JMP     = 0x10000,
-  SMM_INST_CONF_T     = 0x10001,
-  SMM_ALOC_POOL       = 0x10002,
-  SMM_FREE_POOL       = 0x10003,
-  SMM_ALOC_PAGE       = 0x10004,
-  SMM_FREE_PAGE       = 0x10005,
-  SMM_START_AP_PROC   = 0x10006,
-  SMM_REG_HNDL        = 0x10007,
-  SMM_UNREG_HNDL      = 0x10018,
-  SMM_SET_CPL3_TBL    = 0x10019,
-  SMM_INST_PROT       = 0x1001A,
-  SMM_QRY_HOB         = 0x1001B,
-  SMM_ERR_RPT_JMP     = 0x1001C,
-  SMM_MM_HDL_REG_1    = 0x1001D,
-  SMM_MM_HDL_REG_2    = 0x1001E,
-  SMM_MM_HDL_UNREG_1  = 0x1001F,
-  SMM_MM_HDL_UNREG_2  = 0x10020,
-  SMM_SC_SVST_READ_2  = 0x10021,
-  SMM_MM_UNBLOCKED    = 0x10022,
-  SMM_MM_IS_COMM_BUFF = 0x10023,
+  SMM_REG_HDL_JMP           = 0x10000,
+  SMM_INST_CONF_T           = 0x10001,
+  SMM_ALOC_POOL             = 0x10002,
+  SMM_FREE_POOL             = 0x10003,
+  SMM_ALOC_PAGE             = 0x10004,
+  SMM_FREE_PAGE             = 0x10005,
+  SMM_START_AP_PROC         = 0x10006,
+  SMM_REG_HNDL              = 0x10007,
+  SMM_UNREG_HNDL            = 0x10018,
+  SMM_SET_CPL3_TBL          = 0x10019,
+  SMM_INST_PROT             = 0x1001A,
+  SMM_QRY_HOB               = 0x1001B,
+  SMM_ERR_RPT_JMP           = 0x1001C,
+  SMM_MM_HDL_REG_1          = 0x1001D,
+  SMM_MM_HDL_REG_2          = 0x1001E,
+  SMM_MM_HDL_UNREG_1        = 0x1001F,
+  SMM_MM_HDL_UNREG_2        = 0x10020,
+  SMM_SC_SVST_READ_2        = 0x10021,
+  SMM_MM_UNBLOCKED          = 0x10022,
+  SMM_MM_IS_COMM_BUFF       = 0x10023,
+  SMM_SC_BATCH              = 0x10024,
+  SMM_SC_IO_READ_FIFO       = 0x10025,
+  SMM_SC_IO_WRITE_FIFO      = 0x10026,
+  SMM_MP_PARALLEL_FOR       = 0x10027,
+  SMM_MP_PARALLEL_FOR_CHECK = 0x10028,
 } SMM_SYS_CALL;
 
+//
+// First argument of SMM_SC_IO_READ_FIFO and SMM_SC_IO_WRITE_FIFO, carrying the
+// IO port in bits 0..15 and the EFI_MM_IO_WIDTH of each element from bit 16.
+// The second argument is the element count and the third one the buffer.
+//
+#define SMM_SC_IO_FIFO_ARG(Port, Width)  ((((UINTN)(Width)) << 16) | (((UINTN)(Port)) & MAX_UINT16))
+#define SMM_SC_IO_FIFO_PORT(Arg)         ((UINT32)((Arg) & MAX_UINT16))
+#define SMM_SC_IO_FIFO_WIDTH(Arg)        ((Arg) >> 16)
+
+//
+// Operations of a SMM_SC_BATCH record. The MODIFY operations read the target,
+// apply AndMask then Value as an OR mask, and write the result back within
+// the same supervisor transition.
+//
+typedef enum {
+  SMM_SC_BATCH_IO_READ    = 0x0000,
+  SMM_SC_BATCH_IO_WRITE   = 0x0001,
+  SMM_SC_BATCH_IO_MODIFY  = 0x0002,
+  SMM_SC_BATCH_MSR_READ   = 0x0003,
+  SMM_SC_BATCH_MSR_WRITE  = 0x0004,
+  SMM_SC_BATCH_MSR_MODIFY = 0x0005,
+} SMM_SC_BATCH_OPERATION;
+
+//
+// Upper bound of records carried by a single SMM_SC_BATCH request.
+//
+#define SMM_SC_BATCH_MAX_ENTRIES  256
+
+///
+/// One register access of a SMM_SC_BATCH request. Records are executed in
+/// order. On return, Value of read and modify records holds the value read
+/// from the target, Value of write records is left untouched.
+///
+typedef struct {
+  UINT32    Operation;    // SMM_SC_BATCH_OPERATION
+  UINT32    Width;        // EFI_MM_IO_WIDTH of IO records, ignored for MSR records
+  UINT64    Address;      // IO port or MSR index
+  UINT64    Value;        // Value to write, or OR mask of modify records
+  UINT64    AndMask;      // AND mask of modify records, ignored otherwise
+} SMM_SC_BATCH_ENTRY;
+
+//
+// Upper bound of user MMI handlers dispatched with a single ring transition.
+//
+#define MM_USER_MMI_BATCH_MAX_HANDLERS  128
+
+///
+/// One user MMI handler of a MM_USER_MMI_BATCH.
+///
+typedef struct {
+  VOID    *DispatchHandle;
+  VOID    *Handler;             // EFI_MM_HANDLER_ENTRY_POINT
+} MM_USER_MMI_DESCRIPTOR;
+
+///
+/// The user MMI handlers of one MMI entry, laid out by the supervisor in a page
+/// that is read only to user mode, and handed to the dispatcher registered as
+/// third argument of SMM_REG_HDL_JMP. The handlers are invoked in order and the
+/// EFI_STATUS of each is written to Statuses and the TSC cycles it took to
+/// Cycles, both of which point to a writable page.
+/// A NULL Handler was unregistered while the batch was being dispatched and is
+/// skipped. When StopOnClaim is set, no handler is invoked after one returns
+/// EFI_SUCCESS or EFI_INTERRUPT_PENDING.
+///
+typedef struct {
+  UINT32                    Count;
+  UINT32                    StopOnClaim;
+  UINTN                     *Statuses;
+  UINT64                    *Cycles;
+  MM_USER_MMI_DESCRIPTOR    Handlers[MM_USER_MMI_BATCH_MAX_HANDLERS];
+} MM_USER_MMI_BATCH;
+
+///
+/// Argument of a SMM_MP_PARALLEL_FOR request. Chunks points to one
+/// MM_PARALLEL_FOR_CHUNK per processor in MM, the supervisor describes the
+/// chunk a processor is about to run in its entry and hands the entry to
+/// Procedure in user mode. Without Token the request returns when all chunks
+/// are processed, otherwise it returns once the chunks are dispatched and
+/// SMM_MP_PARALLEL_FOR_CHECK reports on the completion written to Token.
+///
+typedef struct {
+  UINTN    Procedure;           // MM_PARALLEL_FOR_PROCEDURE
+  UINTN    Start;
+  UINTN    End;
+  UINTN    ChunkSize;
+  UINTN    Context;
+  UINTN    Chunks;              // MM_PARALLEL_FOR_CHUNK array
+  UINTN    Token;               // MM_COMPLETION, 0 to block
+} SMM_MP_PARALLEL_FOR_REQUEST;
+
 UINT64
 EFIAPI
 SysCall (
@@ -66,6 +161,28 @@ SysCall (
   UINTN  Arg3
   );
 
+/**
+  Execute a list of IO and MSR accesses with a single supervisor transition.
+
+  Every record is checked against the supervisor policy before it is executed,
+  an access blocked by the policy is handled the same way as a blocked
+  SMM_SC_IO_READ/WRITE or SMM_SC_RDMSR/WRMSR request.
+
+  @param[in, out] Entries   The records to execute, values read are written
+                            back into the records.
+  @param[in]      Count     The number of records, no more than
+                            SMM_SC_BATCH_MAX_ENTRIES.
+
+  @retval EFI_SUCCESS             All records are executed.
+  @retval EFI_INVALID_PARAMETER   Entries is NULL, or Count is 0 or too large.
+**/
+EFI_STATUS
+EFIAPI
+SysCallBatch (
+  IN OUT SMM_SC_BATCH_ENTRY  *Entries,
+  IN     UINTN               Count
+  );
+
 /**
  Check if high privilege instruction need go through Syscall
 
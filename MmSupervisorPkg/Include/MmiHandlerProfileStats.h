@@ -0,0 +1,38 @@
+/** @file
+  Per handler dispatch statistics of the MM supervisor.
+
+  The supervisor appends one MMI_HANDLER_STATS record to every handler of the
+  SMI handler profile database, right after the handler context, and counts
+  it in SMM_CORE_SMI_HANDLER_STRUCTURE.Length. Consumers unaware of the record
+  skip it by walking the handlers with Length.
+
+Copyright (C) Microsoft Corporation.
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __MMI_HANDLER_PROFILE_STATS_H__
+#define __MMI_HANDLER_PROFILE_STATS_H__
+
+#define MMI_HANDLER_STATS_SIGNATURE  SIGNATURE_32('M','H','S','T')
+
+//
+// Buckets of MMI_HANDLER_STATS.StatusCount, by the status returned by the handler
+//
+#define MMI_HANDLER_STATUS_SUCCESS            0 // EFI_SUCCESS
+#define MMI_HANDLER_STATUS_QUIESCED           1 // EFI_WARN_INTERRUPT_SOURCE_QUIESCED
+#define MMI_HANDLER_STATUS_SOURCE_PENDING     2 // EFI_WARN_INTERRUPT_SOURCE_PENDING
+#define MMI_HANDLER_STATUS_INTERRUPT_PENDING  3 // EFI_INTERRUPT_PENDING
+#define MMI_HANDLER_STATUS_OTHER              4 // Any other status
+#define MMI_HANDLER_STATUS_BUCKETS            5
+
+typedef struct {
+  UINT32    Signature;
+  UINT32    Reserved;
+  UINT64    Calls;
+  UINT64    TotalCycles;  // TSC cycles spent in the handler over all calls
+  UINT64    MaxCycles;    // TSC cycles of the longest call
+  UINT64    StatusCount[MMI_HANDLER_STATUS_BUCKETS];
+} MMI_HANDLER_STATS;
+
+#endif
@@ -0,0 +1,83 @@
+/** @file
+  MM Communicate Batch Protocol.
+
+  This protocol queues MM communicate messages for the user handlers and sends
+  all queued messages to MM with a single MMI, rather than one MMI, and one
+  rendezvous of all processors, per message.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MM_COMMUNICATE_BATCH_PROTOCOL_H_
+#define _MM_COMMUNICATE_BATCH_PROTOCOL_H_
+
+#define MM_COMMUNICATE_BATCH_PROTOCOL_GUID \
+  { \
+    0x41b0704e, 0x3f9d, 0x4b96, { 0xb8, 0x34, 0x13, 0x84, 0x14, 0xe1, 0xd1, 0x3f } \
+  }
+
+typedef struct _MM_COMMUNICATE_BATCH_PROTOCOL MM_COMMUNICATE_BATCH_PROTOCOL;
+
+extern EFI_GUID  gMmCommunicateBatchProtocolGuid;
+
+/**
+  Queues a message for a registered handler, to be sent on the next Flush.
+
+  The buffers passed in are only read and updated by Flush, they must stay
+  valid until then. They may be placed in the MM communicate buffer published
+  in the PI SMM communication region table. This function must be called at
+  TPL_NOTIFY or below.
+
+  @param[in] This                 The MM_COMMUNICATE_BATCH_PROTOCOL instance.
+  @param[in, out] CommBuffer      A pointer to the message, starting with EFI_MM_COMMUNICATE_HEADER.
+                                  Updated with the response on Flush.
+  @param[in, out] CommSize        The size of the message. Updated with the size of the response on
+                                  Flush. This parameter is optional and may be NULL.
+  @param[out] ReturnStatus        Updated with the status of the message on Flush, as it would
+                                  have been returned by EFI_MM_COMMUNICATION_PROTOCOL.
+
+  @retval EFI_SUCCESS             The message is queued.
+  @retval EFI_INVALID_PARAMETER   CommBuffer or ReturnStatus is NULL, or CommSize is too small.
+  @retval EFI_OUT_OF_RESOURCES    The queue is full, or the message does not fit in the
+                                  communicate buffer with the messages already queued.
+                                  Flush the queue and try again.
+  @retval EFI_BAD_BUFFER_SIZE     The message alone does not fit in the communicate buffer.
+  @retval EFI_UNSUPPORTED         The caller runs above TPL_NOTIFY.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MM_COMMUNICATE_BATCH_QUEUE)(
+  IN CONST MM_COMMUNICATE_BATCH_PROTOCOL  *This,
+  IN OUT VOID                             *CommBuffer,
+  IN OUT UINTN                            *CommSize OPTIONAL,
+  OUT EFI_STATUS                          *ReturnStatus
+  );
+
+/**
+  Sends all queued messages to MM with a single MMI and empties the queue.
+  This function must be called at TPL_NOTIFY or below.
+
+  @param[in] This                 The MM_COMMUNICATE_BATCH_PROTOCOL instance.
+
+  @retval EFI_SUCCESS             The queued messages were sent, or the queue was empty.
+                                  The status of each message is in its ReturnStatus.
+  @retval EFI_UNSUPPORTED         The caller runs above TPL_NOTIFY, the queue is kept.
+  @retval Others                  The batch could not be sent, every ReturnStatus holds
+                                  this status too.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MM_COMMUNICATE_BATCH_FLUSH)(
+  IN CONST MM_COMMUNICATE_BATCH_PROTOCOL  *This
+  );
+
+struct _MM_COMMUNICATE_BATCH_PROTOCOL {
+  MM_COMMUNICATE_BATCH_QUEUE    Queue;
+  MM_COMMUNICATE_BATCH_FLUSH    Flush;
+};
+
+#endif // _MM_COMMUNICATE_BATCH_PROTOCOL_H_
@@ -0,0 +1,107 @@
+/** @file
+  MM Parallel For Protocol.
+
+  This protocol splits a range of work items into chunks and runs a procedure
+  on every chunk, spread over all the processors in MM.
+
+  Copyright (c), Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MM_PARALLEL_FOR_H_
+#define _MM_PARALLEL_FOR_H_
+
+#include <Protocol/MmMp.h>
+
+#define MM_PARALLEL_FOR_PROTOCOL_GUID \
+  { \
+    0x6f2b8c1e, 0x5d47, 0x4a93, { 0x9e, 0x0c, 0x31, 0xa8, 0x7b, 0x54, 0xd2, 0x6f } \
+  }
+
+typedef struct _MM_PARALLEL_FOR_PROTOCOL MM_PARALLEL_FOR_PROTOCOL;
+
+extern EFI_GUID  gMmParallelForProtocolGuid;
+
+///
+/// A chunk of the range handed to a MM_PARALLEL_FOR_PROCEDURE.
+///
+typedef struct {
+  UINTN    Start;     ///< First item of the chunk.
+  UINTN    End;       ///< One past the last item of the chunk.
+  VOID     *Context;  ///< The Context given to ParallelFor.
+  UINTN    CpuIndex;  ///< The processor running the chunk.
+} MM_PARALLEL_FOR_CHUNK;
+
+/**
+  The procedure run on every chunk of a parallel for.
+
+  @param[in]  Chunk   The chunk to process.
+
+  @return The status of the chunk, any error is reported by ParallelFor.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MM_PARALLEL_FOR_PROCEDURE)(
+  IN CONST MM_PARALLEL_FOR_CHUNK  *Chunk
+  );
+
+/**
+  Run Procedure on the items [Start, End), ChunkSize items at a time, on all
+  the processors in MM. Every processor starts with an even share of the
+  chunks and takes over half of the chunks left to another processor once its
+  own share is done.
+
+  @param[in]  This        The MM_PARALLEL_FOR_PROTOCOL instance.
+  @param[in]  Procedure   The procedure to run on every chunk.
+  @param[in]  Start       The first item of the range.
+  @param[in]  End         One past the last item of the range.
+  @param[in]  ChunkSize   The number of items of a chunk.
+  @param[in]  Context     Passed to Procedure in every chunk.
+  @param[out] Token       If NULL, returns when all chunks are processed.
+                          Otherwise returns once the chunks are dispatched,
+                          CheckOnParallelFor reports on the token.
+
+  @retval EFI_SUCCESS             All chunks are processed, or dispatched when Token is not NULL.
+  @retval EFI_INVALID_PARAMETER   Procedure is NULL, the range is empty, or ChunkSize is 0.
+  @retval EFI_NOT_READY           A parallel for or other procedure is still running.
+  @retval EFI_NOT_STARTED         No processor is available to run the chunks.
+  @retval EFI_OUT_OF_RESOURCES    No token is available.
+  @retval Others                  The error returned by Procedure for a chunk.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MM_PARALLEL_FOR)(
+  IN CONST MM_PARALLEL_FOR_PROTOCOL   *This,
+  IN       MM_PARALLEL_FOR_PROCEDURE  Procedure,
+  IN       UINTN                      Start,
+  IN       UINTN                      End,
+  IN       UINTN                      ChunkSize,
+  IN       VOID                       *Context OPTIONAL,
+  OUT      MM_COMPLETION              *Token   OPTIONAL
+  );
+
+/**
+  Check on a parallel for started with a Token.
+
+  @param[in]  This        The MM_PARALLEL_FOR_PROTOCOL instance.
+  @param[in]  Token       The token returned by ParallelFor.
+
+  @retval EFI_NOT_READY           Chunks are still being processed.
+  @retval EFI_NOT_FOUND           Token is not the one of the last parallel for.
+  @retval EFI_SUCCESS             All chunks are processed.
+  @retval Others                  The error returned by Procedure for a chunk.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MM_CHECK_ON_PARALLEL_FOR)(
+  IN CONST MM_PARALLEL_FOR_PROTOCOL  *This,
+  IN       MM_COMPLETION             Token
+  );
+
+struct _MM_PARALLEL_FOR_PROTOCOL {
+  MM_PARALLEL_FOR             ParallelFor;
+  MM_CHECK_ON_PARALLEL_FOR    CheckOnParallelFor;
+};
+
+#endif
@@ -17,4 +17,26 @@
 #include <Library/DebugLib.h>
 #include <Library/RegisterFilterLib.h>
 
+/**
+  Reads an I/O port, performs a bitwise AND followed by a bitwise OR, and
+  writes the result back to the I/O port, either with one SMM_SC_BATCH modify
+  record or consulting the register filter on the read and on the write.
+
+  @param  Width   The width of the I/O port, FilterWidth8, FilterWidth16 or
+                  FilterWidth32.
+  @param  Port    The I/O port to write.
+  @param  AndData The value to AND with the read value from the I/O port.
+  @param  OrData  The value to OR with the result of the AND operation.
+
+  @return The value written back to the I/O port.
+
+**/
+UINT32
+InternalIoAndThenOr (
+  IN      FILTER_IO_WIDTH  Width,
+  IN      UINTN            Port,
+  IN      UINT32           AndData,
+  IN      UINT32           OrData
+  );
+
 #endif
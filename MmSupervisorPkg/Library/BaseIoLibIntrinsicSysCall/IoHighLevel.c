@@ -5,8 +5,13 @@
   Base Library.
 
   Copyright (c) 2006 - 2018, Intel Corporation. All rights reserved.<BR>
+  Copyright (C) Microsoft Corporation.<BR>
   SPDX-License-Identifier: BSD-2-Clause-Patent
 
+  The 8, 16 and 32 bit read-modify-write routines below go through
+  InternalIoAndThenOr (), which takes one supervisor transition when
+  PcdMmSupervisorIoBatchModify is set.
+
   The following IoLib instances contain the same copy of this file:
 
     BaseIoLibIntrinsic
@@ -42,7 +47,7 @@ IoOr8 (
   IN      UINT8  OrData
   )
 {
-  return IoWrite8 (Port, (UINT8)(IoRead8 (Port) | OrData));
+  return (UINT8)InternalIoAndThenOr (FilterWidth8, Port, MAX_UINT8, OrData);
 }
 
 /**
@@ -70,7 +75,7 @@ IoAnd8 (
   IN      UINT8  AndData
   )
 {
-  return IoWrite8 (Port, (UINT8)(IoRead8 (Port) & AndData));
+  return (UINT8)InternalIoAndThenOr (FilterWidth8, Port, AndData, 0);
 }
 
 /**
@@ -101,7 +106,7 @@ IoAndThenOr8 (
   IN      UINT8  OrData
   )
 {
-  return IoWrite8 (Port, (UINT8)((IoRead8 (Port) & AndData) | OrData));
+  return (UINT8)InternalIoAndThenOr (FilterWidth8, Port, AndData, OrData);
 }
 
 /**
@@ -167,10 +172,12 @@ IoBitFieldWrite8 (
   IN      UINT8  Value
   )
 {
-  return IoWrite8 (
-           Port,
-           BitFieldWrite8 (IoRead8 (Port), StartBit, EndBit, Value)
-           );
+  return (UINT8)InternalIoAndThenOr (
+                  FilterWidth8,
+                  Port,
+                  BitFieldWrite8 (MAX_UINT8, StartBit, EndBit, 0),
+                  BitFieldWrite8 (0, StartBit, EndBit, Value)
+                  );
 }
 
 /**
@@ -208,10 +215,12 @@ IoBitFieldOr8 (
   IN      UINT8  OrData
   )
 {
-  return IoWrite8 (
-           Port,
-           BitFieldOr8 (IoRead8 (Port), StartBit, EndBit, OrData)
-           );
+  return (UINT8)InternalIoAndThenOr (
+                  FilterWidth8,
+                  Port,
+                  MAX_UINT8,
+                  BitFieldOr8 (0, StartBit, EndBit, OrData)
+                  );
 }
 
 /**
@@ -249,10 +258,12 @@ IoBitFieldAnd8 (
   IN      UINT8  AndData
   )
 {
-  return IoWrite8 (
-           Port,
-           BitFieldAnd8 (IoRead8 (Port), StartBit, EndBit, AndData)
-           );
+  return (UINT8)InternalIoAndThenOr (
+                  FilterWidth8,
+                  Port,
+                  BitFieldAnd8 (MAX_UINT8, StartBit, EndBit, AndData),
+                  0
+                  );
 }
 
 /**
@@ -295,10 +306,12 @@ IoBitFieldAndThenOr8 (
   IN      UINT8  OrData
   )
 {
-  return IoWrite8 (
-           Port,
-           BitFieldAndThenOr8 (IoRead8 (Port), StartBit, EndBit, AndData, OrData)
-           );
+  return (UINT8)InternalIoAndThenOr (
+                  FilterWidth8,
+                  Port,
+                  BitFieldAnd8 (MAX_UINT8, StartBit, EndBit, AndData),
+                  BitFieldOr8 (0, StartBit, EndBit, OrData)
+                  );
 }
 
 /**
@@ -327,7 +340,7 @@ IoOr16 (
   IN      UINT16  OrData
   )
 {
-  return IoWrite16 (Port, (UINT16)(IoRead16 (Port) | OrData));
+  return (UINT16)InternalIoAndThenOr (FilterWidth16, Port, MAX_UINT16, OrData);
 }
 
 /**
@@ -356,7 +369,7 @@ IoAnd16 (
   IN      UINT16  AndData
   )
 {
-  return IoWrite16 (Port, (UINT16)(IoRead16 (Port) & AndData));
+  return (UINT16)InternalIoAndThenOr (FilterWidth16, Port, AndData, 0);
 }
 
 /**
@@ -388,7 +401,7 @@ IoAndThenOr16 (
   IN      UINT16  OrData
   )
 {
-  return IoWrite16 (Port, (UINT16)((IoRead16 (Port) & AndData) | OrData));
+  return (UINT16)InternalIoAndThenOr (FilterWidth16, Port, AndData, OrData);
 }
 
 /**
@@ -457,10 +470,12 @@ IoBitFieldWrite16 (
   IN      UINT16  Value
   )
 {
-  return IoWrite16 (
-           Port,
-           BitFieldWrite16 (IoRead16 (Port), StartBit, EndBit, Value)
-           );
+  return (UINT16)InternalIoAndThenOr (
+                   FilterWidth16,
+                   Port,
+                   BitFieldWrite16 (MAX_UINT16, StartBit, EndBit, 0),
+                   BitFieldWrite16 (0, StartBit, EndBit, Value)
+                   );
 }
 
 /**
@@ -499,10 +514,12 @@ IoBitFieldOr16 (
   IN      UINT16  OrData
   )
 {
-  return IoWrite16 (
-           Port,
-           BitFieldOr16 (IoRead16 (Port), StartBit, EndBit, OrData)
-           );
+  return (UINT16)InternalIoAndThenOr (
+                   FilterWidth16,
+                   Port,
+                   MAX_UINT16,
+                   BitFieldOr16 (0, StartBit, EndBit, OrData)
+                   );
 }
 
 /**
@@ -541,10 +558,12 @@ IoBitFieldAnd16 (
   IN      UINT16  AndData
   )
 {
-  return IoWrite16 (
-           Port,
-           BitFieldAnd16 (IoRead16 (Port), StartBit, EndBit, AndData)
-           );
+  return (UINT16)InternalIoAndThenOr (
+                   FilterWidth16,
+                   Port,
+                   BitFieldAnd16 (MAX_UINT16, StartBit, EndBit, AndData),
+                   0
+                   );
 }
 
 /**
@@ -588,10 +607,12 @@ IoBitFieldAndThenOr16 (
   IN      UINT16  OrData
   )
 {
-  return IoWrite16 (
-           Port,
-           BitFieldAndThenOr16 (IoRead16 (Port), StartBit, EndBit, AndData, OrData)
-           );
+  return (UINT16)InternalIoAndThenOr (
+                   FilterWidth16,
+                   Port,
+                   BitFieldAnd16 (MAX_UINT16, StartBit, EndBit, AndData),
+                   BitFieldOr16 (0, StartBit, EndBit, OrData)
+                   );
 }
 
 /**
@@ -620,7 +641,7 @@ IoOr32 (
   IN      UINT32  OrData
   )
 {
-  return IoWrite32 (Port, IoRead32 (Port) | OrData);
+  return InternalIoAndThenOr (FilterWidth32, Port, MAX_UINT32, OrData);
 }
 
 /**
@@ -649,7 +670,7 @@ IoAnd32 (
   IN      UINT32  AndData
   )
 {
-  return IoWrite32 (Port, IoRead32 (Port) & AndData);
+  return InternalIoAndThenOr (FilterWidth32, Port, AndData, 0);
 }
 
 /**
@@ -681,7 +702,7 @@ IoAndThenOr32 (
   IN      UINT32  OrData
   )
 {
-  return IoWrite32 (Port, (IoRead32 (Port) & AndData) | OrData);
+  return InternalIoAndThenOr (FilterWidth32, Port, AndData, OrData);
 }
 
 /**
@@ -750,9 +771,11 @@ IoBitFieldWrite32 (
   IN      UINT32  Value
   )
 {
-  return IoWrite32 (
+  return InternalIoAndThenOr (
+           FilterWidth32,
            Port,
-           BitFieldWrite32 (IoRead32 (Port), StartBit, EndBit, Value)
+           BitFieldWrite32 (MAX_UINT32, StartBit, EndBit, 0),
+           BitFieldWrite32 (0, StartBit, EndBit, Value)
            );
 }
 
@@ -792,9 +815,11 @@ IoBitFieldOr32 (
   IN      UINT32  OrData
   )
 {
-  return IoWrite32 (
+  return InternalIoAndThenOr (
+           FilterWidth32,
            Port,
-           BitFieldOr32 (IoRead32 (Port), StartBit, EndBit, OrData)
+           MAX_UINT32,
+           BitFieldOr32 (0, StartBit, EndBit, OrData)
            );
 }
 
@@ -834,9 +859,11 @@ IoBitFieldAnd32 (
   IN      UINT32  AndData
   )
 {
-  return IoWrite32 (
+  return InternalIoAndThenOr (
+           FilterWidth32,
            Port,
-           BitFieldAnd32 (IoRead32 (Port), StartBit, EndBit, AndData)
+           BitFieldAnd32 (MAX_UINT32, StartBit, EndBit, AndData),
+           0
            );
 }
 
@@ -881,9 +908,11 @@ IoBitFieldAndThenOr32 (
   IN      UINT32  OrData
   )
 {
-  return IoWrite32 (
+  return InternalIoAndThenOr (
+           FilterWidth32,
            Port,
-           BitFieldAndThenOr32 (IoRead32 (Port), StartBit, EndBit, AndData, OrData)
+           BitFieldAnd32 (MAX_UINT32, StartBit, EndBit, AndData),
+           BitFieldOr32 (0, StartBit, EndBit, OrData)
            );
 }
 
@@ -269,3 +269,144 @@ IoWrite32 (
 
   return Value;
 }
+
+/**
+  Reads an I/O port without consulting the register filter.
+
+  @param  Width   The width of the I/O port, FilterWidth8, FilterWidth16 or
+                  FilterWidth32.
+  @param  Port    The I/O port to read.
+
+  @return The value read.
+
+**/
+STATIC
+UINT32
+InternalIoReadUnfiltered (
+  IN      FILTER_IO_WIDTH  Width,
+  IN      UINTN            Port
+  )
+{
+  if (Width == FilterWidth8) {
+    return IsTdxGuest () ? TdIoRead8 (Port) : (UINT8)SysCall (SMM_SC_IO_READ, Port, MM_IO_UINT8, 0);
+  } else if (Width == FilterWidth16) {
+    ASSERT ((Port & 1) == 0);
+    return IsTdxGuest () ? TdIoRead16 (Port) : (UINT16)SysCall (SMM_SC_IO_READ, Port, MM_IO_UINT16, 0);
+  }
+
+  ASSERT ((Port & 3) == 0);
+  return IsTdxGuest () ? TdIoRead32 (Port) : (UINT32)SysCall (SMM_SC_IO_READ, Port, MM_IO_UINT32, 0);
+}
+
+/**
+  Writes an I/O port without consulting the register filter.
+
+  @param  Width   The width of the I/O port, FilterWidth8, FilterWidth16 or
+                  FilterWidth32.
+  @param  Port    The I/O port to write.
+  @param  Value   The value to write to the I/O port.
+
+**/
+STATIC
+VOID
+InternalIoWriteUnfiltered (
+  IN      FILTER_IO_WIDTH  Width,
+  IN      UINTN            Port,
+  IN      UINT32           Value
+  )
+{
+  if (Width == FilterWidth8) {
+    if (IsTdxGuest ()) {
+      TdIoWrite8 (Port, (UINT8)Value);
+    } else {
+      SysCall (SMM_SC_IO_WRITE, Port, MM_IO_UINT8, (UINT8)Value);
+    }
+  } else if (Width == FilterWidth16) {
+    ASSERT ((Port & 1) == 0);
+    if (IsTdxGuest ()) {
+      TdIoWrite16 (Port, (UINT16)Value);
+    } else {
+      SysCall (SMM_SC_IO_WRITE, Port, MM_IO_UINT16, (UINT16)Value);
+    }
+  } else {
+    ASSERT ((Port & 3) == 0);
+    if (IsTdxGuest ()) {
+      TdIoWrite32 (Port, Value);
+    } else {
+      SysCall (SMM_SC_IO_WRITE, Port, MM_IO_UINT32, Value);
+    }
+  }
+}
+
+/**
+  Reads an I/O port, performs a bitwise AND followed by a bitwise OR, and
+  writes the result back to the I/O port.
+
+  When PcdMmSupervisorIoBatchModify is set, the read and the write are handed
+  to the supervisor as one SMM_SC_BATCH modify record and the register filter
+  is not consulted. Otherwise the register filter sees the read and then the
+  write with the value computed from it before either reaches the port, and
+  may take over or change each of them, the same way as with IoRead and
+  IoWrite.
+
+  @param  Width   The width of the I/O port, FilterWidth8, FilterWidth16 or
+                  FilterWidth32.
+  @param  Port    The I/O port to write.
+  @param  AndData The value to AND with the read value from the I/O port.
+  @param  OrData  The value to OR with the result of the AND operation.
+
+  @return The value written back to the I/O port.
+
+**/
+UINT32
+InternalIoAndThenOr (
+  IN      FILTER_IO_WIDTH  Width,
+  IN      UINTN            Port,
+  IN      UINT32           AndData,
+  IN      UINT32           OrData
+  )
+{
+  UINT32              Value;
+  UINT32              WidthMask;
+  SMM_SC_BATCH_ENTRY  Entry;
+
+  if (Width == FilterWidth8) {
+    WidthMask   = MAX_UINT8;
+    Entry.Width = MM_IO_UINT8;
+  } else if (Width == FilterWidth16) {
+    ASSERT ((Port & 1) == 0);
+    WidthMask   = MAX_UINT16;
+    Entry.Width = MM_IO_UINT16;
+  } else {
+    ASSERT ((Port & 3) == 0);
+    WidthMask   = MAX_UINT32;
+    Entry.Width = MM_IO_UINT32;
+  }
+
+  if (FeaturePcdGet (PcdMmSupervisorIoBatchModify) && !IsTdxGuest ()) {
+    Entry.Operation = SMM_SC_BATCH_IO_MODIFY;
+    Entry.Address   = Port;
+    Entry.Value     = OrData & WidthMask;
+    Entry.AndMask   = AndData;
+    SysCallBatch (&Entry, 1);
+
+    // The record comes back with the value read from the port
+    return (((UINT32)Entry.Value & AndData) | OrData) & WidthMask;
+  }
+
+  Value = 0;
+  if (FilterBeforeIoRead (Width, Port, &Value)) {
+    Value = InternalIoReadUnfiltered (Width, Port);
+  }
+
+  FilterAfterIoRead (Width, Port, &Value);
+
+  Value = ((Value & AndData) | OrData) & WidthMask;
+  if (FilterBeforeIoWrite (Width, Port, &Value)) {
+    InternalIoWriteUnfiltered (Width, Port, Value);
+  }
+
+  FilterAfterIoWrite (Width, Port, &Value);
+
+  return Value & WidthMask;
+}
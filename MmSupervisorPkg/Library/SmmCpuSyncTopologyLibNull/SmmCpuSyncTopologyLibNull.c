@@ -0,0 +1,42 @@
+/** @file
+  NULL instance of SmmCpuSyncTopologyLib, for platforms whose SmmCpuSyncLib
+  instance does not use the package layout of the CPUs.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Base.h>
+
+#include <Library/DebugLib.h>
+#include <Library/SmmCpuSyncTopologyLib.h>
+
+/**
+  Provide the package of each CPU to an SMM CPU Sync context.
+
+  Must be called right after SmmCpuSyncContextInit(), before any CPU checks in.
+  Implementations that do not use the layout ignore it.
+
+  If Context is NULL, then ASSERT().
+  If CpuPackage is NULL, then ASSERT().
+
+  @param[in,out]  Context           Pointer to the SMM CPU Sync context object.
+  @param[in]      CpuPackage        Package number of each CPU, indexed by CPU index, with as
+                                    many entries as the NumberOfCpus of the context.
+
+  @retval RETURN_SUCCESS            The layout is not used by this implementation.
+
+**/
+RETURN_STATUS
+EFIAPI
+SmmCpuSyncSetPackageLayout (
+  IN OUT SMM_CPU_SYNC_CONTEXT  *Context,
+  IN     CONST UINT32          *CpuPackage
+  )
+{
+  ASSERT (Context != NULL);
+  ASSERT (CpuPackage != NULL);
+
+  return RETURN_SUCCESS;
+}
@@ -0,0 +1,47 @@
+/** @file
+  NULL instance of SmmCpuSyncWaitLib, for platforms whose SmmCpuSyncLib
+  instance lets the APs wait with PAUSE.
+
+  Copyright (C) Microsoft Corporation.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Base.h>
+
+#include <Library/DebugLib.h>
+#include <Library/SmmCpuSyncWaitLib.h>
+
+/**
+  Get the wake up counters of the APs waiting for the BSP, summed up over all CPUs.
+
+  If Context is NULL, then ASSERT().
+  If Wakeups is NULL, then ASSERT().
+  If SpuriousWakeups is NULL, then ASSERT().
+
+  @param[in,out]  Context           Pointer to the SMM CPU Sync context object.
+  @param[in]      Reset             TRUE to clear the counters once they are read.
+  @param[out]     Wakeups           Number of times a waiting AP was woken up.
+  @param[out]     SpuriousWakeups   Number of wake ups that did not release the AP.
+
+  @retval RETURN_UNSUPPORTED        The APs wait with PAUSE, both counters are 0.
+
+**/
+RETURN_STATUS
+EFIAPI
+SmmCpuSyncGetWaitStatistics (
+  IN OUT SMM_CPU_SYNC_CONTEXT  *Context,
+  IN     BOOLEAN               Reset,
+  OUT    UINT64                *Wakeups,
+  OUT    UINT64                *SpuriousWakeups
+  )
+{
+  ASSERT (Context != NULL);
+  ASSERT (Wakeups != NULL);
+  ASSERT (SpuriousWakeups != NULL);
+
+  *Wakeups         = 0;
+  *SpuriousWakeups = 0;
+
+  return RETURN_UNSUPPORTED;
+}
@@ -0,0 +1,637 @@
+/** @file SmmPolicyGateIndex.c
+
+  Builds sorted lookup tables from the IO and MSR descriptors of a secure
+  policy so that the policy gate can answer resource requests by binary
+  search instead of walking every descriptor.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <SmmSecurePolicy.h>
+#include <Protocol/MmCpuIo.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SmmPolicyGateLib.h>
+
+#include "SmmPolicyGateLibInternal.h"
+
+POLICY_GATE_INDEX  mPolicyGateIndex;
+
+/**
+  Compare two compiled intervals by start, end and then descriptor index.
+
+  @param[in]  Buffer1   The first POLICY_GATE_INTERVAL to compare.
+  @param[in]  Buffer2   The second POLICY_GATE_INTERVAL to compare.
+
+  @retval 0     Buffer1 equal to Buffer2.
+  @return <0    Buffer1 is less than Buffer2.
+  @return >0    Buffer1 is greater than Buffer2.
+**/
+STATIC
+INTN
+EFIAPI
+PolicyGateIntervalCompare (
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2
+  )
+{
+  CONST POLICY_GATE_INTERVAL  *Interval1;
+  CONST POLICY_GATE_INTERVAL  *Interval2;
+
+  Interval1 = (CONST POLICY_GATE_INTERVAL *)Buffer1;
+  Interval2 = (CONST POLICY_GATE_INTERVAL *)Buffer2;
+
+  if (Interval1->Start != Interval2->Start) {
+    return (Interval1->Start < Interval2->Start) ? -1 : 1;
+  }
+
+  if (Interval1->End != Interval2->End) {
+    return (Interval1->End < Interval2->End) ? -1 : 1;
+  }
+
+  if (Interval1->Index != Interval2->Index) {
+    return (Interval1->Index < Interval2->Index) ? -1 : 1;
+  }
+
+  return 0;
+}
+
+/**
+  Sort a table of compiled ranges and make sure no two of them overlap, so that
+  a single binary search finds the only range covering a given address.
+
+  @param[in, out] Ranges    The ranges to be sorted.
+  @param[in]      Count     Number of entries in Ranges.
+
+  @retval EFI_SUCCESS             The ranges are sorted and disjoint.
+  @retval EFI_SECURITY_VIOLATION  Two ranges overlap.
+**/
+STATIC
+EFI_STATUS
+SortAndCheckRanges (
+  IN OUT POLICY_GATE_INTERVAL  *Ranges,
+  IN     UINTN                 Count
+  )
+{
+  POLICY_GATE_INTERVAL  SortBuffer;
+  UINTN                 Index;
+
+  QuickSort (Ranges, Count, sizeof (POLICY_GATE_INTERVAL), PolicyGateIntervalCompare, &SortBuffer);
+
+  for (Index = 1; Index < Count; Index++) {
+    if (Ranges[Index].Start <= Ranges[Index - 1].End) {
+      DEBUG ((
+        DEBUG_ERROR,
+        "%a Overlapping policy ranges [%x-%x] and [%x-%x].\n",
+        __FUNCTION__,
+        Ranges[Index - 1].Start,
+        Ranges[Index - 1].End,
+        Ranges[Index].Start,
+        Ranges[Index].End
+        ));
+      return EFI_SECURITY_VIOLATION;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Find the range covering the given address in a sorted, disjoint table.
+
+  @param[in]  Ranges    The sorted ranges to search.
+  @param[in]  Count     Number of entries in Ranges.
+  @param[in]  Address   The address to look up.
+
+  @return The covering range, or NULL if no range covers Address.
+**/
+STATIC
+CONST POLICY_GATE_INTERVAL *
+FindRange (
+  IN CONST POLICY_GATE_INTERVAL  *Ranges,
+  IN UINTN                       Count,
+  IN UINT32                      Address
+  )
+{
+  UINTN  Low;
+  UINTN  High;
+  UINTN  Mid;
+
+  //
+  // Find the last range that starts at or below Address.
+  //
+  Low  = 0;
+  High = Count;
+  while (Low < High) {
+    Mid = Low + (High - Low) / 2;
+    if (Ranges[Mid].Start <= Address) {
+      Low = Mid + 1;
+    } else {
+      High = Mid;
+    }
+  }
+
+  if ((Low == 0) || (Ranges[Low - 1].End < Address)) {
+    return NULL;
+  }
+
+  return &Ranges[Low - 1];
+}
+
+/**
+  Find a strict-width IO entry matching the port and width exactly.
+
+  @param[in]  IoAddress   The IO port of the access.
+  @param[in]  IoSize      The size of the access in bytes.
+
+  @return The matching entry with the lowest descriptor index, or NULL.
+**/
+STATIC
+CONST POLICY_GATE_INTERVAL *
+FindStrictIoEntry (
+  IN UINT32  IoAddress,
+  IN UINT32  IoSize
+  )
+{
+  CONST POLICY_GATE_INTERVAL  *Strict;
+  UINTN                       Low;
+  UINTN                       High;
+  UINTN                       Mid;
+
+  Strict = mPolicyGateIndex.IoStrict;
+
+  //
+  // Find the first entry ordered at or after (IoAddress, IoSize), entries with
+  // the same key are ordered by descriptor index.
+  //
+  Low  = 0;
+  High = mPolicyGateIndex.IoStrictCount;
+  while (Low < High) {
+    Mid = Low + (High - Low) / 2;
+    if ((Strict[Mid].Start < IoAddress) ||
+        ((Strict[Mid].Start == IoAddress) && (Strict[Mid].End < IoSize)))
+    {
+      Low = Mid + 1;
+    } else {
+      High = Mid;
+    }
+  }
+
+  if ((Low < mPolicyGateIndex.IoStrictCount) &&
+      (Strict[Low].Start == IoAddress) &&
+      (Strict[Low].End == IoSize))
+  {
+    return &Strict[Low];
+  }
+
+  return NULL;
+}
+
+/**
+  Release all tables held by the compiled index.
+**/
+STATIC
+VOID
+ResetPolicyIndex (
+  VOID
+  )
+{
+  if (mPolicyGateIndex.IoRanges != NULL) {
+    FreePool (mPolicyGateIndex.IoRanges);
+  }
+
+  if (mPolicyGateIndex.IoStrict != NULL) {
+    FreePool (mPolicyGateIndex.IoStrict);
+  }
+
+  if (mPolicyGateIndex.MsrRanges != NULL) {
+    FreePool (mPolicyGateIndex.MsrRanges);
+  }
+
+  if (mPolicyGateIndex.IoBitmap != NULL) {
+    FreePool (mPolicyGateIndex.IoBitmap);
+  }
+
+  ZeroMem (&mPolicyGateIndex, sizeof (mPolicyGateIndex));
+}
+
+/**
+  Get the bit position of a port in the flattened IO port map.
+
+  @param[in]  WidthIndex    0, 1 or 2 for 8, 16 or 32 bit accesses.
+  @param[in]  IsWrite       TRUE for the write attribute, FALSE for read.
+  @param[in]  Port          The starting IO port of the access.
+
+  @return The bit offset from the start of the map.
+**/
+STATIC
+UINTN
+IoBitmapBit (
+  IN UINTN    WidthIndex,
+  IN BOOLEAN  IsWrite,
+  IN UINT32   Port
+  )
+{
+  return (WidthIndex * 2 + (IsWrite ? 1 : 0)) * POLICY_GATE_IO_PORT_COUNT + Port;
+}
+
+/**
+  Flatten the compiled IO tables into a map that records, for every port and
+  access width, which attributes the deciding descriptor carries. This takes
+  one lookup per port and width at compile time, after which IO requests are
+  answered with a single bit test.
+
+  @retval EFI_SUCCESS             The port map is built.
+  @retval EFI_OUT_OF_RESOURCES    Not enough memory for the port map.
+**/
+STATIC
+EFI_STATUS
+BuildIoBitmap (
+  VOID
+  )
+{
+  UINTN   WidthIndex;
+  UINTN   Bit;
+  UINT32  IoSize;
+  UINT32  Port;
+  UINT32  Attributes;
+
+  mPolicyGateIndex.IoBitmap = AllocateZeroPool (POLICY_GATE_IO_BITMAP_SIZE);
+  if (mPolicyGateIndex.IoBitmap == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (WidthIndex = 0; WidthIndex < POLICY_GATE_IO_WIDTH_COUNT; WidthIndex++) {
+    IoSize = 1 << WidthIndex;
+    for (Port = 0; Port + IoSize <= POLICY_GATE_IO_PORT_COUNT; Port++) {
+      if (LookupIoPolicyIndex (Port, IoSize, &Attributes) >= mPolicyGateIndex.IoRoot->Count) {
+        continue;
+      }
+
+      if (Attributes & SECURE_POLICY_RESOURCE_ATTR_READ) {
+        Bit                                 = IoBitmapBit (WidthIndex, FALSE, Port);
+        mPolicyGateIndex.IoBitmap[Bit / 8] |= (UINT8)(1 << (Bit % 8));
+      }
+
+      if (Attributes & SECURE_POLICY_RESOURCE_ATTR_WRITE) {
+        Bit                                 = IoBitmapBit (WidthIndex, TRUE, Port);
+        mPolicyGateIndex.IoBitmap[Bit / 8] |= (UINT8)(1 << (Bit % 8));
+      }
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Compile the IO descriptors of a policy root into the lookup index.
+
+  @param[in]  SmmSecurityPolicy   The policy that owns the root.
+  @param[in]  PolicyRoot          The IO policy root.
+
+  @retval EFI_SUCCESS             The IO tables are built.
+  @retval EFI_OUT_OF_RESOURCES    Not enough memory for the tables.
+  @retval EFI_SECURITY_VIOLATION  The non strict-width ranges overlap.
+**/
+STATIC
+EFI_STATUS
+CompileIoPolicy (
+  IN SMM_SUPV_SECURE_POLICY_DATA_V1_0  *SmmSecurityPolicy,
+  IN SMM_SUPV_POLICY_ROOT_V1           *PolicyRoot
+  )
+{
+  SMM_SUPV_SECURE_POLICY_IO_DESCRIPTOR_V1_0  *IoDescriptor;
+  POLICY_GATE_INTERVAL                       *Entry;
+  POLICY_GATE_INTERVAL                       SortBuffer;
+  UINT32                                     Index;
+  EFI_STATUS                                 Status;
+
+  if (PolicyRoot->Count == 0) {
+    return EFI_SUCCESS;
+  }
+
+  mPolicyGateIndex.IoRanges = AllocatePool (PolicyRoot->Count * sizeof (POLICY_GATE_INTERVAL));
+  mPolicyGateIndex.IoStrict = AllocatePool (PolicyRoot->Count * sizeof (POLICY_GATE_INTERVAL));
+  if ((mPolicyGateIndex.IoRanges == NULL) || (mPolicyGateIndex.IoStrict == NULL)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  IoDescriptor = (SMM_SUPV_SECURE_POLICY_IO_DESCRIPTOR_V1_0 *)((UINTN)SmmSecurityPolicy + PolicyRoot->Offset);
+  for (Index = 0; Index < PolicyRoot->Count; Index++) {
+    if (IoDescriptor[Index].Attributes & SECURE_POLICY_RESOURCE_ATTR_STRICT_WIDTH) {
+      Entry        = &mPolicyGateIndex.IoStrict[mPolicyGateIndex.IoStrictCount++];
+      Entry->Start = IoDescriptor[Index].IoAddress;
+      Entry->End   = IoDescriptor[Index].LengthOrWidth;
+    } else if (IoDescriptor[Index].LengthOrWidth != 0) {
+      Entry        = &mPolicyGateIndex.IoRanges[mPolicyGateIndex.IoRangeCount++];
+      Entry->Start = IoDescriptor[Index].IoAddress;
+      Entry->End   = (UINT32)IoDescriptor[Index].IoAddress + IoDescriptor[Index].LengthOrWidth - 1;
+    } else {
+      // A zero length range can never be matched by the descriptor walk either
+      continue;
+    }
+
+    Entry->Index      = Index;
+    Entry->Attributes = IoDescriptor[Index].Attributes;
+  }
+
+  QuickSort (
+    mPolicyGateIndex.IoStrict,
+    mPolicyGateIndex.IoStrictCount,
+    sizeof (POLICY_GATE_INTERVAL),
+    PolicyGateIntervalCompare,
+    &SortBuffer
+    );
+
+  Status = SortAndCheckRanges (mPolicyGateIndex.IoRanges, mPolicyGateIndex.IoRangeCount);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // The port map is only an accelerator on top of the sorted tables, go on
+  // without it if it cannot be built.
+  //
+  if (EFI_ERROR (BuildIoBitmap ())) {
+    DEBUG ((DEBUG_WARN, "%a Unable to build IO port map, using sorted tables only.\n", __FUNCTION__));
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Compile the MSR descriptors of a policy root into the lookup index.
+
+  @param[in]  SmmSecurityPolicy   The policy that owns the root.
+  @param[in]  PolicyRoot          The MSR policy root.
+
+  @retval EFI_SUCCESS             The MSR table is built.
+  @retval EFI_OUT_OF_RESOURCES    Not enough memory for the table.
+  @retval EFI_SECURITY_VIOLATION  The MSR ranges overlap.
+**/
+STATIC
+EFI_STATUS
+CompileMsrPolicy (
+  IN SMM_SUPV_SECURE_POLICY_DATA_V1_0  *SmmSecurityPolicy,
+  IN SMM_SUPV_POLICY_ROOT_V1           *PolicyRoot
+  )
+{
+  SMM_SUPV_SECURE_POLICY_MSR_DESCRIPTOR_V1_0  *MsrDescriptor;
+  POLICY_GATE_INTERVAL                        *Entry;
+  UINT32                                      Index;
+
+  if (PolicyRoot->Count == 0) {
+    return EFI_SUCCESS;
+  }
+
+  mPolicyGateIndex.MsrRanges = AllocatePool (PolicyRoot->Count * sizeof (POLICY_GATE_INTERVAL));
+  if (mPolicyGateIndex.MsrRanges == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  MsrDescriptor = (SMM_SUPV_SECURE_POLICY_MSR_DESCRIPTOR_V1_0 *)((UINTN)SmmSecurityPolicy + PolicyRoot->Offset);
+  for (Index = 0; Index < PolicyRoot->Count; Index++) {
+    //
+    // The descriptor walk compares against a 32-bit end address, so a range
+    // that is empty or runs past the top of the MSR space never matches.
+    //
+    if ((MsrDescriptor[Index].Length == 0) ||
+        ((UINT64)MsrDescriptor[Index].MsrAddress + MsrDescriptor[Index].Length > MAX_UINT32))
+    {
+      continue;
+    }
+
+    Entry             = &mPolicyGateIndex.MsrRanges[mPolicyGateIndex.MsrRangeCount++];
+    Entry->Start      = MsrDescriptor[Index].MsrAddress;
+    Entry->End        = MsrDescriptor[Index].MsrAddress + MsrDescriptor[Index].Length - 1;
+    Entry->Index      = Index;
+    Entry->Attributes = MsrDescriptor[Index].Attributes;
+  }
+
+  return SortAndCheckRanges (mPolicyGateIndex.MsrRanges, mPolicyGateIndex.MsrRangeCount);
+}
+
+/**
+  Check whether the lookup index was compiled from the given policy.
+
+  @param[in]  SmmSecurityPolicy   The address of applied SMM secure policy.
+
+  @retval TRUE    Lookups against this policy can be served by the index.
+  @retval FALSE   Lookups against this policy need to walk the descriptors.
+**/
+BOOLEAN
+IsPolicyIndexed (
+  IN SMM_SUPV_SECURE_POLICY_DATA_V1_0  *SmmSecurityPolicy
+  )
+{
+  return (SmmSecurityPolicy != NULL) && (SmmSecurityPolicy == mPolicyGateIndex.Policy);
+}
+
+/**
+  Look up the IO descriptor that decides an access from the compiled index.
+
+  The descriptor walk stops at the first strict-width entry matching both port
+  and width, or at the first other entry covering either the first or the last
+  port of the access. Each of these is found by binary search and the one with
+  the lowest descriptor index is reported.
+
+  @param[in]  IoAddress     The starting IO port of the access.
+  @param[in]  IoSize        The size of the access in bytes.
+  @param[out] Attributes    The attributes of the deciding descriptor.
+
+  @return The index of the deciding descriptor in the policy, or the count of
+          IO descriptors if no descriptor covers the access.
+**/
+UINT32
+LookupIoPolicyIndex (
+  IN  UINT32  IoAddress,
+  IN  UINT32  IoSize,
+  OUT UINT32  *Attributes
+  )
+{
+  CONST POLICY_GATE_INTERVAL  *Candidate[3];
+  UINT32                      Index;
+  UINT32                      Found;
+
+  Candidate[0] = FindStrictIoEntry (IoAddress, IoSize);
+  Candidate[1] = FindRange (mPolicyGateIndex.IoRanges, mPolicyGateIndex.IoRangeCount, IoAddress);
+  Candidate[2] = FindRange (mPolicyGateIndex.IoRanges, mPolicyGateIndex.IoRangeCount, IoAddress + IoSize - 1);
+
+  Found = mPolicyGateIndex.IoRoot->Count;
+  for (Index = 0; Index < ARRAY_SIZE (Candidate); Index++) {
+    if ((Candidate[Index] != NULL) && (Candidate[Index]->Index < Found)) {
+      Found       = Candidate[Index]->Index;
+      *Attributes = Candidate[Index]->Attributes;
+    }
+  }
+
+  return Found;
+}
+
+/**
+  Check the flattened IO port map for an access.
+
+  @param[in]  IoAddress     The starting IO port of the access, the access must
+                            not run past the last IO port.
+  @param[in]  IoWidth       The width of the access, one of MM_IO_UINT8,
+                            MM_IO_UINT16 or MM_IO_UINT32.
+  @param[in]  AccessMask    SECURE_POLICY_RESOURCE_ATTR_READ and/or
+                            SECURE_POLICY_RESOURCE_ATTR_WRITE, no other bits.
+
+  @retval TRUE    The deciding descriptor carries one of the requested attributes.
+  @retval FALSE   No descriptor covers the access, or the deciding descriptor
+                  carries none of the requested attributes.
+**/
+BOOLEAN
+IsIoAccessMatchedInBitmap (
+  IN UINT32           IoAddress,
+  IN EFI_MM_IO_WIDTH  IoWidth,
+  IN UINT32           AccessMask
+  )
+{
+  UINTN  Bit;
+
+  if (AccessMask & SECURE_POLICY_RESOURCE_ATTR_READ) {
+    Bit = IoBitmapBit (IoWidth, FALSE, IoAddress);
+    if (mPolicyGateIndex.IoBitmap[Bit / 8] & (1 << (Bit % 8))) {
+      return TRUE;
+    }
+  }
+
+  if (AccessMask & SECURE_POLICY_RESOURCE_ATTR_WRITE) {
+    Bit = IoBitmapBit (IoWidth, TRUE, IoAddress);
+    if (mPolicyGateIndex.IoBitmap[Bit / 8] & (1 << (Bit % 8))) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+  Look up the MSR descriptor that decides an access from the compiled index.
+
+  @param[in]  MsrAddress    The MSR being accessed.
+  @param[out] Attributes    The attributes of the deciding descriptor.
+
+  @return The index of the deciding descriptor in the policy, or the count of
+          MSR descriptors if no descriptor covers the access.
+**/
+UINT32
+LookupMsrPolicyIndex (
+  IN  UINT32  MsrAddress,
+  OUT UINT32  *Attributes
+  )
+{
+  CONST POLICY_GATE_INTERVAL  *Range;
+
+  Range = FindRange (mPolicyGateIndex.MsrRanges, mPolicyGateIndex.MsrRangeCount, MsrAddress);
+  if (Range == NULL) {
+    return mPolicyGateIndex.MsrRoot->Count;
+  }
+
+  *Attributes = Range->Attributes;
+  return Range->Index;
+}
+
+/**
+  Compile the IO and MSR descriptors of a secure policy into sorted lookup
+  tables, and cache the policy root of each descriptor type. Once compiled,
+  IsIoReadWriteAllowed, IsMsrReadWriteAllowed and IsInstructionExecutionAllowed
+  answer requests against this policy without walking the policy roots and
+  descriptors. Requests against any other policy keep using the walk.
+
+  The policy content must not change after it is compiled. Compiling a policy
+  releases the tables of the previously compiled one, compiling a NULL policy
+  only releases them.
+
+  @param[in]  SmmSecurityPolicy   The address of the SMM secure policy to compile,
+                                  or NULL to drop the current lookup tables.
+
+  @retval EFI_SUCCESS             The policy is compiled.
+  @retval EFI_OUT_OF_RESOURCES    Not enough memory to build the lookup tables.
+  @retval EFI_SECURITY_VIOLATION  The IO or MSR ranges overlap, the policy is
+                                  left uncompiled.
+**/
+EFI_STATUS
+EFIAPI
+CompileSecurityPolicy (
+  IN SMM_SUPV_SECURE_POLICY_DATA_V1_0  *SmmSecurityPolicy
+  )
+{
+  EFI_STATUS               Status;
+  SMM_SUPV_POLICY_ROOT_V1  *PolicyRoot;
+  SMM_SUPV_POLICY_ROOT_V1  *IoRoot;
+  SMM_SUPV_POLICY_ROOT_V1  *MsrRoot;
+  SMM_SUPV_POLICY_ROOT_V1  *InstructionRoot;
+  UINT32                   Index;
+
+  ResetPolicyIndex ();
+
+  if (SmmSecurityPolicy == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // Keep the first root of each type, the same one the descriptor walk would find.
+  //
+  IoRoot          = NULL;
+  MsrRoot         = NULL;
+  InstructionRoot = NULL;
+  PolicyRoot      = (SMM_SUPV_POLICY_ROOT_V1 *)((UINTN)SmmSecurityPolicy + SmmSecurityPolicy->PolicyRootOffset);
+  for (Index = 0; Index < SmmSecurityPolicy->PolicyRootCount; Index++) {
+    if ((PolicyRoot[Index].Type == SMM_SUPV_SECURE_POLICY_DESCRIPTOR_TYPE_IO) && (IoRoot == NULL)) {
+      IoRoot = &PolicyRoot[Index];
+    } else if ((PolicyRoot[Index].Type == SMM_SUPV_SECURE_POLICY_DESCRIPTOR_TYPE_MSR) && (MsrRoot == NULL)) {
+      MsrRoot = &PolicyRoot[Index];
+    } else if ((PolicyRoot[Index].Type == SMM_SUPV_SECURE_POLICY_DESCRIPTOR_TYPE_INSTRUCTION) && (InstructionRoot == NULL)) {
+      InstructionRoot = &PolicyRoot[Index];
+    }
+  }
+
+  mPolicyGateIndex.IoRoot          = IoRoot;
+  mPolicyGateIndex.MsrRoot         = MsrRoot;
+  mPolicyGateIndex.InstructionRoot = InstructionRoot;
+
+  Status = EFI_SUCCESS;
+  if (IoRoot != NULL) {
+    Status = CompileIoPolicy (SmmSecurityPolicy, IoRoot);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a Failed to compile IO policy - %r\n", __FUNCTION__, Status));
+      goto Exit;
+    }
+  }
+
+  if (MsrRoot != NULL) {
+    Status = CompileMsrPolicy (SmmSecurityPolicy, MsrRoot);
+    if (EFI_ERROR (Status)) {
+      DEBUG ((DEBUG_ERROR, "%a Failed to compile MSR policy - %r\n", __FUNCTION__, Status));
+      goto Exit;
+    }
+  }
+
+  mPolicyGateIndex.Policy = SmmSecurityPolicy;
+
+  DEBUG ((
+    DEBUG_INFO,
+    "%a Policy compiled: %d IO ranges, %d strict IO entries, %d MSR ranges, IO port map %a.\n",
+    __FUNCTION__,
+    mPolicyGateIndex.IoRangeCount,
+    mPolicyGateIndex.IoStrictCount,
+    mPolicyGateIndex.MsrRangeCount,
+    (mPolicyGateIndex.IoBitmap != NULL) ? "built" : "absent"
+    ));
+
+Exit:
+  if (EFI_ERROR (Status)) {
+    ResetPolicyIndex ();
+  }
+
+  return Status;
+}
@@ -17,6 +17,8 @@
 #include <Library/SysCallLib.h>
 #include <Library/SafeIntLib.h>
 
+#include "SmmPolicyGateLibInternal.h"
+
 /**
   Given an IO port address and size, determine if the request is allowed by
   our policy.
@@ -49,6 +51,7 @@ IsIoReadWriteAllowed (
   SMM_SUPV_SECURE_POLICY_IO_DESCRIPTOR_V1_0  *IoDescriptor = NULL;
   SMM_SUPV_POLICY_ROOT_V1                    *PolicyRoot   = NULL;
   UINT32                                     IoSize        = 0;
+  UINT32                                     Attributes    = 0;
   UINT32                                     i;
   BOOLEAN                                    FoundMatch = FALSE;
   UINT16                                     Dummy;
@@ -100,6 +103,36 @@ IsIoReadWriteAllowed (
     goto Exit;
   }
 
+  if (IsPolicyIndexed (SmmSecurityPolicy)) {
+    //
+    // The policy has been compiled, find the deciding descriptor by binary search.
+    //
+    PolicyRoot = mPolicyGateIndex.IoRoot;
+    if (PolicyRoot == NULL) {
+      DEBUG ((DEBUG_WARN, "%a Could not find IO policy root, bail to be on the safe side.\n", __FUNCTION__));
+      Status = EFI_ACCESS_DENIED;
+      goto Exit;
+    }
+
+    if ((mPolicyGateIndex.IoBitmap != NULL) &&
+        ((AccessMask & ~(SECURE_POLICY_RESOURCE_ATTR_READ | SECURE_POLICY_RESOURCE_ATTR_WRITE)) == 0))
+    {
+      //
+      // Constant time answer from the flattened port map, which does not keep
+      // track of the deciding descriptor.
+      //
+      i          = PolicyRoot->Count;
+      FoundMatch = IsIoAccessMatchedInBitmap (IoAddress, IoWidth, AccessMask);
+    } else {
+      i = LookupIoPolicyIndex (IoAddress, IoSize, &Attributes);
+      if ((i < PolicyRoot->Count) && (Attributes & AccessMask)) {
+        FoundMatch = TRUE;
+      }
+    }
+
+    goto Decide;
+  }
+
   PolicyRoot = (SMM_SUPV_POLICY_ROOT_V1 *)((UINTN)SmmSecurityPolicy + SmmSecurityPolicy->PolicyRootOffset);
   for (i = 0; i < SmmSecurityPolicy->PolicyRootCount; i++) {
     if (PolicyRoot[i].Type == SMM_SUPV_SECURE_POLICY_DESCRIPTOR_TYPE_IO) {
@@ -163,6 +196,7 @@ IsIoReadWriteAllowed (
     }
   }
 
+Decide:
   if ((FoundMatch && (PolicyRoot->AccessAttr == SMM_SUPV_ACCESS_ATTR_DENY)) ||
       (!FoundMatch && (PolicyRoot->AccessAttr == SMM_SUPV_ACCESS_ATTR_ALLOW)))
   {
@@ -214,6 +248,7 @@ IsMsrReadWriteAllowed (
   EFI_STATUS                                  Status         = EFI_SUCCESS;
   SMM_SUPV_SECURE_POLICY_MSR_DESCRIPTOR_V1_0  *MsrDescriptor = NULL;
   SMM_SUPV_POLICY_ROOT_V1                     *PolicyRoot    = NULL;
+  UINT32                                      Attributes     = 0;
   UINT32                                      i;
   BOOLEAN                                     FoundMatch = FALSE;
 
@@ -229,6 +264,25 @@ IsMsrReadWriteAllowed (
     goto Exit;
   }
 
+  if (IsPolicyIndexed (SmmSecurityPolicy)) {
+    //
+    // The policy has been compiled, find the deciding descriptor by binary search.
+    //
+    PolicyRoot = mPolicyGateIndex.MsrRoot;
+    if (PolicyRoot == NULL) {
+      DEBUG ((DEBUG_WARN, "%a Could not find MSR policy root, bail to be on the safe side.\n", __FUNCTION__));
+      Status = EFI_ACCESS_DENIED;
+      goto Exit;
+    }
+
+    i = LookupMsrPolicyIndex (MsrAddress, &Attributes);
+    if ((i < PolicyRoot->Count) && (Attributes & AccessMask)) {
+      FoundMatch = TRUE;
+    }
+
+    goto Decide;
+  }
+
   PolicyRoot = (SMM_SUPV_POLICY_ROOT_V1 *)((UINTN)SmmSecurityPolicy + SmmSecurityPolicy->PolicyRootOffset);
   for (i = 0; i < SmmSecurityPolicy->PolicyRootCount; i++) {
     if (PolicyRoot[i].Type == SMM_SUPV_SECURE_POLICY_DESCRIPTOR_TYPE_MSR) {
@@ -269,6 +323,7 @@ IsMsrReadWriteAllowed (
     }
   }
 
+Decide:
   if ((FoundMatch && (PolicyRoot->AccessAttr == SMM_SUPV_ACCESS_ATTR_DENY)) ||
       (!FoundMatch && (PolicyRoot->AccessAttr == SMM_SUPV_ACCESS_ATTR_ALLOW)))
   {
@@ -328,15 +383,21 @@ IsInstructionExecutionAllowed (
     goto Exit;
   }
 
-  PolicyRoot = (SMM_SUPV_POLICY_ROOT_V1 *)((UINTN)SmmSecurityPolicy + SmmSecurityPolicy->PolicyRootOffset);
-  for (i = 0; i < SmmSecurityPolicy->PolicyRootCount; i++) {
-    if (PolicyRoot[i].Type == SMM_SUPV_SECURE_POLICY_DESCRIPTOR_TYPE_INSTRUCTION) {
-      PolicyRoot = &PolicyRoot[i];
-      break;
+  if (IsPolicyIndexed (SmmSecurityPolicy)) {
+    // Instruction policies are tiny, only the policy root lookup is cached
+    PolicyRoot = mPolicyGateIndex.InstructionRoot;
+  } else {
+    PolicyRoot = (SMM_SUPV_POLICY_ROOT_V1 *)((UINTN)SmmSecurityPolicy + SmmSecurityPolicy->PolicyRootOffset);
+    for (i = 0; i < SmmSecurityPolicy->PolicyRootCount; i++) {
+      if (PolicyRoot[i].Type == SMM_SUPV_SECURE_POLICY_DESCRIPTOR_TYPE_INSTRUCTION) {
+        break;
+      }
     }
+
+    PolicyRoot = (i < SmmSecurityPolicy->PolicyRootCount) ? &PolicyRoot[i] : NULL;
   }
 
-  if (i >= SmmSecurityPolicy->PolicyRootCount) {
+  if (PolicyRoot == NULL) {
     DEBUG ((DEBUG_WARN, "%a Could not find Instruction policy root, bail to be on the safe side.\n", __FUNCTION__));
     Status = EFI_ACCESS_DENIED;
     goto Exit;
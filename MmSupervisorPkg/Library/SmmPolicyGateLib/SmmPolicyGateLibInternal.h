@@ -0,0 +1,127 @@
+/** @file
+  Internal definitions shared between the policy gate routines and the
+  compiled policy lookup index.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef SMM_POLICY_GATE_LIB_INTERNAL_H_
+#define SMM_POLICY_GATE_LIB_INTERNAL_H_
+
+#include <SmmSecurePolicy.h>
+#include <Protocol/MmCpuIo.h>
+
+//
+// The IO port map holds one bit per port for each of the 8, 16 and 32 bit
+// access widths and for each of the read and write attributes.
+//
+#define POLICY_GATE_IO_PORT_COUNT   (MAX_UINT16 + 1)
+#define POLICY_GATE_IO_WIDTH_COUNT  3
+#define POLICY_GATE_IO_BITMAP_SIZE  (POLICY_GATE_IO_WIDTH_COUNT * 2 * POLICY_GATE_IO_PORT_COUNT / 8)
+
+//
+// One resource range of a compiled policy. Start and End are both inclusive.
+// Index is the position of the originating descriptor in the policy blob, the
+// lowest index wins when several descriptors cover the same request, matching
+// the first-match order of the descriptor walk.
+//
+typedef struct {
+  UINT32    Start;
+  UINT32    End;
+  UINT32    Index;
+  UINT32    Attributes;
+} POLICY_GATE_INTERVAL;
+
+//
+// Lookup index built from a single policy blob by CompileSecurityPolicy.
+//
+typedef struct {
+  SMM_SUPV_SECURE_POLICY_DATA_V1_0    *Policy;
+  SMM_SUPV_POLICY_ROOT_V1             *IoRoot;
+  SMM_SUPV_POLICY_ROOT_V1             *MsrRoot;
+  SMM_SUPV_POLICY_ROOT_V1             *InstructionRoot;
+  // Non strict-width IO ranges, sorted by Start and free of overlap
+  POLICY_GATE_INTERVAL                *IoRanges;
+  UINTN                               IoRangeCount;
+  // Strict-width IO entries, Start holds the port and End holds the width
+  POLICY_GATE_INTERVAL                *IoStrict;
+  UINTN                               IoStrictCount;
+  // Flattened IO port map, NULL if it could not be built
+  UINT8                               *IoBitmap;
+  // MSR ranges, sorted by Start and free of overlap
+  POLICY_GATE_INTERVAL                *MsrRanges;
+  UINTN                               MsrRangeCount;
+} POLICY_GATE_INDEX;
+
+extern POLICY_GATE_INDEX  mPolicyGateIndex;
+
+/**
+  Check whether the lookup index was compiled from the given policy.
+
+  @param[in]  SmmSecurityPolicy   The address of applied SMM secure policy.
+
+  @retval TRUE    Lookups against this policy can be served by the index.
+  @retval FALSE   Lookups against this policy need to walk the descriptors.
+**/
+BOOLEAN
+IsPolicyIndexed (
+  IN SMM_SUPV_SECURE_POLICY_DATA_V1_0  *SmmSecurityPolicy
+  );
+
+/**
+  Look up the IO descriptor that decides an access from the compiled index.
+
+  @param[in]  IoAddress     The starting IO port of the access.
+  @param[in]  IoSize        The size of the access in bytes.
+  @param[out] Attributes    The attributes of the deciding descriptor.
+
+  @return The index of the deciding descriptor in the policy, or the count of
+          IO descriptors if no descriptor covers the access.
+**/
+UINT32
+LookupIoPolicyIndex (
+  IN  UINT32  IoAddress,
+  IN  UINT32  IoSize,
+  OUT UINT32  *Attributes
+  );
+
+/**
+  Check the flattened IO port map for an access.
+
+  @param[in]  IoAddress     The starting IO port of the access, the access must
+                            not run past the last IO port.
+  @param[in]  IoWidth       The width of the access, one of MM_IO_UINT8,
+                            MM_IO_UINT16 or MM_IO_UINT32.
+  @param[in]  AccessMask    SECURE_POLICY_RESOURCE_ATTR_READ and/or
+                            SECURE_POLICY_RESOURCE_ATTR_WRITE, no other bits.
+
+  @retval TRUE    The deciding descriptor carries one of the requested attributes.
+  @retval FALSE   No descriptor covers the access, or the deciding descriptor
+                  carries none of the requested attributes.
+**/
+BOOLEAN
+IsIoAccessMatchedInBitmap (
+  IN UINT32           IoAddress,
+  IN EFI_MM_IO_WIDTH  IoWidth,
+  IN UINT32           AccessMask
+  );
+
+/**
+  Look up the MSR descriptor that decides an access from the compiled index.
+
+  @param[in]  MsrAddress    The MSR being accessed.
+  @param[out] Attributes    The attributes of the deciding descriptor.
+
+  @return The index of the deciding descriptor in the policy, or the count of
+          MSR descriptors if no descriptor covers the access.
+**/
+UINT32
+LookupMsrPolicyIndex (
+  IN  UINT32  MsrAddress,
+  OUT UINT32  *Attributes
+  );
+
+#endif // SMM_POLICY_GATE_LIB_INTERNAL_H_
@@ -11,6 +11,7 @@
 #include <stdarg.h>
 #include <stddef.h>
 #include <setjmp.h>
+#include <time.h>
 #include <cmocka.h>
 
 #include <Uefi.h>
@@ -27,10 +28,19 @@
 #define UNIT_TEST_APP_NAME     "SmmPolicyGateLib Unit Tests"
 #define UNIT_TEST_APP_VERSION  "1.0"
 
+#define BENCHMARK_LOOKUP_COUNT  200000
+#define RANDOM_POLICY_COUNT     64
+#define RANDOM_IO_DESCRIPTORS   48
+#define RANDOM_IO_REQUESTS      20000
+
 typedef struct {
   SMM_SUPV_SECURE_POLICY_DATA_V1_0    *Policy;
 } TEST_CONTEXT_POLICY;
 
+typedef struct {
+  UINT32    DescriptorCount;
+} TEST_CONTEXT_BENCHMARK;
+
 SMM_SUPV_SECURE_POLICY_DATA_V1_0  mTestPolicyTemplate = {
   .VersionMinor     = 0x0000,
   .VersionMajor     = 0x0001,
@@ -161,6 +171,51 @@ CreateSingleInsPolicy (
   return UNIT_TEST_PASSED;
 }
 
+/*
+  Helper function to create the single IO entry test policy and compile its lookup index.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+CreateCompiledSingleIoPolicy (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CreateSingleIoPolicy (Context);
+  UT_ASSERT_NOT_EFI_ERROR (CompileSecurityPolicy (((TEST_CONTEXT_POLICY *)Context)->Policy));
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Helper function to create the single MSR entry test policy and compile its lookup index.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+CreateCompiledSingleMsrPolicy (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CreateSingleMsrPolicy (Context);
+  UT_ASSERT_NOT_EFI_ERROR (CompileSecurityPolicy (((TEST_CONTEXT_POLICY *)Context)->Policy));
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Helper function to create the single instruction entry test policy and compile its lookup index.
+*/
+UNIT_TEST_STATUS
+EFIAPI
+CreateCompiledSingleInsPolicy (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CreateSingleInsPolicy (Context);
+  UT_ASSERT_NOT_EFI_ERROR (CompileSecurityPolicy (((TEST_CONTEXT_POLICY *)Context)->Policy));
+
+  return UNIT_TEST_PASSED;
+}
+
 /*
   Helper function to clean up prepared policy, if needed.
 */
@@ -172,9 +227,13 @@ ClearTestPolicy (
 {
   TEST_CONTEXT_POLICY  *PolicyCntx;
 
+  // Drop the lookup index before its policy goes away
+  CompileSecurityPolicy (NULL);
+
   PolicyCntx = (TEST_CONTEXT_POLICY *)Context;
   if ((PolicyCntx != NULL) && (PolicyCntx->Policy != NULL)) {
     FreePool (PolicyCntx->Policy);
+    PolicyCntx->Policy = NULL;
   }
 }
 
@@ -498,6 +557,355 @@ PolicyGateMatchEntryOnDenyInsList (
   return UNIT_TEST_PASSED;
 }
 
+/*
+  Helper function to advance the pseudo random sequence used by the randomized tests.
+*/
+STATIC
+UINT32
+NextRandom (
+  IN OUT UINT32  *Seed
+  )
+{
+  *Seed = *Seed * 1103515245 + 12345;
+  return *Seed >> 8;
+}
+
+/*
+  Helper function to create an IO policy with random strict width entries and
+  random non-overlapping ranges in random order, spread over the whole port space.
+*/
+STATIC
+SMM_SUPV_SECURE_POLICY_DATA_V1_0 *
+CreateRandomIoPolicy (
+  IN OUT UINT32  *Seed
+  )
+{
+  SMM_SUPV_SECURE_POLICY_DATA_V1_0           *TestPolicy;
+  SMM_SUPV_POLICY_ROOT_V1                    *TestPolicyRoot;
+  SMM_SUPV_SECURE_POLICY_IO_DESCRIPTOR_V1_0  *IoPolicy;
+  SMM_SUPV_SECURE_POLICY_IO_DESCRIPTOR_V1_0  Swap;
+  UINT32                                     PolicySize;
+  UINT32                                     Index;
+  UINT32                                     Other;
+  UINT32                                     Cursor;
+
+  PolicySize = sizeof (SMM_SUPV_SECURE_POLICY_DATA_V1_0) +
+               sizeof (SMM_SUPV_POLICY_ROOT_V1) +
+               RANDOM_IO_DESCRIPTORS * sizeof (SMM_SUPV_SECURE_POLICY_IO_DESCRIPTOR_V1_0);
+
+  TestPolicy = AllocateZeroPool (PolicySize);
+  if (TestPolicy == NULL) {
+    return NULL;
+  }
+
+  CopyMem (TestPolicy, &mTestPolicyTemplate, sizeof (SMM_SUPV_SECURE_POLICY_DATA_V1_0));
+  TestPolicy->PolicyRootCount = 1;
+  TestPolicy->Size            = PolicySize;
+
+  TestPolicyRoot = (SMM_SUPV_POLICY_ROOT_V1 *)(TestPolicy + 1);
+  CopyMem (TestPolicyRoot, &mTestPolicyRootTemplate, sizeof (SMM_SUPV_POLICY_ROOT_V1));
+  TestPolicyRoot->AccessAttr = (NextRandom (Seed) & BIT0) ? SMM_SUPV_ACCESS_ATTR_DENY : SMM_SUPV_ACCESS_ATTR_ALLOW;
+  TestPolicyRoot->Count      = RANDOM_IO_DESCRIPTORS;
+  TestPolicyRoot->Type       = SMM_SUPV_SECURE_POLICY_DESCRIPTOR_TYPE_IO;
+  TestPolicyRoot->Offset     = sizeof (SMM_SUPV_SECURE_POLICY_DATA_V1_0) + sizeof (SMM_SUPV_POLICY_ROOT_V1);
+
+  IoPolicy = (SMM_SUPV_SECURE_POLICY_IO_DESCRIPTOR_V1_0 *)((UINTN)TestPolicy + TestPolicyRoot->Offset);
+  Cursor   = NextRandom (Seed) % 64;
+  for (Index = 0; Index < RANDOM_IO_DESCRIPTORS; Index++) {
+    IoPolicy[Index].Attributes = (NextRandom (Seed) % 3) + 1;
+    if (((NextRandom (Seed) % 3) == 0) || (Cursor > MAX_UINT16)) {
+      // Strict width entries may land anywhere, including inside a range
+      IoPolicy[Index].Attributes   |= SECURE_POLICY_RESOURCE_ATTR_STRICT_WIDTH;
+      IoPolicy[Index].LengthOrWidth = 1 << (NextRandom (Seed) % 3);
+      IoPolicy[Index].IoAddress     = (UINT16)(NextRandom (Seed) % (MAX_UINT16 + 1 - IoPolicy[Index].LengthOrWidth));
+    } else if (Cursor < MAX_UINT16 - 64) {
+      // Ranges do not overlap each other, the last one ends at the top port
+      IoPolicy[Index].IoAddress     = (UINT16)Cursor;
+      IoPolicy[Index].LengthOrWidth = (NextRandom (Seed) % 32) + 1;
+      Cursor                       += IoPolicy[Index].LengthOrWidth + (NextRandom (Seed) % 4096);
+    } else {
+      IoPolicy[Index].IoAddress     = (UINT16)(MAX_UINT16 - 3);
+      IoPolicy[Index].LengthOrWidth = 4;
+      Cursor                        = MAX_UINT16 + 1;
+    }
+  }
+
+  // Shuffle the descriptors so that the policy order does not follow the port order
+  for (Index = RANDOM_IO_DESCRIPTORS - 1; Index > 0; Index--) {
+    Other = NextRandom (Seed) % (Index + 1);
+    CopyMem (&Swap, &IoPolicy[Index], sizeof (Swap));
+    CopyMem (&IoPolicy[Index], &IoPolicy[Other], sizeof (Swap));
+    CopyMem (&IoPolicy[Other], &Swap, sizeof (Swap));
+  }
+
+  return TestPolicy;
+}
+
+/**
+  Unit test for IsIoReadWriteAllowed () with a compiled policy against random
+  policies. Every request is checked against the same policy left uncompiled,
+  where the verdict comes from the descriptor walk. Half of the requests land
+  next to the edges of a descriptor, the others anywhere in the port space.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+PolicyGateRandomIoRequests (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_SUPV_SECURE_POLICY_DATA_V1_0           *CompiledPolicy;
+  SMM_SUPV_SECURE_POLICY_DATA_V1_0           *WalkedPolicy;
+  SMM_SUPV_SECURE_POLICY_IO_DESCRIPTOR_V1_0  *IoPolicy;
+  UINT32                                     Seed;
+  UINT32                                     PolicyIndex;
+  UINT32                                     Index;
+  UINT32                                     Port;
+  UINT32                                     Mask;
+  EFI_MM_IO_WIDTH                            Width;
+  EFI_STATUS                                 Expected;
+  EFI_STATUS                                 Actual;
+
+  Seed = 0x5EC0E;
+  for (PolicyIndex = 0; PolicyIndex < RANDOM_POLICY_COUNT; PolicyIndex++) {
+    CompiledPolicy = CreateRandomIoPolicy (&Seed);
+    UT_ASSERT_NOT_NULL (CompiledPolicy);
+    WalkedPolicy = AllocateCopyPool (CompiledPolicy->Size, CompiledPolicy);
+    UT_ASSERT_NOT_NULL (WalkedPolicy);
+    UT_ASSERT_NOT_EFI_ERROR (CompileSecurityPolicy (CompiledPolicy));
+
+    IoPolicy = (SMM_SUPV_SECURE_POLICY_IO_DESCRIPTOR_V1_0 *)((UINTN)WalkedPolicy + sizeof (SMM_SUPV_SECURE_POLICY_DATA_V1_0) + sizeof (SMM_SUPV_POLICY_ROOT_V1));
+    for (Index = 0; Index < RANDOM_IO_REQUESTS; Index++) {
+      if (Index & BIT0) {
+        Port = NextRandom (&Seed) % (MAX_UINT16 + 1);
+      } else {
+        Port  = IoPolicy[NextRandom (&Seed) % RANDOM_IO_DESCRIPTORS].IoAddress;
+        Port += IoPolicy[NextRandom (&Seed) % RANDOM_IO_DESCRIPTORS].LengthOrWidth * (NextRandom (&Seed) % 2);
+        Port  = (Port + (NextRandom (&Seed) % 9) - 4) & MAX_UINT16;
+      }
+
+      Width = (EFI_MM_IO_WIDTH)(NextRandom (&Seed) % 3);
+      Mask  = (NextRandom (&Seed) % 3) + 1;
+
+      Expected = IsIoReadWriteAllowed (WalkedPolicy, Port, Width, Mask);
+      Actual   = IsIoReadWriteAllowed (CompiledPolicy, Port, Width, Mask);
+      if (Actual != Expected) {
+        UT_LOG_ERROR ("IO verdict mismatch on policy %d port 0x%x width %d mask 0x%x\n", PolicyIndex, Port, Width, Mask);
+        UT_ASSERT_STATUS_EQUAL (Actual, Expected);
+      }
+    }
+
+    CompileSecurityPolicy (NULL);
+    FreePool (WalkedPolicy);
+    FreePool (CompiledPolicy);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Helper function to create an allow list policy with DescriptorCount IO ranges
+  and DescriptorCount MSR ranges, the descriptors are laid out in descending
+  address order so that the sorted index cannot follow the policy order.
+*/
+STATIC
+SMM_SUPV_SECURE_POLICY_DATA_V1_0 *
+CreateLargeIoMsrPolicy (
+  IN UINT32  DescriptorCount
+  )
+{
+  SMM_SUPV_SECURE_POLICY_DATA_V1_0            *TestPolicy;
+  SMM_SUPV_POLICY_ROOT_V1                     *TestPolicyRoot;
+  SMM_SUPV_SECURE_POLICY_IO_DESCRIPTOR_V1_0   *IoPolicy;
+  SMM_SUPV_SECURE_POLICY_MSR_DESCRIPTOR_V1_0  *MsrPolicy;
+  UINT32                                      PolicySize;
+  UINT32                                      Index;
+  UINT32                                      Slot;
+
+  PolicySize = sizeof (SMM_SUPV_SECURE_POLICY_DATA_V1_0) +
+               2 * sizeof (SMM_SUPV_POLICY_ROOT_V1) +
+               DescriptorCount * sizeof (SMM_SUPV_SECURE_POLICY_IO_DESCRIPTOR_V1_0) +
+               DescriptorCount * sizeof (SMM_SUPV_SECURE_POLICY_MSR_DESCRIPTOR_V1_0);
+
+  TestPolicy = AllocateZeroPool (PolicySize);
+  if (TestPolicy == NULL) {
+    return NULL;
+  }
+
+  CopyMem (TestPolicy, &mTestPolicyTemplate, sizeof (SMM_SUPV_SECURE_POLICY_DATA_V1_0));
+  TestPolicy->PolicyRootCount = 2;
+  TestPolicy->Size            = PolicySize;
+
+  TestPolicyRoot = (SMM_SUPV_POLICY_ROOT_V1 *)(TestPolicy + 1);
+  CopyMem (&TestPolicyRoot[0], &mTestPolicyRootTemplate, sizeof (SMM_SUPV_POLICY_ROOT_V1));
+  TestPolicyRoot[0].AccessAttr = SMM_SUPV_ACCESS_ATTR_ALLOW;
+  TestPolicyRoot[0].Count      = DescriptorCount;
+  TestPolicyRoot[0].Type       = SMM_SUPV_SECURE_POLICY_DESCRIPTOR_TYPE_IO;
+  TestPolicyRoot[0].Offset     = sizeof (SMM_SUPV_SECURE_POLICY_DATA_V1_0) + 2 * sizeof (SMM_SUPV_POLICY_ROOT_V1);
+
+  CopyMem (&TestPolicyRoot[1], &mTestPolicyRootTemplate, sizeof (SMM_SUPV_POLICY_ROOT_V1));
+  TestPolicyRoot[1].AccessAttr = SMM_SUPV_ACCESS_ATTR_ALLOW;
+  TestPolicyRoot[1].Count      = DescriptorCount;
+  TestPolicyRoot[1].Type       = SMM_SUPV_SECURE_POLICY_DESCRIPTOR_TYPE_MSR;
+  TestPolicyRoot[1].Offset     = TestPolicyRoot[0].Offset + DescriptorCount * sizeof (SMM_SUPV_SECURE_POLICY_IO_DESCRIPTOR_V1_0);
+
+  IoPolicy  = (SMM_SUPV_SECURE_POLICY_IO_DESCRIPTOR_V1_0 *)((UINTN)TestPolicy + TestPolicyRoot[0].Offset);
+  MsrPolicy = (SMM_SUPV_SECURE_POLICY_MSR_DESCRIPTOR_V1_0 *)((UINTN)TestPolicy + TestPolicyRoot[1].Offset);
+  for (Index = 0; Index < DescriptorCount; Index++) {
+    Slot = DescriptorCount - Index - 1;
+
+    // Every 8 ports hold a 4 port range, every fourth range is strict width instead
+    IoPolicy[Index].IoAddress = (UINT16)(Slot * 8);
+    if ((Slot % 4) == 3) {
+      IoPolicy[Index].Attributes    = SECURE_POLICY_RESOURCE_ATTR_READ | SECURE_POLICY_RESOURCE_ATTR_STRICT_WIDTH;
+      IoPolicy[Index].LengthOrWidth = sizeof (UINT16);
+    } else {
+      IoPolicy[Index].Attributes    = (Slot % 2) ? SECURE_POLICY_RESOURCE_ATTR_READ : SECURE_POLICY_RESOURCE_ATTR_WRITE;
+      IoPolicy[Index].LengthOrWidth = 4;
+    }
+
+    // Every 16 MSRs hold an 8 MSR range
+    MsrPolicy[Index].MsrAddress = 0xC0000000 + Slot * 16;
+    MsrPolicy[Index].Length     = 8;
+    MsrPolicy[Index].Attributes = (Slot % 2) ? SECURE_POLICY_RESOURCE_ATTR_READ : SECURE_POLICY_RESOURCE_ATTR_WRITE;
+  }
+
+  return TestPolicy;
+}
+
+/**
+  Benchmark of IsIoReadWriteAllowed () and IsMsrReadWriteAllowed () with and
+  without a compiled lookup index. Both paths have to reach the same verdict
+  for every request, the time spent by each is logged for comparison.
+
+  @param[in]  Context    Pointer to TEST_CONTEXT_BENCHMARK with the number of
+                         descriptors of each type in the test policy.
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+PolicyGateLookupBenchmark (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  SMM_SUPV_SECURE_POLICY_DATA_V1_0  *CompiledPolicy;
+  SMM_SUPV_SECURE_POLICY_DATA_V1_0  *WalkedPolicy;
+  UINT32                            DescriptorCount;
+  UINT32                            *IoPorts;
+  UINT32                            *Msrs;
+  EFI_STATUS                        *Verdicts;
+  UINT32                            Seed;
+  UINTN                             Index;
+  UINT32                            Mask;
+  EFI_MM_IO_WIDTH                   Width;
+  clock_t                           Start;
+  clock_t                           WalkTicks;
+  clock_t                           IndexTicks;
+
+  DescriptorCount = ((TEST_CONTEXT_BENCHMARK *)Context)->DescriptorCount;
+
+  CompiledPolicy = CreateLargeIoMsrPolicy (DescriptorCount);
+  UT_ASSERT_NOT_NULL (CompiledPolicy);
+  WalkedPolicy = AllocateCopyPool (CompiledPolicy->Size, CompiledPolicy);
+  UT_ASSERT_NOT_NULL (WalkedPolicy);
+  UT_ASSERT_NOT_EFI_ERROR (CompileSecurityPolicy (CompiledPolicy));
+
+  IoPorts  = AllocatePool (BENCHMARK_LOOKUP_COUNT * sizeof (UINT32));
+  Msrs     = AllocatePool (BENCHMARK_LOOKUP_COUNT * sizeof (UINT32));
+  Verdicts = AllocatePool (BENCHMARK_LOOKUP_COUNT * sizeof (EFI_STATUS));
+  UT_ASSERT_NOT_NULL (IoPorts);
+  UT_ASSERT_NOT_NULL (Msrs);
+  UT_ASSERT_NOT_NULL (Verdicts);
+
+  //
+  // Spread the requests over the covered space plus some margin on both ends.
+  //
+  Seed = 0x1234567;
+  for (Index = 0; Index < BENCHMARK_LOOKUP_COUNT; Index++) {
+    Seed           = Seed * 1103515245 + 12345;
+    IoPorts[Index] = (Seed >> 8) % (DescriptorCount * 8 + 16);
+    Seed           = Seed * 1103515245 + 12345;
+    Msrs[Index]    = 0xC0000000 - 16 + (Seed >> 8) % (DescriptorCount * 16 + 32);
+  }
+
+  //
+  // IO lookups
+  //
+  Start = clock ();
+  for (Index = 0; Index < BENCHMARK_LOOKUP_COUNT; Index++) {
+    Width           = (EFI_MM_IO_WIDTH)(Index % 3);
+    Mask            = (Index & BIT2) ? SECURE_POLICY_RESOURCE_ATTR_READ : SECURE_POLICY_RESOURCE_ATTR_WRITE;
+    Verdicts[Index] = IsIoReadWriteAllowed (WalkedPolicy, IoPorts[Index], Width, Mask);
+  }
+
+  WalkTicks = clock () - Start;
+
+  Start = clock ();
+  for (Index = 0; Index < BENCHMARK_LOOKUP_COUNT; Index++) {
+    Width = (EFI_MM_IO_WIDTH)(Index % 3);
+    Mask  = (Index & BIT2) ? SECURE_POLICY_RESOURCE_ATTR_READ : SECURE_POLICY_RESOURCE_ATTR_WRITE;
+    if (IsIoReadWriteAllowed (CompiledPolicy, IoPorts[Index], Width, Mask) != Verdicts[Index]) {
+      UT_LOG_ERROR ("IO verdict mismatch on port 0x%x width %d\n", IoPorts[Index], Width);
+      UT_ASSERT_TRUE (FALSE);
+    }
+  }
+
+  IndexTicks = clock () - Start;
+  UT_LOG_INFO (
+    "%d IO descriptors: %d lookups, walk %d us, index %d us\n",
+    DescriptorCount,
+    BENCHMARK_LOOKUP_COUNT,
+    (UINT32)(WalkTicks * 1000000 / CLOCKS_PER_SEC),
+    (UINT32)(IndexTicks * 1000000 / CLOCKS_PER_SEC)
+    );
+
+  //
+  // MSR lookups
+  //
+  Start = clock ();
+  for (Index = 0; Index < BENCHMARK_LOOKUP_COUNT; Index++) {
+    Mask            = (Index & BIT2) ? SECURE_POLICY_RESOURCE_ATTR_READ : SECURE_POLICY_RESOURCE_ATTR_WRITE;
+    Verdicts[Index] = IsMsrReadWriteAllowed (WalkedPolicy, Msrs[Index], Mask);
+  }
+
+  WalkTicks = clock () - Start;
+
+  Start = clock ();
+  for (Index = 0; Index < BENCHMARK_LOOKUP_COUNT; Index++) {
+    Mask = (Index & BIT2) ? SECURE_POLICY_RESOURCE_ATTR_READ : SECURE_POLICY_RESOURCE_ATTR_WRITE;
+    if (IsMsrReadWriteAllowed (CompiledPolicy, Msrs[Index], Mask) != Verdicts[Index]) {
+      UT_LOG_ERROR ("MSR verdict mismatch on MSR 0x%x\n", Msrs[Index]);
+      UT_ASSERT_TRUE (FALSE);
+    }
+  }
+
+  IndexTicks = clock () - Start;
+  UT_LOG_INFO (
+    "%d MSR descriptors: %d lookups, walk %d us, index %d us\n",
+    DescriptorCount,
+    BENCHMARK_LOOKUP_COUNT,
+    (UINT32)(WalkTicks * 1000000 / CLOCKS_PER_SEC),
+    (UINT32)(IndexTicks * 1000000 / CLOCKS_PER_SEC)
+    );
+
+  CompileSecurityPolicy (NULL);
+  FreePool (Verdicts);
+  FreePool (Msrs);
+  FreePool (IoPorts);
+  FreePool (WalkedPolicy);
+  FreePool (CompiledPolicy);
+
+  return UNIT_TEST_PASSED;
+}
+
 /**
   Initialize the unit test framework, suite, and unit tests for the
   SmmPolicyGateLib and run the SmmPolicyGateLib unit test.
@@ -516,7 +924,9 @@ UnitTestingEntry (
   EFI_STATUS                  Status;
   UNIT_TEST_FRAMEWORK_HANDLE  Framework;
   UNIT_TEST_SUITE_HANDLE      PolicyGateTests;
+  UNIT_TEST_SUITE_HANDLE      BenchmarkTests;
   TEST_CONTEXT_POLICY         PolicyContext;
+  TEST_CONTEXT_BENCHMARK      BenchmarkContext[3];
 
   Framework            = NULL;
   PolicyContext.Policy = NULL;
@@ -552,6 +962,31 @@ UnitTestingEntry (
   AddTestCase (PolicyGateTests, "Policy gate should catch requests listed on deny MSR policy", "DenyMsr", PolicyGateMatchEntryOnDenyMsrList, CreateSingleMsrPolicy, ClearTestPolicy, &PolicyContext);
   AddTestCase (PolicyGateTests, "Policy gate should catch requests listed on allow Instruction policy", "AllowIns", PolicyGateMatchEntryOnAllowInsList, CreateSingleInsPolicy, ClearTestPolicy, &PolicyContext);
   AddTestCase (PolicyGateTests, "Policy gate should catch requests listed on deny Instruction policy", "DenyIns", PolicyGateMatchEntryOnDenyInsList, CreateSingleInsPolicy, ClearTestPolicy, &PolicyContext);
+  AddTestCase (PolicyGateTests, "Compiled policy gate should catch requests listed on allow IO policy", "AllowIOIndexed", PolicyGateMatchEntryOnAllowIoList, CreateCompiledSingleIoPolicy, ClearTestPolicy, &PolicyContext);
+  AddTestCase (PolicyGateTests, "Compiled policy gate should catch requests listed on deny IO policy", "DenyIOIndexed", PolicyGateMatchEntryOnDenyIoList, CreateCompiledSingleIoPolicy, ClearTestPolicy, &PolicyContext);
+  AddTestCase (PolicyGateTests, "Compiled policy gate should catch potentially overflow IO request", "OverflowIOIndexed", PolicyGateOnOverflowIoRequests, CreateCompiledSingleIoPolicy, ClearTestPolicy, &PolicyContext);
+  AddTestCase (PolicyGateTests, "Compiled policy gate should catch requests listed on allow MSR policy", "AllowMsrIndexed", PolicyGateMatchEntryOnAllowMsrList, CreateCompiledSingleMsrPolicy, ClearTestPolicy, &PolicyContext);
+  AddTestCase (PolicyGateTests, "Compiled policy gate should catch requests listed on deny MSR policy", "DenyMsrIndexed", PolicyGateMatchEntryOnDenyMsrList, CreateCompiledSingleMsrPolicy, ClearTestPolicy, &PolicyContext);
+  AddTestCase (PolicyGateTests, "Compiled policy gate should catch requests listed on allow Instruction policy", "AllowInsIndexed", PolicyGateMatchEntryOnAllowInsList, CreateCompiledSingleInsPolicy, ClearTestPolicy, &PolicyContext);
+  AddTestCase (PolicyGateTests, "Compiled policy gate should catch requests listed on deny Instruction policy", "DenyInsIndexed", PolicyGateMatchEntryOnDenyInsList, CreateCompiledSingleInsPolicy, ClearTestPolicy, &PolicyContext);
+  AddTestCase (PolicyGateTests, "Compiled policy gate should agree with the descriptor walk on random IO requests", "RandomIOIndexed", PolicyGateRandomIoRequests, NULL, NULL, NULL);
+
+  //
+  // Populate the lookup benchmark suite, comparing the descriptor walk against the compiled index.
+  //
+  Status = CreateUnitTestSuite (&BenchmarkTests, Framework, "SmmPolicyGateLib Lookup Benchmark", "SmmPolicyGateLib.Benchmark", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BenchmarkTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  BenchmarkContext[0].DescriptorCount = 10;
+  BenchmarkContext[1].DescriptorCount = 100;
+  BenchmarkContext[2].DescriptorCount = 1000;
+  AddTestCase (BenchmarkTests, "Policy lookup with 10 IO and MSR descriptors", "Lookup10", PolicyGateLookupBenchmark, NULL, NULL, &BenchmarkContext[0]);
+  AddTestCase (BenchmarkTests, "Policy lookup with 100 IO and MSR descriptors", "Lookup100", PolicyGateLookupBenchmark, NULL, NULL, &BenchmarkContext[1]);
+  AddTestCase (BenchmarkTests, "Policy lookup with 1000 IO and MSR descriptors", "Lookup1000", PolicyGateLookupBenchmark, NULL, NULL, &BenchmarkContext[2]);
 
   //
   // Execute the tests.
@@ -23,16 +23,32 @@
     BSP: ReleaseOneAp  -->  AP: WaitForBsp
     BSP: WaitForAPs    <--  AP: ReleaseBsp
 
+  When PcdMmSupervisorCpuSyncHierarchical is TRUE and the package of each CPU is
+  provided with SmmCpuSyncSetPackageLayout(), CPUs check in and release the BSP
+  through counters of their own package instead of the global ones. Only the BSP
+  reads the counters of the other packages, when it locks the door and while it
+  waits for the APs.
+
+  When PcdMmSupervisorCpuSyncMwait is TRUE and CPUID reports MONITOR/MWAIT, an
+  AP waiting for the BSP in WaitForBsp() arms MONITOR on its Run semaphore and
+  sleeps in MWAIT until the BSP writes it, instead of spinning with PAUSE. Each
+  semaphore is on its own cache line, so only the release of the AP wakes it up.
+
   Copyright (c) 2023, Intel Corporation. All rights reserved.<BR>
   SPDX-License-Identifier: BSD-2-Clause-Patent
 
 **/
 #include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
 #include <Library/SafeIntLib.h>
 #include <Library/SmmCpuSyncLib.h>
+#include <Library/SmmCpuSyncTopologyLib.h>
+#include <Library/SmmCpuSyncWaitLib.h>
 #include <Library/SynchronizationLib.h>
+#include <Register/Intel/Cpuid.h>
 #include <Uefi.h>
 
 ///
@@ -47,6 +63,25 @@ typedef struct {
   SMM_CPU_SYNC_SEMAPHORE    *Run;
 } SMM_CPU_SYNC_SEMAPHORE_FOR_EACH_CPU;
 
+typedef struct {
+  ///
+  /// Indicate CPUs of the package entered SMM before lock door.
+  ///
+  SMM_CPU_SYNC_SEMAPHORE    *CpuCount;
+  ///
+  /// Number of APs of the package that released the BSP and are not yet waited for.
+  ///
+  SMM_CPU_SYNC_SEMAPHORE    *Arrived;
+} SMM_CPU_SYNC_PACKAGE_SEMAPHORE;
+
+typedef struct {
+  ///
+  /// Number of times MWAIT returned, and how many of those found the semaphore still 0.
+  ///
+  UINT64    Wakeups;
+  UINT64    SpuriousWakeups;
+} SMM_CPU_SYNC_WAIT_STATISTICS;
+
 struct SMM_CPU_SYNC_CONTEXT  {
   ///
   /// Indicate all CPUs in the system.
@@ -71,6 +106,31 @@ struct SMM_CPU_SYNC_CONTEXT  {
   ///
   SMM_CPU_SYNC_SEMAPHORE                 *CpuCount;
   ///
+  /// TRUE if CPUs check in and release the BSP through the semaphores of their package.
+  ///
+  BOOLEAN                                Hierarchical;
+  ///
+  /// Number of packages, and the package of each CPU, indexed by CPU index.
+  ///
+  UINTN                                  NumberOfPackages;
+  UINT32                                 *CpuPackage;
+  ///
+  /// Address and size of the package semaphores, one semaphore per cache line.
+  ///
+  VOID                                   *PackageSemBuffer;
+  UINTN                                  PackageSemBufferPages;
+  SMM_CPU_SYNC_PACKAGE_SEMAPHORE         *PackageSem;
+  ///
+  /// TRUE if APs wait for the BSP with MONITOR/MWAIT instead of PAUSE.
+  ///
+  BOOLEAN                                Mwait;
+  ///
+  /// Address and size of the wait statistics of the CPUs, one cache line per CPU.
+  ///
+  VOID                                   *WaitStatsBuffer;
+  UINTN                                  WaitStatsBufferPages;
+  UINTN                                  WaitStatsSize;
+  ///
   /// Define an array of structure for each CPU semaphore due to the size alignment
   /// requirement. With the array of structure for each CPU semaphore, it's easy to
   /// reach the specific CPU with CPU Index for its own semaphore access: CpuSem[CpuIndex].
@@ -121,6 +181,65 @@ InternalWaitForSemaphore (
   return Value - 1;
 }
 
+/**
+  Same as InternalWaitForSemaphore(), except that the CPU sleeps in MWAIT
+  while the semaphore is 0 instead of spinning.
+
+  @param[in,out]  Context     Pointer to the SMM CPU Sync context object.
+  @param[in]      CpuIndex    The index of the waiting CPU.
+  @param[in,out]  Sem         The semaphore of the waiting CPU.
+
+  @retval     Original integer - 1 if Sem is not locked.
+              MAX_UINT32 if Sem is locked.
+
+**/
+STATIC
+UINT32
+InternalMonitorWaitForSemaphore (
+  IN OUT  SMM_CPU_SYNC_CONTEXT  *Context,
+  IN      UINTN                 CpuIndex,
+  IN OUT  volatile UINT32       *Sem
+  )
+{
+  SMM_CPU_SYNC_WAIT_STATISTICS  *Stats;
+  UINT32                        Value;
+
+  Stats = (SMM_CPU_SYNC_WAIT_STATISTICS *)((UINTN)Context->WaitStatsBuffer + CpuIndex * Context->WaitStatsSize);
+
+  for ( ; ;) {
+    Value = *Sem;
+    if (Value == MAX_UINT32) {
+      return Value;
+    }
+
+    if (Value != 0) {
+      if (InterlockedCompareExchange32 ((UINT32 *)Sem, Value, Value - 1) == Value) {
+        break;
+      }
+
+      continue;
+    }
+
+    //
+    // Check the semaphore again once armed, a release that landed before MONITOR
+    // would not wake MWAIT up
+    //
+    AsmMonitor ((UINTN)Sem, 0, 0);
+    if (*Sem != 0) {
+      continue;
+    }
+
+    AsmMwait (0, 0);
+
+    Stats->Wakeups++;
+    if (*Sem == 0) {
+      Stats->SpuriousWakeups++;
+    }
+  }
+
+  return Value - 1;
+}
+
 /**
   Performs an atomic compare exchange operation to release semaphore.
   The compare exchange operation must be performed using MP safe
@@ -158,6 +277,43 @@ InternalReleaseSemaphore (
   return Value + 1;
 }
 
+/**
+  Performs an atomic compare exchange operation to take up to Count from
+  semaphore, without waiting.
+
+  @param[in,out]  Sem    IN:  32-bit unsigned integer
+                         OUT: original integer - the returned value.
+  @param[in]      Count  The most to take from Sem.
+
+  @retval    The amount taken from Sem, 0 if Sem is 0 or locked.
+
+**/
+STATIC
+UINT32
+InternalTakeSemaphore (
+  IN OUT  volatile UINT32  *Sem,
+  IN      UINT32           Count
+  )
+{
+  UINT32  Value;
+  UINT32  Taken;
+
+  do {
+    Value = *Sem;
+    if ((Value == 0) || (Value == MAX_UINT32)) {
+      return 0;
+    }
+
+    Taken = MIN (Value, Count);
+  } while (InterlockedCompareExchange32 (
+             (UINT32 *)Sem,
+             Value,
+             Value - Taken
+             ) != Value);
+
+  return Taken;
+}
+
 /**
   Performs an atomic compare exchange operation to lock semaphore.
   The compare exchange operation must be performed using MP safe
@@ -188,6 +344,29 @@ InternalLockdownSemaphore (
   return Value;
 }
 
+/**
+  Get the check in counter used by a CPU, the one of its package in hierarchical mode.
+
+  @param[in]  Context     Pointer to the SMM CPU Sync context object.
+  @param[in]  CpuIndex    The CPU index.
+
+  @return The check in counter of the CPU.
+
+**/
+STATIC
+SMM_CPU_SYNC_SEMAPHORE *
+InternalGetCpuCount (
+  IN SMM_CPU_SYNC_CONTEXT  *Context,
+  IN UINTN                 CpuIndex
+  )
+{
+  if (Context->Hierarchical) {
+    return Context->PackageSem[Context->CpuPackage[CpuIndex]].CpuCount;
+  }
+
+  return Context->CpuCount;
+}
+
 /**
   Create and initialize the SMM CPU Sync context. It is to allocate and initialize the
   SMM CPU Sync context.
@@ -218,6 +397,7 @@ SmmCpuSyncContextInit (
   UINTN                                SemAddr;
   UINTN                                CpuIndex;
   SMM_CPU_SYNC_SEMAPHORE_FOR_EACH_CPU  *CpuSem;
+  CPUID_VERSION_INFO_ECX               VersionInfoEcx;
 
   ASSERT (Context != NULL);
 
@@ -243,6 +423,16 @@ SmmCpuSyncContextInit (
   }
 
   (*Context)->ArrivedCpuCountUponLock = 0;
+  (*Context)->Hierarchical            = FALSE;
+  (*Context)->NumberOfPackages        = 0;
+  (*Context)->CpuPackage              = NULL;
+  (*Context)->PackageSemBuffer        = NULL;
+  (*Context)->PackageSemBufferPages   = 0;
+  (*Context)->PackageSem              = NULL;
+  (*Context)->Mwait                   = FALSE;
+  (*Context)->WaitStatsBuffer         = NULL;
+  (*Context)->WaitStatsBufferPages    = 0;
+  (*Context)->WaitStatsSize           = 0;
 
   //
   // Save NumberOfCpus
@@ -296,6 +486,23 @@ SmmCpuSyncContextInit (
     SemAddr += OneSemSize;
   }
 
+  //
+  // Park the waiting APs with MWAIT when asked for and supported, PAUSE otherwise.
+  // The counters are written by each AP, keep them on lines of their own.
+  //
+  if (FeaturePcdGet (PcdMmSupervisorCpuSyncMwait)) {
+    AsmCpuid (CPUID_VERSION_INFO, NULL, NULL, &VersionInfoEcx.Uint32, NULL);
+    if (VersionInfoEcx.Bits.MONITOR == 1) {
+      (*Context)->WaitStatsSize        = ALIGN_VALUE (sizeof (SMM_CPU_SYNC_WAIT_STATISTICS), OneSemSize);
+      (*Context)->WaitStatsBufferPages = EFI_SIZE_TO_PAGES (NumberOfCpus * (*Context)->WaitStatsSize);
+      (*Context)->WaitStatsBuffer      = AllocatePages ((*Context)->WaitStatsBufferPages);
+      if ((*Context)->WaitStatsBuffer != NULL) {
+        ZeroMem ((*Context)->WaitStatsBuffer, EFI_PAGES_TO_SIZE ((*Context)->WaitStatsBufferPages));
+        (*Context)->Mwait = TRUE;
+      }
+    }
+  }
+
   return RETURN_SUCCESS;
 
 ON_ERROR:
@@ -320,11 +527,126 @@ SmmCpuSyncContextDeinit (
 {
   ASSERT (Context != NULL);
 
+  if (Context->PackageSemBuffer != NULL) {
+    FreePages (Context->PackageSemBuffer, Context->PackageSemBufferPages);
+  }
+
+  if (Context->PackageSem != NULL) {
+    FreePool (Context->PackageSem);
+  }
+
+  if (Context->CpuPackage != NULL) {
+    FreePool (Context->CpuPackage);
+  }
+
+  if (Context->WaitStatsBuffer != NULL) {
+    FreePages (Context->WaitStatsBuffer, Context->WaitStatsBufferPages);
+  }
+
   FreePages (Context->SemBuffer, Context->SemBufferPages);
 
   FreePool (Context);
 }
 
+/**
+  Provide the package of each CPU to an SMM CPU Sync context.
+
+  Must be called right after SmmCpuSyncContextInit(), before any CPU checks in.
+  The layout is only used when PcdMmSupervisorCpuSyncHierarchical is TRUE.
+
+  If Context is NULL, then ASSERT().
+  If CpuPackage is NULL, then ASSERT().
+
+  @param[in,out]  Context           Pointer to the SMM CPU Sync context object.
+  @param[in]      CpuPackage        Package number of each CPU, indexed by CPU index, with as
+                                    many entries as the NumberOfCpus of the context.
+
+  @retval RETURN_SUCCESS            The layout is recorded, or not used by this implementation.
+  @retval RETURN_OUT_OF_RESOURCES   There are not enough resources to hold the layout, the
+                                    context keeps working without it.
+
+**/
+RETURN_STATUS
+EFIAPI
+SmmCpuSyncSetPackageLayout (
+  IN OUT SMM_CPU_SYNC_CONTEXT  *Context,
+  IN     CONST UINT32          *CpuPackage
+  )
+{
+  RETURN_STATUS  Status;
+  UINTN          OneSemSize;
+  UINTN          TotalSemSize;
+  UINTN          SemAddr;
+  UINTN          CpuIndex;
+  UINTN          PackageIndex;
+
+  ASSERT (Context != NULL);
+  ASSERT (CpuPackage != NULL);
+
+  if (!FeaturePcdGet (PcdMmSupervisorCpuSyncHierarchical) || Context->Hierarchical) {
+    return RETURN_SUCCESS;
+  }
+
+  //
+  // Package numbers are not always contiguous, use the highest one like InitPackageFirstThreadIndexInfo() does
+  //
+  Context->NumberOfPackages = 0;
+  for (CpuIndex = 0; CpuIndex < Context->NumberOfCpus; CpuIndex++) {
+    Context->NumberOfPackages = MAX (Context->NumberOfPackages, (UINTN)CpuPackage[CpuIndex] + 1);
+  }
+
+  //
+  // Two semaphores per package, CpuCount and Arrived, each on its own cache line
+  //
+  OneSemSize = GetSpinLockProperties ();
+  Status     = SafeUintnMult (Context->NumberOfPackages, 2 * OneSemSize, &TotalSemSize);
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+
+  Context->CpuPackage = AllocateCopyPool (Context->NumberOfCpus * sizeof (UINT32), CpuPackage);
+  Context->PackageSem = AllocatePool (Context->NumberOfPackages * sizeof (SMM_CPU_SYNC_PACKAGE_SEMAPHORE));
+  if ((Context->CpuPackage == NULL) || (Context->PackageSem == NULL)) {
+    Status = RETURN_OUT_OF_RESOURCES;
+    goto ON_ERROR;
+  }
+
+  Context->PackageSemBufferPages = EFI_SIZE_TO_PAGES (TotalSemSize);
+  Context->PackageSemBuffer      = AllocatePages (Context->PackageSemBufferPages);
+  if (Context->PackageSemBuffer == NULL) {
+    Status = RETURN_OUT_OF_RESOURCES;
+    goto ON_ERROR;
+  }
+
+  SemAddr = (UINTN)Context->PackageSemBuffer;
+  for (PackageIndex = 0; PackageIndex < Context->NumberOfPackages; PackageIndex++) {
+    Context->PackageSem[PackageIndex].CpuCount  = (SMM_CPU_SYNC_SEMAPHORE *)SemAddr;
+    *Context->PackageSem[PackageIndex].CpuCount = 0;
+    SemAddr                                    += OneSemSize;
+
+    Context->PackageSem[PackageIndex].Arrived  = (SMM_CPU_SYNC_SEMAPHORE *)SemAddr;
+    *Context->PackageSem[PackageIndex].Arrived = 0;
+    SemAddr                                   += OneSemSize;
+  }
+
+  Context->Hierarchical = TRUE;
+  return RETURN_SUCCESS;
+
+ON_ERROR:
+  if (Context->CpuPackage != NULL) {
+    FreePool (Context->CpuPackage);
+    Context->CpuPackage = NULL;
+  }
+
+  if (Context->PackageSem != NULL) {
+    FreePool (Context->PackageSem);
+    Context->PackageSem = NULL;
+  }
+
+  Context->NumberOfPackages = 0;
+  return Status;
+}
+
 /**
   Reset SMM CPU Sync context. SMM CPU Sync context will be reset to the initialized state.
 
@@ -342,10 +664,19 @@ SmmCpuSyncContextReset (
   IN OUT SMM_CPU_SYNC_CONTEXT  *Context
   )
 {
+  UINTN  PackageIndex;
+
   ASSERT (Context != NULL);
 
   Context->ArrivedCpuCountUponLock = 0;
   *Context->CpuCount               = 0;
+
+  if (Context->Hierarchical) {
+    for (PackageIndex = 0; PackageIndex < Context->NumberOfPackages; PackageIndex++) {
+      *Context->PackageSem[PackageIndex].CpuCount = 0;
+      *Context->PackageSem[PackageIndex].Arrived  = 0;
+    }
+  }
 }
 
 /**
@@ -368,9 +699,25 @@ SmmCpuSyncGetArrivedCpuCount (
   )
 {
   UINT32  Value;
+  UINTN   Count;
+  UINTN   PackageIndex;
 
   ASSERT (Context != NULL);
 
+  if (Context->Hierarchical) {
+    Count = 0;
+    for (PackageIndex = 0; PackageIndex < Context->NumberOfPackages; PackageIndex++) {
+      Value = *Context->PackageSem[PackageIndex].CpuCount;
+      if (Value == (UINT32)-1) {
+        return Context->ArrivedCpuCountUponLock;
+      }
+
+      Count += Value;
+    }
+
+    return Count;
+  }
+
   Value = *Context->CpuCount;
 
   if (Value == (UINT32)-1) {
@@ -409,7 +756,7 @@ SmmCpuSyncCheckInCpu (
   //
   // Check to return if CpuCount has already been locked.
   //
-  if (InternalReleaseSemaphore (Context->CpuCount) == MAX_UINT32) {
+  if (InternalReleaseSemaphore (InternalGetCpuCount (Context, CpuIndex)) == MAX_UINT32) {
     return RETURN_ABORTED;
   }
 
@@ -443,7 +790,7 @@ SmmCpuSyncCheckOutCpu (
 
   ASSERT (CpuIndex < Context->NumberOfCpus);
 
-  if (InternalWaitForSemaphore (Context->CpuCount) == MAX_UINT32) {
+  if (InternalWaitForSemaphore (InternalGetCpuCount (Context, CpuIndex)) == MAX_UINT32) {
     return RETURN_ABORTED;
   }
 
@@ -475,12 +822,30 @@ SmmCpuSyncLockDoor (
   OUT UINTN                    *CpuCount
   )
 {
+  UINTN  PackageIndex;
+
   ASSERT (Context != NULL);
 
   ASSERT (CpuCount != NULL);
 
   ASSERT (CpuIndex < Context->NumberOfCpus);
 
+  if (Context->Hierarchical) {
+    //
+    // Same as below, package by package. A CPU counted in a package that is not locked yet
+    // is still counted in the returned CpuCount.
+    //
+    Context->ArrivedCpuCountUponLock = SmmCpuSyncGetArrivedCpuCount (Context);
+
+    *CpuCount = 0;
+    for (PackageIndex = 0; PackageIndex < Context->NumberOfPackages; PackageIndex++) {
+      *CpuCount += InternalLockdownSemaphore (Context->PackageSem[PackageIndex].CpuCount);
+    }
+
+    Context->ArrivedCpuCountUponLock = *CpuCount;
+    return;
+  }
+
   //
   // Temporarily record the CpuCount into the ArrivedCpuCountUponLock before lock door.
   // Recording before lock door is to avoid the Context->CpuCount is locked but possible
@@ -528,7 +893,9 @@ SmmCpuSyncWaitForAPs (
   IN     UINTN                 BspIndex
   )
 {
-  UINTN  Arrived;
+  UINTN   Arrived;
+  UINTN   PackageIndex;
+  UINT32  Taken;
 
   ASSERT (Context != NULL);
 
@@ -536,6 +903,27 @@ SmmCpuSyncWaitForAPs (
 
   ASSERT (BspIndex < Context->NumberOfCpus);
 
+  if (Context->Hierarchical) {
+    //
+    // APs count their release in their own package, collect them package by package
+    //
+    Arrived = 0;
+    while (Arrived < NumberOfAPs) {
+      Taken = 0;
+      for (PackageIndex = 0; PackageIndex < Context->NumberOfPackages && Arrived + Taken < NumberOfAPs; PackageIndex++) {
+        Taken += InternalTakeSemaphore (Context->PackageSem[PackageIndex].Arrived, (UINT32)(NumberOfAPs - Arrived - Taken));
+      }
+
+      if (Taken == 0) {
+        CpuPause ();
+      }
+
+      Arrived += Taken;
+    }
+
+    return;
+  }
+
   for (Arrived = 0; Arrived < NumberOfAPs; Arrived++) {
     InternalWaitForSemaphore (Context->CpuSem[BspIndex].Run);
   }
@@ -613,6 +1001,11 @@ SmmCpuSyncWaitForBsp (
 
   ASSERT (BspIndex < Context->NumberOfCpus);
 
+  if (Context->Mwait) {
+    InternalMonitorWaitForSemaphore (Context, CpuIndex, Context->CpuSem[CpuIndex].Run);
+    return;
+  }
+
   InternalWaitForSemaphore (Context->CpuSem[CpuIndex].Run);
 }
 
@@ -648,5 +1041,64 @@ SmmCpuSyncReleaseBsp (
 
   ASSERT (BspIndex < Context->NumberOfCpus);
 
+  if (Context->Hierarchical) {
+    InternalReleaseSemaphore (Context->PackageSem[Context->CpuPackage[CpuIndex]].Arrived);
+    return;
+  }
+
   InternalReleaseSemaphore (Context->CpuSem[BspIndex].Run);
 }
+
+/**
+  Get the wake up counters of the APs waiting for the BSP, summed up over all CPUs.
+
+  A wake up is spurious when the AP finds its semaphore still not released
+  after MWAIT returned.
+
+  If Context is NULL, then ASSERT().
+  If Wakeups is NULL, then ASSERT().
+  If SpuriousWakeups is NULL, then ASSERT().
+
+  @param[in,out]  Context           Pointer to the SMM CPU Sync context object.
+  @param[in]      Reset             TRUE to clear the counters once they are read.
+  @param[out]     Wakeups           Number of times a waiting AP was woken up.
+  @param[out]     SpuriousWakeups   Number of wake ups that did not release the AP.
+
+  @retval RETURN_SUCCESS            The counters are returned.
+  @retval RETURN_UNSUPPORTED        The APs wait with PAUSE, both counters are 0.
+
+**/
+RETURN_STATUS
+EFIAPI
+SmmCpuSyncGetWaitStatistics (
+  IN OUT SMM_CPU_SYNC_CONTEXT  *Context,
+  IN     BOOLEAN               Reset,
+  OUT    UINT64                *Wakeups,
+  OUT    UINT64                *SpuriousWakeups
+  )
+{
+  SMM_CPU_SYNC_WAIT_STATISTICS  *Stats;
+  UINTN                         CpuIndex;
+
+  ASSERT (Context != NULL);
+  ASSERT (Wakeups != NULL);
+  ASSERT (SpuriousWakeups != NULL);
+
+  *Wakeups         = 0;
+  *SpuriousWakeups = 0;
+  if (!Context->Mwait) {
+    return RETURN_UNSUPPORTED;
+  }
+
+  for (CpuIndex = 0; CpuIndex < Context->NumberOfCpus; CpuIndex++) {
+    Stats             = (SMM_CPU_SYNC_WAIT_STATISTICS *)((UINTN)Context->WaitStatsBuffer + CpuIndex * Context->WaitStatsSize);
+    *Wakeups         += Stats->Wakeups;
+    *SpuriousWakeups += Stats->SpuriousWakeups;
+    if (Reset) {
+      Stats->Wakeups         = 0;
+      Stats->SpuriousWakeups = 0;
+    }
+  }
+
+  return RETURN_SUCCESS;
+}
@@ -0,0 +1,41 @@
+/** @file
+  Ring 3 interface to submit a batch of IO and MSR accesses with one syscall.
+
+  Copyright (C) Microsoft Corporation.
+
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/SysCallLib.h>
+
+/**
+  Execute a list of IO and MSR accesses with a single supervisor transition.
+
+  Every record is checked against the supervisor policy before it is executed,
+  an access blocked by the policy is handled the same way as a blocked
+  SMM_SC_IO_READ/WRITE or SMM_SC_RDMSR/WRMSR request.
+
+  @param[in, out] Entries   The records to execute, values read are written
+                            back into the records.
+  @param[in]      Count     The number of records, no more than
+                            SMM_SC_BATCH_MAX_ENTRIES.
+
+  @retval EFI_SUCCESS             All records are executed.
+  @retval EFI_INVALID_PARAMETER   Entries is NULL, or Count is 0 or too large.
+**/
+EFI_STATUS
+EFIAPI
+SysCallBatch (
+  IN OUT SMM_SC_BATCH_ENTRY  *Entries,
+  IN     UINTN               Count
+  )
+{
+  if ((Entries == NULL) || (Count == 0) || (Count > SMM_SC_BATCH_MAX_ENTRIES)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return (EFI_STATUS)SysCall (SMM_SC_BATCH, (UINTN)Entries, Count, 0);
+}
@@ -62,6 +62,256 @@ typedef struct _COMM_UPDATE_BUFFER {
   MM_SUPERVISOR_UNBLOCK_MEMORY_PARAMS    NewCommBuffers[MM_OPEN_BUFFER_CNT];
 } MM_SUPERVISOR_COMM_UPDATE_BUFFER;
 
+//
+// Number of latency buckets per syscall. Bucket n counts the calls that took
+// [2^n, 2^(n+1)) TSC ticks, the last bucket also holds all longer calls.
+//
+#define MM_SUPERVISOR_SYSCALL_STATS_BUCKETS  24
+
+//
+// CallIndex reported for the syscalls that do not map to a known index.
+//
+#define MM_SUPERVISOR_SYSCALL_STATS_OTHER  MAX_UINT64
+
+//
+// Flag of MM_SUPERVISOR_SYSCALL_STATS_BUFFER, clear all counters once copied.
+//
+#define MM_SUPERVISOR_SYSCALL_STATS_RESET  BIT0
+
+/**
+  This structure holds the counters of one syscall index, summed up over all
+  processors.
+
+**/
+typedef struct _SYSCALL_STATS_ENTRY {
+  UINT64    CallIndex;
+  UINT64    Count;
+  UINT64    Denials;
+  UINT64    Histogram[MM_SUPERVISOR_SYSCALL_STATS_BUCKETS];
+} MM_SUPERVISOR_SYSCALL_STATS_ENTRY;
+
+/**
+  This structure is used to request a snapshot of the syscall counters. It is
+  followed by EntryCount MM_SUPERVISOR_SYSCALL_STATS_ENTRY, one per syscall
+  index invoked at least once.
+
+**/
+typedef struct _SYSCALL_STATS_BUFFER {
+  UINT32    Flags;
+  UINT32    EntryCount;
+} MM_SUPERVISOR_SYSCALL_STATS_BUFFER;
+
+/**
+  This structure holds one traced syscall.
+
+**/
+typedef struct _SYSCALL_TRACE_ENTRY {
+  UINT64    Timestamp;
+  UINT64    CallIndex;
+  UINT64    Arg1;
+  UINT64    Arg2;
+  UINT64    Arg3;
+  UINT64    CallerAddr;
+  UINT64    Status;
+  UINT32    CpuIndex;
+  UINT32    Reserved;
+} MM_SUPERVISOR_SYSCALL_TRACE_ENTRY;
+
+/**
+  This structure is used to drain the syscall trace rings. It is followed by
+  EntryCount MM_SUPERVISOR_SYSCALL_TRACE_ENTRY, oldest first for each processor.
+  Dropped counts the records overwritten before they could be drained.
+
+**/
+typedef struct _SYSCALL_TRACE_BUFFER {
+  UINT32    EntryCount;
+  UINT32    Dropped;
+} MM_SUPERVISOR_SYSCALL_TRACE_BUFFER;
+
+//
+// Type of MM_SUPERVISOR_ACCESS_PROFILE_ENTRY.
+//
+#define MM_SUPERVISOR_ACCESS_PROFILE_IO   0
+#define MM_SUPERVISOR_ACCESS_PROFILE_MSR  1
+
+/**
+  This structure holds the profile of one IO port or MSR accessed through
+  syscalls. WidthMask has bit n set if the IO port was accessed with
+  EFI_MM_IO_WIDTH n, it is always 0 for MSRs.
+
+**/
+typedef struct _ACCESS_PROFILE_ENTRY {
+  UINT32    Address;
+  UINT8     Type;
+  UINT8     WidthMask;
+  UINT8     Valid;
+  UINT8     Reserved;
+  UINT64    ReadCount;
+  UINT64    WriteCount;
+} MM_SUPERVISOR_ACCESS_PROFILE_ENTRY;
+
+/**
+  This structure is used to request the IO port and MSR access profile. It is
+  followed by EntryCount MM_SUPERVISOR_ACCESS_PROFILE_ENTRY. The buffer is also
+  the binary format consumed by SupervisorPolicyMaker.py.
+
+**/
+typedef struct _ACCESS_PROFILE_BUFFER {
+  UINT32    EntryCount;
+  UINT32    Reserved;
+} MM_SUPERVISOR_ACCESS_PROFILE_BUFFER;
+
+//
+// Flag of MM_SUPERVISOR_PAGE_ATTRIBUTE_CACHE_BUFFER, clear the hit and miss counters once copied.
+//
+#define MM_SUPERVISOR_PAGE_ATTRIBUTE_CACHE_RESET  BIT0
+
+/**
+  This structure is used to request the counters of the page attribute caches
+  consulted by the buffer ownership checks, summed up over all processors.
+  Invalidations counts the page table updates since boot.
+
+**/
+typedef struct _PAGE_ATTRIBUTE_CACHE_BUFFER {
+  UINT32    Flags;
+  UINT32    Reserved;
+  UINT64    Hits;
+  UINT64    Misses;
+  UINT64    Invalidations;
+} MM_SUPERVISOR_PAGE_ATTRIBUTE_CACHE_BUFFER;
+
+//
+// Flag of MM_SUPERVISOR_SYSCALL_MSR_BUFFER, clear all counters once copied.
+//
+#define MM_SUPERVISOR_SYSCALL_MSR_RESET  BIT0
+
+/**
+  This structure is used to request the counters of the syscall MSR setup
+  around demoted calls, summed up over all processors. PerSmi is 1 if the
+  MSRs are kept programmed for a whole SMI. AccessesSaved counts the MSR reads
+  and writes skipped because the MSRs were already programmed.
+
+**/
+typedef struct _SYSCALL_MSR_BUFFER {
+  UINT32    Flags;
+  UINT32    PerSmi;
+  UINT64    Programs;
+  UINT64    AccessesSaved;
+} MM_SUPERVISOR_SYSCALL_MSR_BUFFER;
+
+//
+// Flag of MM_SUPERVISOR_COMM_BUFFER_STATS_BUFFER, clear all counters once copied.
+//
+#define MM_SUPERVISOR_COMM_BUFFER_STATS_RESET  BIT0
+
+/**
+  This structure is used to request the counters of the communicate buffer
+  copies made by the supervisor for synchronous MMIs, over both channels.
+  BytesCopied counts the bytes copied into the internal copy and back out,
+  BytesZeroed the bytes of earlier MMIs cleared from the internal copy.
+
+**/
+typedef struct _COMM_BUFFER_STATS_BUFFER {
+  UINT32    Flags;
+  UINT32    Reserved;
+  UINT64    Mmis;
+  UINT64    BytesCopied;
+  UINT64    BytesZeroed;
+} MM_SUPERVISOR_COMM_BUFFER_STATS_BUFFER;
+
+#define MM_SUPERVISOR_RENDEZVOUS_STATS_RESET  BIT0
+
+/**
+  This structure is used to request the TSC cycles the BSP spent in the SMI rendezvous.
+  EntryCycles counts the time to gather the APs and lock the door, ExitCycles the time
+  from releasing the APs to exit until all of them checked out, HandlerCycles the time
+  the BSP spent in the MM foundation in between. The Max fields hold the longest single SMI.
+
+  Wakeups and SpuriousWakeups count how often the APs waiting for the BSP were woken up
+  from MWAIT, and how many of those did not release them. Both are 0 when the APs wait
+  with PAUSE.
+
+  FastExits counts the SMIs that released the APs to exit without a round of their
+  semaphores, because no procedure was queued on any AP.
+
+**/
+typedef struct _RENDEZVOUS_STATS_BUFFER {
+  UINT32    Flags;
+  UINT32    Reserved;
+  UINT64    Smis;
+  UINT64    EntryCycles;
+  UINT64    MaxEntryCycles;
+  UINT64    ExitCycles;
+  UINT64    MaxExitCycles;
+  UINT64    HandlerCycles;
+  UINT64    MaxHandlerCycles;
+  UINT64    Wakeups;
+  UINT64    SpuriousWakeups;
+  UINT64    FastExits;
+} MM_SUPERVISOR_RENDEZVOUS_STATS_BUFFER;
+
+//
+// Phases of an SMI recorded by each processor in the SMI timeline. ARRIVAL is taken
+// when the processor enters the SMI rendezvous, SYNC_DONE once it is ready to run
+// the MM foundation (BSP) or procedures (AP), DISPATCH_START and DISPATCH_END around
+// the MM foundation or each procedure, RELEASE when the BSP lets the APs go or an AP
+// is let go, and EXIT right before the processor leaves the SMI.
+//
+#define MM_SUPERVISOR_SMI_PHASE_ARRIVAL         0
+#define MM_SUPERVISOR_SMI_PHASE_SYNC_DONE       1
+#define MM_SUPERVISOR_SMI_PHASE_DISPATCH_START  2
+#define MM_SUPERVISOR_SMI_PHASE_DISPATCH_END    3
+#define MM_SUPERVISOR_SMI_PHASE_RELEASE         4
+#define MM_SUPERVISOR_SMI_PHASE_EXIT            5
+#define MM_SUPERVISOR_SMI_PHASE_COUNT           6
+
+//
+// Flag of MM_SUPERVISOR_SMI_TIMELINE_BUFFER, clear the phase statistics once copied.
+//
+#define MM_SUPERVISOR_SMI_TIMELINE_RESET  BIT0
+
+/**
+  This structure holds one phase event of the SMI timeline. SmiIndex counts the
+  SMIs the processor entered before this one.
+
+**/
+typedef struct _SMI_TIMELINE_ENTRY {
+  UINT64    Timestamp;
+  UINT32    SmiIndex;
+  UINT16    CpuIndex;
+  UINT8     Phase;
+  UINT8     Reserved;
+} MM_SUPERVISOR_SMI_TIMELINE_ENTRY;
+
+/**
+  This structure holds the TSC cycles from the arrival of a processor to one phase
+  of the same SMI, summed up over all processors and SMIs. P99Cycles is an upper
+  bound of the 99th percentile, within a quarter of its power of two.
+
+**/
+typedef struct _SMI_PHASE_STATS {
+  UINT64    Count;
+  UINT64    MinCycles;
+  UINT64    AvgCycles;
+  UINT64    MaxCycles;
+  UINT64    P99Cycles;
+} MM_SUPERVISOR_SMI_PHASE_STATS;
+
+/**
+  This structure is used to drain the SMI timeline rings. It is followed by EntryCount
+  MM_SUPERVISOR_SMI_TIMELINE_ENTRY, oldest first for each processor. Dropped counts the
+  events overwritten before they could be drained. Phases holds the statistics of each
+  phase, the one of MM_SUPERVISOR_SMI_PHASE_ARRIVAL stays empty.
+
+**/
+typedef struct _SMI_TIMELINE_BUFFER {
+  UINT32                           Flags;
+  UINT32                           EntryCount;
+  UINT32                           Dropped;
+  UINT32                           Reserved;
+  MM_SUPERVISOR_SMI_PHASE_STATS    Phases[MM_SUPERVISOR_SMI_PHASE_COUNT];
+} MM_SUPERVISOR_SMI_TIMELINE_BUFFER;
+
 #pragma pack(pop)
 
 /**
@@ -96,12 +346,60 @@ typedef struct _COMM_UPDATE_BUFFER {
  **/
 #define   MM_SUPERVISOR_REQUEST_COMM_UPDATE  0x0004
 
+/**
+  @retval EFI_UNSUPPORTED            If syscall statistics are not enabled in this build
+  @retval EFI_BUFFER_TOO_SMALL       If incoming communication buffer is not big enough to hold all
+                                     entries, EntryCount is updated with the number of entries needed
+ **/
+#define   MM_SUPERVISOR_REQUEST_SYSCALL_STATS  0x0005
+
+/**
+  @retval EFI_UNSUPPORTED            If syscall tracing is not enabled in this build
+  @retval EFI_SUCCESS                Drained records are returned. Records that do not fit in the incoming
+                                     communication buffer are kept for the next request
+ **/
+#define   MM_SUPERVISOR_REQUEST_SYSCALL_TRACE  0x0006
+
+/**
+  @retval EFI_UNSUPPORTED            If IO port and MSR access profiling is not enabled in this build
+  @retval EFI_BUFFER_TOO_SMALL       If incoming communication buffer is not big enough to hold all
+                                     entries, EntryCount is updated with the number of entries needed
+ **/
+#define   MM_SUPERVISOR_REQUEST_ACCESS_PROFILE  0x0007
+
+/**
+  @retval EFI_UNSUPPORTED            If the page attribute cache is not enabled in this build
+ **/
+#define   MM_SUPERVISOR_REQUEST_PAGE_ATTRIBUTE_CACHE  0x0008
+
+/**
+  @retval EFI_NOT_READY              If the syscall interface is not initialized
+ **/
+#define   MM_SUPERVISOR_REQUEST_SYSCALL_MSR  0x0009
+
+/**
+  @retval EFI_SUCCESS                If the counters are copied out
+ **/
+#define   MM_SUPERVISOR_REQUEST_COMM_BUFFER_STATS  0x000A
+
+/**
+  @retval EFI_SUCCESS                If the counters are copied out
+ **/
+#define   MM_SUPERVISOR_REQUEST_RENDEZVOUS_STATS  0x000B
+
+/**
+  @retval EFI_UNSUPPORTED            If the SMI timeline is not enabled in this build
+  @retval EFI_SUCCESS                Drained events and phase statistics are returned. Events that do
+                                     not fit in the incoming communication buffer are kept for the next request
+ **/
+#define   MM_SUPERVISOR_REQUEST_SMI_TIMELINE  0x000C
+
 /**
   Maximal request index supported by supervisor. When supported, the value of this definition
   will be populated in the MaxSupervisorRequestLevel of VERSION_INFO_BUFFER upon a successful query
   to supervisor.
 
  **/
-#define   MM_SUPERVISOR_REQUEST_MAX_SUPPORTED  MM_SUPERVISOR_REQUEST_COMM_UPDATE
+#define   MM_SUPERVISOR_REQUEST_MAX_SUPPORTED  MM_SUPERVISOR_REQUEST_SMI_TIMELINE
 
 #endif // _MM_SUPV_REQUEST_DATA_H_
@@ -3,6 +3,7 @@
 #  Dump a policy binary
 #  Create a new policy given an xml file
 #  Append to a policy additional entries given an xml file
+#  Create an allow list xml file from an IO/MSR access profile binary
 #
 # Copyright (c) Microsoft Corporation
 #
@@ -11,6 +12,7 @@
 
 import logging
 import io
+import struct
 from argparse import ArgumentParser
 import os
 import datetime
@@ -144,6 +146,56 @@ def ParseXmlAndAddToPolicy(filepath: str, policy: Supervisor_Policy):
         policy.AddPolicyRoot (policy_root)
 
 
+def ParseAccessProfileToXml(filepath: str, xml_path: str):
+    ''' Turn an IO/MSR access profile binary into allow list XML policy entries
+
+    The binary is the MM_SUPERVISOR_ACCESS_PROFILE_BUFFER returned by
+    MM_SUPERVISOR_REQUEST_ACCESS_PROFILE, followed by its entries.
+    '''
+    HEADER_FORMAT = "<II"
+    ENTRY_FORMAT = "<IBBBBQQ"
+    PROFILE_TYPE_MSR = 1
+
+    with open(filepath, "rb") as f:
+        data = f.read()
+
+    (count, _) = struct.unpack_from(HEADER_FORMAT, data, 0)
+    offset = struct.calcsize(HEADER_FORMAT)
+    if len(data) < offset + count * struct.calcsize(ENTRY_FORMAT):
+        raise Exception(f"Access profile {filepath} is truncated")
+
+    io_entries = []
+    msr_entries = []
+    for (address, entry_type, width_mask, _, _, reads, writes) in struct.iter_unpack(
+            ENTRY_FORMAT, data[offset:offset + count * struct.calcsize(ENTRY_FORMAT)]):
+        attributes = []
+        if reads != 0:
+            attributes.append("Read")
+        if writes != 0:
+            attributes.append("Write")
+        if entry_type == PROFILE_TYPE_MSR:
+            msr_entries.append((address, 1, attributes))
+        else:
+            # Cover the widest access seen on this port
+            io_entries.append((address, 1 << (width_mask.bit_length() - 1) if width_mask != 0 else 1, attributes))
+
+    root = ET.Element("SmmIslolationPolicy")
+    for (name, entries) in (("IO", io_entries), ("MSR", msr_entries)):
+        category = ET.SubElement(root, "SmmCategory", name=name)
+        ET.SubElement(category, "PolicyAccessAttribute", Value="Allow")
+        for (address, size, attributes) in sorted(entries):
+            element = ET.SubElement(category, "PolicyEntry")
+            ET.SubElement(element, "StartAddress", Value=f"0x{address:X}")
+            ET.SubElement(element, "Size", Value=f"0x{size:X}")
+            ET.SubElement(element, "SecurityAttributes", Value=" | ".join(attributes))
+
+    tree = ET.ElementTree(root)
+    ET.indent(tree)
+    tree.write(xml_path)
+    logging.critical(
+        f"Allow list with {len(io_entries)} IO and {len(msr_entries)} MSR entries written to: {os.path.abspath(xml_path)}")
+
+
 class SupervisorPolicyMaker(IUefiHelperPlugin):
 
     def RegisterHelpers(self, obj):
@@ -195,6 +247,11 @@ def main() -> int:
                         help="Path to Xml File to encode as policy", type=str)
     parser.add_argument("-o", "--OutputBinary", "--outputbinary", dest="output_binary_path",
                         default=None, help="Path to output policy binary")
+    parser.add_argument("-p", "--ProfileBinary", "--profilebinary", dest="profile_bin", default=None,
+                        help="Path to an IO/MSR access profile binary to turn into allow list xml entries, see -a",
+                        type=str)
+    parser.add_argument("-a", "--ProfileXml", "--profilexml", dest="profile_xml_path", default=None,
+                        help="Path to output the allow list xml generated from -p", type=str)
     parser.add_argument("-v", "--OutputVersion", "--outputversion", dest="output_version",
                         default=Supervisor_Policy.FLEXBILE_STRUCTURE_VERSION, help="Output binary version in UINT32 format, default will output v1.0",
                         type=int)
@@ -215,6 +272,14 @@ def main() -> int:
         logging.critical("Invalid output version specified")
         return -3
 
+    if args.profile_bin is not None:
+        if not os.path.isfile(args.profile_bin) or args.profile_xml_path is None:
+            logging.critical("Invalid access profile binary or output xml path")
+            return -4
+        ParseAccessProfileToXml(args.profile_bin, args.profile_xml_path)
+        if args.xml_file_path is None and args.input_bin is None:
+            return 0
+
     return SupervisorPolicyMaker.MakeSupervisorPolicy(output_version=args.output_version,
                                                       input_bin=args.input_bin,
                                                       xml_file_path=args.xml_file_path,
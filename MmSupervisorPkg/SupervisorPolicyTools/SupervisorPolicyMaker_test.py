@@ -0,0 +1,99 @@
+# @file
+# unit tests for the access profile conversion of SupervisorPolicyMaker
+#
+# Copyright (c) Microsoft Corporation
+#
+# SPDX-License-Identifier: BSD-2-Clause-Patent
+##
+
+import os
+import tempfile
+import unittest
+import xml.etree.ElementTree as ET
+
+from SupervisorPolicyMaker import ParseAccessProfileToXml, ParseXmlAndAddToPolicy
+from policy_entry import *
+
+
+class TestParseAccessProfileToXml(unittest.TestCase):
+
+    # MM_SUPERVISOR_ACCESS_PROFILE_BUFFER with 5 entries:
+    #   IO  0x70       width mask 0x03, 4 reads
+    #   IO  0xCF8      width mask 0x04, 2 reads, 3 writes
+    #   IO  0x80       width mask 0x01, 7 writes
+    #   MSR 0xC0000080 5 reads, 1 write
+    #   MSR 0x1B       1 read
+    VALID_PROFILE = '0500000000000000' \
+                    '700000000003010004000000000000000000000000000000' \
+                    'F80C00000004010002000000000000000300000000000000' \
+                    '800000000001010000000000000000000700000000000000' \
+                    '800000C00100010005000000000000000100000000000000' \
+                    '1B0000000100010001000000000000000000000000000000'
+
+    EMPTY_PROFILE = '0000000000000000'
+
+    def setUp(self):
+        self.tempdir = tempfile.TemporaryDirectory()
+        self.profile_path = os.path.join(self.tempdir.name, "profile.bin")
+        self.xml_path = os.path.join(self.tempdir.name, "profile.xml")
+
+    def tearDown(self):
+        self.tempdir.cleanup()
+
+    def _convert(self, profile_hex: str) -> ET.Element:
+        with open(self.profile_path, "wb") as f:
+            f.write(bytes.fromhex(profile_hex))
+        ParseAccessProfileToXml(self.profile_path, self.xml_path)
+        return ET.parse(self.xml_path).getroot()
+
+    def _entries(self, root: ET.Element, name: str) -> list:
+        category = root.find(f"SmmCategory[@name='{name}']")
+        self.assertIsNotNone(category)
+        self.assertEqual(category.find("PolicyAccessAttribute").get("Value"), "Allow")
+        return [(e.find("StartAddress").get("Value"),
+                 e.find("Size").get("Value"),
+                 e.find("SecurityAttributes").get("Value")) for e in category.findall("PolicyEntry")]
+
+    def test_valid_profile(self):
+        root = self._convert(self.VALID_PROFILE)
+        self.assertEqual(self._entries(root, "IO"), [
+            ("0x70", "0x2", "Read"),
+            ("0x80", "0x1", "Write"),
+            ("0xCF8", "0x4", "Read | Write")])
+        self.assertEqual(self._entries(root, "MSR"), [
+            ("0x1B", "0x1", "Read"),
+            ("0xC0000080", "0x1", "Read | Write")])
+
+    def test_empty_profile(self):
+        root = self._convert(self.EMPTY_PROFILE)
+        self.assertEqual(self._entries(root, "IO"), [])
+        self.assertEqual(self._entries(root, "MSR"), [])
+
+    def test_truncated_profile(self):
+        # Drop the last entry but keep the count of 5
+        with self.assertRaises(Exception):
+            self._convert(self.VALID_PROFILE[:-48])
+        self.assertFalse(os.path.exists(self.xml_path))
+
+    def test_profile_xml_makes_policy(self):
+        self._convert(self.VALID_PROFILE)
+        a = Supervisor_Policy()
+        ParseXmlAndAddToPolicy(self.xml_path, a)
+        self.assertEqual(len(a.PolicyRoots), 2)
+        for pr in a.PolicyRoots:
+            self.assertEqual(pr.AccessAttr.value, AccessAttribute.ACCESS_ATTR_ALLOW)
+            if pr.GetType() == POLICY_TYPE.IO:
+                self.assertEqual([(p.IoAddress, p.Size, p.Attributes.value) for p in pr.PolicyEntries], [
+                    (0x70, 2, AccessType.READ_INHERITED),
+                    (0x80, 1, AccessType.WRITE_INHERITED),
+                    (0xCF8, 4, AccessType.READ_INHERITED | AccessType.WRITE_INHERITED)])
+            elif pr.GetType() == POLICY_TYPE.MSR:
+                self.assertEqual([(p.MsrAddress, p.Size, p.Attributes.value) for p in pr.PolicyEntries], [
+                    (0x1B, 1, AccessType.READ_INHERITED),
+                    (0xC0000080, 1, AccessType.READ_INHERITED | AccessType.WRITE_INHERITED)])
+            else:
+                self.assertTrue(False)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -918,6 +918,529 @@ RequestUpdateCommBuffer (
   return UNIT_TEST_PASSED;
 }
 
+/*
+  Test case to snapshot and dump the syscall counters from supervisor
+*/
+UNIT_TEST_STATUS
+EFIAPI
+RequestSyscallStats (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                          Status;
+  MM_SUPERVISOR_REQUEST_HEADER        *CommBuffer;
+  MM_SUPERVISOR_SYSCALL_STATS_BUFFER  *StatsBuffer;
+  MM_SUPERVISOR_SYSCALL_STATS_ENTRY   *Entries;
+  UINTN                               Index0;
+  UINTN                               Index1;
+
+  // Grab the CommBuffer and fill it in for this test
+  Status = MmSupvRequestGetCommBuffer (&CommBuffer);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  CommBuffer->Signature = MM_SUPERVISOR_REQUEST_SIG;
+  CommBuffer->Revision  = MM_SUPERVISOR_REQUEST_REVISION;
+  CommBuffer->Request   = MM_SUPERVISOR_REQUEST_SYSCALL_STATS;
+  CommBuffer->Result    = EFI_SUCCESS;
+
+  StatsBuffer             = (MM_SUPERVISOR_SYSCALL_STATS_BUFFER *)(CommBuffer + 1);
+  StatsBuffer->Flags      = MM_SUPERVISOR_SYSCALL_STATS_RESET;
+  StatsBuffer->EntryCount = 0;
+
+  Status = MmSupvRequestDxeToMmCommunicate ();
+
+  if (EFI_ERROR (Status)) {
+    // We encountered some errors on our way fetching syscall statistics.
+    UT_LOG_ERROR ("Supervisor did not successfully process syscall statistics request %r.\n", Status);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  // Get the real handler status code
+  if ((UINTN)CommBuffer->Result != 0) {
+    Status = ENCODE_ERROR ((UINTN)CommBuffer->Result);
+  }
+
+  if (Status == EFI_UNSUPPORTED) {
+    UT_LOG_WARNING ("Syscall statistics are not enabled on this platform.\n");
+    return UNIT_TEST_SKIPPED;
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  Entries = (MM_SUPERVISOR_SYSCALL_STATS_ENTRY *)(StatsBuffer + 1);
+  for (Index0 = 0; Index0 < StatsBuffer->EntryCount; Index0++) {
+    DEBUG ((
+      DEBUG_INFO,
+      "Syscall 0x%lx: %ld calls, %ld denied\n",
+      Entries[Index0].CallIndex,
+      Entries[Index0].Count,
+      Entries[Index0].Denials
+      ));
+    for (Index1 = 0; Index1 < MM_SUPERVISOR_SYSCALL_STATS_BUCKETS; Index1++) {
+      if (Entries[Index0].Histogram[Index1] != 0) {
+        DEBUG ((DEBUG_INFO, "    2^%02d ticks: %ld\n", Index1, Entries[Index0].Histogram[Index1]));
+      }
+    }
+  }
+
+  UT_LOG_INFO ("Supervisor reported %d syscall indices in use.\n", StatsBuffer->EntryCount);
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Test case to drain and dump the syscall trace from supervisor
+*/
+UNIT_TEST_STATUS
+EFIAPI
+RequestSyscallTrace (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                          Status;
+  MM_SUPERVISOR_REQUEST_HEADER        *CommBuffer;
+  MM_SUPERVISOR_SYSCALL_TRACE_BUFFER  *TraceBuffer;
+  MM_SUPERVISOR_SYSCALL_TRACE_ENTRY   *Entries;
+  UINTN                               Index0;
+
+  // Grab the CommBuffer and fill it in for this test
+  Status = MmSupvRequestGetCommBuffer (&CommBuffer);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  CommBuffer->Signature = MM_SUPERVISOR_REQUEST_SIG;
+  CommBuffer->Revision  = MM_SUPERVISOR_REQUEST_REVISION;
+  CommBuffer->Request   = MM_SUPERVISOR_REQUEST_SYSCALL_TRACE;
+  CommBuffer->Result    = EFI_SUCCESS;
+
+  TraceBuffer = (MM_SUPERVISOR_SYSCALL_TRACE_BUFFER *)(CommBuffer + 1);
+
+  Status = MmSupvRequestDxeToMmCommunicate ();
+
+  if (EFI_ERROR (Status)) {
+    // We encountered some errors on our way draining syscall trace.
+    UT_LOG_ERROR ("Supervisor did not successfully process syscall trace request %r.\n", Status);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  // Get the real handler status code
+  if ((UINTN)CommBuffer->Result != 0) {
+    Status = ENCODE_ERROR ((UINTN)CommBuffer->Result);
+  }
+
+  if (Status == EFI_UNSUPPORTED) {
+    UT_LOG_WARNING ("Syscall trace is not enabled on this platform.\n");
+    return UNIT_TEST_SKIPPED;
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  Entries = (MM_SUPERVISOR_SYSCALL_TRACE_ENTRY *)(TraceBuffer + 1);
+  for (Index0 = 0; Index0 < TraceBuffer->EntryCount; Index0++) {
+    DEBUG ((
+      DEBUG_INFO,
+      "[%ld] CPU %d CallIndex: %lx, Arg1: %lx, Arg2: %lx, Arg3: %lx, CallerAddr: %lx - %r\n",
+      Entries[Index0].Timestamp,
+      Entries[Index0].CpuIndex,
+      Entries[Index0].CallIndex,
+      Entries[Index0].Arg1,
+      Entries[Index0].Arg2,
+      Entries[Index0].Arg3,
+      Entries[Index0].CallerAddr,
+      (EFI_STATUS)Entries[Index0].Status
+      ));
+  }
+
+  UT_LOG_INFO ("Supervisor drained %d syscall records, %d dropped.\n", TraceBuffer->EntryCount, TraceBuffer->Dropped);
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Test case to fetch and dump the IO port and MSR access profile from supervisor
+*/
+UNIT_TEST_STATUS
+EFIAPI
+RequestAccessProfile (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                           Status;
+  MM_SUPERVISOR_REQUEST_HEADER         *CommBuffer;
+  MM_SUPERVISOR_ACCESS_PROFILE_BUFFER  *ProfileBuffer;
+  MM_SUPERVISOR_ACCESS_PROFILE_ENTRY   *Entries;
+  UINTN                                Index0;
+
+  // Grab the CommBuffer and fill it in for this test
+  Status = MmSupvRequestGetCommBuffer (&CommBuffer);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  CommBuffer->Signature = MM_SUPERVISOR_REQUEST_SIG;
+  CommBuffer->Revision  = MM_SUPERVISOR_REQUEST_REVISION;
+  CommBuffer->Request   = MM_SUPERVISOR_REQUEST_ACCESS_PROFILE;
+  CommBuffer->Result    = EFI_SUCCESS;
+
+  ProfileBuffer = (MM_SUPERVISOR_ACCESS_PROFILE_BUFFER *)(CommBuffer + 1);
+
+  Status = MmSupvRequestDxeToMmCommunicate ();
+
+  if (EFI_ERROR (Status)) {
+    // We encountered some errors on our way fetching access profile.
+    UT_LOG_ERROR ("Supervisor did not successfully process access profile request %r.\n", Status);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  // Get the real handler status code
+  if ((UINTN)CommBuffer->Result != 0) {
+    Status = ENCODE_ERROR ((UINTN)CommBuffer->Result);
+  }
+
+  if (Status == EFI_UNSUPPORTED) {
+    UT_LOG_WARNING ("IO port and MSR access profiling is not enabled on this platform.\n");
+    return UNIT_TEST_SKIPPED;
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  Entries = (MM_SUPERVISOR_ACCESS_PROFILE_ENTRY *)(ProfileBuffer + 1);
+  for (Index0 = 0; Index0 < ProfileBuffer->EntryCount; Index0++) {
+    DEBUG ((
+      DEBUG_INFO,
+      "%a 0x%x: width mask 0x%x, %ld reads, %ld writes\n",
+      (Entries[Index0].Type == MM_SUPERVISOR_ACCESS_PROFILE_MSR) ? "MSR" : "IO",
+      Entries[Index0].Address,
+      Entries[Index0].WidthMask,
+      Entries[Index0].ReadCount,
+      Entries[Index0].WriteCount
+      ));
+  }
+
+  UT_LOG_INFO ("Supervisor reported %d IO ports and MSRs in use.\n", ProfileBuffer->EntryCount);
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Test case to fetch the page attribute cache counters from supervisor
+*/
+UNIT_TEST_STATUS
+EFIAPI
+RequestPageAttributeCache (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                                 Status;
+  MM_SUPERVISOR_REQUEST_HEADER               *CommBuffer;
+  MM_SUPERVISOR_PAGE_ATTRIBUTE_CACHE_BUFFER  *CacheBuffer;
+
+  // Grab the CommBuffer and fill it in for this test
+  Status = MmSupvRequestGetCommBuffer (&CommBuffer);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  CommBuffer->Signature = MM_SUPERVISOR_REQUEST_SIG;
+  CommBuffer->Revision  = MM_SUPERVISOR_REQUEST_REVISION;
+  CommBuffer->Request   = MM_SUPERVISOR_REQUEST_PAGE_ATTRIBUTE_CACHE;
+  CommBuffer->Result    = EFI_SUCCESS;
+
+  CacheBuffer = (MM_SUPERVISOR_PAGE_ATTRIBUTE_CACHE_BUFFER *)(CommBuffer + 1);
+  ZeroMem (CacheBuffer, sizeof (*CacheBuffer));
+
+  Status = MmSupvRequestDxeToMmCommunicate ();
+
+  if (EFI_ERROR (Status)) {
+    // We encountered some errors on our way fetching cache counters.
+    UT_LOG_ERROR ("Supervisor did not successfully process page attribute cache request %r.\n", Status);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  // Get the real handler status code
+  if ((UINTN)CommBuffer->Result != 0) {
+    Status = ENCODE_ERROR ((UINTN)CommBuffer->Result);
+  }
+
+  if (Status == EFI_UNSUPPORTED) {
+    UT_LOG_WARNING ("Page attribute cache is not enabled on this platform.\n");
+    return UNIT_TEST_SKIPPED;
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  // Every pool operation after the core initialization looks up the cache
+  UT_ASSERT_NOT_EQUAL (CacheBuffer->Hits + CacheBuffer->Misses, 0);
+
+  UT_LOG_INFO (
+    "Page attribute cache: %ld hits, %ld misses, %ld invalidations.\n",
+    CacheBuffer->Hits,
+    CacheBuffer->Misses,
+    CacheBuffer->Invalidations
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Test case to fetch the syscall MSR setup counters from supervisor
+*/
+UNIT_TEST_STATUS
+EFIAPI
+RequestSyscallMsr (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                        Status;
+  MM_SUPERVISOR_REQUEST_HEADER      *CommBuffer;
+  MM_SUPERVISOR_SYSCALL_MSR_BUFFER  *MsrBuffer;
+
+  // Grab the CommBuffer and fill it in for this test
+  Status = MmSupvRequestGetCommBuffer (&CommBuffer);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  CommBuffer->Signature = MM_SUPERVISOR_REQUEST_SIG;
+  CommBuffer->Revision  = MM_SUPERVISOR_REQUEST_REVISION;
+  CommBuffer->Request   = MM_SUPERVISOR_REQUEST_SYSCALL_MSR;
+  CommBuffer->Result    = EFI_SUCCESS;
+
+  MsrBuffer = (MM_SUPERVISOR_SYSCALL_MSR_BUFFER *)(CommBuffer + 1);
+  ZeroMem (MsrBuffer, sizeof (*MsrBuffer));
+
+  Status = MmSupvRequestDxeToMmCommunicate ();
+
+  if (EFI_ERROR (Status)) {
+    // We encountered some errors on our way fetching MSR counters.
+    UT_LOG_ERROR ("Supervisor did not successfully process syscall MSR request %r.\n", Status);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  // Get the real handler status code
+  if ((UINTN)CommBuffer->Result != 0) {
+    Status = ENCODE_ERROR ((UINTN)CommBuffer->Result);
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  // The user drivers have been dispatched through demoted entry points
+  UT_ASSERT_NOT_EQUAL (MsrBuffer->Programs, 0);
+
+  UT_LOG_INFO (
+    "Syscall MSRs: programmed %ld times, %ld MSR accesses saved, per SMI mode %d.\n",
+    MsrBuffer->Programs,
+    MsrBuffer->AccessesSaved,
+    MsrBuffer->PerSmi
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Test case to fetch the communicate buffer copy counters from supervisor
+*/
+UNIT_TEST_STATUS
+EFIAPI
+RequestCommBufferStats (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                              Status;
+  MM_SUPERVISOR_REQUEST_HEADER            *CommBuffer;
+  MM_SUPERVISOR_COMM_BUFFER_STATS_BUFFER  *StatsBuffer;
+
+  // Grab the CommBuffer and fill it in for this test
+  Status = MmSupvRequestGetCommBuffer (&CommBuffer);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  CommBuffer->Signature = MM_SUPERVISOR_REQUEST_SIG;
+  CommBuffer->Revision  = MM_SUPERVISOR_REQUEST_REVISION;
+  CommBuffer->Request   = MM_SUPERVISOR_REQUEST_COMM_BUFFER_STATS;
+  CommBuffer->Result    = EFI_SUCCESS;
+
+  StatsBuffer = (MM_SUPERVISOR_COMM_BUFFER_STATS_BUFFER *)(CommBuffer + 1);
+  ZeroMem (StatsBuffer, sizeof (*StatsBuffer));
+
+  Status = MmSupvRequestDxeToMmCommunicate ();
+
+  if (EFI_ERROR (Status)) {
+    // We encountered some errors on our way fetching comm buffer counters.
+    UT_LOG_ERROR ("Supervisor did not successfully process comm buffer stats request %r.\n", Status);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  // Get the real handler status code
+  if ((UINTN)CommBuffer->Result != 0) {
+    Status = ENCODE_ERROR ((UINTN)CommBuffer->Result);
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  // This very request came in through the supervisor channel
+  UT_ASSERT_NOT_EQUAL (StatsBuffer->Mmis, 0);
+  UT_ASSERT_NOT_EQUAL (StatsBuffer->BytesCopied, 0);
+
+  UT_LOG_INFO (
+    "Comm buffers: %ld MMIs, %ld bytes copied, %ld bytes zeroed, %ld bytes per MMI.\n",
+    StatsBuffer->Mmis,
+    StatsBuffer->BytesCopied,
+    StatsBuffer->BytesZeroed,
+    DivU64x64Remainder (StatsBuffer->BytesCopied + StatsBuffer->BytesZeroed, StatsBuffer->Mmis, NULL)
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Test case to fetch the SMI rendezvous timing counters from supervisor
+*/
+UNIT_TEST_STATUS
+EFIAPI
+RequestRendezvousStats (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                             Status;
+  MM_SUPERVISOR_REQUEST_HEADER           *CommBuffer;
+  MM_SUPERVISOR_RENDEZVOUS_STATS_BUFFER  *StatsBuffer;
+
+  // Grab the CommBuffer and fill it in for this test
+  Status = MmSupvRequestGetCommBuffer (&CommBuffer);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  CommBuffer->Signature = MM_SUPERVISOR_REQUEST_SIG;
+  CommBuffer->Revision  = MM_SUPERVISOR_REQUEST_REVISION;
+  CommBuffer->Request   = MM_SUPERVISOR_REQUEST_RENDEZVOUS_STATS;
+  CommBuffer->Result    = EFI_SUCCESS;
+
+  StatsBuffer = (MM_SUPERVISOR_RENDEZVOUS_STATS_BUFFER *)(CommBuffer + 1);
+  ZeroMem (StatsBuffer, sizeof (*StatsBuffer));
+
+  Status = MmSupvRequestDxeToMmCommunicate ();
+
+  if (EFI_ERROR (Status)) {
+    // We encountered some errors on our way fetching rendezvous counters.
+    UT_LOG_ERROR ("Supervisor did not successfully process rendezvous stats request %r.\n", Status);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  // Get the real handler status code
+  if ((UINTN)CommBuffer->Result != 0) {
+    Status = ENCODE_ERROR ((UINTN)CommBuffer->Result);
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  // The earlier requests of this application went through complete SMIs
+  UT_ASSERT_NOT_EQUAL (StatsBuffer->Smis, 0);
+  UT_ASSERT_TRUE (StatsBuffer->MaxEntryCycles <= StatsBuffer->EntryCycles);
+  UT_ASSERT_TRUE (StatsBuffer->MaxExitCycles <= StatsBuffer->ExitCycles);
+  UT_ASSERT_TRUE (StatsBuffer->MaxHandlerCycles <= StatsBuffer->HandlerCycles);
+  UT_ASSERT_TRUE (StatsBuffer->SpuriousWakeups <= StatsBuffer->Wakeups);
+  UT_ASSERT_TRUE (StatsBuffer->FastExits <= StatsBuffer->Smis);
+
+  UT_LOG_INFO (
+    "Rendezvous: %ld SMIs, %ld entry cycles per SMI (max %ld), %ld exit cycles per SMI (max %ld).\n",
+    StatsBuffer->Smis,
+    DivU64x64Remainder (StatsBuffer->EntryCycles, StatsBuffer->Smis, NULL),
+    StatsBuffer->MaxEntryCycles,
+    DivU64x64Remainder (StatsBuffer->ExitCycles, StatsBuffer->Smis, NULL),
+    StatsBuffer->MaxExitCycles
+    );
+  UT_LOG_INFO (
+    "Rendezvous: %ld BSP handler cycles per SMI (max %ld), %ld AP wake ups, %ld spurious, %ld fast exits.\n",
+    DivU64x64Remainder (StatsBuffer->HandlerCycles, StatsBuffer->Smis, NULL),
+    StatsBuffer->MaxHandlerCycles,
+    StatsBuffer->Wakeups,
+    StatsBuffer->SpuriousWakeups,
+    StatsBuffer->FastExits
+    );
+
+  return UNIT_TEST_PASSED;
+}
+
+/*
+  Test case to drain and dump the SMI phase timeline from supervisor
+*/
+UNIT_TEST_STATUS
+EFIAPI
+RequestSmiTimeline (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                         Status;
+  MM_SUPERVISOR_REQUEST_HEADER       *CommBuffer;
+  MM_SUPERVISOR_SMI_TIMELINE_BUFFER  *TimelineBuffer;
+  MM_SUPERVISOR_SMI_TIMELINE_ENTRY   *Entries;
+  MM_SUPERVISOR_SMI_PHASE_STATS      *Stats;
+  UINTN                              Index0;
+
+  // Grab the CommBuffer and fill it in for this test
+  Status = MmSupvRequestGetCommBuffer (&CommBuffer);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  CommBuffer->Signature = MM_SUPERVISOR_REQUEST_SIG;
+  CommBuffer->Revision  = MM_SUPERVISOR_REQUEST_REVISION;
+  CommBuffer->Request   = MM_SUPERVISOR_REQUEST_SMI_TIMELINE;
+  CommBuffer->Result    = EFI_SUCCESS;
+
+  TimelineBuffer = (MM_SUPERVISOR_SMI_TIMELINE_BUFFER *)(CommBuffer + 1);
+  ZeroMem (TimelineBuffer, sizeof (*TimelineBuffer));
+
+  Status = MmSupvRequestDxeToMmCommunicate ();
+
+  if (EFI_ERROR (Status)) {
+    // We encountered some errors on our way draining SMI timeline.
+    UT_LOG_ERROR ("Supervisor did not successfully process SMI timeline request %r.\n", Status);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  // Get the real handler status code
+  if ((UINTN)CommBuffer->Result != 0) {
+    Status = ENCODE_ERROR ((UINTN)CommBuffer->Result);
+  }
+
+  if (Status == EFI_UNSUPPORTED) {
+    UT_LOG_WARNING ("SMI timeline is not enabled on this platform.\n");
+    return UNIT_TEST_SKIPPED;
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  Entries = (MM_SUPERVISOR_SMI_TIMELINE_ENTRY *)(TimelineBuffer + 1);
+  for (Index0 = 0; Index0 < TimelineBuffer->EntryCount; Index0++) {
+    UT_ASSERT_TRUE (Entries[Index0].Phase < MM_SUPERVISOR_SMI_PHASE_COUNT);
+    DEBUG ((
+      DEBUG_INFO,
+      "[%ld] CPU %d SMI %d Phase %d\n",
+      Entries[Index0].Timestamp,
+      Entries[Index0].CpuIndex,
+      Entries[Index0].SmiIndex,
+      Entries[Index0].Phase
+      ));
+  }
+
+  // The arrival is where the latencies of the other phases are counted from
+  for (Index0 = MM_SUPERVISOR_SMI_PHASE_ARRIVAL + 1; Index0 < MM_SUPERVISOR_SMI_PHASE_COUNT; Index0++) {
+    Stats = &TimelineBuffer->Phases[Index0];
+    if (Stats->Count == 0) {
+      continue;
+    }
+
+    UT_ASSERT_TRUE (Stats->MinCycles <= Stats->AvgCycles);
+    UT_ASSERT_TRUE (Stats->AvgCycles <= Stats->MaxCycles);
+    UT_ASSERT_TRUE (Stats->P99Cycles <= Stats->MaxCycles);
+
+    UT_LOG_INFO (
+      "Phase %d: %ld samples, cycles since arrival min %ld, avg %ld, p99 %ld, max %ld.\n",
+      Index0,
+      Stats->Count,
+      Stats->MinCycles,
+      Stats->AvgCycles,
+      Stats->P99Cycles,
+      Stats->MaxCycles
+      );
+  }
+
+  UT_LOG_INFO ("Supervisor drained %d SMI phase events, %d dropped.\n", TimelineBuffer->EntryCount, TimelineBuffer->Dropped);
+
+  return UNIT_TEST_PASSED;
+}
+
 /// ================================================================================================
 /// ================================================================================================
 ///
@@ -1012,6 +1535,78 @@ MmSupvRequestUnitTestAppEntryPoint (
     NULL,
     NULL
     );
+  AddTestCase (
+    Misc,
+    "Syscall statistics test",
+    "MmSupv.Miscellaneous.MmSupvSyscallStats",
+    RequestSyscallStats,
+    LocateMmCommonCommBuffer,
+    NULL,
+    NULL
+    );
+  AddTestCase (
+    Misc,
+    "Syscall trace test",
+    "MmSupv.Miscellaneous.MmSupvSyscallTrace",
+    RequestSyscallTrace,
+    LocateMmCommonCommBuffer,
+    NULL,
+    NULL
+    );
+  AddTestCase (
+    Misc,
+    "IO and MSR access profile test",
+    "MmSupv.Miscellaneous.MmSupvAccessProfile",
+    RequestAccessProfile,
+    LocateMmCommonCommBuffer,
+    NULL,
+    NULL
+    );
+  AddTestCase (
+    Misc,
+    "Page attribute cache test",
+    "MmSupv.Miscellaneous.MmSupvPageAttributeCache",
+    RequestPageAttributeCache,
+    LocateMmCommonCommBuffer,
+    NULL,
+    NULL
+    );
+  AddTestCase (
+    Misc,
+    "Syscall MSR setup test",
+    "MmSupv.Miscellaneous.MmSupvSyscallMsr",
+    RequestSyscallMsr,
+    LocateMmCommonCommBuffer,
+    NULL,
+    NULL
+    );
+  AddTestCase (
+    Misc,
+    "Comm buffer copy test",
+    "MmSupv.Miscellaneous.MmSupvCommBufferStats",
+    RequestCommBufferStats,
+    LocateMmCommonCommBuffer,
+    NULL,
+    NULL
+    );
+  AddTestCase (
+    Misc,
+    "SMI rendezvous timing test",
+    "MmSupv.Miscellaneous.MmSupvRendezvousStats",
+    RequestRendezvousStats,
+    LocateMmCommonCommBuffer,
+    NULL,
+    NULL
+    );
+  AddTestCase (
+    Misc,
+    "SMI phase timeline test",
+    "MmSupv.Miscellaneous.MmSupvSmiTimeline",
+    RequestSmiTimeline,
+    LocateMmCommonCommBuffer,
+    NULL,
+    NULL
+    );
 
   //
   // Execute the tests.
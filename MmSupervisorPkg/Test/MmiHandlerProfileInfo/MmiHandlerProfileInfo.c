@@ -23,6 +23,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Guid/PiSmmCommunicationRegionTable.h>
 
 #include <Guid/SmiHandlerProfile.h>
+#include <MmiHandlerProfileStats.h>
 
 #define PROFILE_NAME_STRING_LENGTH  64
 CHAR8  mNameString[PROFILE_NAME_STRING_LENGTH + 1];
@@ -655,6 +656,136 @@ DumpSmiHandler (
   return;
 }
 
+/**
+  Get the dispatch statistics the supervisor appended to a handler record.
+
+  @param SmiHandlerStruct  SMI handler record
+
+  @return statistics of the handler, or NULL if the record carries none
+**/
+MMI_HANDLER_STATS *
+GetSmiHandlerStats (
+  IN SMM_CORE_SMI_HANDLER_STRUCTURE  *SmiHandlerStruct
+  )
+{
+  MMI_HANDLER_STATS  *Stats;
+
+  if (SmiHandlerStruct->Length < sizeof (SMM_CORE_SMI_HANDLER_STRUCTURE) + ALIGN_VALUE (SmiHandlerStruct->ContextBufferSize, sizeof (UINT64)) + sizeof (MMI_HANDLER_STATS)) {
+    return NULL;
+  }
+
+  Stats = (MMI_HANDLER_STATS *)((UINTN)SmiHandlerStruct + SmiHandlerStruct->Length - sizeof (MMI_HANDLER_STATS));
+  if (Stats->Signature != MMI_HANDLER_STATS_SIGNATURE) {
+    return NULL;
+  }
+
+  return Stats;
+}
+
+typedef struct {
+  SMM_CORE_SMI_DATABASE_STRUCTURE    *SmiStruct;
+  SMM_CORE_SMI_HANDLER_STRUCTURE     *SmiHandlerStruct;
+  MMI_HANDLER_STATS                  *Stats;
+} HOT_SMI_HANDLER;
+
+/**
+  Dump the SMI handlers that were called, of all categories, ranked by the
+  cycles spent in them.
+**/
+VOID
+DumpHotSmiHandlers (
+  VOID
+  )
+{
+  SMM_CORE_SMI_DATABASE_STRUCTURE    *SmiStruct;
+  SMM_CORE_SMI_HANDLER_STRUCTURE     *SmiHandlerStruct;
+  SMM_CORE_IMAGE_DATABASE_STRUCTURE  *ImageStruct;
+  MMI_HANDLER_STATS                  *Stats;
+  HOT_SMI_HANDLER                    *HotHandlers;
+  HOT_SMI_HANDLER                    HotHandler;
+  UINTN                              HotCount;
+  UINTN                              MaxCount;
+  UINTN                              Index;
+  UINTN                              Rank;
+  CHAR8                              *NameString;
+
+  //
+  // Every handler takes at least one record, which bounds the number of handlers
+  //
+  MaxCount    = mSmiHandlerProfileDatabaseSize / sizeof (SMM_CORE_SMI_HANDLER_STRUCTURE);
+  HotHandlers = AllocatePool (MaxCount * sizeof (HOT_SMI_HANDLER));
+  if (HotHandlers == NULL) {
+    return;
+  }
+
+  HotCount  = 0;
+  SmiStruct = (VOID *)mSmiHandlerProfileDatabase;
+  while ((UINTN)SmiStruct < (UINTN)mSmiHandlerProfileDatabase + mSmiHandlerProfileDatabaseSize) {
+    if (SmiStruct->Header.Signature == SMM_CORE_SMI_DATABASE_SIGNATURE) {
+      SmiHandlerStruct = (VOID *)(SmiStruct + 1);
+      for (Index = 0; (Index < SmiStruct->HandlerCount) && (HotCount < MaxCount); Index++) {
+        Stats = GetSmiHandlerStats (SmiHandlerStruct);
+        if ((Stats != NULL) && (Stats->Calls != 0)) {
+          HotHandlers[HotCount].SmiStruct        = SmiStruct;
+          HotHandlers[HotCount].SmiHandlerStruct = SmiHandlerStruct;
+          HotHandlers[HotCount].Stats            = Stats;
+          HotCount++;
+        }
+
+        SmiHandlerStruct = (VOID *)((UINTN)SmiHandlerStruct + SmiHandlerStruct->Length);
+      }
+    }
+
+    SmiStruct = (VOID *)((UINTN)SmiStruct + SmiStruct->Header.Length);
+  }
+
+  //
+  // Insertion sort, the hottest handler first
+  //
+  for (Index = 1; Index < HotCount; Index++) {
+    CopyMem (&HotHandler, &HotHandlers[Index], sizeof (HotHandler));
+    for (Rank = Index; (Rank > 0) && (HotHandlers[Rank - 1].Stats->TotalCycles < HotHandler.Stats->TotalCycles); Rank--) {
+      CopyMem (&HotHandlers[Rank], &HotHandlers[Rank - 1], sizeof (HotHandler));
+    }
+
+    CopyMem (&HotHandlers[Rank], &HotHandler, sizeof (HotHandler));
+  }
+
+  for (Rank = 0; Rank < HotCount; Rank++) {
+    SmiStruct        = HotHandlers[Rank].SmiStruct;
+    SmiHandlerStruct = HotHandlers[Rank].SmiHandlerStruct;
+    Stats            = HotHandlers[Rank].Stats;
+    Print (L"  <HotSmiHandler Rank=\"%d\"", Rank + 1);
+    if (!IsZeroGuid (&SmiStruct->HandlerType)) {
+      Print (L" HandlerType=\"%g\"", &SmiStruct->HandlerType);
+    }
+
+    Print (L">\n");
+    ImageStruct = GetImageFromRef ((UINTN)SmiHandlerStruct->ImageRef);
+    if (ImageStruct != NULL) {
+      NameString = GetDriverNameString (ImageStruct);
+      Print (L"    <Module RefId=\"0x%x\" Name=\"%a\"/>\n", SmiHandlerStruct->ImageRef, NameString);
+    }
+
+    Print (L"    <Handler Address=\"0x%lx\"/>\n", SmiHandlerStruct->Handler);
+    Print (
+      L"    <Cycles Total=\"%ld\" Max=\"%ld\" Average=\"%ld\"/>\n",
+      Stats->TotalCycles,
+      Stats->MaxCycles,
+      DivU64x64Remainder (Stats->TotalCycles, Stats->Calls, NULL)
+      );
+    Print (L"    <Calls Total=\"%ld\"", Stats->Calls);
+    Print (L" Success=\"%ld\"", Stats->StatusCount[MMI_HANDLER_STATUS_SUCCESS]);
+    Print (L" Quiesced=\"%ld\"", Stats->StatusCount[MMI_HANDLER_STATUS_QUIESCED]);
+    Print (L" SourcePending=\"%ld\"", Stats->StatusCount[MMI_HANDLER_STATUS_SOURCE_PENDING]);
+    Print (L" InterruptPending=\"%ld\"", Stats->StatusCount[MMI_HANDLER_STATUS_INTERRUPT_PENDING]);
+    Print (L" Other=\"%ld\"/>\n", Stats->StatusCount[MMI_HANDLER_STATUS_OTHER]);
+    Print (L"  </HotSmiHandler>\n");
+  }
+
+  FreePool (HotHandlers);
+}
+
 /**
   The Entry Point for SMI handler profile info application.
 
@@ -708,7 +839,15 @@ MmiHandlerProfileInfoEntrypoint (
   DumpSmiHandler (SmmCoreSmiHandlerCategoryHardwareHandler);
   Print (L"  </SmiHandlerCategory>\n\n");
 
-  Print (L"</SmiHandlerDatabase>\n");
+  Print (L"</SmiHandlerDatabase>\n\n");
+
+  //
+  // Dump SMI handlers ranked by the cycles spent in them
+  //
+  Print (L"<HotSmiHandlers>\n");
+  Print (L"  <!-- SMI Handler called, hottest first -->\n");
+  DumpHotSmiHandlers ();
+  Print (L"</HotSmiHandlers>\n");
   Print (L"</SmiHandlerProfile>\n");
 
   if (mSmiHandlerProfileDatabase != NULL) {